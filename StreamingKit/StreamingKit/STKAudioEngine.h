@@ -0,0 +1,58 @@
+//
+//  STKAudioEngine.h
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <AudioToolbox/AudioToolbox.h>
+#import "STKAudioPlayerStatistics.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+///
+/// A single output unit and multichannel mixer shared by players created with -[STKAudioPlayer initWithOptions:engine:].
+/// Each player renders into its own mixer input bus with its own volume, pan and frame filters and every bus is
+/// mixed in the one render cycle of the output unit, so any number of players cost one output unit and one render thread.
+/// Players attached to an engine decode at the engine's sample rate and have no equalizer or playback rate.
+///
+@interface STKAudioEngine : NSObject
+
+/// The sample rate of the mix and of every attached player
+@property (readonly) Float64 sampleRate;
+/// The number of mixer input buses which is the most players that can be attached at once
+@property (readonly) UInt32 maximumInputCount;
+/// The number of players attached
+@property (readonly) UInt32 inputCount;
+/// The volume of the mix (Default is 1)
+@property (readwrite) Float32 volume;
+@property (readonly) BOOL running;
+
+/// Initializes an engine with 8 inputs at 44.1kHz
+-(instancetype) init;
+/// Initializes an engine with the given number of inputs at the given sample rate (0 for 44.1kHz)
+-(instancetype) initWithSampleRate:(Float64)sampleRate maximumInputCount:(UInt32)maximumInputCount;
+
+/// Starts the output. Players start it when they start playing so this only needs to be called to start it early
+-(BOOL) start;
+/// Stops the output. Attached players are silent until it's started again
+-(void) stop;
+
+/// Nanoseconds spent rendering the whole mix in each render cycle (all attached players included)
+-(STKAudioPlayerHistogram*) renderDuration;
+-(void) resetStatistics;
+
+/// Claims a free mixer input bus which is rendered by callback in the given format. Returns NO if every bus is in use or
+/// the mixer doesn't accept the format. Used by STKAudioPlayer
+-(BOOL) attachInputWithCallback:(AURenderCallbackStruct)callback format:(const AudioStreamBasicDescription*)format bus:(UInt32*)bus;
+/// Releases a bus claimed with attachInputWithCallback:format:bus:. The callback is no longer called once this returns
+-(void) detachInputFromBus:(UInt32)bus;
+/// Sets the volume (0 - 1) of an input bus
+-(void) setVolume:(Float32)volume forBus:(UInt32)bus;
+/// Sets the pan (-1 left to 1 right) of an input bus
+-(void) setPan:(Float32)pan forBus:(UInt32)bus;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,331 @@
+//
+//  STKAudioEngine.m
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import "STKAudioEngine.h"
+#import <pthread.h>
+#import <mach/mach_time.h>
+
+#define STK_ENGINE_DEFAULT_SAMPLE_RATE (44100.0)
+#define STK_ENGINE_DEFAULT_MAXIMUM_INPUT_COUNT (8)
+
+#define kOutputBus 0
+
+static UInt32 maxFramesPerSlice = 4096;
+static mach_timebase_info_data_t machTimebaseInfo;
+
+@interface STKAudioEngine()
+{
+    AUGraph audioGraph;
+    AUNode outputNode;
+    AUNode mixerNode;
+    AudioComponentInstance outputUnit;
+    AudioComponentInstance mixerUnit;
+
+    /// Guards the graph and busInUse
+    pthread_mutex_t engineMutex;
+    BOOL* busInUse;
+
+    Float32 volume;
+    STKHistogram renderDuration;
+    /// Render thread only
+    uint64_t renderStart;
+}
+@end
+
+@implementation STKAudioEngine
+
++(void) initialize
+{
+    mach_timebase_info(&machTimebaseInfo);
+}
+
+static OSStatus EngineRenderNotify(void* inRefCon, AudioUnitRenderActionFlags* ioActionFlags, const AudioTimeStamp* inTimeStamp, UInt32 inBusNumber, UInt32 inNumberFrames, AudioBufferList* ioData)
+{
+    STKAudioEngine* engine = (__bridge STKAudioEngine*)inRefCon;
+
+    if (*ioActionFlags & kAudioUnitRenderAction_PreRender)
+    {
+        engine->renderStart = mach_absolute_time();
+    }
+    else if ((*ioActionFlags & kAudioUnitRenderAction_PostRender) && engine->renderStart != 0)
+    {
+        uint64_t elapsed = mach_absolute_time() - engine->renderStart;
+
+        STKHistogramRecord(&engine->renderDuration, elapsed * machTimebaseInfo.numer / machTimebaseInfo.denom);
+    }
+
+    return 0;
+}
+
+-(instancetype) init
+{
+    return [self initWithSampleRate:0 maximumInputCount:0];
+}
+
+-(instancetype) initWithSampleRate:(Float64)sampleRateIn maximumInputCount:(UInt32)maximumInputCountIn
+{
+    if (self = [super init])
+    {
+        _sampleRate = sampleRateIn > 0 ? sampleRateIn : STK_ENGINE_DEFAULT_SAMPLE_RATE;
+        _maximumInputCount = maximumInputCountIn > 0 ? maximumInputCountIn : STK_ENGINE_DEFAULT_MAXIMUM_INPUT_COUNT;
+
+        volume = 1.0;
+        busInUse = calloc(_maximumInputCount, sizeof(BOOL));
+
+        pthread_mutex_init(&engineMutex, NULL);
+
+        if (![self createAudioGraph])
+        {
+            return nil;
+        }
+    }
+
+    return self;
+}
+
+-(void) dealloc
+{
+    if (audioGraph)
+    {
+        AUGraphStop(audioGraph);
+        AUGraphUninitialize(audioGraph);
+        AUGraphClose(audioGraph);
+        DisposeAUGraph(audioGraph);
+
+        audioGraph = nil;
+    }
+
+    free(busInUse);
+
+    pthread_mutex_destroy(&engineMutex);
+}
+
+#define CHECK_STATUS_AND_RETURN_NO(call) \
+    if ((status = (call))) \
+    { \
+        NSLog(@"STKAudioEngine: %s failed (%d)", #call, (int)status); \
+        return NO; \
+    }
+
+-(BOOL) createAudioGraph
+{
+    OSStatus status;
+
+    AudioComponentDescription outputUnitDescription =
+    {
+        .componentType = kAudioUnitType_Output,
+#if TARGET_OS_IPHONE
+        .componentSubType = kAudioUnitSubType_RemoteIO,
+#else
+        .componentSubType = kAudioUnitSubType_DefaultOutput,
+#endif
+        .componentManufacturer = kAudioUnitManufacturer_Apple
+    };
+
+    AudioComponentDescription mixerDescription =
+    {
+        .componentType = kAudioUnitType_Mixer,
+        .componentSubType = kAudioUnitSubType_MultiChannelMixer,
+        .componentManufacturer = kAudioUnitManufacturer_Apple
+    };
+
+    CHECK_STATUS_AND_RETURN_NO(NewAUGraph(&audioGraph));
+    CHECK_STATUS_AND_RETURN_NO(AUGraphOpen(audioGraph));
+
+    CHECK_STATUS_AND_RETURN_NO(AUGraphAddNode(audioGraph, &outputUnitDescription, &outputNode));
+    CHECK_STATUS_AND_RETURN_NO(AUGraphNodeInfo(audioGraph, outputNode, NULL, &outputUnit));
+    CHECK_STATUS_AND_RETURN_NO(AUGraphAddNode(audioGraph, &mixerDescription, &mixerNode));
+    CHECK_STATUS_AND_RETURN_NO(AUGraphNodeInfo(audioGraph, mixerNode, NULL, &mixerUnit));
+
+#if TARGET_OS_IPHONE
+    UInt32 flag = 1;
+
+    CHECK_STATUS_AND_RETURN_NO(AudioUnitSetProperty(outputUnit, kAudioOutputUnitProperty_EnableIO, kAudioUnitScope_Output, kOutputBus, &flag, sizeof(flag)));
+#endif
+
+    CHECK_STATUS_AND_RETURN_NO(AudioUnitSetProperty(mixerUnit, kAudioUnitProperty_MaximumFramesPerSlice, kAudioUnitScope_Global, 0, &maxFramesPerSlice, sizeof(maxFramesPerSlice)));
+    CHECK_STATUS_AND_RETURN_NO(AudioUnitSetProperty(mixerUnit, kAudioUnitProperty_ElementCount, kAudioUnitScope_Input, 0, &_maximumInputCount, sizeof(_maximumInputCount)));
+    CHECK_STATUS_AND_RETURN_NO(AudioUnitSetProperty(mixerUnit, kAudioUnitProperty_SampleRate, kAudioUnitScope_Output, 0, &_sampleRate, sizeof(_sampleRate)));
+
+    // Buses without a player are skipped by the mixer
+
+    for (UInt32 i = 0; i < _maximumInputCount; i++)
+    {
+        CHECK_STATUS_AND_RETURN_NO(AudioUnitSetParameter(mixerUnit, kMultiChannelMixerParam_Enable, kAudioUnitScope_Input, i, 0, 0));
+    }
+
+    CHECK_STATUS_AND_RETURN_NO(AUGraphConnectNodeInput(audioGraph, mixerNode, 0, outputNode, 0));
+    CHECK_STATUS_AND_RETURN_NO(AudioUnitAddRenderNotify(outputUnit, EngineRenderNotify, (__bridge void*)self));
+    CHECK_STATUS_AND_RETURN_NO(AUGraphInitialize(audioGraph));
+
+    return YES;
+}
+
+-(BOOL) running
+{
+    Boolean isRunning;
+
+    pthread_mutex_lock(&engineMutex);
+    OSStatus status = AUGraphIsRunning(audioGraph, &isRunning);
+    pthread_mutex_unlock(&engineMutex);
+
+    return status == 0 && isRunning;
+}
+
+-(BOOL) start
+{
+    OSStatus status = 0;
+    Boolean isRunning;
+
+    pthread_mutex_lock(&engineMutex);
+
+    if (AUGraphIsRunning(audioGraph, &isRunning) != 0 || !isRunning)
+    {
+        status = AUGraphStart(audioGraph);
+    }
+
+    pthread_mutex_unlock(&engineMutex);
+
+    return status == 0;
+}
+
+-(void) stop
+{
+    pthread_mutex_lock(&engineMutex);
+    AUGraphStop(audioGraph);
+    pthread_mutex_unlock(&engineMutex);
+}
+
+-(UInt32) inputCount
+{
+    UInt32 retval = 0;
+
+    pthread_mutex_lock(&engineMutex);
+
+    for (UInt32 i = 0; i < _maximumInputCount; i++)
+    {
+        retval += busInUse[i] ? 1 : 0;
+    }
+
+    pthread_mutex_unlock(&engineMutex);
+
+    return retval;
+}
+
+-(Float32) volume
+{
+    return volume;
+}
+
+-(void) setVolume:(Float32)value
+{
+    volume = value;
+
+    AudioUnitSetParameter(mixerUnit, kMultiChannelMixerParam_Volume, kAudioUnitScope_Output, 0, value, 0);
+}
+
+-(BOOL) attachInputWithCallback:(AURenderCallbackStruct)callback format:(const AudioStreamBasicDescription*)format bus:(UInt32*)bus
+{
+    OSStatus status;
+    UInt32 i;
+
+    pthread_mutex_lock(&engineMutex);
+
+    for (i = 0; i < _maximumInputCount; i++)
+    {
+        if (!busInUse[i])
+        {
+            break;
+        }
+    }
+
+    if (i == _maximumInputCount)
+    {
+        pthread_mutex_unlock(&engineMutex);
+
+        return NO;
+    }
+
+    // The bus is disabled so the format can change while the rest of the mix plays
+
+    status = AudioUnitSetProperty(mixerUnit, kAudioUnitProperty_StreamFormat, kAudioUnitScope_Input, i, format, sizeof(*format));
+
+    if (status == 0)
+    {
+        status = AUGraphSetNodeInputCallback(audioGraph, mixerNode, i, &callback);
+    }
+
+    if (status == 0)
+    {
+        status = AUGraphUpdate(audioGraph, NULL);
+    }
+
+    if (status)
+    {
+        NSLog(@"STKAudioEngine: Can't attach an input with this format (%d)", (int)status);
+
+        pthread_mutex_unlock(&engineMutex);
+
+        return NO;
+    }
+
+    AudioUnitSetParameter(mixerUnit, kMultiChannelMixerParam_Volume, kAudioUnitScope_Input, i, 1.0, 0);
+    AudioUnitSetParameter(mixerUnit, kMultiChannelMixerParam_Pan, kAudioUnitScope_Input, i, 0, 0);
+    AudioUnitSetParameter(mixerUnit, kMultiChannelMixerParam_Enable, kAudioUnitScope_Input, i, 1, 0);
+
+    busInUse[i] = YES;
+    *bus = i;
+
+    pthread_mutex_unlock(&engineMutex);
+
+    return YES;
+}
+
+-(void) detachInputFromBus:(UInt32)bus
+{
+    pthread_mutex_lock(&engineMutex);
+
+    if (bus >= _maximumInputCount || !busInUse[bus])
+    {
+        pthread_mutex_unlock(&engineMutex);
+
+        return;
+    }
+
+    AudioUnitSetParameter(mixerUnit, kMultiChannelMixerParam_Enable, kAudioUnitScope_Input, bus, 0, 0);
+    AUGraphDisconnectNodeInput(audioGraph, mixerNode, bus);
+
+    // Blocks until the render thread has picked up the change so the callback's context can go away
+
+    AUGraphUpdate(audioGraph, NULL);
+
+    busInUse[bus] = NO;
+
+    pthread_mutex_unlock(&engineMutex);
+}
+
+-(void) setVolume:(Float32)value forBus:(UInt32)bus
+{
+    AudioUnitSetParameter(mixerUnit, kMultiChannelMixerParam_Volume, kAudioUnitScope_Input, bus, value, 0);
+}
+
+-(void) setPan:(Float32)pan forBus:(UInt32)bus
+{
+    AudioUnitSetParameter(mixerUnit, kMultiChannelMixerParam_Pan, kAudioUnitScope_Input, bus, pan, 0);
+}
+
+-(STKAudioPlayerHistogram*) renderDuration
+{
+    return [[STKAudioPlayerHistogram alloc] initWithHistogram:&renderDuration];
+}
+
+-(void) resetStatistics
+{
+    STKHistogramReset(&renderDuration);
+}
+
+@end
@@ -38,6 +38,8 @@
 #import <Foundation/Foundation.h>
 #import <pthread.h>
 #import "STKDataSource.h"
+#import "STKAudioPlayerStatistics.h"
+#import "STKAudioEngine.h"
 #import <AudioToolbox/AudioToolbox.h>
 
 #if TARGET_OS_IPHONE
@@ -79,6 +81,24 @@ typedef NS_ENUM(NSInteger, STKAudioPlayerErrorCode)
     STKAudioPlayerErrorOther = 0xffff
 };
 
+typedef NS_ENUM(NSInteger, STKAudioPlayerSampleRate)
+{
+	/// Decode everything to 44.1kHz
+	STKAudioPlayerSampleRateDefault = 0,
+	/// Decode to the sample rate of the output hardware when the player is created
+	STKAudioPlayerSampleRateHardware,
+	/// Decode to the sample rate of the item that starts playback. Items queued behind it are converted to that rate
+	STKAudioPlayerSampleRateSource
+};
+
+typedef NS_ENUM(NSInteger, STKAudioPlayerSampleFormat)
+{
+	/// Signed 16-bit integer samples
+	STKAudioPlayerSampleFormatInt16 = 0,
+	/// 32-bit floating point samples
+	STKAudioPlayerSampleFormatFloat32
+};
+
 ///
 /// Options to initiailise the Audioplayer with.
 /// By default if you set buffer size or seconds to 0, the non-zero default will be used
@@ -90,11 +110,12 @@ typedef struct
     BOOL flushQueueOnSeek;
     /// If YES then volume control will be enabled on iOS
     BOOL enableVolumeMixer;
-    /// A pointer to a 0 terminated array of band frequencies (iOS 5.0 and later, OSX 10.9 and later)
+    /// A 0 terminated array of up to 24 band frequencies. Each band is a half octave wide peaking filter run on the render thread
     Float32 equalizerBandFrequencies[24];
 	/// The size of the internal I/O read buffer. This data in this buffer is transient and does not need to be larger.
     UInt32 readBufferSize;
-    /// The size of the decompressed buffer (Default is 10 seconds which uses about 1.7MB of RAM)
+    /// The size of the decompressed buffer (Default is 10 seconds which uses about 1.7MB of RAM). With compressedBuffering it's
+    /// the total of the compressed and decompressed audio buffered
     Float32 bufferSizeInSeconds;
     /// Number of seconds of decompressed audio is required before playback first starts for each item (Default is 0.5 seconds. Must be larger than bufferSizeInSeconds)
     Float32 secondsRequiredToStartPlaying;
@@ -102,16 +123,72 @@ typedef struct
     Float32 gracePeriodAfterSeekInSeconds;
     /// Number of seconds of decompressed audio required before playback resumes after a buffer underrun (Default is 5 seconds. Must be larger than bufferSizeinSeconds)
     Float32 secondsRequiredToStartPlayingAfterBufferUnderun;
+    /// The sample rate of the decoded PCM pipeline (Default is 44.1kHz)
+    STKAudioPlayerSampleRate pcmSampleRate;
+    /// The sample format of the decoded PCM pipeline used by the buffer, frame filters, metering and recording (Default is Int16)
+    STKAudioPlayerSampleFormat pcmSampleFormat;
+    /// If YES each channel of the decoded PCM pipeline is kept in its own buffer (Default is NO)
+    BOOL pcmNonInterleaved;
+    /// Number of seconds of the next queued item to decode ahead while the current item plays so it starts without a gap (Default is 0 which disables decoding ahead)
+    Float32 secondsToPreDecodeNextItem;
+    /// Number of seconds over which the end of an item is crossfaded with the start of the next item (Default is 0 for no crossfade)
+    Float32 crossfadeDurationInSeconds;
+    /// Number of pending items whose connections are opened and first bytes read ahead of time so they start from memory (Default is 0 which disables prefetching)
+    UInt32 prefetchQueueItemCount;
+    /// Number of kilobytes read ahead for each prefetched item. More is read if needed to reach the audio data (Default is 64KB)
+    UInt32 prefetchSizeInKB;
+    /// Maximum number of kilobytes held by all prefetched items (Default is 1MB)
+    UInt32 prefetchMemoryLimitInKB;
+    /// If YES the seconds required to start playing and to resume after a buffer underrun are scaled for each item by how
+    /// fast its data source downloads compared to its bit rate. Fast links start sooner and slow links buffer more (Default is NO)
+    BOOL adaptiveBuffering;
+    /// If YES the player creates no audio graph and plays nothing. Decoded frames are pulled with renderFrames:count: as fast as
+    /// they can be decoded. The volume and playback rate belong to the graph so they don't apply and
+    /// STKAudioPlayerSampleRateHardware decodes at the default sample rate (Default is NO)
+    BOOL offlineRendering;
+    /// Number of kilobytes of compressed packets read ahead of the decoder. The network keeps being read into this queue
+    /// while the decompressed buffer is full and already downloaded packets keep being decoded while the network stalls (Default is 512KB)
+    UInt32 packetQueueSizeInKB;
+    /// If YES most of bufferSizeInSeconds is held as compressed packets in the packet queue and only pcmWindowInSeconds of it
+    /// is decoded ahead of playback, which takes a fraction of the memory for long buffers. The seconds required to start playing
+    /// and to resume after a buffer underrun count both. The packet queue is sized for at least 128kbps (Default is NO)
+    BOOL compressedBuffering;
+    /// Seconds of decompressed audio kept ahead of playback when compressedBuffering is YES. It's raised to fit two
+    /// crossfades (Default is 1 second)
+    Float32 pcmWindowInSeconds;
+    /// If YES a data source's recordToFileUrl gets the stream's compressed packets as they are (in a CAF file) rather than
+    /// the decoded audio re-encoded as AAC. Streams whose packets can't be stored fall back to re-encoding (Default is NO)
+    BOOL recordCompressedPassthrough;
+    /// If YES decoding sleeps until playback drains the decompressed buffer below burstLowWatermark and then refills it to
+    /// burstHighWatermark in one go, and reading waits for the packet queue to drain below burstLowWatermark before it
+    /// resumes. Fewer and longer wakeups let the CPU stay idle for longer during background playback (Default is NO)
+    BOOL burstDecoding;
+    /// Fraction (0 - 1) of the decompressed buffer (and the packet queue) below which burstDecoding refills (Default is 0.25)
+    Float32 burstLowWatermark;
+    /// Fraction (0 - 1) of the decompressed buffer that burstDecoding refills up to (Default is 1)
+    Float32 burstHighWatermark;
+    /// If YES file URLs passed to play and queue are read through a memory mapping (STKMappedFileDataSource) rather than
+    /// a stream. Only for files nothing truncates while they play: reading a page cut off from the file crashes the app (Default is NO)
+    BOOL mapLocalFiles;
 }
 STKAudioPlayerOptions;
 
 #define STK_DISABLE_BUFFER (0xffffffff)
 
+/// Frames are in the format returned by the player's canonicalAudioStreamBasicDescription. For interleaved formats
+/// frames points to the samples. For non-interleaved formats frames points to an AudioBufferList with one buffer
+/// per channel and bytesPerFrame is the size of a single sample.
 typedef void(^STKFrameFilter)(UInt32 channelsPerFrame, UInt32 bytesPerFrame, UInt32 frameCount, void* frames);
 
+/// Frame filter invoked directly on the audio render thread. Implementations must be real-time safe
+/// (no locks, allocations or Objective-C messaging). The context is passed through unchanged and frames are laid out as for STKFrameFilter.
+typedef void(*STKFrameFilterFunction)(void* _Nullable context, UInt32 channelsPerFrame, UInt32 bytesPerFrame, UInt32 frameCount, void* frames);
+
 @interface STKFrameFilterEntry : NSObject
 @property (readonly) NSString* name;
 @property (readonly) STKFrameFilter filter;
+@property (readonly) STKFrameFilterFunction function;
+@property (readonly, nullable) void* context;
 @end
 
 @class STKAudioPlayer;
@@ -138,6 +215,10 @@ typedef void(^STKFrameFilter)(UInt32 channelsPerFrame, UInt32 bytesPerFrame, UIn
 /// Raised when datasource read stream metadata. Called from the non-main thread.
 -(void) audioPlayer:(STKAudioPlayer*)audioPlayer didReadStreamMetadata:(NSDictionary*)dictionary;
 
+/// Raised once per item when its first decoded frames are queued for playback.
+/// timeToFirstSample is the number of seconds since the player started reading the item (for items decoded ahead this is from when the item was needed)
+-(void) audioPlayer:(STKAudioPlayer*)audioPlayer didQueueFirstFramesOfQueueItemId:(NSObject*)queueItemId timeToFirstSample:(double)timeToFirstSample;
+
 @end
 
 @interface STKAudioPlayer : NSObject<STKDataSourceDelegate>
@@ -145,6 +226,11 @@ typedef void(^STKFrameFilter)(UInt32 channelsPerFrame, UInt32 bytesPerFrame, UIn
 /// Gets or sets the volume (ranges 0 - 1.0).
 /// On iOS the STKAudioPlayerOptionEnableMultichannelMixer option must be enabled for volume to work.
 @property (readwrite) Float32 volume;
+/// Gets or sets the pan from -1 (left) to 1 (right) (default is 0).
+/// Applies to players attached to an STKAudioEngine and players created with the enableVolumeMixer option.
+@property (readwrite) Float32 pan;
+/// Gets the engine the player renders into or nil if it has its own audio graph
+@property (readonly, nullable) STKAudioEngine* engine;
 /// Gets or sets the player muted state
 @property (readwrite) BOOL muted;
 /// Gets the current item duration in seconds
@@ -157,11 +243,12 @@ typedef void(^STKFrameFilter)(UInt32 channelsPerFrame, UInt32 bytesPerFrame, UIn
 @property(readwrite) float overlap;
 /// Enables or disables peak and average decibel meteting
 @property (readwrite) BOOL meteringEnabled;
-/// Enables or disables the EQ
+/// Enables or disables the EQ. The bands fade in and out rather than switching
 @property (readwrite) BOOL equalizerEnabled;
 /// Returns an array of STKFrameFilterEntry objects representing the filters currently in use
 @property (readonly, nullable) NSArray* frameFilters;
-/// Returns the items pending to be played (includes buffering and upcoming items but does not include the current item)
+/// Returns the items pending to be played (includes buffering and upcoming items but does not include the current item).
+/// The array is kept until the queue changes so reading it again is cheap and doesn't wait on the player
 @property (readonly) NSArray* pendingQueue;
 /// The number of items pending to be played (includes buffering and upcoming items but does not include the current item)
 @property (readonly) NSUInteger pendingQueueCount;
@@ -175,6 +262,13 @@ typedef void(^STKFrameFilter)(UInt32 channelsPerFrame, UInt32 bytesPerFrame, UIn
 @property (readonly) STKAudioPlayerStopReason stopReason;
 /// Gets and sets the delegate used for receiving events from the STKAudioPlayer
 @property (readwrite, weak) id<STKAudioPlayerDelegate> delegate;
+/// Gets or sets the dispatch queue delegate callbacks are delivered on (default is nil). When nil the playback thread waits
+/// for most callbacks to run on the main thread. When set, the player never waits: callbacks are delivered in order,
+/// state changes that happen while earlier callbacks are waiting are merged and stream metadata is dropped if too many are
+/// waiting (see STKAudioPlayerStatistics.delegateCallbacksDropped). Other callbacks are never dropped
+@property (readwrite, strong, nullable) dispatch_queue_t delegateQueue;
+/// Gets or sets the directory where seek indexes for variable bit rate streams are kept between sessions (default is nil which keeps them in memory only)
+@property (readwrite, copy, nullable) NSURL* seekIndexDirectoryUrl;
 
 /// Creates a datasource from a given URL.
 /// URLs with FILE schemes will return an STKLocalFileDataSource.
@@ -182,15 +276,24 @@ typedef void(^STKFrameFilter)(UInt32 channelsPerFrame, UInt32 bytesPerFrame, UIn
 /// URLs with unrecognised schemes will return nil.
 +(STKDataSource*) dataSourceFromURL:(NSURL*)url;
 
-/// Returns canonical audio format used by STKFrameFilter blocks.
+/// Returns the default canonical audio format used by STKFrameFilter blocks (44.1kHz interleaved Int16 stereo).
 +(AudioStreamBasicDescription)canonicalAudioStreamBasicDescription;
 
+/// Returns the canonical audio format this player decodes to and passes to STKFrameFilter blocks.
+/// The sample rate may change between items if the player was created with STKAudioPlayerSampleRateSource.
+-(AudioStreamBasicDescription)canonicalAudioStreamBasicDescription;
+
 /// Initializes a new STKAudioPlayer with the default options
 -(instancetype) init;
 
 /// Initializes a new STKAudioPlayer with the given options
 -(instancetype) initWithOptions:(STKAudioPlayerOptions)optionsIn;
 
+/// Initializes a new STKAudioPlayer that renders into an input of the given engine instead of creating its own audio graph.
+/// The player decodes at the engine's sample rate. The playback rate doesn't apply. If the engine has no free
+/// inputs the player creates its own audio graph
+-(instancetype) initWithOptions:(STKAudioPlayerOptions)optionsIn engine:(nullable STKAudioEngine*)engineIn;
+
 /// Plays an item from the given URL string (all pending queued items are removed).
 /// The NSString is used as the queue item ID
 -(void) play:(NSString*)urlString;
@@ -227,6 +330,13 @@ typedef void(^STKFrameFilter)(UInt32 channelsPerFrame, UInt32 bytesPerFrame, UIn
 /// Queues a DataSource with the given queueItemId
 -(void) queueDataSource:(STKDataSource*)dataSource withQueueItemId:(NSObject*)queueItemId;
 
+/// Queues DataSources with the given queueItemIds (one per DataSource) in order. Cheaper than queueing them one at a time
+-(void) queueDataSources:(NSArray<STKDataSource*>*)dataSources withQueueItemIds:(NSArray<NSObject*>*)queueItemIds;
+
+/// Removes the least recently queued upcoming item with the given queueItemId. Items already buffering aren't removed.
+/// Returns NO if there's no such item
+-(BOOL) removeQueuedItemWithId:(NSObject*)queueItemId;
+
 /// Plays the given item (all pending queued items are removed)
 -(void) setDataSource:(STKDataSource*)dataSourceIn withQueueItemId:(NSObject*)queueItemId;
 
@@ -268,17 +378,41 @@ typedef void(^STKFrameFilter)(UInt32 channelsPerFrame, UInt32 bytesPerFrame, UIn
 /// If the given name is nil, the filter will be inserted at the beginning of the filter change
 -(void) addFrameFilterWithName:(NSString*)name afterFilterWithName:(nullable NSString*)afterFilterWithName block:(STKFrameFilter)block;
 
-/// Reads the peak power in decibals for the given channel (0 or 1).
-/// Return values are between -60 (low) and 0 (high).
+/// Appends a frame filter with the given name and C function to the end of the filter chain.
+/// The context must remain valid until the filter is removed or the player is deallocated
+-(void) appendFrameFilterWithName:(NSString*)name function:(STKFrameFilterFunction)function context:(nullable void*)context;
+
+/// Adds a frame filter with the given name and C function just after the filter with the given name.
+/// If the given name is nil, the filter will be inserted at the beginning of the filter change
+-(void) addFrameFilterWithName:(NSString*)name afterFilterWithName:(nullable NSString*)afterFilterWithName function:(STKFrameFilterFunction)function context:(nullable void*)context;
+
+/// Reads the peak power in decibals (dBFS) of the most recently rendered block for the given channel (0 based).
+/// Return values are between -60 (low) and 0 (high) and -60 for channels the player doesn't have.
+/// Values are true dBFS of the block with no smoothing, so a full scale sine peaks at 0 and averages -3. Versions before
+/// the vectorized meter returned the peak and mean of a slow low-pass envelope offset by -74dB, which rose gradually
+/// within each block and read 0 for most music. Smooth the values yourself if you relied on that.
 -(float) peakPowerInDecibelsForChannel:(NSUInteger)channelNumber;
 
-/// Reads the average power in decibals for the given channel (0 or 1)
-/// Return values are between -60 (low) and 0 (high).
+/// Reads the average (RMS) power in decibals (dBFS) of the most recently rendered block for the given channel (0 based).
+/// Return values are between -60 (low) and 0 (high) and -60 for channels the player doesn't have (see peakPowerInDecibelsForChannel:).
 -(float) averagePowerInDecibelsForChannel:(NSUInteger)channelNumber;
 
-/// Sets the gain value (from -96 low to +24 high) for an equalizer band (0 based index)
+/// Sets the gain value (from -96 low to +24 high) for an equalizer band (0 based index). Safe to call from any thread
+/// and the gain moves to the new value over a few milliseconds
 -(void) setGain:(float)gain forEqualizerBand:(int)bandIndex;
 
+/// Renders up to frameCount (at most 4096) frames into bufferList when the player was created with the offlineRendering option.
+/// The frames go through the frame filters and are in the player's canonicalAudioStreamBasicDescription format with one buffer per plane.
+/// Blocks until the frames have been decoded and returns the number rendered which may be fewer at the end of an item.
+/// Returns 0 when there is nothing left to play or the player is paused or stopped. Call from one thread at a time
+-(UInt32) renderFrames:(AudioBufferList*)bufferList count:(UInt32)frameCount;
+
+/// Returns a snapshot of the player's playback statistics. Safe to call from any thread at any time
+-(STKAudioPlayerStatistics*) statistics;
+
+/// Resets the player's playback statistics to zero
+-(void) resetStatistics;
+
 @end
 
 NS_ASSUME_NONNULL_END
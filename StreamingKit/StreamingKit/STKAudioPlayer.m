@@ -37,34 +37,60 @@
 #import "STKHTTPDataSource.h"
 #import "STKAutoRecoveringHTTPDataSource.h"
 #import "STKLocalFileDataSource.h"
+#import "STKMappedFileDataSource.h"
+#import "STKPrefetchingDataSource.h"
+#import "STKBandwidthEstimator.h"
+#import "STKAudioPlayerStatistics.h"
+#import "STKPacketQueue.h"
+#import "STKRecordingWriter.h"
+#import "STKDelegateDispatcher.h"
 #import "STKQueueEntry.h"
-#import "NSMutableArray+STKAudioPlayer.h"
+#import "STKEntryQueue.h"
+#import "STKRingBuffer.h"
+#import "STKFrameFilterChain.h"
+#import "STKMeter.h"
+#import "STKEqualizer.h"
 #import "libkern/OSAtomic.h"
-#import <float.h>
-
-#ifndef DBL_MAX
-#define DBL_MAX 1.7976931348623157e+308
-#endif
+#import <CommonCrypto/CommonDigest.h>
+#import <mach/mach_time.h>
+#import <mach/message.h>
 
 #pragma mark Defines
 
 #define kOutputBus 0
 #define kInputBus 1
 
-#define STK_DBMIN (-60)
-#define STK_DBOFFSET (-74.0)
-#define STK_LOWPASSFILTERTIMESLICE (0.0005)
 
 #define STK_DEFAULT_PCM_BUFFER_SIZE_IN_SECONDS (10)
 #define STK_DEFAULT_SECONDS_REQUIRED_TO_START_PLAYING (1)
 #define STK_DEFAULT_SECONDS_REQUIRED_TO_START_PLAYING_AFTER_BUFFER_UNDERRUN (7.5)
 #define STK_MAX_COMPRESSED_PACKETS_FOR_BITRATE_CALCULATION (4096)
 #define STK_DEFAULT_READ_BUFFER_SIZE (64 * 1024)
+#define STK_OFFLINE_RENDER_WAIT_NANOSECONDS (10 * NSEC_PER_MSEC)
 #define STK_DEFAULT_PACKET_BUFFER_SIZE (2048)
 #define STK_DEFAULT_GRACE_PERIOD_AFTER_SEEK_SECONDS (0.5)
-
-#define OSSTATUS_PRINTF_PLACEHOLDER @"%c%c%c%c"
-#define OSSTATUS_PRINTF_VALUE(status) (char)(((status) >> 24) & 0xFF), (char)(((status) >> 16) & 0xFF), (char)(((status) >> 8) & 0xFF), (char)((status) & 0xFF)
+#define STK_PRE_DECODE_READ_SIZE (4 * 1024)
+#define STK_DEFAULT_PREFETCH_SIZE_IN_KB (64)
+#define STK_DEFAULT_PREFETCH_MEMORY_LIMIT_IN_KB (1024)
+#define STK_ADAPTIVE_BUFFERING_MINIMUM_SECONDS (0.25)
+#define STK_ADAPTIVE_BUFFERING_MAXIMUM_BUFFER_FRACTION (0.75)
+#define STK_ADAPTIVE_BUFFERING_UNKNOWN_DURATION_SECONDS (60)
+#define STK_DEFAULT_PACKET_QUEUE_SIZE_IN_KB (512)
+/// Room always left in the packet queue for records that don't carry packets so they never have to wait
+#define STK_PACKET_QUEUE_HEADROOM (16 * 1024)
+/// Reads are limited to this fraction of the free space in the packet queue to allow for packet descriptions and wrapping
+#define STK_PACKET_QUEUE_READ_FRACTION (4)
+#define STK_PACKET_QUEUE_MINIMUM_READ_SIZE (2 * 1024)
+#define STK_RENDER_EVENT_QUEUE_SIZE (4 * 1024)
+/// Delegate callbacks waiting on the delegateQueue beyond this are dropped
+#define STK_DELEGATE_CALLBACK_LIMIT (256)
+#define STK_DEFAULT_PCM_WINDOW_IN_SECONDS (1)
+#define STK_DEFAULT_BURST_LOW_WATERMARK (0.25)
+#define STK_DEFAULT_BURST_HIGH_WATERMARK (1.0)
+/// The packet queue holds bufferSizeInSeconds of compressed audio at up to this bit rate when compressedBuffering is YES
+#define STK_COMPRESSED_BUFFERING_BYTES_PER_SECOND (128 * 1024 / 8)
+/// Bytes of audio a recording can fall behind by before blocks are dropped
+#define STK_RECORDING_QUEUE_SIZE (1024 * 1024)
 
 #define LOGINFO(x) [self logInfo:[NSString stringWithFormat:@"%s %@", sel_getName(_cmd), x]];
 
@@ -94,6 +120,36 @@ static void PopulateOptionsWithDefault(STKAudioPlayerOptions* options)
     {
         options->gracePeriodAfterSeekInSeconds = MIN(STK_DEFAULT_GRACE_PERIOD_AFTER_SEEK_SECONDS, options->bufferSizeInSeconds);
     }
+    
+    if (options->prefetchSizeInKB == 0)
+    {
+        options->prefetchSizeInKB = STK_DEFAULT_PREFETCH_SIZE_IN_KB;
+    }
+    
+    if (options->prefetchMemoryLimitInKB == 0)
+    {
+        options->prefetchMemoryLimitInKB = STK_DEFAULT_PREFETCH_MEMORY_LIMIT_IN_KB;
+    }
+    
+    if (options->packetQueueSizeInKB == 0)
+    {
+        options->packetQueueSizeInKB = STK_DEFAULT_PACKET_QUEUE_SIZE_IN_KB;
+    }
+    
+    if (options->pcmWindowInSeconds == 0)
+    {
+        options->pcmWindowInSeconds = STK_DEFAULT_PCM_WINDOW_IN_SECONDS;
+    }
+    
+    if (options->burstLowWatermark == 0)
+    {
+        options->burstLowWatermark = STK_DEFAULT_BURST_LOW_WATERMARK;
+    }
+    
+    if (options->burstHighWatermark == 0)
+    {
+        options->burstHighWatermark = STK_DEFAULT_BURST_HIGH_WATERMARK;
+    }
 }
 
 static void NormalizeDisabledBuffers(STKAudioPlayerOptions* options)
@@ -124,6 +180,45 @@ static void NormalizeDisabledBuffers(STKAudioPlayerOptions* options)
     }
 }
 
+static AudioStreamBasicDescription CanonicalAudioStreamBasicDescriptionWithFormat(Float64 sampleRate, STKAudioPlayerSampleFormat sampleFormat, BOOL nonInterleaved)
+{
+    const UInt32 channelsPerFrame = 2;
+    UInt32 bytesPerSample;
+    AudioFormatFlags formatFlags = kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsPacked;
+    
+    if (sampleFormat == STKAudioPlayerSampleFormatFloat32)
+    {
+        bytesPerSample = sizeof(Float32);
+        formatFlags |= kAudioFormatFlagIsFloat;
+    }
+    else
+    {
+        bytesPerSample = sizeof(SInt16);
+        formatFlags |= kAudioFormatFlagIsSignedInteger;
+    }
+    
+    // Non-interleaved formats describe a single channel buffer
+    
+    UInt32 bytesPerFrame = nonInterleaved ? bytesPerSample : bytesPerSample * channelsPerFrame;
+    
+    if (nonInterleaved)
+    {
+        formatFlags |= kAudioFormatFlagIsNonInterleaved;
+    }
+    
+    return (AudioStreamBasicDescription)
+    {
+        .mSampleRate = sampleRate,
+        .mFormatID = kAudioFormatLinearPCM,
+        .mFormatFlags = formatFlags,
+        .mFramesPerPacket = 1,
+        .mChannelsPerFrame = channelsPerFrame,
+        .mBytesPerFrame = bytesPerFrame,
+        .mBitsPerChannel = 8 * bytesPerSample,
+        .mBytesPerPacket = bytesPerFrame
+    };
+}
+
 #define CHECK_STATUS_AND_REPORT(call) \
 	if ((status = (call))) \
 	{ \
@@ -162,13 +257,57 @@ typedef enum
 }
 STKAudioPlayerInternalState;
 
+typedef enum
+{
+    /// Re-evaluate which processing nodes are needed and reconnect the graph
+    STKAudioPlayerGraphCommandReconnect = (1 << 0)
+}
+STKAudioPlayerGraphCommand;
+
+/// Records passed from the playback thread to the decode thread through the packet queue
+typedef enum
+{
+    /// Packets parsed for the entry in context. The payloads are the packet descriptions (if any) and the packet data
+    STKDecodeRecordPackets = 1,
+    /// count frames decoded ahead for the entry in context to move from the staging buffer into the PCM buffer
+    STKDecodeRecordStagedFrames,
+    /// Replaces the decoder's converter with the one in context. The payload is its input format
+    STKDecodeRecordConverter,
+    /// Resets the decoder's converter between items with the same format
+    STKDecodeRecordConverterReset,
+    /// Starts recording the entry in context
+    STKDecodeRecordStartRecording,
+    /// Everything for the entry in context has been queued
+    STKDecodeRecordEndOfEntry
+}
+STKDecodeRecordType;
+
+/// Events passed from the render thread to the playback thread through the render event queue
+typedef enum
+{
+    /// The last frame of the playing entry has been played. count is the generation of the playing entry
+    STKRenderEventEntryFinished = 1,
+    /// The render thread changed the state and the delegate needs telling
+    STKRenderEventStateChanged
+}
+STKRenderEventType;
+
 #pragma mark STKFrameFilterEntry
 
+static void STKFrameFilterBlockFunction(void* context, UInt32 channelsPerFrame, UInt32 bytesPerFrame, UInt32 frameCount, void* frames)
+{
+	__unsafe_unretained STKFrameFilter filter = (__bridge STKFrameFilter)context;
+	
+	filter(channelsPerFrame, bytesPerFrame, frameCount, frames);
+}
+
 @interface STKFrameFilterEntry()
 {
 @public
 	NSString* name;
 	STKFrameFilter filter;
+	STKFrameFilterFunction function;
+	void* context;
 }
 @end
 
@@ -179,6 +318,24 @@ STKAudioPlayerInternalState;
 	{
 		self->filter = [filterIn copy];
 		self->name = nameIn;
+		self->function = STKFrameFilterBlockFunction;
+		self->context = (__bridge void*)self->filter;
+	}
+	
+	return self;
+}
+
+-(instancetype) initWithFunction:(STKFrameFilterFunction)functionIn context:(void*)contextIn andName:(NSString*)nameIn
+{
+	if (self = [super init])
+	{
+		self->filter = ^(UInt32 channelsPerFrame, UInt32 bytesPerFrame, UInt32 frameCount, void* frames)
+		{
+			functionIn(contextIn, channelsPerFrame, bytesPerFrame, frameCount, frames);
+		};
+		self->name = nameIn;
+		self->function = functionIn;
+		self->context = contextIn;
 	}
 	
 	return self;
@@ -193,6 +350,16 @@ STKAudioPlayerInternalState;
 {
 	return self->filter;
 }
+
+-(STKFrameFilterFunction) function
+{
+	return self->function;
+}
+
+-(void*) context
+{
+	return self->context;
+}
 @end
 
 #pragma mark STKAudioPlayer
@@ -200,14 +367,13 @@ STKAudioPlayerInternalState;
 static UInt32 maxFramesPerSlice = 4096;
 
 static AudioComponentDescription mixerDescription;
-static AudioComponentDescription nbandUnitDescription;
 static AudioComponentDescription outputUnitDescription;
 static AudioComponentDescription convertUnitDescription;
 static AudioComponentDescription playbackRateUnitDescription;
-static AudioStreamBasicDescription canonicalAudioStreamBasicDescription;
-static AudioStreamBasicDescription recordAudioStreamBasicDescription;
+static AudioStreamBasicDescription defaultCanonicalAudioStreamBasicDescription;
+static mach_timebase_info_data_t machTimebaseInfo;
 
-@interface STKAudioPlayer()
+@interface STKAudioPlayer() <NSMachPortDelegate>
 {
 	BOOL muted;
 	
@@ -216,75 +382,118 @@ static AudioStreamBasicDescription recordAudioStreamBasicDescription;
     STKAudioPlayerInternalState internalState;
 	
 	Float32 volume;
-	Float32 peakPowerDb[2];
-	Float32 averagePowerDb[2];
+	Float32 pan;
+	Float32 playbackRate;
+	STKMeter meter;
+    STKEqualizer equalizer;
+    
+    /// Set for players that render into a bus of a shared engine instead of their own graph
+    STKAudioEngine* engine;
+    UInt32 engineBus;
 	
 	BOOL meteringEnabled;
-    BOOL equalizerOn;
     BOOL equalizerEnabled;
+    BOOL mixerOn;
+    BOOL playbackRateOn;
+    int32_t pendingGraphCommands;
     STKAudioPlayerOptions options;
 
     NSMutableArray* converterNodes;
 
 	AUGraph audioGraph;
-    AUNode eqNode;
 	AUNode mixerNode;
     AUNode outputNode;
 	
-	AUNode eqInputNode;
-	AUNode eqOutputNode;
 	AUNode mixerInputNode;
 	AUNode mixerOutputNode;
 	AUNode playbackRateNode;
 	
-    AudioComponentInstance eqUnit;
 	AudioComponentInstance mixerUnit;
 	AudioComponentInstance playbackRateUnit;
 	AudioComponentInstance outputUnit;
 		
-    UInt32 eqBandCount;
     int32_t waitingForDataAfterSeekFrameCount;
 	
     UInt32 framesRequiredToStartPlaying;
     UInt32 framesRequiredToPlayAfterRebuffering;
 	UInt32 framesRequiredBeforeWaitingForDataAfterSeekBecomesPlaying;
+    /// Frames of compressed audio read ahead of the PCM buffer before reading pauses (compressedBuffering only)
+    UInt64 compressedFramesToBuffer;
+    /// The render thread wakes the decode thread once fewer frames than this are left in the PCM buffer
+    UInt32 pcmSpaceSignalFrameCount;
+    /// PCM buffer fill levels between which burstDecoding refills
+    UInt32 pcmBurstLowWatermarkFrames;
+    UInt32 pcmBurstHighWatermarkFrames;
+    /// YES while the decode thread is refilling the PCM buffer up to the high watermark (decode thread only)
+    BOOL pcmBurstRefilling;
     
     STKQueueEntry* volatile currentlyPlayingEntry;
     STKQueueEntry* volatile currentlyReadingEntry;
     
-    NSMutableArray* upcomingQueue;
-    NSMutableArray* bufferingQueue;
+    STKEntryQueue* upcomingQueue;
+    NSMutableArray* prefetchDataSources;
+    STKEntryQueue* bufferingQueue;
+    
+    /// The item ids of the pending queue as of pendingQueueSnapshotVersion so it can be read without the playerMutex
+    os_unfair_lock pendingQueueSnapshotLock;
+    NSArray* pendingQueueSnapshot;
+    uint64_t pendingQueueSnapshotVersion;
     
-    os_unfair_lock pcmBufferSpinLock;
     os_unfair_lock internalStateLock;
-    volatile UInt32 pcmBufferTotalFrameCount;
-    volatile UInt32 pcmBufferFrameStartIndex;
-    volatile UInt32 pcmBufferUsedFrameCount;
-    volatile UInt32 pcmBufferFrameSizeInBytes;
     
-    AudioBuffer* pcmAudioBuffer;
-    AudioBufferList pcmAudioBufferList;
+    /// The state the delegate was last told about
+    STKAudioPlayerState dispatchedState;
+    os_unfair_lock stateChangeDispatchLock;
+    
+    /// Delivers delegate callbacks on the delegateQueue (nil if there isn't one)
+    STKDelegateDispatcher* delegateDispatcher;
+    os_unfair_lock delegateDispatcherLock;
+    
+    AudioStreamBasicDescription canonicalAudioStreamBasicDescription;
+    STKRingBuffer pcmRingBuffer;
+    AudioBufferList* pcmDecodeBufferList;
+    AudioBufferList* preDecodeBufferList;
     AudioConverterRef audioConverterRef;
+    AudioStreamBasicDescription decodeAudioStreamBasicDescription;
+    
+    STKPacketQueue packetQueue;
+    NSThread* decodeThread;
+    NSConditionLock* decodeThreadFinishedCondLock;
+    pthread_mutex_t decodeMutex;
+    pthread_cond_t decodeCondition;
+    uint32_t decodeFlushCount;
+    BOOL decodeThreadWaiting;
+    BOOL readingPaused;
+    volatile BOOL decodeThreadStopRequested;
+    
+    STKQueueEntry* preDecodeEntry;
+    AudioFileStreamID preDecodeAudioFileStream;
+    AudioConverterRef preDecodeAudioConverterRef;
+    AudioStreamBasicDescription preDecodeAudioConverterAudioStreamBasicDescription;
+    STKRingBuffer preDecodeRingBuffer;
+    UInt32 preDecodeFrameCount;
+    BOOL preDecodeParsing;
+    BOOL preDecodeFailed;
+    BOOL preDecodeEof;
+    STKQueueEntry* preDecodeAbandonedEntry;
+    
+    UInt32 crossfadeFrameCount;
+    void* crossfadeBuffer;
+    __unsafe_unretained STKQueueEntry* crossfadingEntry;
 
     AudioStreamBasicDescription audioConverterAudioStreamBasicDescription;
     
 	BOOL deallocating;
     BOOL discontinuous;
 	NSArray* frameFilters;
+	STKFrameFilterPipeline frameFilterPipeline;
     NSThread* playbackThread;
     NSRunLoop* playbackThreadRunLoop;
     AudioFileStreamID audioFileStream;
     NSConditionLock* threadStartedLock;
     NSConditionLock* threadFinishedCondLock;
     
-    AudioFileID recordAudioFileId;
-    UInt32 recordFilePacketPosition;
-    AudioConverterRef recordAudioConverterRef;
-    UInt32 recordOutputBufferSize;
-    UInt8 *recordOutputBuffer;
-    UInt32 recordPacketsPerBuffer;
-    UInt32 recordPacketSize;
-    AudioStreamPacketDescription *recordPacketDescriptions;
+    STKRecordingWriter* recordingWriter;
     
 	void(^stopBackBackgroundTaskBlock)(void);
     
@@ -293,15 +502,43 @@ static AudioStreamBasicDescription recordAudioStreamBasicDescription;
     os_unfair_lock currentEntryReferencesLock;
 
     pthread_mutex_t playerMutex;
-    pthread_cond_t playerThreadReadyCondition;
+    /// Callers of renderFrames:count: wait on offlineRenderCondition (with offlineRenderMutex) while offlineRenderWaiterCount is above 0
+    /// and keep holding offlineRenderMutex while they render so the PCM buffers can't be replaced under them
+    pthread_mutex_t offlineRenderMutex;
+    pthread_cond_t offlineRenderCondition;
+    int32_t offlineRenderWaiterCount;
     pthread_mutex_t mainThreadSyncCallMutex;
     pthread_cond_t mainThreadSyncCallReadyCondition;
     
-    volatile BOOL waiting;
+    /// The decode thread waits on pcmSpaceSemaphore for the render thread to make room in the PCM buffer
+    BOOL decodeThreadWaitingForSpace;
+    dispatch_semaphore_t pcmSpaceSemaphore;
+    /// The playback thread waits on packetQueueSpaceSemaphore for the decode thread to make room in the packet queue
+    BOOL playbackThreadWaitingForSpace;
+    dispatch_semaphore_t packetQueueSpaceSemaphore;
+    
+    /// Events from the render thread for the playback thread, which is woken by a message to renderEventPort
+    STKPacketQueue renderEventQueue;
+    NSMachPort* renderEventPort;
+    mach_port_t renderEventMachPort;
+    
+    /// Changes whenever currentlyPlayingEntry does (never 0). Written with currentEntryReferencesLock held
+    uint32_t playingEntryGeneration;
+    /// The generation that played to its end to give way to the current one (0 if it didn't)
+    uint32_t playingEntryPredecessorGeneration;
+    
+    /// Render thread only: the generation frames were last counted against, the frames played past the end of it
+    /// (which belong to the entry that follows it) and the last generation a finished event was queued for
+    uint32_t renderEntryGeneration;
+    SInt64 renderFramesPastEnd;
+    uint32_t renderFinishedGeneration;
+    
     volatile double requestedSeekTime;
     volatile BOOL disposeWasRequested;
     volatile BOOL seekToTimeWasRequested;
     volatile STKAudioPlayerStopReason stopReason;
+    
+    STKAudioPlayerCounters counters;
 }
 
 @property (readwrite) STKAudioPlayerInternalState internalState;
@@ -327,8 +564,32 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
 
 @implementation STKAudioPlayer
 
+static uint64_t MachTimeToNanoseconds(uint64_t time)
+{
+    return time * machTimebaseInfo.numer / machTimebaseInfo.denom;
+}
+
+/// Locks the playerMutex and records how long the caller had to wait for it
+static void LockPlayerMutex(STKAudioPlayer* player)
+{
+    if (pthread_mutex_trylock(&player->playerMutex) == 0)
+    {
+        STKHistogramRecord(&player->counters.playerMutexWait, 0);
+        
+        return;
+    }
+    
+    uint64_t start = mach_absolute_time();
+    
+    pthread_mutex_lock(&player->playerMutex);
+    
+    STKHistogramRecord(&player->counters.playerMutexWait, MachTimeToNanoseconds(mach_absolute_time() - start));
+}
+
 +(void) initialize
 {
+    mach_timebase_info(&machTimebaseInfo);
+    
     convertUnitDescription = (AudioComponentDescription)
     {
         .componentManufacturer = kAudioUnitManufacturer_Apple,
@@ -338,13 +599,6 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
         .componentFlagsMask = 0
     };
     
-#ifdef CA_CANONICAL_DEPRECATED
-    const int bytesPerSample = sizeof(SInt16);
-#elif __IPHONE_OS_VERSION_MIN_REQUIRED >= 80000
-    const int bytesPerSample = sizeof(SInt16);
-#else
-    const int bytesPerSample = sizeof(AudioSampleType);
-#endif
 
     playbackRateUnitDescription = (AudioComponentDescription)
     {
@@ -355,17 +609,7 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
         .componentFlagsMask		= 0,
     };
 
-    canonicalAudioStreamBasicDescription = (AudioStreamBasicDescription)
-    {
-        .mSampleRate = 44100.00,
-        .mFormatID = kAudioFormatLinearPCM,
-        .mFormatFlags = kAudioFormatFlagIsSignedInteger | kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsPacked,
-        .mFramesPerPacket = 1,
-        .mChannelsPerFrame = 2,
-        .mBytesPerFrame = bytesPerSample * 2 /*channelsPerFrame*/,
-        .mBitsPerChannel = 8 * bytesPerSample,
-        .mBytesPerPacket = (bytesPerSample * 2)
-    };
+    defaultCanonicalAudioStreamBasicDescription = CanonicalAudioStreamBasicDescriptionWithFormat(44100.00, STKAudioPlayerSampleFormatInt16, NO);
     
 	outputUnitDescription = (AudioComponentDescription)
 	{
@@ -389,12 +633,6 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
 		.componentManufacturer = kAudioUnitManufacturer_Apple
 	};
     
-	nbandUnitDescription = (AudioComponentDescription)
-	{
-		.componentType = kAudioUnitType_Effect,
-		.componentSubType = kAudioUnitSubType_NBandEQ,
-		.componentManufacturer=kAudioUnitManufacturer_Apple
-	};
 }
 -(STKAudioPlayerOptions) options
 {
@@ -412,6 +650,16 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
 }
 
 -(void) setInternalState:(STKAudioPlayerInternalState)value ifInState:(BOOL(^)(STKAudioPlayerInternalState))ifInState
+{
+    if ([self changeInternalState:value ifInState:ifInState])
+    {
+        [self dispatchStateChange];
+    }
+}
+
+/// Sets the internal state and the state it maps to without telling the delegate. Only holds the internalStateLock
+/// briefly and allocates nothing so the render thread can call it. Returns YES if the state changed
+-(BOOL) changeInternalState:(STKAudioPlayerInternalState)value ifInState:(BOOL(^)(STKAudioPlayerInternalState))ifInState
 {
     STKAudioPlayerState newState;
     
@@ -455,42 +703,107 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
 	
 	waitingForDataAfterSeekFrameCount = 0;
 	
-    if (value == internalState)
+    if (value == internalState || (ifInState != NULL && !ifInState(self->internalState)))
     {
         lockUnlock(&internalStateLock);
         
-        return;
+        return NO;
     }
     
-    if (ifInState != NULL)
+    internalState = value;
+    
+    BOOL retval = newState != self.state && !deallocating;
+    
+    if (retval)
     {
-        if (!ifInState(self->internalState))
-        {
-            lockUnlock(&internalStateLock);
-            
-            return;
-        }
+        self.state = newState;
     }
     
-    internalState = value;
+    lockUnlock(&internalStateLock);
     
-	STKAudioPlayerState previousState = self.state;
-	
-    if (newState != previousState && !deallocating)
+    return retval;
+}
+
+/// Tells the delegate the state changed from the last state it was told about. Changes made on the render thread
+/// are told by the playback thread later so the delegate may hear one change where there were several
+-(void) dispatchStateChange
+{
+    setLock(&stateChangeDispatchLock);
+    
+    STKAudioPlayerState state = self.state;
+    STKAudioPlayerState previousState = dispatchedState;
+    
+    // Dispatched with the lock held so changes reach the delegate in the order they were made
+    
+    if (state != previousState && !deallocating)
     {
-        self.state = newState;
+        dispatchedState = state;
         
-        lockUnlock(&internalStateLock);
+        STKDelegateDispatcher* dispatcher = [self currentDelegateDispatcher];
         
-        dispatch_async(dispatch_get_main_queue(), ^
+        if (dispatcher != nil)
         {
-            [self.delegate audioPlayer:self stateChanged:self.state previousState:previousState];
-        });
+            [dispatcher dispatchStateChange:state previousState:previousState handler:^(STKAudioPlayerState state, STKAudioPlayerState fromState)
+            {
+                [self.delegate audioPlayer:self stateChanged:state previousState:fromState];
+            }];
+        }
+        else
+        {
+            dispatch_async(dispatch_get_main_queue(), ^
+            {
+                [self.delegate audioPlayer:self stateChanged:state previousState:previousState];
+            });
+        }
     }
-    else
+    
+    lockUnlock(&stateChangeDispatchLock);
+}
+
+-(STKDelegateDispatcher*) currentDelegateDispatcher
+{
+    setLock(&delegateDispatcherLock);
+    STKDelegateDispatcher* retval = delegateDispatcher;
+    lockUnlock(&delegateDispatcherLock);
+    
+    return retval;
+}
+
+-(dispatch_queue_t) delegateQueue
+{
+    return [self currentDelegateDispatcher].queue;
+}
+
+-(void) setDelegateQueue:(dispatch_queue_t)queue
+{
+    // Callbacks already waiting are still delivered on the previous queue
+    
+    STKDelegateDispatcher* dispatcher = queue != nil ? [[STKDelegateDispatcher alloc] initWithQueue:queue limit:STK_DELEGATE_CALLBACK_LIMIT] : nil;
+    
+    setLock(&delegateDispatcherLock);
+    delegateDispatcher = dispatcher;
+    lockUnlock(&delegateDispatcherLock);
+}
+
+/// Queues a delegate callback on the delegateQueue without waiting for it. Returns NO if there's no delegateQueue
+-(BOOL) dispatchToDelegateQueue:(void(^)(void))block
+{
+    STKDelegateDispatcher* dispatcher = [self currentDelegateDispatcher];
+    
+    if (dispatcher == nil)
     {
-        lockUnlock(&internalStateLock);
+        return NO;
     }
+    
+    [dispatcher dispatch:^
+    {
+        if (!self->disposeWasRequested)
+        {
+            block();
+        }
+    }];
+    
+    return YES;
 }
 
 -(STKAudioPlayerStopReason) stopReason
@@ -522,35 +835,57 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
 }
 
 -(instancetype) initWithOptions:(STKAudioPlayerOptions)optionsIn
+{
+    return [self initWithOptions:optionsIn engine:nil];
+}
+
+-(instancetype) initWithOptions:(STKAudioPlayerOptions)optionsIn engine:(STKAudioEngine*)engineIn
 {
     if (self = [super init])
     {
-        pcmBufferSpinLock = OS_UNFAIR_LOCK_INIT;
         internalStateLock = OS_UNFAIR_LOCK_INIT;
+        stateChangeDispatchLock = OS_UNFAIR_LOCK_INIT;
+        delegateDispatcherLock = OS_UNFAIR_LOCK_INIT;
         seekLock = OS_UNFAIR_LOCK_INIT;
         currentEntryReferencesLock = OS_UNFAIR_LOCK_INIT;
 
         options = optionsIn;
 		
 		self->volume = 1.0;
+		self->playbackRate = 1.0;
         self->equalizerEnabled = optionsIn.equalizerBandFrequencies[0] != 0;
 
         PopulateOptionsWithDefault(&options);
         NormalizeDisabledBuffers(&options);
         
-        framesRequiredToStartPlaying = canonicalAudioStreamBasicDescription.mSampleRate * options.secondsRequiredToStartPlaying;
-        framesRequiredToPlayAfterRebuffering = canonicalAudioStreamBasicDescription.mSampleRate * options.secondsRequiredToStartPlayingAfterBufferUnderun;
-		framesRequiredBeforeWaitingForDataAfterSeekBecomesPlaying = canonicalAudioStreamBasicDescription.mSampleRate * options.gracePeriodAfterSeekInSeconds;
+        Float64 sampleRate = defaultCanonicalAudioStreamBasicDescription.mSampleRate;
         
-        pcmAudioBuffer = &pcmAudioBufferList.mBuffers[0];
+        // Every input of an engine is mixed at the engine's sample rate
         
-        pcmAudioBufferList.mNumberBuffers = 1;
-        pcmAudioBufferList.mBuffers[0].mDataByteSize = (canonicalAudioStreamBasicDescription.mSampleRate * options.bufferSizeInSeconds) * canonicalAudioStreamBasicDescription.mBytesPerFrame;
-        pcmAudioBufferList.mBuffers[0].mData = (void*)calloc(pcmAudioBuffer->mDataByteSize, 1);
-        pcmAudioBufferList.mBuffers[0].mNumberChannels = 2;
-		
-        pcmBufferFrameSizeInBytes = canonicalAudioStreamBasicDescription.mBytesPerFrame;
-        pcmBufferTotalFrameCount = pcmAudioBuffer->mDataByteSize / pcmBufferFrameSizeInBytes;
+        if (engineIn != nil && !options.offlineRendering)
+        {
+            engine = engineIn;
+            sampleRate = engine.sampleRate;
+            options.pcmSampleRate = STKAudioPlayerSampleRateDefault;
+        }
+        
+        canonicalAudioStreamBasicDescription = CanonicalAudioStreamBasicDescriptionWithFormat(sampleRate, options.pcmSampleFormat, options.pcmNonInterleaved);
+        
+        STKAudioPlayerCountersReset(&counters);
+        STKFrameFilterPipelineInit(&frameFilterPipeline);
+        STKMeterInit(&meter, canonicalAudioStreamBasicDescription.mChannelsPerFrame, options.pcmSampleFormat == STKAudioPlayerSampleFormatFloat32 ? STKMeterSampleFormatFloat32 : STKMeterSampleFormatInt16, options.pcmNonInterleaved);
+        
+        UInt32 equalizerBandCount = 0;
+        
+        while (equalizerBandCount < STK_EQUALIZER_MAX_BANDS && options.equalizerBandFrequencies[equalizerBandCount] != 0)
+        {
+            equalizerBandCount++;
+        }
+        
+        STKEqualizerInit(&equalizer, canonicalAudioStreamBasicDescription.mChannelsPerFrame, options.pcmSampleFormat == STKAudioPlayerSampleFormatFloat32 ? STKEqualizerSampleFormatFloat32 : STKEqualizerSampleFormatInt16, options.pcmNonInterleaved, options.equalizerBandFrequencies, equalizerBandCount, sampleRate);
+        STKEqualizerSetEnabled(&equalizer, self->equalizerEnabled);
+        
+        [self createPcmBuffers];
         
         readBufferSize = options.readBufferSize;
         readBuffer = calloc(sizeof(UInt8), readBufferSize);
@@ -561,20 +896,56 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
         pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
         
         pthread_mutex_init(&playerMutex, &attr);
+        pthread_mutex_init(&decodeMutex, &attr);
         pthread_mutex_init(&mainThreadSyncCallMutex, NULL);
-        pthread_cond_init(&playerThreadReadyCondition, NULL);
+        pthread_mutex_init(&offlineRenderMutex, NULL);
+        pthread_cond_init(&decodeCondition, NULL);
+        pthread_cond_init(&offlineRenderCondition, NULL);
         pthread_cond_init(&mainThreadSyncCallReadyCondition, NULL);
+        
+        // Always room for a few full reads whatever the option says
+        
+        UInt32 packetQueueSize = MAX(options.packetQueueSizeInKB * 1024, STK_PACKET_QUEUE_HEADROOM + 2 * STK_PACKET_QUEUE_READ_FRACTION * readBufferSize);
+        
+        if (options.compressedBuffering)
+        {
+            packetQueueSize = MAX(packetQueueSize, STK_PACKET_QUEUE_HEADROOM + (UInt32)(options.bufferSizeInSeconds * STK_COMPRESSED_BUFFERING_BYTES_PER_SECOND));
+        }
+        
+        STKPacketQueueInit(&packetQueue, packetQueueSize);
+        STKPacketQueueInit(&renderEventQueue, STK_RENDER_EVENT_QUEUE_SIZE);
+        
+        pcmSpaceSemaphore = dispatch_semaphore_create(0);
+        packetQueueSpaceSemaphore = dispatch_semaphore_create(0);
+        
+        renderEventPort = (NSMachPort*)[NSMachPort port];
+        renderEventPort.delegate = self;
+        renderEventMachPort = renderEventPort.machPort;
 
         threadStartedLock = [[NSConditionLock alloc] initWithCondition:0];
         threadFinishedCondLock = [[NSConditionLock alloc] initWithCondition:0];
+        decodeThreadFinishedCondLock = [[NSConditionLock alloc] initWithCondition:0];
         
         self.internalState = STKAudioPlayerInternalStateInitialised;
         
-        upcomingQueue = [[NSMutableArray alloc] init];
-        bufferingQueue = [[NSMutableArray alloc] init];
+        upcomingQueue = [[STKEntryQueue alloc] init];
+        bufferingQueue = [[STKEntryQueue alloc] init];
+        pendingQueueSnapshotLock = OS_UNFAIR_LOCK_INIT;
+        prefetchDataSources = [[NSMutableArray alloc] init];
 
 		[self resetPcmBuffers];
-        [self createAudioGraph];
+        
+        if (engine != nil)
+        {
+            [self attachToEngine];
+        }
+        
+        if (!options.offlineRendering && engine == nil)
+        {
+            [self createAudioGraph];
+        }
+        
+        [self createDecodeThread];
         [self createPlaybackThread];
     }
     
@@ -596,9 +967,7 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
         currentlyPlayingEntry.dataSource.delegate = nil;
         [currentlyReadingEntry.dataSource unregisterForEvents];
         
-        setLock(&currentEntryReferencesLock);
-		currentlyPlayingEntry = nil;
-        lockUnlock(&currentEntryReferencesLock);
+        [self setCurrentlyPlayingEntry:nil reachedEnd:NO];
     }
     
     [self closeRecordAudioFile];
@@ -627,6 +996,13 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
 		
 		audioGraph = nil;
     }
+    
+    if (engine != nil)
+    {
+        [engine detachInputFromBus:engineBus];
+        
+        engine = nil;
+    }
 }
 
 -(void) dealloc
@@ -638,12 +1014,26 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
 	[self destroyAudioResources];
     
     pthread_mutex_destroy(&playerMutex);
+    pthread_mutex_destroy(&decodeMutex);
     pthread_mutex_destroy(&mainThreadSyncCallMutex);
-    pthread_cond_destroy(&playerThreadReadyCondition);
+    pthread_mutex_destroy(&offlineRenderMutex);
+    pthread_cond_destroy(&decodeCondition);
+    pthread_cond_destroy(&offlineRenderCondition);
     pthread_cond_destroy(&mainThreadSyncCallReadyCondition);
     
     free(readBuffer);
-    free(pcmAudioBufferList.mBuffers[0].mData);
+    STKRingBufferDestroy(&pcmRingBuffer);
+    STKRingBufferDestroy(&preDecodeRingBuffer);
+    free(pcmDecodeBufferList);
+    free(preDecodeBufferList);
+    free(crossfadeBuffer);
+    STKPacketQueueDestroy(&packetQueue);
+    STKPacketQueueDestroy(&renderEventQueue);
+    
+    [renderEventPort invalidate];
+    STKFrameFilterPipelineDestroy(&frameFilterPipeline);
+    STKMeterDestroy(&meter);
+    STKEqualizerDestroy(&equalizer);
 }
 
 -(void) startSystemBackgroundTask
@@ -695,95 +1085,213 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
     return retval;
 }
 
-+ (AudioStreamBasicDescription)canonicalAudioStreamBasicDescription
-{
-  return canonicalAudioStreamBasicDescription;
-}
-
--(void) clearQueue
+/// Creates the data source for a URL passed to play or queue, which maps local files if the options ask for it
+-(STKDataSource*) dataSourceFromURL:(NSURL*)url
 {
-    pthread_mutex_lock(&playerMutex);
+    if (options.mapLocalFiles && [url.scheme isEqualToString:@"file"])
     {
-        if ([self.delegate respondsToSelector:@selector(audioPlayer:didCancelQueuedItems:)])
-        {
-            NSMutableArray* array = [[NSMutableArray alloc] initWithCapacity:bufferingQueue.count + upcomingQueue.count];
-            
-            for (STKQueueEntry* entry in upcomingQueue)
-            {
-                [array addObject:entry.queueItemId];
-            }
-			
-			for (STKQueueEntry* entry in bufferingQueue)
-            {
-                [array addObject:entry.queueItemId];
-            }
-            
-            [upcomingQueue removeAllObjects];
-			[bufferingQueue removeAllObjects];
-            
-            if (array.count > 0)
-            {
-                [self playbackThreadQueueMainThreadSyncBlock:^
-                {
-                    if ([self.delegate respondsToSelector:@selector(audioPlayer:didCancelQueuedItems:)])
-                    {
-                        [self.delegate audioPlayer:self didCancelQueuedItems:array];
-                    }
-                }];
-            }
-        }
-        else
-        {
-            [bufferingQueue removeAllObjects];
-            [upcomingQueue removeAllObjects];
-        }
+        return [[STKMappedFileDataSource alloc] initWithFilePath:url.path];
     }
-    pthread_mutex_unlock(&playerMutex);
-}
-
--(void) play:(NSString*)urlString
-{
-	[self play:urlString withQueueItemID:urlString];
-}
-
--(void) play:(NSString*)urlString withQueueItemID:(NSObject*)queueItemId
-{
-    NSURL* url = [NSURL URLWithString:urlString];
     
-	[self setDataSource:[STKAudioPlayer dataSourceFromURL:url] withQueueItemId:queueItemId];
-}
-
--(void) playURL:(NSURL*)url
-{
-	[self playURL:url withQueueItemID:url];
-}
-
--(void) playURL:(NSURL*)url withQueueItemID:(NSObject*)queueItemId
-{
-	[self setDataSource:[STKAudioPlayer dataSourceFromURL:url] withQueueItemId:queueItemId];
+    return [STKAudioPlayer dataSourceFromURL:url];
 }
 
--(void) playDataSource:(STKDataSource*)dataSource
++ (AudioStreamBasicDescription)canonicalAudioStreamBasicDescription
 {
-	[self playDataSource:dataSource withQueueItemID:dataSource];
+  return defaultCanonicalAudioStreamBasicDescription;
 }
 
--(void) playDataSource:(STKDataSource*)dataSource withQueueItemID:(NSObject *)queueItemId
+-(AudioStreamBasicDescription) canonicalAudioStreamBasicDescription
 {
-	[self setDataSource:dataSource withQueueItemId:queueItemId];
+    return canonicalAudioStreamBasicDescription;
 }
 
--(void) setDataSource:(STKDataSource*)dataSourceIn withQueueItemId:(NSObject*)queueItemId
+/// (Re)creates the PCM buffer and frame thresholds for the current canonical format.
+/// Must not be called while the audio graph is running.
+-(void) createPcmBuffers
 {
-    pthread_mutex_lock(&playerMutex);
+    Float64 sampleRate = canonicalAudioStreamBasicDescription.mSampleRate;
+    UInt32 planeCount = (canonicalAudioStreamBasicDescription.mFormatFlags & kAudioFormatFlagIsNonInterleaved) ? canonicalAudioStreamBasicDescription.mChannelsPerFrame : 1;
+    Float32 pcmBufferSizeInSeconds = options.bufferSizeInSeconds;
+    
+    // The rest of the buffer is read ahead as packets which are decoded as the PCM buffer drains. It has to hold
+    // the end of one item and the start of the next for a crossfade
+    
+    if (options.compressedBuffering)
     {
-        LOGINFO(([NSString stringWithFormat:@"Playing: %@", [queueItemId description]]));
+        pcmBufferSizeInSeconds = MIN(options.bufferSizeInSeconds, options.pcmWindowInSeconds + 2 * options.crossfadeDurationInSeconds);
+        compressedFramesToBuffer = sampleRate * (options.bufferSizeInSeconds - pcmBufferSizeInSeconds);
+    }
+    
+    framesRequiredToStartPlaying = sampleRate * options.secondsRequiredToStartPlaying;
+    framesRequiredToPlayAfterRebuffering = sampleRate * options.secondsRequiredToStartPlayingAfterBufferUnderun;
+    framesRequiredBeforeWaitingForDataAfterSeekBecomesPlaying = sampleRate * options.gracePeriodAfterSeekInSeconds;
+    
+    STKRingBufferDestroy(&pcmRingBuffer);
+    STKRingBufferInit(&pcmRingBuffer, MAX(1, (UInt32)(sampleRate * pcmBufferSizeInSeconds)), canonicalAudioStreamBasicDescription.mBytesPerFrame, planeCount);
+    STKEqualizerSetSampleRate(&equalizer, sampleRate);
+    
+    // The low watermark is at least a frame so the render thread always gets to wake the decode thread
+    
+    pcmBurstHighWatermarkFrames = MAX(2, (UInt32)(pcmRingBuffer.frameCount * MIN(MAX(options.burstHighWatermark, 0), 1)));
+    pcmBurstLowWatermarkFrames = MAX(1, MIN((UInt32)(pcmRingBuffer.frameCount * MIN(MAX(options.burstLowWatermark, 0), 1)), pcmBurstHighWatermarkFrames - 1));
+    pcmSpaceSignalFrameCount = options.burstDecoding ? pcmBurstLowWatermarkFrames : pcmRingBuffer.frameCount / 2;
+    pcmBurstRefilling = YES;
+    
+    // The decode thread and the playback thread (decoding ahead) each have their own
+    
+    if (pcmDecodeBufferList == NULL)
+    {
+        pcmDecodeBufferList = calloc(1, offsetof(AudioBufferList, mBuffers) + sizeof(AudioBuffer) * planeCount);
+        pcmDecodeBufferList->mNumberBuffers = planeCount;
+        
+        preDecodeBufferList = calloc(1, offsetof(AudioBufferList, mBuffers) + sizeof(AudioBuffer) * planeCount);
+        preDecodeBufferList->mNumberBuffers = planeCount;
+    }
+    
+    preDecodeFrameCount = sampleRate * options.secondsToPreDecodeNextItem;
+    crossfadeFrameCount = sampleRate * options.crossfadeDurationInSeconds;
+    
+    STKRingBufferDestroy(&preDecodeRingBuffer);
+    
+    if (preDecodeFrameCount > 0)
+    {
+        // An extra second leaves room for the packets of the read that crosses the look-ahead
+        
+        STKRingBufferInit(&preDecodeRingBuffer, preDecodeFrameCount + (UInt32)sampleRate, canonicalAudioStreamBasicDescription.mBytesPerFrame, planeCount);
+    }
+    
+    if (crossfadeFrameCount > 0 && crossfadeBuffer == NULL)
+    {
+        crossfadeBuffer = malloc((size_t)maxFramesPerSlice * canonicalAudioStreamBasicDescription.mBytesPerFrame * planeCount);
+    }
+}
+
+/// Switches the PCM pipeline to a new sample rate. The graph is stopped and uninitialised while the
+/// units and buffers are reconfigured so it must only be called when there's nothing left to play
+-(void) reconfigureForSampleRate:(Float64)sampleRate
+{
+    OSStatus status;
+    BOOL wasRunning = [self audioGraphIsRunning];
+    
+    [self cancelPreDecode];
+    
+    if (audioGraph == nil)
+    {
+        // Only offline players get here and renderFrames:count: holds offlineRenderMutex while it reads the buffers
+        
+        pthread_mutex_lock(&offlineRenderMutex);
+        
+        canonicalAudioStreamBasicDescription.mSampleRate = sampleRate;
+        
+        [self createPcmBuffers];
+        
+        pthread_mutex_unlock(&offlineRenderMutex);
+        
+        return;
+    }
+    
+    if (wasRunning)
+    {
+        CHECK_STATUS_AND_REPORT(AUGraphStop(audioGraph));
+    }
+    
+    CHECK_STATUS_AND_REPORT(AUGraphUninitialize(audioGraph));
+    
+    canonicalAudioStreamBasicDescription.mSampleRate = sampleRate;
+    
+    [self createPcmBuffers];
+    [self applyCanonicalAudioStreamBasicDescriptionToUnits];
+    [self connectGraph];
+    
+    CHECK_STATUS_AND_REPORT(AUGraphInitialize(audioGraph));
+    
+    if (wasRunning)
+    {
+        CHECK_STATUS_AND_REPORT(AUGraphStart(audioGraph));
+    }
+}
+
+-(void) clearQueue
+{
+    LockPlayerMutex(self);
+    {
+        if ([self.delegate respondsToSelector:@selector(audioPlayer:didCancelQueuedItems:)])
+        {
+            NSMutableArray* array = [self pendingQueueItemIds];
+            
+            [upcomingQueue removeAllEntries];
+			[bufferingQueue removeAllEntries];
+            
+            if (array.count > 0)
+            {
+                [self playbackThreadQueueMainThreadSyncBlock:^
+                {
+                    if ([self.delegate respondsToSelector:@selector(audioPlayer:didCancelQueuedItems:)])
+                    {
+                        [self.delegate audioPlayer:self didCancelQueuedItems:array];
+                    }
+                }];
+            }
+        }
+        else
+        {
+            [bufferingQueue removeAllEntries];
+            [upcomingQueue removeAllEntries];
+        }
+    }
+    pthread_mutex_unlock(&playerMutex);
+    
+    // Prefetching for the removed items is cancelled on the playback thread
+    
+    [self wakeupPlaybackThread];
+}
+
+-(void) play:(NSString*)urlString
+{
+	[self play:urlString withQueueItemID:urlString];
+}
+
+-(void) play:(NSString*)urlString withQueueItemID:(NSObject*)queueItemId
+{
+    NSURL* url = [NSURL URLWithString:urlString];
+    
+	[self setDataSource:[self dataSourceFromURL:url] withQueueItemId:queueItemId];
+}
+
+-(void) playURL:(NSURL*)url
+{
+	[self playURL:url withQueueItemID:url];
+}
+
+-(void) playURL:(NSURL*)url withQueueItemID:(NSObject*)queueItemId
+{
+	[self setDataSource:[self dataSourceFromURL:url] withQueueItemId:queueItemId];
+}
+
+-(void) playDataSource:(STKDataSource*)dataSource
+{
+	[self playDataSource:dataSource withQueueItemID:dataSource];
+}
+
+-(void) playDataSource:(STKDataSource*)dataSource withQueueItemID:(NSObject *)queueItemId
+{
+	[self setDataSource:dataSource withQueueItemId:queueItemId];
+}
+
+-(void) setDataSource:(STKDataSource*)dataSourceIn withQueueItemId:(NSObject*)queueItemId
+{
+    LockPlayerMutex(self);
+    {
+        LOGINFO(([NSString stringWithFormat:@"Playing: %@", [queueItemId description]]));
         
 		if (![self audioGraphIsRunning])
 		{
 			[self startSystemBackgroundTask];
 		}
         
+        dataSourceIn = [self prefetchedDataSourceForDataSource:dataSourceIn];
+        
         [self clearQueue];
 
         [upcomingQueue enqueue:[[STKQueueEntry alloc] initWithDataSource:dataSourceIn andQueueItemId:queueItemId]];
@@ -812,12 +1320,12 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
 
 -(void) queueURL:(NSURL*)url withQueueItemId:(NSObject*)queueItemId
 {
-	[self queueDataSource:[STKAudioPlayer dataSourceFromURL:url] withQueueItemId:queueItemId];
+	[self queueDataSource:[self dataSourceFromURL:url] withQueueItemId:queueItemId];
 }
 
 -(void) queueDataSource:(STKDataSource*)dataSourceIn withQueueItemId:(NSObject*)queueItemId
 {
-    pthread_mutex_lock(&playerMutex);
+    LockPlayerMutex(self);
     {
 		if (![self audioGraphIsRunning])
 		{
@@ -831,11 +1339,63 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
     [self wakeupPlaybackThread];
 }
 
+-(void) queueDataSources:(NSArray<STKDataSource*>*)dataSourcesIn withQueueItemIds:(NSArray<NSObject*>*)queueItemIds
+{
+    NSAssert(dataSourcesIn.count == queueItemIds.count, @"dataSources.count == queueItemIds.count");
+    
+    NSUInteger count = MIN(dataSourcesIn.count, queueItemIds.count);
+    NSMutableArray* entries = [[NSMutableArray alloc] initWithCapacity:count];
+    
+    for (NSUInteger i = 0; i < count; i++)
+    {
+        [entries addObject:[[STKQueueEntry alloc] initWithDataSource:dataSourcesIn[i] andQueueItemId:queueItemIds[i]]];
+    }
+    
+    LockPlayerMutex(self);
+    {
+		if (![self audioGraphIsRunning])
+		{
+			[self startSystemBackgroundTask];
+		}
+        
+        for (STKQueueEntry* entry in entries)
+        {
+            [upcomingQueue enqueue:entry];
+        }
+    }
+    pthread_mutex_unlock(&playerMutex);
+    
+    [self wakeupPlaybackThread];
+}
+
+-(BOOL) removeQueuedItemWithId:(NSObject*)queueItemId
+{
+    STKQueueEntry* entry;
+    
+    LockPlayerMutex(self);
+    {
+        entry = [upcomingQueue removeEntryWithQueueItemId:queueItemId];
+    }
+    pthread_mutex_unlock(&playerMutex);
+    
+    if (entry == nil)
+    {
+        return NO;
+    }
+    
+    // Prefetching and decoding ahead for the item are cancelled on the playback thread
+    
+    [self wakeupPlaybackThread];
+    
+    return YES;
+}
+
 -(void) handlePropertyChangeForFileStream:(AudioFileStreamID)inAudioFileStream fileStreamPropertyID:(AudioFileStreamPropertyID)inPropertyID ioFlags:(UInt32*)ioFlags
 {
 	OSStatus error;
+    STKQueueEntry* entry = preDecodeParsing ? preDecodeEntry : currentlyReadingEntry;
     
-    if (!currentlyReadingEntry)
+    if (!entry)
     {
         return;
     }
@@ -847,10 +1407,10 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
             SInt64 offset;
             UInt32 offsetSize = sizeof(offset);
             
-            AudioFileStreamGetProperty(audioFileStream, kAudioFileStreamProperty_DataOffset, &offsetSize, &offset);
+            AudioFileStreamGetProperty(inAudioFileStream, kAudioFileStreamProperty_DataOffset, &offsetSize, &offset);
             
-            currentlyReadingEntry->parsedHeader = YES;
-            currentlyReadingEntry->audioDataOffset = offset;
+            entry->parsedHeader = YES;
+            entry->audioDataOffset = offset;
             
             break;
         }
@@ -866,15 +1426,15 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
         case kAudioFileStreamProperty_DataFormat:
         {
             AudioStreamBasicDescription newBasicDescription;
-            STKQueueEntry* entryToUpdate = currentlyReadingEntry;
+            STKQueueEntry* entryToUpdate = entry;
 
-            if (!currentlyReadingEntry->parsedHeader)
+            if (!entry->parsedHeader)
             {
                 UInt32 size = sizeof(newBasicDescription);
                 
                 AudioFileStreamGetProperty(inAudioFileStream, kAudioFileStreamProperty_DataFormat, &size, &newBasicDescription);
 
-                pthread_mutex_lock(&playerMutex);
+                LockPlayerMutex(self);
                 
                 if (entryToUpdate->audioStreamBasicDescription.mFormatID == 0)
                 {
@@ -887,11 +1447,11 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
                 UInt32 packetBufferSize = 0;
                 UInt32 sizeOfPacketBufferSize = sizeof(packetBufferSize);
                 
-                error = AudioFileStreamGetProperty(audioFileStream, kAudioFileStreamProperty_PacketSizeUpperBound, &sizeOfPacketBufferSize, &packetBufferSize);
+                error = AudioFileStreamGetProperty(inAudioFileStream, kAudioFileStreamProperty_PacketSizeUpperBound, &sizeOfPacketBufferSize, &packetBufferSize);
                 
                 if (error || packetBufferSize == 0)
                 {
-                    error = AudioFileStreamGetProperty(audioFileStream, kAudioFileStreamProperty_MaximumPacketSize, &sizeOfPacketBufferSize, &packetBufferSize);
+                    error = AudioFileStreamGetProperty(inAudioFileStream, kAudioFileStreamProperty_MaximumPacketSize, &sizeOfPacketBufferSize, &packetBufferSize);
                     
                     if (error || packetBufferSize == 0)
                     {
@@ -907,7 +1467,14 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
                     entryToUpdate->packetBufferSize = packetBufferSize;
                 }
                 
-                [self createAudioConverter:&currentlyReadingEntry->audioStreamBasicDescription];
+                if (preDecodeParsing)
+                {
+                    [self createPreDecodeAudioConverter];
+                }
+                else
+                {
+                    [self createAudioConverter:&entry->audioStreamBasicDescription];
+                }
                 
                 pthread_mutex_unlock(&playerMutex);
             }
@@ -921,17 +1488,24 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
             
             AudioFileStreamGetProperty(inAudioFileStream, kAudioFileStreamProperty_AudioDataByteCount, &byteCountSize, &audioDataByteCount);
             
-            currentlyReadingEntry->audioDataByteCount = audioDataByteCount;
+            entry->audioDataByteCount = audioDataByteCount;
             
             break;
         }
 		case kAudioFileStreamProperty_ReadyToProducePackets:
         {
-			if (audioConverterAudioStreamBasicDescription.mFormatID != kAudioFormatLinearPCM)
+			if (!preDecodeParsing && audioConverterAudioStreamBasicDescription.mFormatID != kAudioFormatLinearPCM)
 			{
 				discontinuous = YES;
 			}
             
+            if (entry->seekTable.cursorPacket == 0)
+            {
+                STKSeekTableSetCursorAtStart(&entry->seekTable, entry->audioDataOffset);
+            }
+            
+            [self loadSeekTableForEntry:entry];
+            
             break;
         }
         case kAudioFileStreamProperty_FormatList:
@@ -961,7 +1535,7 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
                 
                 if (pasbd.mFormatID == kAudioFormatMPEG4AAC_HE || pasbd.mFormatID == kAudioFormatMPEG4AAC_HE_V2)
                 {
-                    currentlyReadingEntry->audioStreamBasicDescription = pasbd;
+                    entry->audioStreamBasicDescription = pasbd;
 
                     break;
                 }
@@ -989,6 +1563,8 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
 {
     self.internalState = STKAudioPlayerInternalStateError;
     
+    [self signalOfflineRender];
+    
     [self playbackThreadQueueMainThreadSyncBlock:^
     {
         [self.delegate audioPlayer:self unexpectedError:errorCodeIn];
@@ -1059,7 +1635,11 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
 
 -(void) setRate:(float)rate
 {
+	self->playbackRate = rate;
+	
 	AudioUnitSetParameter(playbackRateUnit, kNewTimePitchParam_Rate, kAudioUnitScope_Global, 0, rate, 0);
+	
+	[self queueGraphCommand:STKAudioPlayerGraphCommandReconnect];
 }
 
 -(float) overlap
@@ -1096,14 +1676,8 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
 		[self processRunloop];
 	}];
 
-	pthread_mutex_lock(&playerMutex);
-
-	if (waiting)
-	{
-		pthread_cond_signal(&playerThreadReadyCondition);
-	}
-
-	pthread_mutex_unlock(&playerMutex);
+	[self signalPcmBufferSpace];
+	[self signalPacketQueueSpace];
 }
 
 -(void) seekToTime:(double)value
@@ -1150,10 +1724,108 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
 {
     STKQueueEntry* next = [bufferingQueue dequeue];
     
-    [self processFinishPlayingIfAnyAndPlayingNext:entry withNext:next];
+    [self processFinishPlayingIfAnyAndPlayingNext:entry withNext:next reachedEnd:YES];
     [self processRunloop];
 }
 
+#pragma mark Render events
+
+// The render thread never takes the playerMutex. It counts frames played against the playing entry with atomics and
+// queues an event when the entry's last frame has been played. The playback thread carries the event out and moves on to
+// the next entry, starting a new generation. Frames the render thread plays in the meantime belong to the next entry and
+// are counted against it once the render thread sees the new generation
+
+/// Sets the playing entry and starts a new generation of it for the render thread. reachedEnd is YES if the previous
+/// entry played to its end so frames played past it belong to entry
+-(void) setCurrentlyPlayingEntry:(STKQueueEntry*)entry reachedEnd:(BOOL)reachedEnd
+{
+    setLock(&currentEntryReferencesLock);
+    
+    playingEntryPredecessorGeneration = reachedEnd ? playingEntryGeneration : 0;
+    playingEntryGeneration = playingEntryGeneration == UINT32_MAX ? 1 : playingEntryGeneration + 1;
+    currentlyPlayingEntry = entry;
+    
+    lockUnlock(&currentEntryReferencesLock);
+}
+
+/// Carries out the events queued by the render thread. Called with the playerMutex held
+-(void) processRenderEvents
+{
+    STKPacketQueueRecord record;
+    
+    // The playback thread is the queue's only consumer
+    
+    if ([NSThread currentThread] != playbackThread)
+    {
+        return;
+    }
+    
+    BOOL processed = NO;
+    
+    while (STKPacketQueuePeek(&renderEventQueue, &record))
+    {
+        STKPacketQueuePop(&renderEventQueue);
+        
+        processed = YES;
+        
+        // Events for an entry that has since been replaced (by seeking or stopping) no longer apply
+        
+        if (record.type == STKRenderEventEntryFinished && record.count == playingEntryGeneration && currentlyPlayingEntry != nil)
+        {
+            [self audioQueueFinishedPlaying:currentlyPlayingEntry];
+        }
+    }
+    
+    // State changes are told here whatever the events were so one the render thread couldn't queue still goes out
+    
+    if (processed)
+    {
+        [self dispatchStateChange];
+    }
+}
+
+-(void) handleMachMessage:(void*)message
+{
+    // Render events are carried out by processRunloop once the run loop returns
+}
+
+/// Queues a render event and wakes the playback thread without blocking. Returns NO if the queue is full.
+/// A full port queue means the playback thread is already due to wake
+static BOOL QueueRenderEvent(STKAudioPlayer* audioPlayer, STKRenderEventType type, uint32_t count)
+{
+    if (!STKPacketQueuePush(&audioPlayer->renderEventQueue, type, count, 0, NULL))
+    {
+        return NO;
+    }
+    
+    mach_msg_header_t header =
+    {
+        .msgh_bits = MACH_MSGH_BITS(MACH_MSG_TYPE_MAKE_SEND, 0),
+        .msgh_size = sizeof(mach_msg_header_t),
+        .msgh_remote_port = audioPlayer->renderEventMachPort,
+        .msgh_local_port = MACH_PORT_NULL,
+        .msgh_id = 0
+    };
+    
+    mach_msg(&header, MACH_SEND_MSG | MACH_SEND_TIMEOUT, sizeof(header), 0, MACH_PORT_NULL, 0, MACH_PORT_NULL);
+    
+    return YES;
+}
+
+/// Changes the state from the render thread if the player is running and not paused. The delegate is told by the playback thread
+static void SetInternalStateFromRenderThread(STKAudioPlayer* audioPlayer, STKAudioPlayerInternalState value)
+{
+    BOOL changed = [audioPlayer changeInternalState:value ifInState:^BOOL(STKAudioPlayerInternalState state)
+    {
+        return (state & STKAudioPlayerInternalStateRunning) && state != STKAudioPlayerInternalStatePaused;
+    }];
+    
+    if (changed)
+    {
+        QueueRenderEvent(audioPlayer, STKRenderEventStateChanged, 0);
+    }
+}
+
 -(void) setCurrentlyReadingEntry:(STKQueueEntry*)entry andStartPlaying:(BOOL)startPlaying
 {
     [self setCurrentlyReadingEntry:entry andStartPlaying:startPlaying clearQueue:YES];
@@ -1165,7 +1837,10 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
 
     if (startPlaying)
     {
-        memset(&pcmAudioBuffer->mData[0], 0, pcmBufferTotalFrameCount * pcmBufferFrameSizeInBytes);
+        [self flushDecoder];
+        [self closeRecordAudioFile];
+        
+        STKRingBufferFlush(&pcmRingBuffer);
     }
     
     if (audioFileStream)
@@ -1177,20 +1852,46 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
     
     if (currentlyReadingEntry)
     {
+        [self saveSeekTableForEntry:currentlyReadingEntry];
+        
         currentlyReadingEntry.dataSource.delegate = nil;
         [currentlyReadingEntry.dataSource unregisterForEvents];
         [currentlyReadingEntry.dataSource close];
     }
     
+    BOOL preDecoded = entry != nil && entry == preDecodeEntry && [self canAdoptPreDecodeStartPlaying:startPlaying];
+    
+    // Frames still staged for the previous reading entry are moved by the decode thread (or were flushed above)
+    
+    if (!preDecoded && entry != nil && entry == preDecodeEntry)
+    {
+        [self cancelPreDecode];
+    }
+    
     setLock(&currentEntryReferencesLock);
     currentlyReadingEntry = entry;
     lockUnlock(&currentEntryReferencesLock);
     
-    currentlyReadingEntry.dataSource.delegate = self;
-    [currentlyReadingEntry.dataSource registerForEvents:[NSRunLoop currentRunLoop]];
-    [currentlyReadingEntry.dataSource seekToOffset:0];
+    if (entry != nil)
+    {
+        entry->readStartTime = CFAbsoluteTimeGetCurrent();
+    }
     
-    [self closeRecordAudioFile];
+    if (preDecoded)
+    {
+        [self adoptPreDecode];
+    }
+    else
+    {
+        if (entry != nil)
+        {
+            STKSeekTableSetCursor(&entry->seekTable, 0, 0);
+        }
+        
+        currentlyReadingEntry.dataSource.delegate = self;
+        [currentlyReadingEntry.dataSource registerForEvents:[NSRunLoop currentRunLoop]];
+        [currentlyReadingEntry.dataSource seekToOffset:0];
+    }
     
     if (startPlaying)
     {
@@ -1207,9 +1908,19 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
     {
         [bufferingQueue enqueue:entry];
     }
+    
+    if (preDecoded)
+    {
+        [self resumeAdoptedPreDecode];
+    }
 }
 
 -(void) processFinishPlayingIfAnyAndPlayingNext:(STKQueueEntry*)entry withNext:(STKQueueEntry*)next
+{
+    [self processFinishPlayingIfAnyAndPlayingNext:entry withNext:next reachedEnd:NO];
+}
+
+-(void) processFinishPlayingIfAnyAndPlayingNext:(STKQueueEntry*)entry withNext:(STKQueueEntry*)next reachedEnd:(BOOL)reachedEnd
 {
     if (entry != currentlyPlayingEntry)
     {
@@ -1237,10 +1948,9 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
             lockUnlock(&seekLock);
         }
         
-        setLock(&currentEntryReferencesLock);
-        currentlyPlayingEntry = next;
-        NSObject* playingQueueItemId = playingQueueItemId = currentlyPlayingEntry.queueItemId;
-        lockUnlock(&currentEntryReferencesLock);
+        [self setCurrentlyPlayingEntry:next reachedEnd:reachedEnd];
+        
+        NSObject* playingQueueItemId = next.queueItemId;
         
         if (!isPlayingSameItemProbablySeek && entry)
         {
@@ -1262,9 +1972,7 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
     }
     else
     {
-        setLock(&currentEntryReferencesLock);
-		currentlyPlayingEntry = nil;
-        lockUnlock(&currentEntryReferencesLock);
+        [self setCurrentlyPlayingEntry:nil reachedEnd:NO];
         
         if (!isPlayingSameItemProbablySeek && entry)
         {
@@ -1286,6 +1994,11 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
 	{
 		return;
 	}
+	
+	if ([self dispatchToDelegateQueue:block])
+	{
+		return;
+	}
 
 	dispatch_async(dispatch_get_main_queue(), ^
 	{
@@ -1322,6 +2035,11 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
 
 -(void) playbackThreadQueueMainThreadSyncBlock:(void(^)(void))block
 {
+    if ([self dispatchToDelegateQueue:block])
+    {
+        return;
+    }
+    
     block = [block copy];
     
     [self invokeOnPlaybackThread:^
@@ -1339,22 +2057,20 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
 {
     if (bufferingQueue.count > 0)
     {
-        for (STKQueueEntry* queueEntry in bufferingQueue)
+        [bufferingQueue enumerateEntriesWithOptions:0 usingBlock:^(STKQueueEntry* queueEntry, BOOL* stop)
         {
             queueEntry->parsedHeader = NO;
             
             [queueEntry reset];
-        }
+        }];
 
         [upcomingQueue skipQueueWithQueue:bufferingQueue];
-        
-        [bufferingQueue removeAllObjects];
     }
 }
 
 -(BOOL) processRunloop
 {
-    pthread_mutex_lock(&playerMutex);
+    LockPlayerMutex(self);
     {
         if (disposeWasRequested)
         {
@@ -1362,7 +2078,11 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
             
             return NO;
         }
-        else if (self.internalState == STKAudioPlayerInternalStatePaused)
+        
+        [self processGraphCommands];
+        [self processRenderEvents];
+        
+        if (self.internalState == STKAudioPlayerInternalStatePaused)
         {
             pthread_mutex_unlock(&playerMutex);
             
@@ -1379,6 +2099,10 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
         }
         else if (seekToTimeWasRequested && currentlyPlayingEntry && currentlyPlayingEntry != currentlyReadingEntry)
         {
+            // The decode thread may still be queueing frames for the entries about to be reset
+            
+            [self flushDecoder];
+            
             currentlyPlayingEntry->parsedHeader = NO;
             [currentlyPlayingEntry reset];
             
@@ -1421,6 +2145,10 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
             }
         }
         
+        [self processPreDecode];
+        [self processPrefetch];
+        [self updateBufferingThresholds];
+        
         if (currentlyPlayingEntry && currentlyPlayingEntry->parsedHeader && [currentlyPlayingEntry calculatedBitRate] > 0.0)
         {
             int32_t originalSeekVersion;
@@ -1463,7 +2191,15 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
 		[threadStartedLock lockWhenCondition:0];
         [threadStartedLock unlockWithCondition:1];
 		
-		[playbackThreadRunLoop addPort:[NSPort port] forMode:NSDefaultRunLoopMode];
+		[playbackThreadRunLoop addPort:renderEventPort forMode:NSDefaultRunLoopMode];
+        
+        STKAudioPlayerCounters* playerCounters = &counters;
+        CFRunLoopObserverRef wakeupObserver = CFRunLoopObserverCreateWithHandler(NULL, kCFRunLoopAfterWaiting, true, 0, ^(CFRunLoopObserverRef observer, CFRunLoopActivity activity)
+        {
+            STKCounterAdd(&playerCounters->playbackThreadWakeupCount, 1);
+        });
+        
+        CFRunLoopAddObserver(playbackThreadRunLoop.getCFRunLoop, wakeupObserver, kCFRunLoopCommonModes);
         
 		while (true)
 		{
@@ -1482,15 +2218,22 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
 		disposeWasRequested = NO;
 		seekToTimeWasRequested = NO;
 		
+        CFRunLoopObserverInvalidate(wakeupObserver);
+        CFRelease(wakeupObserver);
+        
+		[self stopDecodeThread];
+		[self cancelPreDecode];
+		[self cancelPrefetch];
+		
 		[currentlyReadingEntry.dataSource unregisterForEvents];
 		[currentlyPlayingEntry.dataSource unregisterForEvents];
 		
 		currentlyReadingEntry.dataSource.delegate = nil;
 		currentlyPlayingEntry.dataSource.delegate = nil;
 		
-        pthread_mutex_lock(&playerMutex);
+        LockPlayerMutex(self);
+        [self setCurrentlyPlayingEntry:nil reachedEnd:NO];
         setLock(&currentEntryReferencesLock);
-		currentlyPlayingEntry = nil;
 		currentlyReadingEntry = nil;
         lockUnlock(&currentEntryReferencesLock);
         pthread_mutex_unlock(&playerMutex);
@@ -1533,35 +2276,59 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
     
     double calculatedBitRate = [currentEntry calculatedBitRate];
     
+    // The index only keeps growing from a known packet
+    
+    STKSeekTableSetCursor(&currentEntry->seekTable, -1, 0);
+    currentEntry->packetsToDiscard = 0;
+    
     if (currentEntry->packetDuration > 0 && calculatedBitRate > 0)
     {
         UInt32 ioFlags = 0;
         SInt64 packetAlignedByteOffset;
         SInt64 seekPacket = floor(requestedSeekTime / currentEntry->packetDuration);
+        UInt64 indexedPacket, indexedByteOffset;
         
-        error = AudioFileStreamSeek(audioFileStream, seekPacket, &packetAlignedByteOffset, &ioFlags);
-        
-        if (!error) {
-            seekByteOffset = packetAlignedByteOffset + currentEntry->audioDataOffset;
-            if (!(ioFlags & kAudioFileStreamSeekFlag_OffsetIsEstimated)) {
-                double delta = ((seekByteOffset - (SInt64)currentEntry->audioDataOffset) - packetAlignedByteOffset) / calculatedBitRate * 8;
-
-                setLock(&currentEntry->spinLock);
-                currentEntry->seekTime -= delta;
-                lockUnlock(&currentEntry->spinLock);
+        if (STKSeekTableLookup(&currentEntry->seekTable, seekPacket, &indexedPacket, &indexedByteOffset))
+        {
+            seekByteOffset = currentEntry->audioDataOffset + indexedByteOffset;
+            currentEntry->packetsToDiscard = (UInt32)(seekPacket - indexedPacket);
+            
+            STKSeekTableSetCursor(&currentEntry->seekTable, indexedPacket, indexedByteOffset);
+            
+            setLock(&currentEntry->spinLock);
+            currentEntry->seekTime = seekPacket * currentEntry->packetDuration;
+            lockUnlock(&currentEntry->spinLock);
+        }
+        else
+        {
+            error = AudioFileStreamSeek(audioFileStream, seekPacket, &packetAlignedByteOffset, &ioFlags);
+            
+            if (!error) {
+                seekByteOffset = packetAlignedByteOffset + currentEntry->audioDataOffset;
+                if (!(ioFlags & kAudioFileStreamSeekFlag_OffsetIsEstimated)) {
+                    double delta = ((seekByteOffset - (SInt64)currentEntry->audioDataOffset) - packetAlignedByteOffset) / calculatedBitRate * 8;
+
+                    setLock(&currentEntry->spinLock);
+                    currentEntry->seekTime -= delta;
+                    lockUnlock(&currentEntry->spinLock);
+                }
+                else
+                {
+                    UInt64 estimatedByteOffset;
+                    double duration = [currentEntry duration];
+                    
+                    // A Xing/VBRI table of contents is closer than an estimate from the average bit rate
+                    
+                    if (duration > 0 && STKSeekTableEstimateOffset(&currentEntry->seekTable, requestedSeekTime / duration, currentEntry.dataSource.length, &estimatedByteOffset))
+                    {
+                        seekByteOffset = estimatedByteOffset;
+                    }
+                }
             }
         }
     }
     
-    if (audioConverterRef)
-    {
-        AudioConverterReset(audioConverterRef);
-    }
-    
-    if (recordAudioConverterRef)
-    {
-        AudioConverterReset(recordAudioConverterRef);
-    }
+    [self flushDecoder];
     
     [currentEntry reset];
     [currentEntry.dataSource seekToOffset:seekByteOffset];
@@ -1570,16 +2337,35 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
 	
     self.internalState = STKAudioPlayerInternalStateWaitingForDataAfterSeek;
     
-    if (audioGraph)
+    // Offline and engine players have no graph of their own but still hold frames from before the seek
+    
+    [self resetPcmBuffers];
+}
+
+/// Reads into readBuffer or, for data sources that support it, points bytes straight at the data source's own bytes
+-(int) readFromDataSource:(STKDataSource*)dataSource bytes:(const UInt8**)bytesOut withSize:(int)size
+{
+    if (dataSource.supportsReadBytesNoCopy)
     {
-        [self resetPcmBuffers];
+        return [dataSource readBytesNoCopy:bytesOut withSize:size];
     }
+    
+    *bytesOut = readBuffer;
+    
+    return [dataSource readIntoBuffer:readBuffer withSize:size];
 }
 
 -(void) dataSourceDataAvailable:(STKDataSource*)dataSourceIn
 {
 	OSStatus error;
     
+    if (preDecodeEntry != nil && preDecodeEntry.dataSource == dataSourceIn)
+    {
+        [self preDecodeDataSourceDataAvailable:dataSourceIn];
+        
+        return;
+    }
+    
     if (currentlyReadingEntry.dataSource != dataSourceIn)
     {
         return;
@@ -1590,7 +2376,29 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
         return;
     }
     
-    int read = [currentlyReadingEntry.dataSource readIntoBuffer:readBuffer withSize:readBufferSize];
+    int readSize = [self packetQueueReadSize];
+    
+    if (readSize == 0)
+    {
+        // The decode thread picks reading up again once it has made room. It may have done so before it could see the flag
+        
+        __atomic_store_n(&readingPaused, YES, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        
+        readSize = [self packetQueueReadSize];
+        
+        if (readSize == 0)
+        {
+            return;
+        }
+        
+        __atomic_store_n(&readingPaused, NO, __ATOMIC_SEQ_CST);
+    }
+    
+    const UInt8* bytes;
+    int read = [self readFromDataSource:currentlyReadingEntry.dataSource bytes:&bytes withSize:readSize];
+    
+    [self recordRead:read forEntry:currentlyReadingEntry];
     
     if (read == 0)
     {
@@ -1621,6 +2429,8 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
         return;
     }
     
+    STKSeekTableScanHeader(&currentlyReadingEntry->seekTable, bytes, read, currentlyReadingEntry.dataSource.position - read);
+    
     int flags = 0;
     
     if (discontinuous)
@@ -1630,7 +2440,7 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
     
     if (audioFileStream)
     {
-        error = AudioFileStreamParseBytes(audioFileStream, read, readBuffer, flags);
+        error = AudioFileStreamParseBytes(audioFileStream, read, bytes, flags);
         
         if (error)
         {
@@ -1656,6 +2466,15 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
 
 -(void) dataSourceErrorOccured:(STKDataSource*)dataSourceIn
 {
+    if (preDecodeEntry != nil && preDecodeEntry.dataSource == dataSourceIn)
+    {
+        // The item is read again from the start when it's needed and reports the error then
+        
+        [self cancelPreDecode];
+        
+        return;
+    }
+    
     if (currentlyReadingEntry.dataSource != dataSourceIn)
     {
         return;
@@ -1666,6 +2485,13 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
 
 -(void) dataSourceEof:(STKDataSource*)dataSourceIn
 {
+    if (preDecodeEntry != nil && preDecodeEntry.dataSource == dataSourceIn)
+    {
+        preDecodeEof = YES;
+        
+        return;
+    }
+    
     if (currentlyReadingEntry == nil || currentlyReadingEntry.dataSource != dataSourceIn)
     {
         dataSourceIn.delegate = nil;
@@ -1682,14 +2508,14 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
     
     NSObject* queueItemId = currentlyReadingEntry.queueItemId;
     
-    [self closeRecordAudioFile];
+    [self saveSeekTableForEntry:currentlyReadingEntry];
     
     [self dispatchSyncOnMainThread:^
     {
         [self.delegate audioPlayer:self didFinishBufferingSourceWithQueueItemId:queueItemId];
     }];
 
-    pthread_mutex_lock(&playerMutex);
+    LockPlayerMutex(self);
     
     if (currentlyReadingEntry == nil)
     {
@@ -1700,9 +2526,9 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
         return;
     }
     
-    setLock(&currentlyReadingEntry->spinLock);
-    currentlyReadingEntry->lastFrameQueued = currentlyReadingEntry->framesQueued;
-    lockUnlock(&currentlyReadingEntry->spinLock);
+    // The decode thread marks the last frame (and closes any recording) once it gets to this
+    
+    [self queueDecodeRecord:STKDecodeRecordEndOfEntry forEntry:currentlyReadingEntry count:0];
     
     currentlyReadingEntry.dataSource.delegate = nil;
     [currentlyReadingEntry.dataSource unregisterForEvents];
@@ -1720,12 +2546,36 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
 -(void)dataSource:(STKDataSource *)dataSource didReadStreamMetadata:(NSDictionary *)metadata
 {
     if([self.delegate respondsToSelector:@selector(audioPlayer:didReadStreamMetadata:)])
-        [self.delegate audioPlayer:self didReadStreamMetadata:metadata];
+    {
+        STKDelegateDispatcher* dispatcher = [self currentDelegateDispatcher];
+        
+        if (dispatcher == nil)
+        {
+            [self.delegate audioPlayer:self didReadStreamMetadata:metadata];
+            
+            return;
+        }
+        
+        // Metadata is superseded by the next so it's dropped rather than queued without limit if the delegateQueue falls behind
+        
+        BOOL dispatched = [dispatcher dispatchDroppable:^
+        {
+            if (!self->disposeWasRequested)
+            {
+                [self.delegate audioPlayer:self didReadStreamMetadata:metadata];
+            }
+        }];
+        
+        if (!dispatched)
+        {
+            STKCounterAdd(&counters.delegateCallbacksDropped, 1);
+        }
+    }
 }
 
 -(void) pause
 {
-    pthread_mutex_lock(&playerMutex);
+    LockPlayerMutex(self);
     {
 		OSStatus error;
         
@@ -1749,6 +2599,7 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
             }
             
             [self wakeupPlaybackThread];
+            [self signalOfflineRender];
         }
     }
     pthread_mutex_unlock(&playerMutex);
@@ -1756,7 +2607,7 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
 
 -(void) resume
 {
-    pthread_mutex_lock(&playerMutex);
+    LockPlayerMutex(self);
     {
 		OSStatus error;
 		
@@ -1791,21 +2642,13 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
 
 -(void) resetPcmBuffers
 {
-    setLock(&pcmBufferSpinLock);
-    
-    self->pcmBufferFrameStartIndex = 0;
-    self->pcmBufferUsedFrameCount = 0;
-	self->peakPowerDb[0] = STK_DBMIN;
-	self->peakPowerDb[1] = STK_DBMIN;
-	self->averagePowerDb[0] = STK_DBMIN;
-	self->averagePowerDb[1] = STK_DBMIN;
-    
-    lockUnlock(&pcmBufferSpinLock);
+    STKRingBufferFlush(&pcmRingBuffer);
+    STKMeterReset(&meter);
 }
 
 -(void) stop
 {
-    pthread_mutex_lock(&playerMutex);
+    LockPlayerMutex(self);
     {
         if (self.internalState == STKAudioPlayerInternalStateStopped)
         {
@@ -1822,8 +2665,10 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
 		
         [self invokeOnPlaybackThread:^
         {
-            pthread_mutex_lock(&self->playerMutex);
+            LockPlayerMutex(self);
             {
+                [self flushDecoder];
+                
                 self->currentlyReadingEntry.dataSource.delegate = nil;
                 [self->currentlyReadingEntry.dataSource unregisterForEvents];
                 [self->currentlyReadingEntry.dataSource close];
@@ -1835,8 +2680,9 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
                 
                 [self clearQueue];
                 
+                [self setCurrentlyPlayingEntry:nil reachedEnd:NO];
+                
                 setLock(&self->currentEntryReferencesLock);
-                self->currentlyPlayingEntry = nil;
                 self->currentlyReadingEntry = nil;
                 self->seekToTimeWasRequested = NO;
                 lockUnlock(&self->currentEntryReferencesLock);
@@ -1866,10 +2712,12 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
             CFRunLoopStop(CFRunLoopGetCurrent());
         }];
         
-        pthread_mutex_lock(&playerMutex);
+        LockPlayerMutex(self);
         disposeWasRequested = YES;
-        pthread_cond_signal(&playerThreadReadyCondition);
         pthread_mutex_unlock(&playerMutex);
+        
+        [self signalPcmBufferSpace];
+        [self signalPacketQueueSpace];
 
         pthread_mutex_lock(&mainThreadSyncCallMutex);
         disposeWasRequested = YES;
@@ -1912,31 +2760,14 @@ static void AudioFileStreamPacketsProc(void* clientData, UInt32 numberBytes, UIn
 
 -(void) closeRecordAudioFile
 {
-    if (recordAudioFileId)
-    {
-        AudioFileClose(recordAudioFileId);
-        recordAudioFileId = NULL;
-    }
-    
-    if (recordAudioConverterRef)
-    {
-        AudioConverterDispose(recordAudioConverterRef);
-        recordAudioConverterRef = nil;
-    }
+    // Recording happens on the decode thread. The writer finishes the file in the background
     
-    if (recordOutputBuffer)
-    {
-        free(recordOutputBuffer);
-        recordOutputBuffer = NULL;
-    }
+    pthread_mutex_lock(&decodeMutex);
     
-    if (recordPacketDescriptions)
-    {
-        free(recordPacketDescriptions);
-        recordPacketDescriptions = NULL;
-    }
+    [recordingWriter close];
+    recordingWriter = nil;
     
-    recordFilePacketPosition = 0;
+    pthread_mutex_unlock(&decodeMutex);
 }
 
 -(void) dispose
@@ -2007,56 +2838,62 @@ static BOOL GetHardwareCodecClassDesc(UInt32 formatId, AudioClassDescription* cl
     }
 }
 
+/// Creates the converter for the reading entry and hands it to the decode thread after the packets already queued
 -(void) createAudioConverter:(AudioStreamBasicDescription*)asbd
 {
     OSStatus status;
     Boolean writable;
     UInt32 cookieSize = 0;
+    AudioConverterRef converter = nil;
     
-    if (memcmp(asbd, &audioConverterAudioStreamBasicDescription, sizeof(AudioStreamBasicDescription)) == 0)
+    if (options.pcmSampleRate == STKAudioPlayerSampleRateSource
+        && asbd->mSampleRate > 0
+        && asbd->mSampleRate != canonicalAudioStreamBasicDescription.mSampleRate
+        && currentlyReadingEntry == currentlyPlayingEntry
+        && STKRingBufferUsedFrameCount(&pcmRingBuffer) == 0
+        && STKPacketQueueIsEmpty(&packetQueue))
     {
-        AudioConverterReset(audioConverterRef);
+        // Nothing is left to decode so the decode thread isn't using the buffers being replaced
         
-        if (recordAudioConverterRef)
-        {
-            AudioConverterReset(recordAudioConverterRef);
-        }
+        pthread_mutex_lock(&decodeMutex);
         
-        return;
+        [self destroyAudioConverter];
+        
+        memset(&audioConverterAudioStreamBasicDescription, 0, sizeof(audioConverterAudioStreamBasicDescription));
+        
+        [self reconfigureForSampleRate:asbd->mSampleRate];
+        
+        pthread_mutex_unlock(&decodeMutex);
     }
-
-    [self destroyAudioConverter];
     
     BOOL isRecording = currentlyReadingEntry.dataSource.recordToFileUrl != nil;
     
-    if (isRecording)
+    if (memcmp(asbd, &audioConverterAudioStreamBasicDescription, sizeof(AudioStreamBasicDescription)) == 0)
     {
-        recordAudioStreamBasicDescription = (AudioStreamBasicDescription)
+        [self queueDecodeRecord:STKDecodeRecordConverterReset forEntry:nil count:0];
+        
+        if (isRecording)
         {
-            .mFormatID = kAudioFormatMPEG4AAC,
-            .mFormatFlags = kMPEG4Object_AAC_LC,
-            .mChannelsPerFrame = canonicalAudioStreamBasicDescription.mChannelsPerFrame,
-            .mSampleRate = canonicalAudioStreamBasicDescription.mSampleRate,
-        };
+            [self queueDecodeRecord:STKDecodeRecordStartRecording forEntry:currentlyReadingEntry count:0];
+        }
         
-        UInt32 dataSize = sizeof(recordAudioStreamBasicDescription);
-        AudioFormatGetProperty(kAudioFormatProperty_FormatInfo,
-                               0,
-                               NULL,
-                               &dataSize,
-                               &recordAudioStreamBasicDescription);
+        return;
     }
     
+    // Packets are dropped until the new converter is queued
+    
+    memset(&audioConverterAudioStreamBasicDescription, 0, sizeof(audioConverterAudioStreamBasicDescription));
+    
     AudioClassDescription classDesc;
     
     if (GetHardwareCodecClassDesc(asbd->mFormatID, &classDesc))
     {
-        AudioConverterNewSpecific(asbd, &canonicalAudioStreamBasicDescription, 1,  &classDesc, &audioConverterRef);
+        AudioConverterNewSpecific(asbd, &canonicalAudioStreamBasicDescription, 1,  &classDesc, &converter);
     }
     
-    if (!audioConverterRef)
+    if (!converter)
     {
-        status = AudioConverterNew(asbd, &canonicalAudioStreamBasicDescription, &audioConverterRef);
+        status = AudioConverterNew(asbd, &canonicalAudioStreamBasicDescription, &converter);
         
         if (status)
         {
@@ -2066,120 +2903,40 @@ static BOOL GetHardwareCodecClassDesc(UInt32 formatId, AudioClassDescription* cl
         }
     }
     
-    if (isRecording && !recordAudioConverterRef)
-    {
-        status = AudioConverterNew(&canonicalAudioStreamBasicDescription, &recordAudioStreamBasicDescription, &recordAudioConverterRef);
-        
-        if (status)
-        {
-            NSLog(@"STKAudioPlayer failed to create a recording audio converter");
-        }
-    }
-
-    audioConverterAudioStreamBasicDescription = *asbd;
-    
     if (self->currentlyReadingEntry.dataSource.audioFileTypeHint != kAudioFileAAC_ADTSType)
     {
         status = AudioFileStreamGetPropertyInfo(audioFileStream, kAudioFileStreamProperty_MagicCookieData, &cookieSize, &writable);
     
-        if (status)
-        {
-            return;
-        }
-        
-        void* cookieData = alloca(cookieSize);
-        
-        status = AudioFileStreamGetProperty(audioFileStream, kAudioFileStreamProperty_MagicCookieData, &cookieSize, cookieData);
-        
-        if (status)
+        if (status == 0)
         {
-            return;
-        }
-        
-        status = AudioConverterSetProperty(audioConverterRef, kAudioConverterDecompressionMagicCookie, cookieSize, cookieData);
-        
-        if (status)
-        {
-            [self unexpectedError:STKAudioPlayerErrorAudioSystemError];
+            void* cookieData = alloca(cookieSize);
             
-            return;
-        }
-    }
-    
-    if (recordAudioConverterRef)
-    {
-        if (recordAudioFileId)
-        {
-            AudioFileClose(recordAudioFileId);
-            recordAudioFileId = NULL;
-        }
-        
-        if (recordOutputBuffer)
-        {
-            free(recordOutputBuffer);
-            recordOutputBuffer = NULL;
-        }
-        
-        if (recordPacketDescriptions)
-        {
-            free(recordPacketDescriptions);
-            recordPacketDescriptions = NULL;
-        }
-        
-        recordOutputBufferSize = 32 * 1024;
-        recordPacketSize = canonicalAudioStreamBasicDescription.mBytesPerPacket;
-        
-        if (recordPacketSize == 0)
-        {
-            UInt32 size = sizeof(recordPacketSize);
-            if (0 == AudioConverterGetProperty(recordAudioConverterRef, kAudioConverterPropertyMaximumOutputPacketSize, &size, &recordPacketSize))
+            status = AudioFileStreamGetProperty(audioFileStream, kAudioFileStreamProperty_MagicCookieData, &cookieSize, cookieData);
+            
+            if (status == 0)
             {
-                if (recordPacketSize > recordOutputBufferSize)
+                status = AudioConverterSetProperty(converter, kAudioConverterDecompressionMagicCookie, cookieSize, cookieData);
+                
+                if (status)
                 {
-                    recordOutputBufferSize = recordPacketSize;
+                    AudioConverterDispose(converter);
+                    
+                    [self unexpectedError:STKAudioPlayerErrorAudioSystemError];
+                    
+                    return;
                 }
-                
-                recordPacketsPerBuffer = recordOutputBufferSize / recordPacketSize;
-            }
-            else
-            {
-                AudioConverterDispose(recordAudioConverterRef);
-                recordAudioConverterRef = NULL;
-                
-                NSLog(@"STKAudioPlayer: Can't support this output format for recording");
             }
         }
-        else
-        {
-            recordPacketsPerBuffer = recordOutputBufferSize / recordPacketSize;
-        }
-        
-        UInt32 propertySize = sizeof(UInt32);
-        UInt32 externallyFramed = 0;
-        OSStatus error = AudioFormatGetProperty(kAudioFormatProperty_FormatIsExternallyFramed, sizeof(recordAudioStreamBasicDescription), &recordAudioStreamBasicDescription, &propertySize, &externallyFramed);
-        
-        if (externallyFramed)
-        {
-            recordPacketDescriptions = (AudioStreamPacketDescription *)malloc(sizeof(AudioStreamPacketDescription) * recordPacketsPerBuffer);
-        }
-        
-        recordOutputBuffer = (UInt8 *)malloc(sizeof(UInt8) * recordOutputBufferSize);
-            
-        error = AudioFileCreateWithURL(
-                                                (__bridge CFURLRef)(currentlyReadingEntry.dataSource.recordToFileUrl),
-                                                kAudioFileCAFType,
-                                                &recordAudioStreamBasicDescription,
-                                                kAudioFileFlags_EraseFile,
-                                                &recordAudioFileId);
-        
-        recordFilePacketPosition = 0;
-        
-        if (error)
-        {
-            NSLog(@"STKAudioPlayer failed to create a recording audio file at %@", currentlyReadingEntry.dataSource.recordToFileUrl);
-            
-            [self closeRecordAudioFile];
-        }
+    }
+    
+    if ([self queueConverter:converter withFormat:asbd])
+    {
+        audioConverterAudioStreamBasicDescription = *asbd;
+    }
+    
+    if (isRecording)
+    {
+        [self queueDecodeRecord:STKDecodeRecordStartRecording forEntry:currentlyReadingEntry count:0];
     }
 }
 
@@ -2195,8 +2952,6 @@ static BOOL GetHardwareCodecClassDesc(UInt32 formatId, AudioClassDescription* cl
 #if TARGET_OS_IPHONE
     CHECK_STATUS_AND_RETURN(AudioUnitSetParameter(playbackRateUnit, kNewTimePitchParam_Rate, kAudioUnitScope_Global, 0, 1, 0));
 #endif
-    
-  CHECK_STATUS_AND_RETURN(AudioUnitSetProperty(playbackRateUnit, kAudioUnitProperty_StreamFormat, kAudioUnitScope_Input, kOutputBus, &canonicalAudioStreamBasicDescription, sizeof(canonicalAudioStreamBasicDescription)));
 }
 
 -(void) createOutputUnit
@@ -2216,7 +2971,20 @@ static BOOL GetHardwareCodecClassDesc(UInt32 formatId, AudioClassDescription* cl
 	CHECK_STATUS_AND_RETURN(AudioUnitSetProperty(outputUnit, kAudioOutputUnitProperty_EnableIO, kAudioUnitScope_Input, kInputBus, &flag, sizeof(flag)));
 #endif
     
-    CHECK_STATUS_AND_RETURN(AudioUnitSetProperty(outputUnit, kAudioUnitProperty_StreamFormat, kAudioUnitScope_Input, kOutputBus, &canonicalAudioStreamBasicDescription, sizeof(canonicalAudioStreamBasicDescription)));
+    if (options.pcmSampleRate == STKAudioPlayerSampleRateHardware)
+    {
+        AudioStreamBasicDescription hardwareFormat;
+        UInt32 size = sizeof(hardwareFormat);
+        
+        if (AudioUnitGetProperty(outputUnit, kAudioUnitProperty_StreamFormat, kAudioUnitScope_Output, kOutputBus, &hardwareFormat, &size) == 0
+            && hardwareFormat.mSampleRate > 0
+            && hardwareFormat.mSampleRate != canonicalAudioStreamBasicDescription.mSampleRate)
+        {
+            canonicalAudioStreamBasicDescription.mSampleRate = hardwareFormat.mSampleRate;
+            
+            [self createPcmBuffers];
+        }
+    }
 }
 
 -(void) createMixerUnit
@@ -2235,58 +3003,17 @@ static BOOL GetHardwareCodecClassDesc(UInt32 formatId, AudioClassDescription* cl
 	UInt32 busCount = 1;
 	
 	CHECK_STATUS_AND_RETURN(AudioUnitSetProperty(mixerUnit, kAudioUnitProperty_ElementCount, kAudioUnitScope_Input, 0, &busCount, sizeof(busCount)));
-	
-	Float64 graphSampleRate = 44100.0;
-	
-	CHECK_STATUS_AND_RETURN(AudioUnitSetProperty(mixerUnit, kAudioUnitProperty_SampleRate, kAudioUnitScope_Output, 0, &graphSampleRate, sizeof(graphSampleRate)));
 	CHECK_STATUS_AND_RETURN(AudioUnitSetParameter(mixerUnit, kMultiChannelMixerParam_Volume, kAudioUnitScope_Input, 0, 1.0, 0));
 }
 
--(void) createEqUnit
-{
-#if TARGET_OS_MAC && MAC_OS_X_VERSION_MAX_ALLOWED < MAC_OS_X_VERSION_10_9
-    return;
-#else
-	OSStatus status;
-    
-	if (self->options.equalizerBandFrequencies[0] == 0)
-    {
-		return;
-	}
-	
-	CHECK_STATUS_AND_RETURN(AUGraphAddNode(audioGraph, &nbandUnitDescription, &eqNode));
-	CHECK_STATUS_AND_RETURN(AUGraphNodeInfo(audioGraph, eqNode, NULL, &eqUnit));
-	CHECK_STATUS_AND_RETURN(AudioUnitSetProperty(eqUnit, kAudioUnitProperty_MaximumFramesPerSlice, kAudioUnitScope_Global, 0, &maxFramesPerSlice, sizeof(maxFramesPerSlice)));
-	
-	while (self->options.equalizerBandFrequencies[eqBandCount] != 0)
-	{
-		eqBandCount++;
-	}
-	
-	CHECK_STATUS_AND_RETURN(AudioUnitSetProperty(eqUnit, kAUNBandEQProperty_NumberOfBands, kAudioUnitScope_Global, 0, &eqBandCount, sizeof(eqBandCount)));
-	
-	for (int i = 0; i < eqBandCount; i++)
-	{
-		CHECK_STATUS_AND_RETURN(AudioUnitSetParameter(eqUnit, kAUNBandEQParam_Frequency + i, kAudioUnitScope_Global, 0, (AudioUnitParameterValue)self->options.equalizerBandFrequencies[i], 0));
-	}
-	
-	for (int i = 0; i < eqBandCount; i++)
-	{
-		CHECK_STATUS_AND_RETURN(AudioUnitSetParameter(eqUnit, kAUNBandEQParam_BypassBand + i, kAudioUnitScope_Global, 0, (AudioUnitParameterValue)0, 0));
-	}
-#endif
-}
-
 -(void) setGain:(float)gain forEqualizerBand:(int)bandIndex
 {
-	if (!eqUnit)
+	if (bandIndex < 0)
 	{
 		return;
 	}
-    
-    OSStatus status;
 	
-	CHECK_STATUS_AND_RETURN(AudioUnitSetParameter(eqUnit, kAUNBandEQParam_Gain + bandIndex, kAudioUnitScope_Global, 0, gain, 0));
+	STKEqualizerSetGain(&equalizer, (uint32_t)bandIndex, gain);
 }
 
 -(AUNode) createConverterNode:(AudioStreamBasicDescription)srcFormat desFormat:(AudioStreamBasicDescription)desFormat
@@ -2367,6 +3094,27 @@ static BOOL GetHardwareCodecClassDesc(UInt32 formatId, AudioClassDescription* cl
 	}
 }
 
+-(void) applyCanonicalAudioStreamBasicDescriptionToUnits
+{
+    OSStatus status;
+    Float64 graphSampleRate = canonicalAudioStreamBasicDescription.mSampleRate;
+    
+    if (mixerNode)
+    {
+        CHECK_STATUS_AND_REPORT(AudioUnitSetProperty(mixerUnit, kAudioUnitProperty_SampleRate, kAudioUnitScope_Output, 0, &graphSampleRate, sizeof(graphSampleRate)));
+    }
+    
+    if (playbackRateNode)
+    {
+        CHECK_STATUS_AND_REPORT(AudioUnitSetProperty(playbackRateUnit, kAudioUnitProperty_StreamFormat, kAudioUnitScope_Input, kOutputBus, &canonicalAudioStreamBasicDescription, sizeof(canonicalAudioStreamBasicDescription)));
+    }
+    
+    if (outputNode)
+    {
+        CHECK_STATUS_AND_REPORT(AudioUnitSetProperty(outputUnit, kAudioUnitProperty_StreamFormat, kAudioUnitScope_Input, kOutputBus, &canonicalAudioStreamBasicDescription, sizeof(canonicalAudioStreamBasicDescription)));
+    }
+}
+
 -(void) createAudioGraph
 {
     OSStatus status;
@@ -2375,11 +3123,13 @@ static BOOL GetHardwareCodecClassDesc(UInt32 formatId, AudioClassDescription* cl
 	CHECK_STATUS_AND_RETURN(NewAUGraph(&audioGraph));
 	CHECK_STATUS_AND_RETURN(AUGraphOpen(audioGraph));
 	
-	[self createEqUnit];
+	// The output unit is created first so the hardware sample rate is known before the other units are configured
+	
+	[self createOutputUnit];
 	[self createMixerUnit];
 	[self createPlaybackRateUnit];
-	[self createOutputUnit];
     
+    [self applyCanonicalAudioStreamBasicDescriptionToUnits];
     [self connectGraph];
 	
 	CHECK_STATUS_AND_RETURN(AUGraphInitialize(audioGraph));
@@ -2387,11 +3137,31 @@ static BOOL GetHardwareCodecClassDesc(UInt32 formatId, AudioClassDescription* cl
 	self.volume = self->volume;
 }
 
--(void) connectGraph
+/// Renders into a bus of the shared engine instead of an audio graph of the player's own. Falls back to creating
+/// one if the engine has no free bus
+-(void) attachToEngine
 {
-    OSStatus status;
-    NSMutableArray* nodes = [[NSMutableArray alloc] init];
-    NSMutableArray* units = [[NSMutableArray alloc] init];
+    AURenderCallbackStruct callbackStruct;
+    
+    callbackStruct.inputProc = OutputRenderCallback;
+    callbackStruct.inputProcRefCon = (__bridge void*)self;
+    
+    if (![engine attachInputWithCallback:callbackStruct format:&canonicalAudioStreamBasicDescription bus:&engineBus])
+    {
+        NSLog(@"STKAudioPlayer: Can't attach to the engine so using an audio graph of its own");
+        
+        engine = nil;
+        canonicalAudioStreamBasicDescription.mSampleRate = defaultCanonicalAudioStreamBasicDescription.mSampleRate;
+        
+        [self createPcmBuffers];
+    }
+}
+
+-(void) connectGraph
+{
+    OSStatus status;
+    NSMutableArray* nodes = [[NSMutableArray alloc] init];
+    NSMutableArray* units = [[NSMutableArray alloc] init];
     
     AUGraphClearConnections(audioGraph);
     
@@ -2401,36 +3171,42 @@ static BOOL GetHardwareCodecClassDesc(UInt32 formatId, AudioClassDescription* cl
     }
     
     [converterNodes removeAllObjects];
+    
+    // Idle nodes are left out of the chain entirely. Nodes coming back in are reset so they
+    // don't play out stale state from the last time they were connected
 
-    if (eqNode)
+    if ([self mixerNeeded])
     {
-        if (self->equalizerEnabled)
+        if (!self->mixerOn)
         {
-            [nodes addObject:@(eqNode)];
-            [units addObject:[NSValue valueWithPointer:eqUnit]];
-            
-            self->equalizerOn = YES;
-        }
-        else
-        {
-            self->equalizerOn = NO;
+            AudioUnitReset(mixerUnit, kAudioUnitScope_Global, 0);
         }
-	}
-    else
-    {
-        self->equalizerOn = NO;
-    }
-    
-    if (mixerNode)
-    {
+        
         [nodes addObject:@(mixerNode)];
         [units addObject:[NSValue valueWithPointer:mixerUnit]];
+        
+        self->mixerOn = YES;
+    }
+    else
+    {
+        self->mixerOn = NO;
     }
 
-    if (playbackRateNode)
+    if ([self playbackRateNeeded])
     {
+        if (!self->playbackRateOn)
+        {
+            AudioUnitReset(playbackRateUnit, kAudioUnitScope_Global, 0);
+        }
+        
         [nodes addObject:@(playbackRateNode)];
         [units addObject:[NSValue valueWithPointer:playbackRateUnit]];
+        
+        self->playbackRateOn = YES;
+    }
+    else
+    {
+        self->playbackRateOn = NO;
     }
 
     if (outputNode)
@@ -2452,6 +3228,55 @@ static BOOL GetHardwareCodecClassDesc(UInt32 formatId, AudioClassDescription* cl
     }
 }
 
+-(BOOL) mixerNeeded
+{
+    return mixerNode && (self->volume != 1.0 || self->pan != 0);
+}
+
+-(BOOL) playbackRateNeeded
+{
+    return playbackRateNode && self->playbackRate != 1.0;
+}
+
+/// Queues a graph command to be served by the playback thread. Commands are coalesced so
+/// queuing the same command multiple times before it is served only runs it once
+-(void) queueGraphCommand:(STKAudioPlayerGraphCommand)command
+{
+    if ((__atomic_fetch_or(&pendingGraphCommands, command, __ATOMIC_ACQ_REL) & command) == command)
+    {
+        return;
+    }
+    
+    [self wakeupPlaybackThread];
+}
+
+/// Serves pending graph commands. Must be called on the playback thread with the playerMutex held
+-(void) processGraphCommands
+{
+    int32_t commands = __atomic_exchange_n(&pendingGraphCommands, 0, __ATOMIC_ACQ_REL);
+    
+    if (commands == 0 || !audioGraph)
+    {
+        return;
+    }
+    
+    if (commands & STKAudioPlayerGraphCommandReconnect)
+    {
+        if ([self mixerNeeded] == self->mixerOn
+            && [self playbackRateNeeded] == self->playbackRateOn)
+        {
+            return;
+        }
+        
+        OSStatus status;
+        Boolean isUpdated;
+        
+        [self connectGraph];
+        
+        CHECK_STATUS_AND_REPORT(AUGraphUpdate(audioGraph, &isUpdated));
+    }
+}
+
 -(BOOL) audioGraphIsRunning
 {
 	OSStatus status;
@@ -2473,6 +3298,22 @@ static BOOL GetHardwareCodecClassDesc(UInt32 formatId, AudioClassDescription* cl
     
 	[self resetPcmBuffers];
     
+    if (audioGraph == nil)
+    {
+        // Offline players are pulled with renderFrames:count: instead and engine players render whenever the engine runs
+        
+        if (engine != nil && ![engine start])
+        {
+            [self unexpectedError:STKAudioPlayerErrorAudioSystemError];
+            
+            return NO;
+        }
+        
+        [self stopSystemBackgroundTask];
+        
+        return YES;
+    }
+    
     if ([self audioGraphIsRunning])
     {
         return NO;
@@ -2501,6 +3342,8 @@ static BOOL GetHardwareCodecClassDesc(UInt32 formatId, AudioClassDescription* cl
         stopReason = stopReasonIn;
         self.internalState = STKAudioPlayerInternalStateStopped;
         
+        [self signalOfflineRender];
+        
         return;
     }
     
@@ -2538,6 +3381,8 @@ typedef struct
     BOOL done;
     UInt32 numberOfPackets;
     AudioBuffer audioBuffer;
+    /// Used instead of audioBuffer when set (non-interleaved PCM)
+    const AudioBufferList* audioBufferList;
     AudioStreamPacketDescription* packetDescriptions;
 }
 AudioConvertInfo;
@@ -2553,8 +3398,18 @@ OSStatus AudioConverterCallback(AudioConverterRef inAudioConverter, UInt32* ioNu
     	return 100;
     }
     
-    ioData->mNumberBuffers = 1;
-    ioData->mBuffers[0] = convertInfo->audioBuffer;
+    if (convertInfo->audioBufferList)
+    {
+        for (UInt32 i = 0; i < MIN(ioData->mNumberBuffers, convertInfo->audioBufferList->mNumberBuffers); i++)
+        {
+            ioData->mBuffers[i] = convertInfo->audioBufferList->mBuffers[i];
+        }
+    }
+    else
+    {
+        ioData->mNumberBuffers = 1;
+        ioData->mBuffers[0] = convertInfo->audioBuffer;
+    }
 
     if (outDataPacketDescription)
     {
@@ -2567,8 +3422,146 @@ OSStatus AudioConverterCallback(AudioConverterRef inAudioConverter, UInt32* ioNu
     return 0;
 }
 
+-(void) updateBitRateEstimateForEntry:(STKQueueEntry*)entry numberPackets:(UInt32)numberPackets packetDescriptions:(AudioStreamPacketDescription*)packetDescriptionsIn
+{
+    if (packetDescriptionsIn && entry->processedPacketsCount < STK_MAX_COMPRESSED_PACKETS_FOR_BITRATE_CALCULATION)
+    {
+        int count = MIN(numberPackets, STK_MAX_COMPRESSED_PACKETS_FOR_BITRATE_CALCULATION - entry->processedPacketsCount);
+        
+        for (int i = 0; i < count; i++)
+        {
+			SInt64 packetSize;
+			
+			packetSize = packetDescriptionsIn[i].mDataByteSize;
+			
+            OSAtomicAdd32((int32_t)packetSize, &entry->processedPacketsSizeTotal);
+            OSAtomicIncrement32(&entry->processedPacketsCount);
+        }
+    }
+}
+
+-(void) updateSeekTableForEntry:(STKQueueEntry*)entry numberPackets:(UInt32)numberPackets packetDescriptions:(AudioStreamPacketDescription*)packetDescriptionsIn
+{
+    if (packetDescriptionsIn == NULL)
+    {
+        // Constant bit rate streams seek exactly without an index
+        
+        return;
+    }
+    
+    for (UInt32 i = 0; i < numberPackets; i++)
+    {
+        STKSeekTableAddPacket(&entry->seekTable, packetDescriptionsIn[i].mDataByteSize);
+    }
+}
+
+-(NSURL*) seekTableUrlForEntry:(STKQueueEntry*)entry
+{
+    NSURL* directoryUrl = self.seekIndexDirectoryUrl;
+    NSString* cacheKey = entry.dataSource.cacheKey;
+    SInt64 length = entry.dataSource.length;
+    
+    if (directoryUrl == nil || cacheKey == nil || length <= 0)
+    {
+        return nil;
+    }
+    
+    unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+    NSData* keyData = [[NSString stringWithFormat:@"%@|%lld", cacheKey, length] dataUsingEncoding:NSUTF8StringEncoding];
+    NSMutableString* fileName = [NSMutableString stringWithCapacity:CC_SHA256_DIGEST_LENGTH * 2 + 8];
+    
+    CC_SHA256(keyData.bytes, (CC_LONG)keyData.length, digest);
+    
+    for (int i = 0; i < CC_SHA256_DIGEST_LENGTH; i++)
+    {
+        [fileName appendFormat:@"%02x", digest[i]];
+    }
+    
+    [fileName appendString:@".stkseek"];
+    
+    return [directoryUrl URLByAppendingPathComponent:fileName];
+}
+
+-(void) loadSeekTableForEntry:(STKQueueEntry*)entry
+{
+    if (entry->seekTablePersistedCount > 0)
+    {
+        return;
+    }
+    
+    NSURL* url = [self seekTableUrlForEntry:entry];
+    
+    if (url == nil)
+    {
+        return;
+    }
+    
+    NSData* data = [NSData dataWithContentsOfURL:url];
+    
+    if (data != nil && STKSeekTableDeserialize(&entry->seekTable, data.bytes, data.length))
+    {
+        entry->seekTablePersistedCount = entry->seekTable.count;
+    }
+}
+
+-(void) saveSeekTableForEntry:(STKQueueEntry*)entry
+{
+    if (entry->seekTable.count <= entry->seekTablePersistedCount)
+    {
+        return;
+    }
+    
+    NSURL* url = [self seekTableUrlForEntry:entry];
+    
+    if (url == nil)
+    {
+        return;
+    }
+    
+    NSMutableData* data = [NSMutableData dataWithLength:STKSeekTableSerializedSize(&entry->seekTable)];
+    
+    STKSeekTableSerialize(&entry->seekTable, data.mutableBytes);
+    
+    [[NSFileManager defaultManager] createDirectoryAtURL:[url URLByDeletingLastPathComponent] withIntermediateDirectories:YES attributes:nil error:nil];
+    
+    if ([data writeToURL:url atomically:YES])
+    {
+        entry->seekTablePersistedCount = entry->seekTable.count;
+    }
+}
+
+-(void) entryDidQueueFrames:(STKQueueEntry*)entry
+{
+    [self signalOfflineRender];
+    
+    if (entry->timeToFirstSample >= 0)
+    {
+        return;
+    }
+    
+    entry->timeToFirstSample = CFAbsoluteTimeGetCurrent() - entry->readStartTime;
+    
+    if ([self.delegate respondsToSelector:@selector(audioPlayer:didQueueFirstFramesOfQueueItemId:timeToFirstSample:)])
+    {
+        NSObject* queueItemId = entry.queueItemId;
+        double timeToFirstSample = entry->timeToFirstSample;
+        
+        [self playbackThreadQueueMainThreadSyncBlock:^
+        {
+            [self.delegate audioPlayer:self didQueueFirstFramesOfQueueItemId:queueItemId timeToFirstSample:timeToFirstSample];
+        }];
+    }
+}
+
 -(void) handleAudioPackets:(const void*)inputData numberBytes:(UInt32)numberBytes numberPackets:(UInt32)numberPackets packetDescriptions:(AudioStreamPacketDescription*)packetDescriptionsIn
 {
+    if (preDecodeParsing)
+    {
+        [self handlePreDecodeAudioPackets:inputData numberBytes:numberBytes numberPackets:numberPackets packetDescriptions:packetDescriptionsIn];
+        
+        return;
+    }
+    
     if (currentlyReadingEntry == nil)
     {
         return;
@@ -2584,12 +3577,14 @@ OSStatus AudioConverterCallback(AudioConverterRef inAudioConverter, UInt32* ioNu
 		return;
 	}
     
-    if (audioConverterRef == nil)
+    // No converter has been queued for the reading entry
+    
+    if (audioConverterAudioStreamBasicDescription.mFormatID == 0)
     {
         return;
     }
     
-    if ((seekToTimeWasRequested && [currentlyPlayingEntry calculatedBitRate] > 0.0))
+    if ([self seekWillRestartReading])
     {
 		[self wakeupPlaybackThread];
 		
@@ -2598,325 +3593,1381 @@ OSStatus AudioConverterCallback(AudioConverterRef inAudioConverter, UInt32* ioNu
 	
 	discontinuous = NO;
     
-    OSStatus status;
+    [self updateSeekTableForEntry:currentlyReadingEntry numberPackets:numberPackets packetDescriptions:packetDescriptionsIn];
     
-    AudioConvertInfo convertInfo;
-
-    convertInfo.done = NO;
-    convertInfo.numberOfPackets = numberPackets;
-    convertInfo.packetDescriptions = packetDescriptionsIn;
-    convertInfo.audioBuffer.mData = (void *)inputData;
-    convertInfo.audioBuffer.mDataByteSize = numberBytes;
-    convertInfo.audioBuffer.mNumberChannels = audioConverterAudioStreamBasicDescription.mChannelsPerFrame;
-
-    if (packetDescriptionsIn && currentlyReadingEntry->processedPacketsCount < STK_MAX_COMPRESSED_PACKETS_FOR_BITRATE_CALCULATION)
+    if (currentlyReadingEntry->packetsToDiscard > 0 && packetDescriptionsIn)
     {
-        int count = MIN(numberPackets, STK_MAX_COMPRESSED_PACKETS_FOR_BITRATE_CALCULATION - currentlyReadingEntry->processedPacketsCount);
+        // Seeks through the seek table start from the indexed packet before the one asked for
         
-        for (int i = 0; i < count; i++)
+        UInt32 packetsToDiscard = MIN(currentlyReadingEntry->packetsToDiscard, numberPackets);
+        
+        currentlyReadingEntry->packetsToDiscard -= packetsToDiscard;
+        packetDescriptionsIn += packetsToDiscard;
+        numberPackets -= packetsToDiscard;
+        
+        if (numberPackets == 0)
         {
-			SInt64 packetSize;
-			
-			packetSize = packetDescriptionsIn[i].mDataByteSize;
-			
-            OSAtomicAdd32((int32_t)packetSize, &currentlyReadingEntry->processedPacketsSizeTotal);
-            OSAtomicIncrement32(&currentlyReadingEntry->processedPacketsCount);
+            return;
         }
     }
     
-    while (true)
+    [self updateBitRateEstimateForEntry:currentlyReadingEntry numberPackets:numberPackets packetDescriptions:packetDescriptionsIn];
+    
+    [self queuePackets:inputData numberBytes:numberBytes numberPackets:numberPackets packetDescriptions:packetDescriptionsIn forEntry:currentlyReadingEntry];
+}
+
+#pragma mark Decoding
+
+// The playback thread reads and parses the current item and queues its packets for the decode thread along with
+// records for everything else that has to happen at that point in the stream (a new converter, frames decoded
+// ahead, the end of an item). The decode thread owns the converter and the recording and is the only writer of the
+// PCM buffer. Each stage only waits on its own buffer: reading pauses while the packet queue is full and decoding
+// waits while the PCM buffer is full.
+//
+// The decode thread holds the decodeMutex while it works on a record and the playback thread holds it to flush the
+// queue. The playerMutex may be locked before the decodeMutex but never while holding it.
+
+-(void) createDecodeThread
+{
+    decodeThread = [[NSThread alloc] initWithTarget:self selector:@selector(startDecoding) object:nil];
+    
+    [decodeThread start];
+}
+
+-(void) startDecoding
+{
+    @autoreleasepool
     {
-        setLock(&pcmBufferSpinLock);
-        UInt32 used = pcmBufferUsedFrameCount;
-        UInt32 start = pcmBufferFrameStartIndex;
-        UInt32 end = (pcmBufferFrameStartIndex + pcmBufferUsedFrameCount) % pcmBufferTotalFrameCount;
-        UInt32 framesLeftInsideBuffer = pcmBufferTotalFrameCount - used;
-        lockUnlock(&pcmBufferSpinLock);
+        NSThread.currentThread.threadPriority = 1;
         
-        if (framesLeftInsideBuffer == 0)
+        while (true)
         {
-            pthread_mutex_lock(&playerMutex);
-            
-            while (true)
+            @autoreleasepool
             {
-                setLock(&pcmBufferSpinLock);
-                used = pcmBufferUsedFrameCount;
-                start = pcmBufferFrameStartIndex;
-                end = (pcmBufferFrameStartIndex + pcmBufferUsedFrameCount) % pcmBufferTotalFrameCount;
-                framesLeftInsideBuffer = pcmBufferTotalFrameCount - used;
-                lockUnlock(&pcmBufferSpinLock);
-
-                if (framesLeftInsideBuffer > 0)
+                if (![self decodeNextRecord])
                 {
                     break;
                 }
-                
-                if  (disposeWasRequested
-                     || self.internalState == STKAudioPlayerInternalStateStopped
-                     || self.internalState == STKAudioPlayerInternalStateDisposed
-                     || self.internalState == STKAudioPlayerInternalStatePendingNext)
-                {
-                    pthread_mutex_unlock(&playerMutex);
-                    
-                    return;
-                }
-				
-				if (seekToTimeWasRequested && [currentlyPlayingEntry calculatedBitRate] > 0.0)
-				{
-					pthread_mutex_unlock(&playerMutex);
-					
-					[self wakeupPlaybackThread];
-					
-					return;
-				}
-                
-                waiting = YES;
-
-                pthread_cond_wait(&playerThreadReadyCondition, &playerMutex);
-                
-                waiting = NO;
             }
-            
-            pthread_mutex_unlock(&playerMutex);
         }
         
-        AudioBuffer* localPcmAudioBuffer;
-        AudioBufferList localPcmBufferList;
-        
-        localPcmBufferList.mNumberBuffers = 1;
-        localPcmAudioBuffer = &localPcmBufferList.mBuffers[0];
-        
-        if (end >= start)
-        {
-            UInt32 framesAdded = 0;
-            UInt32 framesToDecode = pcmBufferTotalFrameCount - end;
-            
-            localPcmAudioBuffer->mData = pcmAudioBuffer->mData + (end * pcmBufferFrameSizeInBytes);
-            localPcmAudioBuffer->mDataByteSize = framesToDecode * pcmBufferFrameSizeInBytes;
-            localPcmAudioBuffer->mNumberChannels = pcmAudioBuffer->mNumberChannels;
-            
-            status = AudioConverterFillComplexBuffer(audioConverterRef, AudioConverterCallback, (void*)&convertInfo, &framesToDecode, &localPcmBufferList, NULL);
-            
-            framesAdded = framesToDecode;
-            
-            if ((status == 100 || status == 0) && recordAudioFileId && recordAudioConverterRef)
-            {
-                [self handleRecordingOfAudioPackets:framesToDecode audioBuffer:&localPcmBufferList.mBuffers[0]];
-            }
+        [decodeThreadFinishedCondLock lock];
+        [decodeThreadFinishedCondLock unlockWithCondition:1];
+    }
+}
 
-            if (status == 100)
-            {
-                setLock(&pcmBufferSpinLock);
-                pcmBufferUsedFrameCount += framesAdded;
-                lockUnlock(&pcmBufferSpinLock);
+-(void) stopDecodeThread
+{
+    STKPacketQueueRecord record;
+    
+    if (decodeThread == nil)
+    {
+        return;
+    }
+    
+    pthread_mutex_lock(&decodeMutex);
+    decodeThreadStopRequested = YES;
+    pthread_cond_signal(&decodeCondition);
+    pthread_mutex_unlock(&decodeMutex);
+    
+    [self signalPcmBufferSpace];
+    
+    [decodeThreadFinishedCondLock lockWhenCondition:1];
+    [decodeThreadFinishedCondLock unlockWithCondition:0];
+    
+    decodeThread = nil;
+    
+    while (STKPacketQueuePeek(&packetQueue, &record))
+    {
+        if (record.type == STKDecodeRecordConverter)
+        {
+            AudioConverterDispose((AudioConverterRef)record.context);
+        }
+        
+        [self popDecodeRecord:&record];
+    }
+}
 
-                setLock(&currentlyReadingEntry->spinLock);
-                currentlyReadingEntry->framesQueued += framesAdded;
-                lockUnlock(&currentlyReadingEntry->spinLock);
-                
-                return;
-            }
-            else if (status != 0)
-            {
-                [self unexpectedError:STKAudioPlayerErrorCodecError];
-                
-                return;
-            }
+/// Wakes the decode thread if it's waiting for records
+-(void) signalDecodeThread
+{
+    // Pairs with the fence in decodeNextRecord so either the decode thread sees the new record or this sees it waiting
+    
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    
+    if (__atomic_load_n(&decodeThreadWaiting, __ATOMIC_RELAXED))
+    {
+        pthread_mutex_lock(&decodeMutex);
+        pthread_cond_signal(&decodeCondition);
+        pthread_mutex_unlock(&decodeMutex);
+    }
+}
+
+/// The number of bytes that can be read without the packets overflowing the packet queue or 0 if reading should pause.
+/// With compressedBuffering reading also pauses once the queue holds enough seconds
+-(int) packetQueueReadSize
+{
+    UInt32 freeBytes = STKPacketQueueFreeBytes(&packetQueue);
+    
+    if (freeBytes <= STK_PACKET_QUEUE_HEADROOM)
+    {
+        return 0;
+    }
+    
+    if (options.compressedBuffering && STKPacketQueueFrameCount(&packetQueue) >= compressedFramesToBuffer)
+    {
+        return 0;
+    }
+    
+    UInt32 retval = MIN((UInt32)readBufferSize, (freeBytes - STK_PACKET_QUEUE_HEADROOM) / STK_PACKET_QUEUE_READ_FRACTION);
+    
+    if (retval < STK_PACKET_QUEUE_MINIMUM_READ_SIZE && retval < (UInt32)readBufferSize)
+    {
+        return 0;
+    }
+    
+    return (int)retval;
+}
+
+/// Whether the packet queue holds more than burstLowWatermark of its bytes (or of the audio it reads ahead with compressedBuffering)
+-(BOOL) packetQueueAboveLowWatermark
+{
+    if (packetQueue.capacity - STKPacketQueueFreeBytes(&packetQueue) > packetQueue.capacity * options.burstLowWatermark)
+    {
+        return YES;
+    }
+    
+    return options.compressedBuffering && STKPacketQueueFrameCount(&packetQueue) > compressedFramesToBuffer * options.burstLowWatermark;
+}
+
+/// Called by the decode thread once it has made room in the packet queue
+-(void) resumeReadingIfPaused
+{
+    // Pairs with the fence after dataSourceDataAvailable: sets readingPaused
+    
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    
+    if (!__atomic_load_n(&readingPaused, __ATOMIC_RELAXED))
+    {
+        return;
+    }
+    
+    // Reading resumes with a few large reads rather than many small ones
+    
+    if (!STKPacketQueueIsEmpty(&packetQueue) && [self packetQueueReadSize] < readBufferSize / 2)
+    {
+        return;
+    }
+    
+    // With burstDecoding the network is read in bursts too, once the decoder has drained the queue below the low watermark
+    
+    if (options.burstDecoding && !STKPacketQueueIsEmpty(&packetQueue) && [self packetQueueAboveLowWatermark])
+    {
+        return;
+    }
+    
+    if (!__atomic_exchange_n(&readingPaused, NO, __ATOMIC_SEQ_CST))
+    {
+        return;
+    }
+    
+    [self invokeOnPlaybackThread:^
+    {
+        STKDataSource* dataSource = self->currentlyReadingEntry.dataSource;
+        
+        if (dataSource != nil)
+        {
+            [self dataSourceDataAvailable:dataSource];
+        }
+    }];
+}
+
+/// YES if a requested seek is about to restart reading from another position so the packets parsed from the current
+/// read aren't needed. Seeks that can't move the reading position (such as on streams of unknown length) don't
+-(BOOL) seekWillRestartReading
+{
+    if (!seekToTimeWasRequested || [currentlyPlayingEntry calculatedBitRate] <= 0.0)
+    {
+        return NO;
+    }
+    
+    return currentlyReadingEntry != currentlyPlayingEntry || currentlyPlayingEntry.dataSource.length > 0;
+}
+
+/// Wakes the playback thread if it's waiting for space in the packet queue
+-(void) signalPacketQueueSpace
+{
+    // Pairs with the fence in waitForPacketQueueSpaceWithDescriptionsSize: so either the playback thread sees the change or this sees it waiting
+    
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    
+    if (__atomic_load_n(&playbackThreadWaitingForSpace, __ATOMIC_RELAXED))
+    {
+        dispatch_semaphore_signal(packetQueueSpaceSemaphore);
+    }
+}
+
+/// Waits for the decode thread to make room for a record in the packet queue and reserves it. Returns NO if the packets
+/// should be dropped because the player is stopping or moving to another item or a seek is about to parse the stream
+/// again from another position. Reads leave enough room that this is rare
+-(BOOL) waitForPacketQueueSpaceWithDescriptionsSize:(UInt32)descriptionsSize dataSize:(UInt32)dataSize descriptions:(void**)descriptions data:(void**)data
+{
+    BOOL retval;
+    
+    while (true)
+    {
+        // Set before looking at the player and the free space so the decode thread signals once it pops a record and
+        // requests that stop or move the player signal too (see signalPacketQueueSpace). The semaphore may have been
+        // signalled more than once so this can wake early and go round again
+        
+        __atomic_store_n(&playbackThreadWaitingForSpace, YES, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        
+        if (disposeWasRequested
+            || decodeThreadStopRequested
+            || self.internalState == STKAudioPlayerInternalStateStopped
+            || self.internalState == STKAudioPlayerInternalStateDisposed
+            || self.internalState == STKAudioPlayerInternalStatePendingNext
+            || [self seekWillRestartReading])
+        {
+            retval = NO;
             
-            framesToDecode = start;
+            break;
+        }
+        
+        if (STKPacketQueueBeginPush(&packetQueue, descriptionsSize, dataSize, descriptions, data))
+        {
+            retval = YES;
             
-            if (framesToDecode == 0)
-            {
-                setLock(&pcmBufferSpinLock);
-                pcmBufferUsedFrameCount += framesAdded;
-                lockUnlock(&pcmBufferSpinLock);
-                
-                setLock(&currentlyReadingEntry->spinLock);
-                currentlyReadingEntry->framesQueued += framesAdded;
-                lockUnlock(&currentlyReadingEntry->spinLock);
-                
-                continue;
-            }
+            break;
+        }
+        
+        dispatch_semaphore_wait(packetQueueSpaceSemaphore, DISPATCH_TIME_FOREVER);
+        
+        STKCounterAdd(&counters.playbackThreadWakeupCount, 1);
+    }
+    
+    __atomic_store_n(&playbackThreadWaitingForSpace, NO, __ATOMIC_RELAXED);
+    
+    // The seek reads the stream again from the new position
+    
+    if (!retval && [self seekWillRestartReading])
+    {
+        [self wakeupPlaybackThread];
+    }
+    
+    return retval;
+}
+
+/// Copies packets parsed for entry into the packet queue with their descriptions rebased onto the copy
+-(void) queuePackets:(const void*)inputData numberBytes:(UInt32)numberBytes numberPackets:(UInt32)numberPackets packetDescriptions:(AudioStreamPacketDescription*)packetDescriptionsIn forEntry:(STKQueueEntry*)entry
+{
+    const UInt8* data = inputData;
+    UInt32 dataSize = numberBytes;
+    UInt32 descriptionsSize = 0;
+    SInt64 firstOffset = 0;
+    
+    if (packetDescriptionsIn)
+    {
+        AudioStreamPacketDescription* last = &packetDescriptionsIn[numberPackets - 1];
+        
+        firstOffset = packetDescriptionsIn[0].mStartOffset;
+        data += firstOffset;
+        dataSize = (UInt32)(last->mStartOffset + last->mDataByteSize - firstOffset);
+        descriptionsSize = numberPackets * sizeof(AudioStreamPacketDescription);
+        
+        if (numberPackets > 1 && STKPacketQueueRecordSize(descriptionsSize, dataSize) > packetQueue.capacity - STK_PACKET_QUEUE_HEADROOM)
+        {
+            UInt32 half = numberPackets / 2;
+            
+            [self queuePackets:inputData numberBytes:numberBytes numberPackets:half packetDescriptions:packetDescriptionsIn forEntry:entry];
+            [self queuePackets:inputData numberBytes:numberBytes numberPackets:numberPackets - half packetDescriptions:packetDescriptionsIn + half forEntry:entry];
+            
+            return;
+        }
+    }
+    
+    if (STKPacketQueueRecordSize(descriptionsSize, dataSize) > packetQueue.capacity)
+    {
+        return;
+    }
+    
+    void* descriptions;
+    void* destination;
+    
+    if (!STKPacketQueueBeginPush(&packetQueue, descriptionsSize, dataSize, &descriptions, &destination)
+        && ![self waitForPacketQueueSpaceWithDescriptionsSize:descriptionsSize dataSize:dataSize descriptions:&descriptions data:&destination])
+    {
+        return;
+    }
+    
+    memcpy(destination, data, dataSize);
+    
+    for (UInt32 i = 0; i < descriptionsSize / sizeof(AudioStreamPacketDescription); i++)
+    {
+        AudioStreamPacketDescription* description = (AudioStreamPacketDescription*)descriptions + i;
+        
+        *description = packetDescriptionsIn[i];
+        description->mStartOffset -= firstOffset;
+    }
+    
+    // Frames are counted at the PCM sample rate so they add up with the frames in the PCM buffer
+    
+    UInt64 frames = (UInt64)numberPackets * entry->audioStreamBasicDescription.mFramesPerPacket;
+    
+    if (entry->audioStreamBasicDescription.mSampleRate > 0)
+    {
+        frames = frames * canonicalAudioStreamBasicDescription.mSampleRate / entry->audioStreamBasicDescription.mSampleRate;
+    }
+    
+    STKPacketQueueEndPush(&packetQueue, STKDecodeRecordPackets, numberPackets, frames, (void*)CFBridgingRetain(entry));
+    
+    [self signalDecodeThread];
+}
+
+/// Queues a record without packets for the decode thread. Reads leave room for these so they never wait
+-(void) queueDecodeRecord:(STKDecodeRecordType)type forEntry:(STKQueueEntry*)entry count:(UInt32)count
+{
+    void* context = entry == nil ? NULL : (void*)CFBridgingRetain(entry);
+    
+    // Staged frames are already decoded so they're buffered audio as much as packets are
+    
+    if (!STKPacketQueuePush(&packetQueue, type, count, type == STKDecodeRecordStagedFrames ? count : 0, context))
+    {
+        if (context != NULL)
+        {
+            CFBridgingRelease(context);
+        }
+        
+        [self unexpectedError:STKAudioPlayerErrorAudioSystemError];
+        
+        return;
+    }
+    
+    [self signalDecodeThread];
+}
+
+/// Hands converter over to the decode thread which uses it for the packets queued after it.
+/// Returns NO (and disposes of it) if it couldn't be queued
+-(BOOL) queueConverter:(AudioConverterRef)converter withFormat:(AudioStreamBasicDescription*)asbd
+{
+    void* descriptions;
+    void* data;
+    
+    if (!STKPacketQueueBeginPush(&packetQueue, 0, sizeof(AudioStreamBasicDescription), &descriptions, &data))
+    {
+        AudioConverterDispose(converter);
+        
+        [self unexpectedError:STKAudioPlayerErrorAudioSystemError];
+        
+        return NO;
+    }
+    
+    memcpy(data, asbd, sizeof(AudioStreamBasicDescription));
+    
+    STKPacketQueueEndPush(&packetQueue, STKDecodeRecordConverter, 0, 0, converter);
+    
+    [self signalDecodeThread];
+    
+    return YES;
+}
+
+/// Releases the oldest record in the packet queue and the entry it refers to. Converters belong to whoever applied them
+-(void) popDecodeRecord:(STKPacketQueueRecord*)record
+{
+    if (record->type != STKDecodeRecordConverter && record->context != NULL)
+    {
+        CFBridgingRelease(record->context);
+    }
+    
+    STKPacketQueuePop(&packetQueue);
+}
+
+/// Discards everything queued for the decode thread and whatever it's part way through along with frames decoded ahead
+/// for the reading entry. Converters and recordings in the queue are applied so later packets are decoded as if the
+/// decode thread had got to them
+-(void) flushDecoder
+{
+    STKPacketQueueRecord record;
+    
+    pthread_mutex_lock(&decodeMutex);
+    
+    while (STKPacketQueuePeek(&packetQueue, &record))
+    {
+        if (record.type == STKDecodeRecordConverter)
+        {
+            [self applyConverterRecord:&record];
+        }
+        else if (record.type == STKDecodeRecordStartRecording)
+        {
+            [self openRecordAudioFileForEntry:(__bridge STKQueueEntry*)record.context];
+        }
+        
+        [self popDecodeRecord:&record];
+    }
+    
+    if (audioConverterRef)
+    {
+        AudioConverterReset(audioConverterRef);
+    }
+    
+    // The decode thread only reads staged frames with the decodeMutex held so they can be freed straight away
+    
+    if (preDecodeEntry == nil)
+    {
+        STKRingBufferReset(&preDecodeRingBuffer);
+    }
+    
+    __atomic_add_fetch(&decodeFlushCount, 1, __ATOMIC_RELEASE);
+    
+    pthread_mutex_unlock(&decodeMutex);
+    
+    // The decode thread gives up on what it was doing if it's waiting for space in the PCM buffer
+    
+    [self signalPcmBufferSpace];
+    
+    [self resumeReadingIfPaused];
+}
+
+/// Waits for the oldest record in the packet queue and carries it out. Returns NO when the decode thread should exit
+-(BOOL) decodeNextRecord
+{
+    STKPacketQueueRecord record;
+    BOOL completed = YES;
+    BOOL failed = NO;
+    
+    pthread_mutex_lock(&decodeMutex);
+    
+    while (true)
+    {
+        if (decodeThreadStopRequested)
+        {
+            pthread_mutex_unlock(&decodeMutex);
             
-            localPcmAudioBuffer->mData = pcmAudioBuffer->mData;
-            localPcmAudioBuffer->mDataByteSize = framesToDecode * pcmBufferFrameSizeInBytes;
-            localPcmAudioBuffer->mNumberChannels = pcmAudioBuffer->mNumberChannels;
+            return NO;
+        }
+        
+        // Set before looking at the queue so anything queued afterwards signals the condition (see signalDecodeThread)
+        
+        __atomic_store_n(&decodeThreadWaiting, YES, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        
+        if (STKPacketQueuePeek(&packetQueue, &record))
+        {
+            break;
+        }
+        
+        pthread_cond_wait(&decodeCondition, &decodeMutex);
+        
+        STKCounterAdd(&counters.decodeThreadWakeupCount, 1);
+    }
+    
+    __atomic_store_n(&decodeThreadWaiting, NO, __ATOMIC_RELAXED);
+    
+    STKQueueEntry* entry = record.type == STKDecodeRecordConverter || record.context == NULL ? nil : (__bridge STKQueueEntry*)record.context;
+    
+    switch (record.type)
+    {
+        case STKDecodeRecordPackets:
+        {
+            completed = [self decodePackets:&record forEntry:entry failed:&failed];
             
-            status = AudioConverterFillComplexBuffer(audioConverterRef, AudioConverterCallback, (void*)&convertInfo, &framesToDecode, &localPcmBufferList, NULL);
+            break;
+        }
+        case STKDecodeRecordStagedFrames:
+        {
+            completed = [self moveStagedFrames:record.count forEntry:entry];
             
-            framesAdded += framesToDecode;
+            break;
+        }
+        case STKDecodeRecordConverter:
+        {
+            [self applyConverterRecord:&record];
             
-            if ((status == 100 || status == 0) && recordAudioFileId && recordAudioConverterRef)
+            break;
+        }
+        case STKDecodeRecordConverterReset:
+        {
+            if (audioConverterRef)
             {
-                [self handleRecordingOfAudioPackets:framesToDecode audioBuffer:&localPcmBufferList.mBuffers[0]];
+                AudioConverterReset(audioConverterRef);
             }
             
-            if (status == 100)
-            {
-                setLock(&pcmBufferSpinLock);
-                pcmBufferUsedFrameCount += framesAdded;
-                lockUnlock(&pcmBufferSpinLock);
-                
-                setLock(&currentlyReadingEntry->spinLock);
-                currentlyReadingEntry->framesQueued += framesAdded;
-                lockUnlock(&currentlyReadingEntry->spinLock);
-                
-                return;
-            }
-            else if (status == 0)
-            {
-                setLock(&pcmBufferSpinLock);
-                pcmBufferUsedFrameCount += framesAdded;
-                lockUnlock(&pcmBufferSpinLock);
-                
-                setLock(&currentlyReadingEntry->spinLock);
-                currentlyReadingEntry->framesQueued += framesAdded;
-                lockUnlock(&currentlyReadingEntry->spinLock);
-                
-                continue;
-            }
-            else if (status != 0)
-            {
-                [self unexpectedError:STKAudioPlayerErrorCodecError];
-                
-                return;
-            }
+            break;
         }
-        else
+        case STKDecodeRecordStartRecording:
+        {
+            [self openRecordAudioFileForEntry:entry];
+            
+            break;
+        }
+        case STKDecodeRecordEndOfEntry:
+        {
+            setLock(&entry->spinLock);
+            entry->lastFrameQueued = entry->framesQueued;
+            lockUnlock(&entry->spinLock);
+            
+            [self closeRecordAudioFile];
+            
+            break;
+        }
+    }
+    
+    // A record being worked on when the queue was flushed is already gone
+    
+    if (completed)
+    {
+        [self popDecodeRecord:&record];
+    }
+    
+    pthread_mutex_unlock(&decodeMutex);
+    
+    if (failed)
+    {
+        [self unexpectedError:STKAudioPlayerErrorCodecError];
+    }
+    
+    if (record.type == STKDecodeRecordEndOfEntry)
+    {
+        [self signalOfflineRender];
+    }
+    
+    [self signalPacketQueueSpace];
+    [self resumeReadingIfPaused];
+    
+    return YES;
+}
+
+/// Wakes the decode thread if it's waiting for space in the PCM buffer
+-(void) signalPcmBufferSpace
+{
+    // Pairs with the fence in waitForPcmBufferSpace so either the decode thread sees the change or this sees it waiting
+    
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    
+    if (__atomic_load_n(&decodeThreadWaitingForSpace, __ATOMIC_RELAXED))
+    {
+        dispatch_semaphore_signal(pcmSpaceSemaphore);
+    }
+}
+
+/// The number of frames the decode thread should write into the PCM buffer now. With burstDecoding it's 0 from when the
+/// buffer reaches the high watermark until playback drains it below the low watermark. Called by the decode thread
+-(UInt32) pcmFramesToDecode
+{
+    UInt32 used = STKRingBufferUsedFrameCount(&pcmRingBuffer);
+    UInt32 framesFree = STKRingBufferFreeFrameCount(&pcmRingBuffer);
+    
+    if (!options.burstDecoding)
+    {
+        return framesFree;
+    }
+    
+    // The whole buffer is filled until playing so the frames required to start playing are always reached
+    
+    if (self.internalState != STKAudioPlayerInternalStatePlaying)
+    {
+        pcmBurstRefilling = YES;
+        
+        return framesFree;
+    }
+    
+    if (used >= pcmBurstHighWatermarkFrames)
+    {
+        pcmBurstRefilling = NO;
+        
+        return 0;
+    }
+    
+    if (!pcmBurstRefilling && used >= pcmBurstLowWatermarkFrames)
+    {
+        return 0;
+    }
+    
+    pcmBurstRefilling = YES;
+    
+    return MIN(framesFree, pcmBurstHighWatermarkFrames - used);
+}
+
+/// Returns the number of contiguous frames that can be written into the PCM buffer at *region, waiting for the render
+/// thread to make room if it's full (or above the low watermark with burstDecoding). Called by the decode thread with the
+/// decodeMutex held, which is released while it waits. Returns 0 if the decoder was flushed or is stopping in the meantime
+-(UInt32) waitForPcmBufferSpace:(void**)region sinceFlush:(uint32_t)flushCount
+{
+    while (true)
+    {
+        UInt32 framesToDecode = [self pcmFramesToDecode];
+        
+        if (framesToDecode > 0)
+        {
+            UInt32 framesLeftInsideBuffer = STKRingBufferBeginWrite(&pcmRingBuffer, region);
+            
+            if (framesLeftInsideBuffer > 0)
+            {
+                return MIN(framesLeftInsideBuffer, framesToDecode);
+            }
+        }
+        
+        pthread_mutex_unlock(&decodeMutex);
+        
+        // Set before looking at the free space so the render thread signals once it makes room (see RenderFrames).
+        // The semaphore may have been signalled more than once so this can wake early and go round again
+        
+        __atomic_store_n(&decodeThreadWaitingForSpace, YES, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        
+        if ([self pcmFramesToDecode] == 0
+            && !decodeThreadStopRequested
+            && __atomic_load_n(&decodeFlushCount, __ATOMIC_ACQUIRE) == flushCount)
+        {
+            dispatch_semaphore_wait(pcmSpaceSemaphore, DISPATCH_TIME_FOREVER);
+            
+            STKCounterAdd(&counters.decodeThreadWakeupCount, 1);
+        }
+        
+        __atomic_store_n(&decodeThreadWaitingForSpace, NO, __ATOMIC_RELAXED);
+        
+        pthread_mutex_lock(&decodeMutex);
+        
+        if (decodeThreadStopRequested || decodeFlushCount != flushCount)
+        {
+            return 0;
+        }
+    }
+}
+
+/// Publishes frames written into the PCM buffer for entry and tells anyone waiting for them. Called by the decode
+/// thread with the decodeMutex held, which is released while it does. Returns NO if the decoder was flushed in the meantime
+-(BOOL) publishFrames:(UInt32)frameCount forEntry:(STKQueueEntry*)entry sinceFlush:(uint32_t)flushCount
+{
+    STKRingBufferEndWrite(&pcmRingBuffer, frameCount);
+    
+    setLock(&entry->spinLock);
+    entry->framesQueued += frameCount;
+    lockUnlock(&entry->spinLock);
+    
+    pthread_mutex_unlock(&decodeMutex);
+    
+    [self entryDidQueueFrames:entry];
+    
+    pthread_mutex_lock(&decodeMutex);
+    
+    return !decodeThreadStopRequested && decodeFlushCount == flushCount;
+}
+
+/// Decodes a packets record into the PCM buffer. Returns NO if the decoder was flushed before it finished
+-(BOOL) decodePackets:(STKPacketQueueRecord*)record forEntry:(STKQueueEntry*)entry failed:(BOOL*)failed
+{
+    OSStatus status;
+    AudioConvertInfo convertInfo;
+    uint32_t flushCount = decodeFlushCount;
+    
+    if (audioConverterRef == nil)
+    {
+        return YES;
+    }
+    
+    convertInfo.done = NO;
+    convertInfo.audioBufferList = NULL;
+    convertInfo.numberOfPackets = record->count;
+    convertInfo.packetDescriptions = record->descriptionsSize > 0 ? (AudioStreamPacketDescription*)record->descriptions : NULL;
+    convertInfo.audioBuffer.mData = (void*)record->data;
+    convertInfo.audioBuffer.mDataByteSize = record->dataSize;
+    convertInfo.audioBuffer.mNumberChannels = decodeAudioStreamBasicDescription.mChannelsPerFrame;
+    
+    if (recordingWriter.passthrough)
+    {
+        [recordingWriter writePackets:record->data size:record->dataSize descriptions:convertInfo.packetDescriptions count:record->count];
+    }
+    
+    while (true)
+    {
+        void* region;
+        UInt32 framesToDecode = [self waitForPcmBufferSpace:&region sinceFlush:flushCount];
+        
+        if (framesToDecode == 0)
+        {
+            return NO;
+        }
+        
+        size_t planeStride = STKRingBufferPlaneStride(&pcmRingBuffer);
+        
+        for (UInt32 i = 0; i < pcmDecodeBufferList->mNumberBuffers; i++)
+        {
+            pcmDecodeBufferList->mBuffers[i].mData = (UInt8*)region + planeStride * i;
+            pcmDecodeBufferList->mBuffers[i].mDataByteSize = framesToDecode * pcmRingBuffer.bytesPerFrame;
+            pcmDecodeBufferList->mBuffers[i].mNumberChannels = canonicalAudioStreamBasicDescription.mChannelsPerFrame / pcmDecodeBufferList->mNumberBuffers;
+        }
+        
+        uint64_t decodeStart = mach_absolute_time();
+        
+        status = AudioConverterFillComplexBuffer(audioConverterRef, AudioConverterCallback, (void*)&convertInfo, &framesToDecode, pcmDecodeBufferList, NULL);
+        
+        STKHistogramRecord(&counters.decodeDuration, MachTimeToNanoseconds(mach_absolute_time() - decodeStart));
+        
+        if (status != 100 && status != 0)
+        {
+            *failed = YES;
+            
+            return YES;
+        }
+        
+        if (recordingWriter && !recordingWriter.passthrough)
+        {
+            [recordingWriter writeFrames:pcmDecodeBufferList count:framesToDecode];
+        }
+        
+        if (![self publishFrames:framesToDecode forEntry:entry sinceFlush:flushCount])
+        {
+            return NO;
+        }
+        
+        if (status == 100)
+        {
+            return YES;
+        }
+    }
+}
+
+/// Moves frameCount frames decoded ahead for entry from the staging buffer into the PCM buffer.
+/// Returns NO if the decoder was flushed before it finished
+-(BOOL) moveStagedFrames:(UInt32)frameCount forEntry:(STKQueueEntry*)entry
+{
+    uint32_t flushCount = decodeFlushCount;
+    
+    while (frameCount > 0)
+    {
+        void* region;
+        UInt32 framesLeftInsideBuffer = [self waitForPcmBufferSpace:&region sinceFlush:flushCount];
+        
+        if (framesLeftInsideBuffer == 0)
+        {
+            return NO;
+        }
+        
+        size_t planeStride = STKRingBufferPlaneStride(&pcmRingBuffer);
+        void* destinations[pcmRingBuffer.planeCount];
+        
+        for (UInt32 i = 0; i < pcmRingBuffer.planeCount; i++)
+        {
+            destinations[i] = (UInt8*)region + planeStride * i;
+        }
+        
+        UInt32 framesCopied = STKRingBufferRead(&preDecodeRingBuffer, destinations, MIN(framesLeftInsideBuffer, frameCount));
+        
+        if (framesCopied == 0)
+        {
+            break;
+        }
+        
+        frameCount -= framesCopied;
+        
+        if (![self publishFrames:framesCopied forEntry:entry sinceFlush:flushCount])
+        {
+            return NO;
+        }
+    }
+    
+    return YES;
+}
+
+/// Starts using the converter handed over by a converter record. Called with the decodeMutex held
+-(void) applyConverterRecord:(STKPacketQueueRecord*)record
+{
+    [self destroyAudioConverter];
+    
+    audioConverterRef = (AudioConverterRef)record->context;
+    
+    memcpy(&decodeAudioStreamBasicDescription, record->data, sizeof(AudioStreamBasicDescription));
+}
+
+/// Starts recording entry to its data source's recordToFileUrl, either its packets as they are or its decoded frames
+/// re-encoded as AAC. Called with the decodeMutex held
+-(void) openRecordAudioFileForEntry:(STKQueueEntry*)entry
+{
+    NSURL* url = entry.dataSource.recordToFileUrl;
+    
+    [self closeRecordAudioFile];
+    
+    if (url == nil)
+    {
+        return;
+    }
+    
+    if (options.recordCompressedPassthrough && audioConverterRef)
+    {
+        UInt32 cookieSize = 0;
+        NSMutableData* cookie = nil;
+        
+        if (AudioConverterGetPropertyInfo(audioConverterRef, kAudioConverterDecompressionMagicCookie, &cookieSize, NULL) == 0 && cookieSize > 0)
+        {
+            cookie = [NSMutableData dataWithLength:cookieSize];
+            
+            if (AudioConverterGetProperty(audioConverterRef, kAudioConverterDecompressionMagicCookie, &cookieSize, cookie.mutableBytes))
+            {
+                cookie = nil;
+            }
+        }
+        
+        recordingWriter = [[STKRecordingWriter alloc] initWithUrl:url packetFormat:decodeAudioStreamBasicDescription magicCookie:cookie queueSize:STK_RECORDING_QUEUE_SIZE];
+    }
+    
+    if (recordingWriter == nil)
+    {
+        recordingWriter = [[STKRecordingWriter alloc] initWithUrl:url pcmFormat:canonicalAudioStreamBasicDescription queueSize:STK_RECORDING_QUEUE_SIZE];
+    }
+}
+
+#pragma mark Adaptive buffering
+
+-(void) updateBufferingThresholds
+{
+    STKQueueEntry* entry = currentlyReadingEntry;
+    Float64 sampleRate = canonicalAudioStreamBasicDescription.mSampleRate;
+    
+    if (!options.adaptiveBuffering || entry == nil || !entry->parsedHeader || sampleRate <= 0)
+    {
+        return;
+    }
+    
+    double mediaBytesPerSecond = [entry calculatedBitRate] / 8;
+    double downloadBytesPerSecond = entry.dataSource.downloadBytesPerSecond;
+    double ratio = mediaBytesPerSecond > 0 ? downloadBytesPerSecond / mediaBytesPerSecond : 0;
+    double duration = [entry duration];
+    double remaining = duration > 0 ? MAX(duration - [entry progressInFrames] / sampleRate, 0) : STK_ADAPTIVE_BUFFERING_UNKNOWN_DURATION_SECONDS;
+    double maximum = options.bufferSizeInSeconds * STK_ADAPTIVE_BUFFERING_MAXIMUM_BUFFER_FRACTION;
+    
+    framesRequiredToStartPlaying = sampleRate * STKAdaptiveBufferSeconds(options.secondsRequiredToStartPlaying, ratio, remaining, STK_ADAPTIVE_BUFFERING_MINIMUM_SECONDS, maximum);
+    framesRequiredToPlayAfterRebuffering = sampleRate * STKAdaptiveBufferSeconds(options.secondsRequiredToStartPlayingAfterBufferUnderun, ratio, remaining, STK_ADAPTIVE_BUFFERING_MINIMUM_SECONDS, maximum);
+}
+
+#pragma mark Prefetching
+
+-(void) processPrefetch
+{
+    if ([NSThread currentThread] != playbackThread)
+    {
+        return;
+    }
+    
+    NSUInteger itemCount = MIN(options.prefetchQueueItemCount, upcomingQueue.count);
+    NSUInteger memoryLimit = (NSUInteger)options.prefetchMemoryLimitInKB * 1024;
+    NSUInteger maximumByteCountPerItem = MAX((NSUInteger)options.prefetchSizeInKB * 1024, itemCount > 0 ? memoryLimit / itemCount : 0);
+    NSUInteger memoryUsed = 0;
+    NSMutableArray* entries = [[NSMutableArray alloc] initWithCapacity:itemCount];
+    
+    // The next item is at the front of the queue
+    
+    [upcomingQueue enumerateEntriesWithOptions:0 usingBlock:^(STKQueueEntry* entry, BOOL* stop)
+    {
+        if (entries.count == itemCount)
+        {
+            *stop = YES;
+            
+            return;
+        }
+        
+        [entries addObject:entry];
+    }];
+    
+    for (STKPrefetchingDataSource* dataSource in [prefetchDataSources copy])
+    {
+        if (dataSource.delegate != nil)
+        {
+            // In use so the prefetched bytes are about to be read
+            
+            [prefetchDataSources removeObject:dataSource];
+        }
+        else if (![[entries valueForKey:@"dataSource"] containsObject:dataSource])
+        {
+            [dataSource cancelPrefetch];
+            [prefetchDataSources removeObject:dataSource];
+        }
+        else
+        {
+            memoryUsed += maximumByteCountPerItem;
+        }
+    }
+    
+    for (STKQueueEntry* entry in entries)
+    {
+        // Data sources read without copying are as quick to start from as prefetched bytes
+        
+        if ([entry.dataSource isKindOfClass:[STKPrefetchingDataSource class]]
+            || entry.dataSource.supportsReadBytesNoCopy
+            || entry.dataSource.delegate != nil
+            || entry.dataSource.recordToFileUrl != nil)
+        {
+            continue;
+        }
+        
+        if (memoryUsed + maximumByteCountPerItem > memoryLimit)
+        {
+            break;
+        }
+        
+        STKPrefetchingDataSource* dataSource = [[STKPrefetchingDataSource alloc] initWithDataSource:entry.dataSource];
+        
+        entry.dataSource = dataSource;
+        
+        [prefetchDataSources addObject:dataSource];
+        [dataSource prefetchOnRunLoop:[NSRunLoop currentRunLoop] byteCount:(NSUInteger)options.prefetchSizeInKB * 1024 maximumByteCount:maximumByteCountPerItem];
+        
+        memoryUsed += maximumByteCountPerItem;
+    }
+}
+
+-(void) cancelPrefetch
+{
+    for (STKPrefetchingDataSource* dataSource in prefetchDataSources)
+    {
+        [dataSource cancelPrefetch];
+    }
+    
+    [prefetchDataSources removeAllObjects];
+}
+
+/// Returns the prefetched data source of a pending item for the same stream so playing it starts from memory
+-(STKDataSource*) prefetchedDataSourceForDataSource:(STKDataSource*)dataSourceIn
+{
+    NSString* cacheKey = dataSourceIn.cacheKey;
+    __block STKDataSource* retval = dataSourceIn;
+    
+    [upcomingQueue enumerateEntriesWithOptions:NSEnumerationReverse usingBlock:^(STKQueueEntry* entry, BOOL* stop)
+    {
+        STKPrefetchingDataSource* dataSource = (STKPrefetchingDataSource*)entry.dataSource;
+        
+        if (![dataSource isKindOfClass:[STKPrefetchingDataSource class]] || dataSource.delegate != nil)
+        {
+            return;
+        }
+        
+        if (dataSource.innerDataSource == dataSourceIn || (cacheKey != nil && [dataSource.cacheKey isEqualToString:cacheKey]))
+        {
+            retval = dataSource;
+            *stop = YES;
+        }
+    }];
+    
+    return retval;
+}
+
+#pragma mark Pre-decoding
+
+/// Starts decoding the next queued item ahead into the staging buffer while the current item plays
+/// and cancels it if the item is no longer next in the queue
+-(void) processPreDecode
+{
+    if ([NSThread currentThread] != playbackThread)
+    {
+        return;
+    }
+    
+    if (preDecodeEntry != nil && preDecodeEntry != [upcomingQueue peek])
+    {
+        [self cancelPreDecode];
+    }
+    
+    if (preDecodeFrameCount == 0
+        || preDecodeEntry != nil
+        || currentlyReadingEntry == nil
+        || seekToTimeWasRequested
+        || STKRingBufferUsedFrameCount(&preDecodeRingBuffer) > 0)
+    {
+        return;
+    }
+    
+    STKQueueEntry* entry = [upcomingQueue peek];
+    
+    // Recording is set up as an item is read so those items aren't decoded ahead
+    
+    if (entry == nil
+        || entry == preDecodeAbandonedEntry
+        || entry.dataSource == currentlyReadingEntry.dataSource
+        || entry.dataSource.recordToFileUrl != nil)
+    {
+        return;
+    }
+    
+    LOGINFO(([entry description]));
+    
+    preDecodeEntry = entry;
+    preDecodeFailed = NO;
+    preDecodeEof = NO;
+    
+    STKSeekTableSetCursor(&entry->seekTable, 0, 0);
+    
+    entry.dataSource.delegate = self;
+    [entry.dataSource registerForEvents:[NSRunLoop currentRunLoop]];
+    [entry.dataSource seekToOffset:0];
+}
+
+-(void) cancelPreDecode
+{
+    if (preDecodeEntry == nil)
+    {
+        return;
+    }
+    
+    LOGINFO(([preDecodeEntry description]));
+    
+    preDecodeEntry.dataSource.delegate = nil;
+    [preDecodeEntry.dataSource unregisterForEvents];
+    [preDecodeEntry.dataSource close];
+    
+    if (preDecodeAudioFileStream)
+    {
+        AudioFileStreamClose(preDecodeAudioFileStream);
+        
+        preDecodeAudioFileStream = 0;
+    }
+    
+    if (preDecodeAudioConverterRef)
+    {
+        AudioConverterDispose(preDecodeAudioConverterRef);
+        
+        preDecodeAudioConverterRef = nil;
+    }
+    
+    memset(&preDecodeAudioConverterAudioStreamBasicDescription, 0, sizeof(preDecodeAudioConverterAudioStreamBasicDescription));
+    
+    preDecodeEntry->parsedHeader = NO;
+    [preDecodeEntry reset];
+    
+    preDecodeEntry = nil;
+    preDecodeEof = NO;
+    
+    pthread_mutex_lock(&decodeMutex);
+    STKRingBufferReset(&preDecodeRingBuffer);
+    pthread_mutex_unlock(&decodeMutex);
+}
+
+/// Cancels decoding ahead and doesn't try again for the same item. It's read normally when it's needed
+-(void) abandonPreDecode
+{
+    preDecodeAbandonedEntry = preDecodeEntry;
+    
+    [self cancelPreDecode];
+}
+
+-(BOOL) canAdoptPreDecodeStartPlaying:(BOOL)startPlaying
+{
+    if (preDecodeFailed || preDecodeAudioConverterRef == nil || !preDecodeEntry->parsedHeader)
+    {
+        return NO;
+    }
+    
+    // An item that starts playback by itself may switch the PCM sample rate so it's decoded again from the start
+    
+    if (startPlaying
+        && options.pcmSampleRate == STKAudioPlayerSampleRateSource
+        && preDecodeAudioConverterAudioStreamBasicDescription.mSampleRate != canonicalAudioStreamBasicDescription.mSampleRate)
+    {
+        return NO;
+    }
+    
+    return YES;
+}
+
+/// Hands the parser and converter of the item decoded ahead over to the reading path.
+/// Frames left in the staging buffer now belong to the reading entry
+-(void) adoptPreDecode
+{
+    LOGINFO(([preDecodeEntry description]));
+    
+    audioFileStream = preDecodeAudioFileStream;
+    audioConverterAudioStreamBasicDescription = preDecodeAudioConverterAudioStreamBasicDescription;
+    discontinuous = NO;
+    
+    if (![self queueConverter:preDecodeAudioConverterRef withFormat:&audioConverterAudioStreamBasicDescription])
+    {
+        memset(&audioConverterAudioStreamBasicDescription, 0, sizeof(audioConverterAudioStreamBasicDescription));
+    }
+    
+    preDecodeAudioFileStream = 0;
+    preDecodeAudioConverterRef = nil;
+    memset(&preDecodeAudioConverterAudioStreamBasicDescription, 0, sizeof(preDecodeAudioConverterAudioStreamBasicDescription));
+    
+    preDecodeEntry = nil;
+}
+
+-(void) resumeAdoptedPreDecode
+{
+    BOOL eof = preDecodeEof;
+    STKDataSource* dataSource = currentlyReadingEntry.dataSource;
+    
+    UInt32 stagedFrameCount = STKRingBufferUsedFrameCount(&preDecodeRingBuffer);
+    
+    preDecodeEof = NO;
+    
+    // The decode thread moves the frames decoded ahead into the PCM buffer before any packets read from here on
+    
+    if (stagedFrameCount > 0)
+    {
+        [self queueDecodeRecord:STKDecodeRecordStagedFrames forEntry:currentlyReadingEntry count:stagedFrameCount];
+    }
+    
+    // Reading stopped once enough was decoded ahead (or the item was read to the end) so pick it up again
+    // from the run loop rather than while the player lock is held
+    
+    [self invokeOnPlaybackThread:^
+    {
+        if (self->currentlyReadingEntry.dataSource != dataSource)
+        {
+            return;
+        }
+        
+        if (eof)
+        {
+            [self dataSourceEof:dataSource];
+        }
+        else
+        {
+            [self dataSourceDataAvailable:dataSource];
+        }
+    }];
+}
+
+-(void) preDecodeDataSourceDataAvailable:(STKDataSource*)dataSourceIn
+{
+    OSStatus error;
+    
+    // Small reads so decoding stops close to the look-ahead. The rest is read once the item is adopted
+    
+    while (preDecodeEntry != nil
+           && dataSourceIn.hasBytesAvailable
+           && STKRingBufferUsedFrameCount(&preDecodeRingBuffer) < preDecodeFrameCount)
+    {
+        const UInt8* bytes;
+        int read = [self readFromDataSource:dataSourceIn bytes:&bytes withSize:MIN(readBufferSize, STK_PRE_DECODE_READ_SIZE)];
+        
+        [self recordRead:read forEntry:preDecodeEntry];
+        
+        if (read == 0)
+        {
+            break;
+        }
+        
+        if (read < 0)
+        {
+            [self abandonPreDecode];
+            
+            return;
+        }
+        
+        if (preDecodeAudioFileStream == 0)
+        {
+            error = AudioFileStreamOpen((__bridge void*)self, AudioFileStreamPropertyListenerProc, AudioFileStreamPacketsProc, dataSourceIn.audioFileTypeHint, &preDecodeAudioFileStream);
+            
+            if (error)
+            {
+                [self abandonPreDecode];
+                
+                return;
+            }
+        }
+        
+        STKSeekTableScanHeader(&preDecodeEntry->seekTable, bytes, read, dataSourceIn.position - read);
+        
+        // Parsing is synchronous so the stream callbacks use this to tell the two parsers apart
+        
+        preDecodeParsing = YES;
+        error = AudioFileStreamParseBytes(preDecodeAudioFileStream, read, bytes, 0);
+        preDecodeParsing = NO;
+        
+        if (error || preDecodeFailed)
+        {
+            [self abandonPreDecode];
+            
+            return;
+        }
+    }
+}
+
+-(void) createPreDecodeAudioConverter
+{
+    OSStatus status;
+    Boolean writable;
+    UInt32 cookieSize = 0;
+    AudioStreamBasicDescription* asbd = &preDecodeEntry->audioStreamBasicDescription;
+    
+    if (preDecodeAudioConverterRef)
+    {
+        AudioConverterDispose(preDecodeAudioConverterRef);
+        
+        preDecodeAudioConverterRef = nil;
+    }
+    
+    status = AudioConverterNew(asbd, &canonicalAudioStreamBasicDescription, &preDecodeAudioConverterRef);
+    
+    if (status)
+    {
+        preDecodeFailed = YES;
+        
+        return;
+    }
+    
+    preDecodeAudioConverterAudioStreamBasicDescription = *asbd;
+    
+    if (preDecodeEntry.dataSource.audioFileTypeHint != kAudioFileAAC_ADTSType)
+    {
+        status = AudioFileStreamGetPropertyInfo(preDecodeAudioFileStream, kAudioFileStreamProperty_MagicCookieData, &cookieSize, &writable);
+        
+        if (status)
+        {
+            return;
+        }
+        
+        void* cookieData = alloca(cookieSize);
+        
+        status = AudioFileStreamGetProperty(preDecodeAudioFileStream, kAudioFileStreamProperty_MagicCookieData, &cookieSize, cookieData);
+        
+        if (status)
+        {
+            return;
+        }
+        
+        status = AudioConverterSetProperty(preDecodeAudioConverterRef, kAudioConverterDecompressionMagicCookie, cookieSize, cookieData);
+        
+        if (status)
+        {
+            preDecodeFailed = YES;
+        }
+    }
+}
+
+-(void) handlePreDecodeAudioPackets:(const void*)inputData numberBytes:(UInt32)numberBytes numberPackets:(UInt32)numberPackets packetDescriptions:(AudioStreamPacketDescription*)packetDescriptionsIn
+{
+    if (preDecodeEntry == nil || !preDecodeEntry->parsedHeader || preDecodeAudioConverterRef == nil || preDecodeFailed)
+    {
+        return;
+    }
+    
+    OSStatus status;
+    AudioConvertInfo convertInfo;
+    size_t planeStride = STKRingBufferPlaneStride(&preDecodeRingBuffer);
+    
+    convertInfo.done = NO;
+    convertInfo.audioBufferList = NULL;
+    convertInfo.numberOfPackets = numberPackets;
+    convertInfo.packetDescriptions = packetDescriptionsIn;
+    convertInfo.audioBuffer.mData = (void *)inputData;
+    convertInfo.audioBuffer.mDataByteSize = numberBytes;
+    convertInfo.audioBuffer.mNumberChannels = preDecodeAudioConverterAudioStreamBasicDescription.mChannelsPerFrame;
+    
+    [self updateBitRateEstimateForEntry:preDecodeEntry numberPackets:numberPackets packetDescriptions:packetDescriptionsIn];
+    [self updateSeekTableForEntry:preDecodeEntry numberPackets:numberPackets packetDescriptions:packetDescriptionsIn];
+    
+    while (true)
+    {
+        void* region;
+        UInt32 framesToDecode = STKRingBufferBeginWrite(&preDecodeRingBuffer, &region);
+        
+        if (framesToDecode == 0)
+        {
+            // Only very low bit rates can overrun the extra room in the staging buffer
+            
+            preDecodeFailed = YES;
+            
+            return;
+        }
+        
+        for (UInt32 i = 0; i < preDecodeBufferList->mNumberBuffers; i++)
+        {
+            preDecodeBufferList->mBuffers[i].mData = (UInt8*)region + planeStride * i;
+            preDecodeBufferList->mBuffers[i].mDataByteSize = framesToDecode * preDecodeRingBuffer.bytesPerFrame;
+            preDecodeBufferList->mBuffers[i].mNumberChannels = canonicalAudioStreamBasicDescription.mChannelsPerFrame / preDecodeBufferList->mNumberBuffers;
+        }
+        
+        uint64_t decodeStart = mach_absolute_time();
+        
+        status = AudioConverterFillComplexBuffer(preDecodeAudioConverterRef, AudioConverterCallback, (void*)&convertInfo, &framesToDecode, preDecodeBufferList, NULL);
+        
+        STKHistogramRecord(&counters.decodeDuration, MachTimeToNanoseconds(mach_absolute_time() - decodeStart));
+        
+        if (status != 100 && status != 0)
         {
-            UInt32 framesAdded = 0;
-            UInt32 framesToDecode = start - end;
-            
-            localPcmAudioBuffer->mData = pcmAudioBuffer->mData + (end * pcmBufferFrameSizeInBytes);
-            localPcmAudioBuffer->mDataByteSize = framesToDecode * pcmBufferFrameSizeInBytes;
-            localPcmAudioBuffer->mNumberChannels = pcmAudioBuffer->mNumberChannels;
-            
-            status = AudioConverterFillComplexBuffer(audioConverterRef, AudioConverterCallback, (void*)&convertInfo, &framesToDecode, &localPcmBufferList, NULL);
-            
-            framesAdded = framesToDecode;
-            
-            if ((status == 100 || status == 0) && recordAudioFileId && recordAudioConverterRef)
-            {
-                [self handleRecordingOfAudioPackets:framesToDecode audioBuffer:&localPcmBufferList.mBuffers[0]];
-            }
+            preDecodeFailed = YES;
             
-            if (status == 100)
-            {
-                setLock(&pcmBufferSpinLock);
-                pcmBufferUsedFrameCount += framesAdded;
-                lockUnlock(&pcmBufferSpinLock);
-                
-                setLock(&currentlyReadingEntry->spinLock);
-                currentlyReadingEntry->framesQueued += framesAdded;
-                lockUnlock(&currentlyReadingEntry->spinLock);
-                
-                return;
-            }
-            else if (status == 0)
-            {
-                setLock(&pcmBufferSpinLock);
-                pcmBufferUsedFrameCount += framesAdded;
-                lockUnlock(&pcmBufferSpinLock);
-                
-                setLock(&currentlyReadingEntry->spinLock);
-                currentlyReadingEntry->framesQueued += framesAdded;
-                lockUnlock(&currentlyReadingEntry->spinLock);
-
-                continue;
-            }
-            else if (status != 0)
-            {
-                [self unexpectedError:STKAudioPlayerErrorCodecError];
-                
-                return;
-            }
+            return;
+        }
+        
+        STKRingBufferEndWrite(&preDecodeRingBuffer, framesToDecode);
+        
+        if (status == 100)
+        {
+            return;
         }
     }
 }
 
-- (void)handleRecordingOfAudioPackets:(UInt32)numberOfPackets audioBuffer:(AudioBuffer *)audioBuffer
+/// Mixes the start of the incoming item into the end of the outgoing item with an equal power curve.
+/// position is the index of the first frame within a crossfade of length frames
+static void CrossfadeFrames(const AudioStreamBasicDescription* format, UInt32 planeCount, void* const* outgoing, void* const* incoming, UInt32 frameCount, UInt32 position, UInt32 length)
 {
-    if (recordAudioFileId && recordAudioConverterRef)
+    UInt32 samplesPerFrame = format->mChannelsPerFrame / planeCount;
+    BOOL isFloat = (format->mFormatFlags & kAudioFormatFlagIsFloat) != 0;
+    
+    for (UInt32 i = 0; i < frameCount; i++)
     {
-        AudioConvertInfo recordConvertInfo;
-        recordConvertInfo.done = NO;
-        recordConvertInfo.numberOfPackets = numberOfPackets;
-        recordConvertInfo.packetDescriptions = NULL;
-        recordConvertInfo.audioBuffer = *audioBuffer;
-        
-        AudioBufferList convertedData;
-        convertedData.mNumberBuffers = 1;
-        convertedData.mBuffers[0].mNumberChannels = recordAudioStreamBasicDescription.mChannelsPerFrame;
-        convertedData.mBuffers[0].mDataByteSize = recordOutputBufferSize;
-        convertedData.mBuffers[0].mData = recordOutputBuffer;
-        
-        UInt32 ioOutputDataPackets;
-        OSStatus status;
+        float t = ((float)(position + i) + 0.5f) / (float)length;
+        float fadeIn = sinf(t * (float)M_PI_2);
+        float fadeOut = cosf(t * (float)M_PI_2);
         
-        while (1)
+        for (UInt32 plane = 0; plane < planeCount; plane++)
         {
-            ioOutputDataPackets = recordPacketsPerBuffer;
-            
-            status = AudioConverterFillComplexBuffer(recordAudioConverterRef, AudioConverterCallback, (void*)&recordConvertInfo, &ioOutputDataPackets, &convertedData, recordPacketDescriptions);
-            
-            if (status == 100 || status == 0)
+            for (UInt32 j = i * samplesPerFrame; j < (i + 1) * samplesPerFrame; j++)
             {
-                if (ioOutputDataPackets > 0)
+                if (isFloat)
                 {
-                    OSStatus writeError = AudioFileWritePackets(recordAudioFileId,
-                                          NO,
-                                          convertedData.mBuffers[0].mDataByteSize,
-                                          recordPacketDescriptions,
-                                          recordFilePacketPosition,
-                                          &ioOutputDataPackets,
-                                          convertedData.mBuffers[0].mData);
-
-                    if (writeError)
-                    {
-                        NSLog(@"STKAudioPlayer:handleRecordingOfAudioPackets failed on AudioFileWritePackets with error \"" OSSTATUS_PRINTF_PLACEHOLDER "\"", OSSTATUS_PRINTF_VALUE(writeError));
-                    }
-                    else
-                    {
-                        recordFilePacketPosition += ioOutputDataPackets;
-                    }
+                    ((Float32*)outgoing[plane])[j] = ((Float32*)outgoing[plane])[j] * fadeOut + ((Float32*)incoming[plane])[j] * fadeIn;
+                }
+                else
+                {
+                    float value = ((SInt16*)outgoing[plane])[j] * fadeOut + ((SInt16*)incoming[plane])[j] * fadeIn;
+                    
+                    ((SInt16*)outgoing[plane])[j] = (SInt16)MAX(-32768.0f, MIN(32767.0f, value));
                 }
-            }
-            else
-            {
-                NSLog(@"STKAudioPlayer: Unexpected error during recording audio file conversion");
-            }
-            
-            if (status == 100)
-            {
-                break;
             }
         }
     }
 }
 
-static OSStatus OutputRenderCallback(void* inRefCon, AudioUnitRenderActionFlags* ioActionFlags, const AudioTimeStamp* inTimeStamp, UInt32 inBusNumber, UInt32 inNumberFrames, AudioBufferList* ioData)
+static OSStatus RenderFrames(STKAudioPlayer* audioPlayer, UInt32 inNumberFrames, AudioBufferList* ioData)
 {
-    STKAudioPlayer* audioPlayer = (__bridge STKAudioPlayer*)inRefCon;
-
     setLock(&audioPlayer->currentEntryReferencesLock);
 	STKQueueEntry* entry = audioPlayer->currentlyPlayingEntry;
     STKQueueEntry* currentlyReadingEntry = audioPlayer->currentlyReadingEntry;
+    uint32_t generation = audioPlayer->playingEntryGeneration;
+    uint32_t predecessorGeneration = audioPlayer->playingEntryPredecessorGeneration;
     lockUnlock(&audioPlayer->currentEntryReferencesLock);
     
-    setLock(&audioPlayer->pcmBufferSpinLock);
-    
     BOOL waitForBuffer = NO;
 	BOOL muted = audioPlayer->muted;
-    AudioBuffer* audioBuffer = audioPlayer->pcmAudioBuffer;
-    UInt32 frameSizeInBytes = audioPlayer->pcmBufferFrameSizeInBytes;
-    UInt32 used = audioPlayer->pcmBufferUsedFrameCount;
-    UInt32 start = audioPlayer->pcmBufferFrameStartIndex;
+    STKRingBuffer* pcmRingBuffer = &audioPlayer->pcmRingBuffer;
+    
+    // Frames are only read when some are used so flushed ones are skipped here or a flushed full buffer would never
+    // be handed back to the decode thread. It's woken below once used is seen to be low
+    
+    STKRingBufferSyncConsumer(pcmRingBuffer);
+    
+    UInt32 frameSizeInBytes = pcmRingBuffer->bytesPerFrame;
+    UInt32 bufferCount = MIN(ioData->mNumberBuffers, pcmRingBuffer->planeCount);
+    UInt32 used = STKRingBufferUsedFrameCount(pcmRingBuffer);
     STKAudioPlayerInternalState state = audioPlayer->internalState;
-    UInt32 end = (audioPlayer->pcmBufferFrameStartIndex + audioPlayer->pcmBufferUsedFrameCount) % audioPlayer->pcmBufferTotalFrameCount;
-    BOOL signal = audioPlayer->waiting && used < audioPlayer->pcmBufferTotalFrameCount / 2;
-	NSArray* frameFilters = audioPlayer->frameFilters;
+    BOOL offline = audioPlayer->options.offlineRendering;
+    
+    // Packets waiting to be decoded count towards the thresholds for starting (the decode thread keeps the PCM buffer topped up).
+    // The PCM buffer may be smaller than the thresholds so an item that has been read to the end doesn't wait for more
+    
+    SInt64 compressedFrames = audioPlayer->options.compressedBuffering ? (SInt64)STKPacketQueueFrameCount(&audioPlayer->packetQueue) : 0;
+    BOOL entryWasRead = audioPlayer->options.compressedBuffering && currentlyReadingEntry != entry;
     
-	if (entry)
+    STKHistogramRecord(&audioPlayer->counters.bufferFill, pcmRingBuffer->frameCount > 0 ? (uint64_t)used * 1000 / pcmRingBuffer->frameCount : 0);
+    
+	// Offline callers wait for frames in renderFrames:count: so the thresholds for starting don't apply
+	
+	if (entry && !offline)
 	{
 		if (state == STKAudioPlayerInternalStateWaitingForData)
 		{
@@ -2928,7 +4979,7 @@ static OSStatus OutputRenderCallback(void* inRefCon, AudioUnitRenderActionFlags*
 			}
 			
 			if (entry && currentlyReadingEntry == entry
-				&& entry->framesQueued < framesRequiredToStartPlaying)
+				&& entry->framesQueued + compressedFrames < framesRequiredToStartPlaying)
 			{
 				waitForBuffer = YES;
 			}
@@ -2942,7 +4993,7 @@ static OSStatus OutputRenderCallback(void* inRefCon, AudioUnitRenderActionFlags*
 				framesRequiredToStartPlaying = MIN(framesRequiredToStartPlaying, entry->lastFrameQueued - entry->framesQueued);
 			}
 			
-			if (used < framesRequiredToStartPlaying)
+			if (!entryWasRead && used + compressedFrames < framesRequiredToStartPlaying)
 			{
 				waitForBuffer = YES;
 			}
@@ -2963,9 +5014,8 @@ static OSStatus OutputRenderCallback(void* inRefCon, AudioUnitRenderActionFlags*
 		}
 	}
     
-    lockUnlock(&audioPlayer->pcmBufferSpinLock);
-    
     UInt32 totalFramesCopied = 0;
+    UInt32 crossfadeFramesSkipped = 0;
     
     if (used > 0 && !waitForBuffer && entry != nil && ((state & STKAudioPlayerInternalStateRunning) && state != STKAudioPlayerInternalStatePaused))
     {
@@ -2978,319 +5028,480 @@ static OSStatus OutputRenderCallback(void* inRefCon, AudioUnitRenderActionFlags*
             // Resuming from buffering
         }
         
-        if (end > start)
+        UInt32 framesToCopy = MIN(inNumberFrames, used);
+        void* destinations[bufferCount];
+        
+        for (UInt32 i = 0; i < bufferCount; i++)
+        {
+            destinations[i] = ioData->mBuffers[i].mData;
+        }
+        
+        // Crossfading starts only if the beginning of the next item is already queued behind the whole fade
+        // so the next item never comes in part way through. The end of the current item is read on its own
+        // and the start of the next item is peeked from further along and mixed in
+        
+        SInt64 crossfadeRemaining = -1;
+        UInt32 crossfadeFrameCount = audioPlayer->crossfadeFrameCount;
+        
+        if (crossfadeFrameCount > 0)
+        {
+            if (entry->lastFrameQueued < 0)
+            {
+                audioPlayer->crossfadingEntry = nil;
+            }
+            else
+            {
+                SInt64 remaining = entry->lastFrameQueued - entry->framesPlayed;
+                
+                if (remaining >= crossfadeFrameCount && used >= remaining + crossfadeFrameCount)
+                {
+                    audioPlayer->crossfadingEntry = entry;
+                }
+                
+                if (audioPlayer->crossfadingEntry == entry && remaining > 0 && used >= remaining + crossfadeFrameCount)
+                {
+                    crossfadeRemaining = remaining;
+                    framesToCopy = (UInt32)MIN(framesToCopy, remaining);
+                }
+            }
+        }
+        
+        totalFramesCopied = STKRingBufferRead(pcmRingBuffer, muted ? NULL : destinations, framesToCopy);
+        
+        if (crossfadeRemaining >= 0)
         {
-            UInt32 framesToCopy = MIN(inNumberFrames, used);
+            UInt32 fadeStart = crossfadeRemaining > crossfadeFrameCount ? (UInt32)(crossfadeRemaining - crossfadeFrameCount) : 0;
             
-            ioData->mBuffers[0].mNumberChannels = 2;
-            ioData->mBuffers[0].mDataByteSize = frameSizeInBytes * framesToCopy;
-			
-			if (muted)
-			{
-				memset(ioData->mBuffers[0].mData, 0, ioData->mBuffers[0].mDataByteSize);
-			}
-			else
-			{
-				memcpy(ioData->mBuffers[0].mData, audioBuffer->mData + (start * frameSizeInBytes), ioData->mBuffers[0].mDataByteSize);
-			}
+            if (!muted && fadeStart < totalFramesCopied)
+            {
+                UInt32 position = crossfadeFrameCount - (UInt32)(crossfadeRemaining - fadeStart);
+                UInt32 fadeFrames = MIN(totalFramesCopied - fadeStart, maxFramesPerSlice);
+                void* outgoing[bufferCount];
+                void* incoming[bufferCount];
+                
+                for (UInt32 i = 0; i < bufferCount; i++)
+                {
+                    outgoing[i] = (UInt8*)destinations[i] + fadeStart * frameSizeInBytes;
+                    incoming[i] = (UInt8*)audioPlayer->crossfadeBuffer + (size_t)maxFramesPerSlice * frameSizeInBytes * i;
+                }
+                
+                fadeFrames = STKRingBufferPeek(pcmRingBuffer, (UInt32)(crossfadeRemaining + position - totalFramesCopied), incoming, fadeFrames);
+                
+                CrossfadeFrames(&audioPlayer->canonicalAudioStreamBasicDescription, bufferCount, outgoing, incoming, fadeFrames, position, crossfadeFrameCount);
+            }
             
-            totalFramesCopied = framesToCopy;
+            if (totalFramesCopied == crossfadeRemaining)
+            {
+                // The current item has ended and the start of the next item has already been heard
+                
+                crossfadeFramesSkipped = STKRingBufferRead(pcmRingBuffer, NULL, crossfadeFrameCount);
+                audioPlayer->crossfadingEntry = nil;
+                
+                void* remainder[bufferCount];
+                
+                for (UInt32 i = 0; i < bufferCount; i++)
+                {
+                    remainder[i] = (UInt8*)destinations[i] + totalFramesCopied * frameSizeInBytes;
+                }
+                
+                totalFramesCopied += STKRingBufferRead(pcmRingBuffer, muted ? NULL : remainder, inNumberFrames - totalFramesCopied);
+            }
+        }
+        
+        for (UInt32 i = 0; i < bufferCount; i++)
+        {
+            ioData->mBuffers[i].mNumberChannels = audioPlayer->canonicalAudioStreamBasicDescription.mChannelsPerFrame / bufferCount;
+            ioData->mBuffers[i].mDataByteSize = frameSizeInBytes * totalFramesCopied;
             
-            setLock(&audioPlayer->pcmBufferSpinLock);
-            audioPlayer->pcmBufferFrameStartIndex = (audioPlayer->pcmBufferFrameStartIndex + totalFramesCopied) % audioPlayer->pcmBufferTotalFrameCount;
-            audioPlayer->pcmBufferUsedFrameCount -= totalFramesCopied;
-            lockUnlock(&audioPlayer->pcmBufferSpinLock);
+            if (muted)
+            {
+                memset(ioData->mBuffers[i].mData, 0, ioData->mBuffers[i].mDataByteSize);
+            }
         }
-        else
+        
+        SetInternalStateFromRenderThread(audioPlayer, STKAudioPlayerInternalStatePlaying);
+    }
+    
+    if (totalFramesCopied < inNumberFrames)
+    {
+        UInt32 delta = inNumberFrames - totalFramesCopied;
+        
+        for (UInt32 i = 0; i < ioData->mNumberBuffers; i++)
+        {
+            memset(ioData->mBuffers[i].mData + (totalFramesCopied * frameSizeInBytes), 0, delta * frameSizeInBytes);
+        }
+        
+        if (entry != nil)
+        {
+            STKCounterAdd(&audioPlayer->counters.framesZeroFilled, delta);
+        }
+        
+        if (state == STKAudioPlayerInternalStateRebuffering)
+        {
+            STKCounterAdd(&audioPlayer->counters.underrunFrames, delta);
+        }
+        
+        if (!(entry == nil || state == STKAudioPlayerInternalStateWaitingForDataAfterSeek || state == STKAudioPlayerInternalStateWaitingForData || state == STKAudioPlayerInternalStateRebuffering))
         {
-            UInt32 framesToCopy = MIN(inNumberFrames, audioPlayer->pcmBufferTotalFrameCount - start);
+            // Buffering
             
-            ioData->mBuffers[0].mNumberChannels = 2;
-            ioData->mBuffers[0].mDataByteSize = frameSizeInBytes * framesToCopy;
-			
-			if (muted)
+            STKCounterAdd(&audioPlayer->counters.underrunCount, 1);
+            STKCounterAdd(&audioPlayer->counters.underrunFrames, delta);
+            
+            SetInternalStateFromRenderThread(audioPlayer, STKAudioPlayerInternalStateRebuffering);
+        }
+		else if (state == STKAudioPlayerInternalStateWaitingForDataAfterSeek)
+		{
+			if (totalFramesCopied == 0)
 			{
-				memset(ioData->mBuffers[0].mData, 0, ioData->mBuffers[0].mDataByteSize);
+				OSAtomicAdd32(inNumberFrames - totalFramesCopied, &audioPlayer->waitingForDataAfterSeekFrameCount);
+				
+				if (audioPlayer->waitingForDataAfterSeekFrameCount > audioPlayer->framesRequiredBeforeWaitingForDataAfterSeekBecomesPlaying)
+				{
+					SetInternalStateFromRenderThread(audioPlayer, STKAudioPlayerInternalStatePlaying);
+				}
 			}
 			else
 			{
-				memcpy(ioData->mBuffers[0].mData, audioBuffer->mData + (start * frameSizeInBytes), ioData->mBuffers[0].mDataByteSize);
+				audioPlayer->waitingForDataAfterSeekFrameCount = 0;
 			}
-            
-            UInt32 moreFramesToCopy = 0;
-            UInt32 delta = inNumberFrames - framesToCopy;
-            
-            if (delta > 0)
-            {
-                moreFramesToCopy = MIN(delta, end);
-                
-                ioData->mBuffers[0].mNumberChannels = 2;
-                ioData->mBuffers[0].mDataByteSize += frameSizeInBytes * moreFramesToCopy;
-				
-				if (muted)
-				{
-					memset(ioData->mBuffers[0].mData + (framesToCopy * frameSizeInBytes), 0, frameSizeInBytes * moreFramesToCopy);
-				}
-				else
-				{
-					memcpy(ioData->mBuffers[0].mData + (framesToCopy * frameSizeInBytes), audioBuffer->mData, frameSizeInBytes * moreFramesToCopy);
-				}
-            }
-            
-            totalFramesCopied = framesToCopy + moreFramesToCopy;
-            
-            setLock(&audioPlayer->pcmBufferSpinLock);
-            audioPlayer->pcmBufferFrameStartIndex = (audioPlayer->pcmBufferFrameStartIndex + totalFramesCopied) % audioPlayer->pcmBufferTotalFrameCount;
-            audioPlayer->pcmBufferUsedFrameCount -= totalFramesCopied;
-            lockUnlock(&audioPlayer->pcmBufferSpinLock);
+		}
+    }
+
+	// Non-interleaved frame filters get the whole buffer list
+	
+	void* frames = pcmRingBuffer->planeCount > 1 ? (void*)ioData : ioData->mBuffers[0].mData;
+	
+	STKFrameFilterPipelineProcess(&audioPlayer->frameFilterPipeline, audioPlayer->canonicalAudioStreamBasicDescription.mChannelsPerFrame, audioPlayer->canonicalAudioStreamBasicDescription.mBytesPerFrame, inNumberFrames, frames);
+	
+	// Equalized after the frame filters like the equalizer unit that used to follow this callback in the graph
+	
+	if (ioData->mNumberBuffers >= pcmRingBuffer->planeCount)
+	{
+		void* planes[pcmRingBuffer->planeCount];
+		
+		for (UInt32 i = 0; i < pcmRingBuffer->planeCount; i++)
+		{
+			planes[i] = ioData->mBuffers[i].mData;
+		}
+		
+		STKEqualizerProcess(&audioPlayer->equalizer, planes, inNumberFrames);
+	}
+    
+    // Pairs with the fence in waitForPcmBufferSpace so either the decode thread sees the room made or this sees it waiting
+    
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    
+    if (__atomic_load_n(&audioPlayer->decodeThreadWaitingForSpace, __ATOMIC_RELAXED) && used < audioPlayer->pcmSpaceSignalFrameCount)
+    {
+        dispatch_semaphore_signal(audioPlayer->pcmSpaceSemaphore);
+    }
+    
+    // Frames played past the end of the previous generation belong to this entry if it followed on from it
+    
+    SInt64 framesToCount = totalFramesCopied + crossfadeFramesSkipped;
+    
+    if (generation != audioPlayer->renderEntryGeneration)
+    {
+        if (predecessorGeneration == audioPlayer->renderEntryGeneration)
+        {
+            framesToCount += audioPlayer->renderFramesPastEnd;
         }
         
-        [audioPlayer setInternalState:STKAudioPlayerInternalStatePlaying ifInState:^BOOL(STKAudioPlayerInternalState state)
-        {
-            return (state & STKAudioPlayerInternalStateRunning) && state != STKAudioPlayerInternalStatePaused;
-        }];
+        audioPlayer->renderEntryGeneration = generation;
+        audioPlayer->renderFramesPastEnd = 0;
+    }
+    
+    if (entry == nil)
+    {
+        return 0;
+    }
+    
+    SInt64 lastFrameQueued = __atomic_load_n(&entry->lastFrameQueued, __ATOMIC_ACQUIRE);
+    SInt64 framesPlayedForCurrent = framesToCount;
+
+    if (lastFrameQueued >= 0)
+    {
+        framesPlayedForCurrent = MAX(MIN(lastFrameQueued - __atomic_load_n(&entry->framesPlayed, __ATOMIC_RELAXED), framesPlayedForCurrent), 0);
+    }
+    
+    SInt64 framesPlayed = __atomic_add_fetch(&entry->framesPlayed, framesPlayedForCurrent, __ATOMIC_RELAXED);
+    
+    audioPlayer->renderFramesPastEnd += framesToCount - framesPlayedForCurrent;
+    
+    if (framesPlayedForCurrent > 0 && entry->timeToFirstAudio < 0)
+    {
+        entry->timeToFirstAudio = CFAbsoluteTimeGetCurrent() - entry->readStartTime;
+        
+        STKHistogramRecord(&audioPlayer->counters.timeToFirstAudio, (uint64_t)(MAX(entry->timeToFirstAudio, 0) * 1000));
+    }
+    
+    // Tried again on the next call if the event queue is full
+    
+    if (framesPlayed == lastFrameQueued
+        && audioPlayer->renderFinishedGeneration != generation
+        && QueueRenderEvent(audioPlayer, STKRenderEventEntryFinished, generation))
+    {
+        audioPlayer->renderFinishedGeneration = generation;
+    }
+    
+    return 0;
+}
+
+static OSStatus OutputRenderCallback(void* inRefCon, AudioUnitRenderActionFlags* ioActionFlags, const AudioTimeStamp* inTimeStamp, UInt32 inBusNumber, UInt32 inNumberFrames, AudioBufferList* ioData)
+{
+    STKAudioPlayer* audioPlayer = (__bridge STKAudioPlayer*)inRefCon;
+    STKAudioPlayerCounters* counters = &audioPlayer->counters;
+    Float64 sampleRate = audioPlayer->canonicalAudioStreamBasicDescription.mSampleRate;
+    uint64_t start = mach_absolute_time();
+    
+    OSStatus status = RenderFrames(audioPlayer, inNumberFrames, ioData);
+    
+    uint64_t duration = MachTimeToNanoseconds(mach_absolute_time() - start);
+    
+    STKCounterAdd(&counters->renderCallCount, 1);
+    STKCounterAdd(&counters->framesRendered, inNumberFrames);
+    STKHistogramRecord(&counters->renderDuration, duration);
+    
+    // The callback has to finish within the time it takes to play the frames it was asked for
+    
+    if (sampleRate > 0 && duration > (uint64_t)(inNumberFrames * (double)NSEC_PER_SEC / sampleRate))
+    {
+        STKCounterAdd(&counters->renderDeadlineMissCount, 1);
+    }
+    
+    return status;
+}
+
+#pragma mark Offline rendering
+
+/// Wakes a caller waiting in renderFrames:count: for decoded frames or for playback to end. Called for every chunk
+/// the decode thread queues so it only takes a lock when there is a caller waiting
+-(void) signalOfflineRender
+{
+    if (!options.offlineRendering)
+    {
+        return;
+    }
+    
+    // Pairs with the fence in renderFrames:count: so either the caller sees the new frames or state or this sees it waiting
+    
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    
+    if (__atomic_load_n(&offlineRenderWaiterCount, __ATOMIC_RELAXED) > 0)
+    {
+        pthread_mutex_lock(&offlineRenderMutex);
+        pthread_cond_broadcast(&offlineRenderCondition);
+        pthread_mutex_unlock(&offlineRenderMutex);
+    }
+}
+
+/// Returns YES if renderFrames:count: should stop waiting for frameCount frames
+-(BOOL) offlineRenderReadyForFrameCount:(UInt32)frameCount
+{
+    STKAudioPlayerInternalState state = self.internalState;
+    UInt32 used = STKRingBufferUsedFrameCount(&pcmRingBuffer);
+    
+    if (used >= frameCount || disposeWasRequested)
+    {
+        return YES;
+    }
+    
+    if (state == STKAudioPlayerInternalStatePaused || (!(state & STKAudioPlayerInternalStateRunning) && state != STKAudioPlayerInternalStatePendingNext))
+    {
+        return YES;
+    }
+    
+    // The rest of the playing item is already decoded (the next item may not have started yet)
+    
+    setLock(&currentEntryReferencesLock);
+    STKQueueEntry* entry = currentlyPlayingEntry;
+    lockUnlock(&currentEntryReferencesLock);
+    
+    if (used > 0 && entry != nil)
+    {
+        setLock(&entry->spinLock);
+        BOOL ended = entry->lastFrameQueued >= 0 && used >= entry->lastFrameQueued - entry->framesPlayed;
+        lockUnlock(&entry->spinLock);
+        
+        return ended;
+    }
+    
+    return NO;
+}
+
+-(UInt32) renderFrames:(AudioBufferList*)bufferList count:(UInt32)frameCount
+{
+    if (!options.offlineRendering)
+    {
+        return 0;
     }
     
-    if (totalFramesCopied < inNumberFrames)
+    uint64_t start = mach_absolute_time();
+    
+    frameCount = MIN(frameCount, maxFramesPerSlice);
+    
+    pthread_mutex_lock(&offlineRenderMutex);
+    
+    // Counted before looking at the buffer so frames queued afterwards signal the condition (see signalOfflineRender)
+    
+    __atomic_add_fetch(&offlineRenderWaiterCount, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    
+    while (![self offlineRenderReadyForFrameCount:frameCount])
     {
-        UInt32 delta = inNumberFrames - totalFramesCopied;
+        // Waiting here doesn't read so flushed frames are skipped as RenderFrames does or a flushed full buffer would
+        // leave the decode thread waiting for space and this waiting for frames
         
-        memset(ioData->mBuffers[0].mData + (totalFramesCopied * frameSizeInBytes), 0, delta * frameSizeInBytes);
-        
-        if (!(entry == nil || state == STKAudioPlayerInternalStateWaitingForDataAfterSeek || state == STKAudioPlayerInternalStateWaitingForData || state == STKAudioPlayerInternalStateRebuffering))
+        if (STKRingBufferSyncConsumer(&pcmRingBuffer))
         {
-            // Buffering
+            [self signalPcmBufferSpace];
             
-            [audioPlayer setInternalState:STKAudioPlayerInternalStateRebuffering ifInState:^BOOL(STKAudioPlayerInternalState state)
-            {
-                 return (state & STKAudioPlayerInternalStateRunning) && state != STKAudioPlayerInternalStatePaused;
-            }];
+            continue;
         }
-		else if (state == STKAudioPlayerInternalStateWaitingForDataAfterSeek)
-		{
-			if (totalFramesCopied == 0)
-			{
-				OSAtomicAdd32(inNumberFrames - totalFramesCopied, &audioPlayer->waitingForDataAfterSeekFrameCount);
-				
-				if (audioPlayer->waitingForDataAfterSeekFrameCount > audioPlayer->framesRequiredBeforeWaitingForDataAfterSeekBecomesPlaying)
-				{
-					[audioPlayer setInternalState:STKAudioPlayerInternalStatePlaying ifInState:^BOOL(STKAudioPlayerInternalState state)
-					{
-						return (state & STKAudioPlayerInternalStateRunning) && state != STKAudioPlayerInternalStatePaused;
-					}];
-				}
-			}
-			else
-			{
-				audioPlayer->waitingForDataAfterSeekFrameCount = 0;
-			}
-		}
+        
+        struct timespec timeout = { .tv_sec = 0, .tv_nsec = STK_OFFLINE_RENDER_WAIT_NANOSECONDS };
+        
+        pthread_cond_timedwait_relative_np(&offlineRenderCondition, &offlineRenderMutex, &timeout);
     }
-
-	if (frameFilters)
-	{
-		NSUInteger count = frameFilters.count;
-		AudioStreamBasicDescription asbd = canonicalAudioStreamBasicDescription;
-		
-		for (int i = 0; i < count; i++)
-		{
-			STKFrameFilterEntry* entry = [frameFilters objectAtIndex:i];
-			
-			entry->filter(asbd.mChannelsPerFrame, asbd.mBytesPerFrame, inNumberFrames, ioData->mBuffers[0].mData);
-		}
-	}
     
-    if (audioPlayer->equalizerEnabled != audioPlayer->equalizerOn)
+    __atomic_sub_fetch(&offlineRenderWaiterCount, 1, __ATOMIC_RELAXED);
+    
+    STKAudioPlayerInternalState state = self.internalState;
+    
+    if (!(state & STKAudioPlayerInternalStateRunning) || state == STKAudioPlayerInternalStatePaused)
     {
-        Boolean isUpdated;
+        pthread_mutex_unlock(&offlineRenderMutex);
         
-        [audioPlayer connectGraph];
-        
-        AUGraphUpdate(audioPlayer->audioGraph, &isUpdated);
-        
-        isUpdated = isUpdated;
+        return 0;
     }
-	
-    if (entry == nil)
+    
+    frameCount = MIN(frameCount, STKRingBufferUsedFrameCount(&pcmRingBuffer));
+    
+    if (frameCount == 0)
     {
+        pthread_mutex_unlock(&offlineRenderMutex);
+        
         return 0;
     }
     
-    setLock(&entry->spinLock);
-	
-    SInt64 extraFramesPlayedNotAssigned = 0;
-    SInt64 framesPlayedForCurrent = totalFramesCopied;
+    // Still held so reconfigureForSampleRate: can't replace the buffers while they're being read
+    
+    uint64_t renderStart = mach_absolute_time();
+    
+    RenderFrames(self, frameCount, bufferList);
+    
+    uint64_t end = mach_absolute_time();
+    
+    pthread_mutex_unlock(&offlineRenderMutex);
+    
+    STKCounterAdd(&counters.renderCallCount, 1);
+    STKCounterAdd(&counters.framesRendered, frameCount);
+    STKCounterAdd(&counters.offlineRenderTime, MachTimeToNanoseconds(end - start));
+    STKHistogramRecord(&counters.renderDuration, MachTimeToNanoseconds(end - renderStart));
+    
+    return frameCount;
+}
 
-    if (entry->lastFrameQueued >= 0)
+/// The item ids of the buffering and upcoming entries, most recently queued first. Called with the playerMutex held
+-(NSMutableArray*) pendingQueueItemIds
+{
+	NSMutableArray* retval = [[NSMutableArray alloc] initWithCapacity:upcomingQueue.count + bufferingQueue.count];
+	
+    void (^addQueueItemId)(STKQueueEntry*, BOOL*) = ^(STKQueueEntry* entry, BOOL* stop)
     {
-        framesPlayedForCurrent = MIN(entry->lastFrameQueued - entry->framesPlayed, framesPlayedForCurrent);
-    }
+        [retval addObject:entry.queueItemId];
+    };
     
-    entry->framesPlayed += framesPlayedForCurrent;
-    extraFramesPlayedNotAssigned = totalFramesCopied - framesPlayedForCurrent;
+    [upcomingQueue enumerateEntriesWithOptions:NSEnumerationReverse usingBlock:addQueueItemId];
+    [bufferingQueue enumerateEntriesWithOptions:NSEnumerationReverse usingBlock:addQueueItemId];
     
-    BOOL lastFramePlayed = entry->framesPlayed == entry->lastFrameQueued;
+	return retval;
+}
 
-    lockUnlock(&entry->spinLock);
+-(uint64_t) pendingQueueVersion
+{
+    return upcomingQueue.version + bufferingQueue.version;
+}
+
+/// Returns the snapshot of pendingQueue if neither queue has changed since it was taken
+-(NSArray*) currentPendingQueueSnapshot
+{
+    NSArray* retval = nil;
+    uint64_t version = [self pendingQueueVersion];
     
-    if (signal || lastFramePlayed)
+    setLock(&pendingQueueSnapshotLock);
+    
+    if (pendingQueueSnapshot != nil && pendingQueueSnapshotVersion == version)
     {
-        pthread_mutex_lock(&audioPlayer->playerMutex);
-        
-        setLock(&audioPlayer->currentEntryReferencesLock);
-        STKQueueEntry* currentlyPlayingEntry = audioPlayer->currentlyPlayingEntry;
-        lockUnlock(&audioPlayer->currentEntryReferencesLock);
-       
-        if (lastFramePlayed && entry == currentlyPlayingEntry)
-        {
-            [audioPlayer audioQueueFinishedPlaying:entry];
-            
-            while (extraFramesPlayedNotAssigned > 0)
-            {
-                setLock(&audioPlayer->currentEntryReferencesLock);
-                STKQueueEntry* newEntry = audioPlayer->currentlyPlayingEntry;
-                lockUnlock(&audioPlayer->currentEntryReferencesLock);
-                
-                if (newEntry != nil)
-                {
-                    SInt64 framesPlayedForCurrent = extraFramesPlayedNotAssigned;
-                    
-                    setLock(&newEntry->spinLock);
-                    
-                    if (newEntry->lastFrameQueued > 0)
-                    {
-                        framesPlayedForCurrent = MIN(newEntry->lastFrameQueued - newEntry->framesPlayed, framesPlayedForCurrent);
-                    }
-                    
-                    newEntry->framesPlayed += framesPlayedForCurrent;
-                    
-                    if (newEntry->framesPlayed == newEntry->lastFrameQueued)
-                    {
-                        lockUnlock(&newEntry->spinLock);
-                        
-                        [audioPlayer audioQueueFinishedPlaying:newEntry];
-                    }
-                    else
-                    {
-                        lockUnlock(&newEntry->spinLock);
-                    }
-                    
-                    extraFramesPlayedNotAssigned -= framesPlayedForCurrent;
-                }
-				else
-				{
-					break;
-				}
-            }
-        }
-
-        pthread_cond_signal(&audioPlayer->playerThreadReadyCondition);
-        pthread_mutex_unlock(&audioPlayer->playerMutex);
+        retval = pendingQueueSnapshot;
     }
     
-    return 0;
+    lockUnlock(&pendingQueueSnapshotLock);
+    
+    return retval;
 }
 
 -(NSArray*) pendingQueue
 {
-	pthread_mutex_lock(&playerMutex);
-	
-	NSArray* retval;
-	NSMutableArray* mutableArray = [[NSMutableArray alloc] initWithCapacity:upcomingQueue.count + bufferingQueue.count];
-	
-    for (STKQueueEntry* entry in upcomingQueue)
-    {
-        [mutableArray addObject:[entry queueItemId]];
-    }
+    NSArray* retval = [self currentPendingQueueSnapshot];
     
-    for (STKQueueEntry* entry in bufferingQueue)
+    if (retval != nil)
     {
-        [mutableArray addObject:[entry queueItemId]];
+        return retval;
     }
     
-	retval = [NSArray arrayWithArray:mutableArray];
+	LockPlayerMutex(self);
+	
+    uint64_t version = [self pendingQueueVersion];
+	
+	retval = [NSArray arrayWithArray:[self pendingQueueItemIds]];
 	
 	pthread_mutex_unlock(&playerMutex);
+    
+    setLock(&pendingQueueSnapshotLock);
+    
+    pendingQueueSnapshot = retval;
+    pendingQueueSnapshotVersion = version;
+    
+    lockUnlock(&pendingQueueSnapshotLock);
 	
 	return retval;
 }
 
 -(NSUInteger) pendingQueueCount
 {
-	pthread_mutex_lock(&playerMutex);
-	
-	NSUInteger retval = upcomingQueue.count + bufferingQueue.count;
-	
-	pthread_mutex_unlock(&playerMutex);
-	
-	return retval;
+	return upcomingQueue.count + bufferingQueue.count;
 }
 
 -(NSObject*) mostRecentlyQueuedStillPendingItem
 {
-	pthread_mutex_lock(&playerMutex);
-	
-	if (upcomingQueue.count > 0)
-	{
-		NSObject* retval = [[upcomingQueue objectAtIndex:0] queueItemId];
-		
-		pthread_mutex_unlock(&playerMutex);
-		
-		return retval;
-	}
+    NSArray* snapshot = [self currentPendingQueueSnapshot];
+    
+    if (snapshot != nil)
+    {
+        return snapshot.firstObject;
+    }
+    
+	LockPlayerMutex(self);
 	
-	if (bufferingQueue.count > 0)
-	{
-		NSObject* retval = [[bufferingQueue objectAtIndex:0] queueItemId];
-		
-		pthread_mutex_unlock(&playerMutex);
-		
-		return retval;
-	}
+	STKQueueEntry* entry = [upcomingQueue peekLast] ?: [bufferingQueue peekLast];
 	
 	pthread_mutex_unlock(&playerMutex);
 	
-	return nil;
+	return entry.queueItemId;
 }
 
 -(float) peakPowerInDecibelsForChannel:(NSUInteger)channelNumber
 {
-	if (channelNumber >= canonicalAudioStreamBasicDescription.mChannelsPerFrame)
-	{
-		return 0;
-	}
+	// Channels the meter doesn't have read as silent
 	
-	return peakPowerDb[channelNumber];
-}
-
--(void) setPeakPowerInDecibelsForChannel:(NSUInteger)channelNumber andPower: (Float32)power
-{
-    if (channelNumber >= canonicalAudioStreamBasicDescription.mChannelsPerFrame)
-    {
-        return;
-    }
-    
-    peakPowerDb[channelNumber] = power;
+	return STKMeterPeakPowerDb(&meter, (UInt32)MIN(channelNumber, UINT32_MAX));
 }
 
 -(float) averagePowerInDecibelsForChannel:(NSUInteger)channelNumber
 {
-	if (channelNumber >= canonicalAudioStreamBasicDescription.mChannelsPerFrame)
-	{
-		return 0;
-	}
-	
-	return averagePowerDb[channelNumber];
-}
-
--(void) setAveragePowerInDecibelsForChannel:(NSUInteger)channelNumber andPower: (Float32)power
-{
-    if (channelNumber >= canonicalAudioStreamBasicDescription.mChannelsPerFrame)
-    {
-        return;
-    }
-    
-    averagePowerDb[channelNumber] = power;
+	return STKMeterAveragePowerDb(&meter, (UInt32)MIN(channelNumber, UINT32_MAX));
 }
 
 -(BOOL) meteringEnabled
@@ -3298,23 +5509,34 @@ static OSStatus OutputRenderCallback(void* inRefCon, AudioUnitRenderActionFlags*
 	return self->meteringEnabled;
 }
 
-#define CALCULATE_METER(channel) \
-	Float32 currentFilteredValueOfSampleAmplitude##channel = STK_LOWPASSFILTERTIMESLICE * absoluteValueOfSampleAmplitude##channel + (1.0 - STK_LOWPASSFILTERTIMESLICE) * previousFilteredValueOfSampleAmplitude##channel; \
-	previousFilteredValueOfSampleAmplitude##channel = currentFilteredValueOfSampleAmplitude##channel; \
-	Float32 sampleDB##channel = 20.0 * log10(currentFilteredValueOfSampleAmplitude##channel) + STK_DBOFFSET; \
-	if ((sampleDB##channel == sampleDB##channel) && (sampleDB##channel != -DBL_MAX)) \
-	{ \
-		if(sampleDB##channel > peakValue##channel) \
-		{ \
-			peakValue##channel = sampleDB##channel; \
-		} \
-		if (sampleDB##channel > -DBL_MAX) \
-		{ \
-			count##channel++; \
-			totalValue##channel += sampleDB##channel; \
-		} \
-		decibels##channel = peakValue##channel; \
-	};
+static void STKMeteringFrameFilter(void* context, UInt32 channelsPerFrame, UInt32 bytesPerFrame, UInt32 frameCount, void* frames)
+{
+	STKMeter* meter = (STKMeter*)context;
+	
+	if (meter->nonInterleaved)
+	{
+		AudioBufferList* bufferList = (AudioBufferList*)frames;
+		const void* buffers[bufferList->mNumberBuffers];
+		
+		if (bufferList->mNumberBuffers < meter->channelCount)
+		{
+			return;
+		}
+		
+		for (UInt32 i = 0; i < bufferList->mNumberBuffers; i++)
+		{
+			buffers[i] = bufferList->mBuffers[i].mData;
+		}
+		
+		STKMeterProcess(meter, buffers, frameCount);
+	}
+	else
+	{
+		const void* buffers[] = { frames };
+		
+		STKMeterProcess(meter, buffers, frameCount);
+	}
+}
 
 -(void) setMeteringEnabled:(BOOL)value
 {
@@ -3330,66 +5552,45 @@ static OSStatus OutputRenderCallback(void* inRefCon, AudioUnitRenderActionFlags*
 	}
 	else
 	{
-		__weak STKAudioPlayer* weakSelf = self;
-        
-		[self appendFrameFilterWithName:@"STKMeteringFilter" block:^(UInt32 channelsPerFrame, UInt32 bytesPerFrame, UInt32 frameCount, void* frames)
-		{
-			SInt16* samples16 = (SInt16*)frames;
-			SInt32* samples32 = (SInt32*)frames;
-			UInt32 countLeft = 0;
-			UInt32 countRight = 0;
-			Float32 decibelsLeft = STK_DBMIN;
-			Float32 peakValueLeft = STK_DBMIN;
-			Float64 totalValueLeft = 0;
-			Float32 previousFilteredValueOfSampleAmplitudeLeft = 0;
-			Float32 decibelsRight = STK_DBMIN;
-			Float32 peakValueRight = STK_DBMIN;
-			Float64 totalValueRight = 0;
-			Float32 previousFilteredValueOfSampleAmplitudeRight = 0;
-			
-			if (bytesPerFrame / channelsPerFrame == 2)
-			{
-				for (int i = 0; i < frameCount * channelsPerFrame; i += channelsPerFrame)
-				{
-					Float32 absoluteValueOfSampleAmplitudeLeft = abs(samples16[i]);
-					Float32 absoluteValueOfSampleAmplitudeRight = abs(samples16[i + 1]);
-					
-					CALCULATE_METER(Left);
-					CALCULATE_METER(Right);
-				}
-			}
-			else if (bytesPerFrame / channelsPerFrame == 4)
-			{
-				for (int i = 0; i < frameCount * channelsPerFrame; i += channelsPerFrame)
-				{
-					Float32 absoluteValueOfSampleAmplitudeLeft = abs(samples32[i]) / 32768.0;
-					Float32 absoluteValueOfSampleAmplitudeRight = abs(samples32[i + 1]) / 32768.0;
-					
-					CALCULATE_METER(Left);
-					CALCULATE_METER(Right);
-				}
-			}
-			else
-			{
-				return;
-			}
-			
-			[weakSelf setPeakPowerInDecibelsForChannel:0 andPower:MIN(MAX(decibelsLeft, -60), 0)];
-			[weakSelf setPeakPowerInDecibelsForChannel:1 andPower:MIN(MAX(decibelsRight, -60), 0)];
-			
-			if (countLeft > 0)
-			{
-				[weakSelf setAveragePowerInDecibelsForChannel:0 andPower:MIN(MAX(totalValueLeft / frameCount, -60), 0)];
-			}
-			
-			if (countRight != 0)
-			{
-				[weakSelf setAveragePowerInDecibelsForChannel:1 andPower:MIN(MAX(totalValueRight / frameCount, -60), 0)];
-			}
-		}];
+		STKMeterReset(&meter);
+		
+		[self appendFrameFilterWithName:@"STKMeteringFilter" function:STKMeteringFrameFilter context:&meter];
+		self->meteringEnabled = YES;
 	}
 }
 
+#pragma mark Statistics
+
+-(void) recordRead:(int)read forEntry:(STKQueueEntry*)entry
+{
+    STKCounterAdd(&counters.readCallCount, 1);
+    STKCounterAdd(&entry->readCallCount, 1);
+    
+    if (read > 0)
+    {
+        STKCounterAdd(&counters.bytesRead, read);
+        STKCounterAdd(&entry->bytesRead, read);
+    }
+}
+
+-(STKAudioPlayerStatistics*) statistics
+{
+    setLock(&currentEntryReferencesLock);
+    STKQueueEntry* playingEntry = currentlyPlayingEntry;
+    STKQueueEntry* readingEntry = currentlyReadingEntry;
+    lockUnlock(&currentEntryReferencesLock);
+    
+    UInt32 frameCount = pcmRingBuffer.frameCount;
+    double bufferFillLevel = frameCount > 0 ? (double)STKRingBufferUsedFrameCount(&pcmRingBuffer) / frameCount : 0;
+    
+    return [[STKAudioPlayerStatistics alloc] initWithCounters:&counters sampleRate:canonicalAudioStreamBasicDescription.mSampleRate bufferFillLevel:bufferFillLevel currentlyPlayingEntry:playingEntry currentlyReadingEntry:readingEntry];
+}
+
+-(void) resetStatistics
+{
+    STKAudioPlayerCountersReset(&counters);
+}
+
 #pragma mark Frame Filters
 
 -(NSArray*) frameFilters
@@ -3397,14 +5598,50 @@ static OSStatus OutputRenderCallback(void* inRefCon, AudioUnitRenderActionFlags*
 	return frameFilters;
 }
 
+/// Builds a new filter chain from the given entries and swaps it into the render thread.
+/// Must be called with the playerMutex held.
+-(void) publishFrameFilters:(NSArray*)replacement
+{
+	STKFrameFilterChain* chain = NULL;
+	
+	if (replacement.count > 0)
+	{
+		chain = STKFrameFilterChainCreate((UInt32)replacement.count);
+		
+		if (chain == NULL)
+		{
+			return;
+		}
+		
+		for (UInt32 i = 0; i < chain->count; i++)
+		{
+			STKFrameFilterEntry* filterEntry = replacement[i];
+			
+			chain->stages[i].function = filterEntry->function;
+			chain->stages[i].context = filterEntry->context;
+		}
+	}
+	
+	STKFrameFilterPipelinePublish(&frameFilterPipeline, chain);
+	
+	// The previous entries (and their blocks) are only released once the render thread has stopped using them
+	
+	frameFilters = replacement.count > 0 ? replacement : nil;
+}
+
 -(void) appendFrameFilterWithName:(NSString*)name block:(STKFrameFilter)block
 {
 	[self addFrameFilterWithName:name afterFilterWithName:nil block:block];
 }
 
+-(void) appendFrameFilterWithName:(NSString*)name function:(STKFrameFilterFunction)function context:(void*)context
+{
+	[self addFrameFilterWithName:name afterFilterWithName:nil function:function context:context];
+}
+
 -(void) removeFrameFilterWithName:(NSString*)name
 {
-	pthread_mutex_lock(&self->playerMutex);
+	LockPlayerMutex(self);
 	
 	NSMutableArray* newFrameFilters = [[NSMutableArray alloc] initWithCapacity:frameFilters.count + 1];
 	
@@ -3416,31 +5653,30 @@ static OSStatus OutputRenderCallback(void* inRefCon, AudioUnitRenderActionFlags*
 		}
 	}
 	
-	NSArray* replacement = [NSArray arrayWithArray:newFrameFilters];
-	
-	setLock(&pcmBufferSpinLock);
-	if (newFrameFilters.count > 0)
-	{
-		frameFilters = replacement;
-	}
-	else
-	{
-		frameFilters = nil;
-	}
-	lockUnlock(&pcmBufferSpinLock);
+	[self publishFrameFilters:[NSArray arrayWithArray:newFrameFilters]];
 	
 	pthread_mutex_unlock(&self->playerMutex);
 }
 
 -(void) addFrameFilterWithName:(NSString*)name afterFilterWithName:(NSString*)afterFilterWithName block:(STKFrameFilter)block
 {
-	pthread_mutex_lock(&self->playerMutex);
+	[self addFrameFilterEntry:[[STKFrameFilterEntry alloc] initWithFilter:block andName:name] afterFilterWithName:afterFilterWithName];
+}
+
+-(void) addFrameFilterWithName:(NSString*)name afterFilterWithName:(NSString*)afterFilterWithName function:(STKFrameFilterFunction)function context:(void*)context
+{
+	[self addFrameFilterEntry:[[STKFrameFilterEntry alloc] initWithFunction:function context:context andName:name] afterFilterWithName:afterFilterWithName];
+}
+
+-(void) addFrameFilterEntry:(STKFrameFilterEntry*)newEntry afterFilterWithName:(NSString*)afterFilterWithName
+{
+	LockPlayerMutex(self);
 	
 	NSMutableArray* newFrameFilters = [[NSMutableArray alloc] initWithCapacity:frameFilters.count + 1];
 	
 	if (afterFilterWithName == nil)
 	{
-		[newFrameFilters addObject:[[STKFrameFilterEntry alloc] initWithFilter:block andName:name]];
+		[newFrameFilters addObject:newEntry];
 		[newFrameFilters addObjectsFromArray:frameFilters];
 	}
 	else
@@ -3449,25 +5685,21 @@ static OSStatus OutputRenderCallback(void* inRefCon, AudioUnitRenderActionFlags*
 		{
 			if (afterFilterWithName != nil && [filterEntry->name isEqualToString:afterFilterWithName])
 			{
-				[newFrameFilters addObject:[[STKFrameFilterEntry alloc] initWithFilter:block andName:name]];
+				[newFrameFilters addObject:newEntry];
 			}
 			
 			[newFrameFilters addObject:filterEntry];
 		}
 	}
 	
-	NSArray* replacement = [NSArray arrayWithArray:newFrameFilters];
-	
-	setLock(&pcmBufferSpinLock);
-	frameFilters = replacement;
-	lockUnlock(&pcmBufferSpinLock);
+	[self publishFrameFilters:[NSArray arrayWithArray:newFrameFilters]];
 	
 	pthread_mutex_unlock(&self->playerMutex);
 }
 
 -(void) addFrameFilter:(STKFrameFilter)frameFilter withName:(NSString*)name afterFilterWithName:(NSString*)afterFilterWithName
 {
-	pthread_mutex_lock(&self->playerMutex);
+	LockPlayerMutex(self);
 	
 	NSMutableArray* newFrameFilters = [[NSMutableArray alloc] initWithCapacity:frameFilters.count + 1];
 	
@@ -3489,11 +5721,7 @@ static OSStatus OutputRenderCallback(void* inRefCon, AudioUnitRenderActionFlags*
 		}
 	}
 	
-	NSArray* replacement = [NSArray arrayWithArray:newFrameFilters];
-	
-	setLock(&pcmBufferSpinLock);
-	frameFilters = replacement;
-	lockUnlock(&pcmBufferSpinLock);
+	[self publishFrameFilters:[NSArray arrayWithArray:newFrameFilters]];
 	
 	pthread_mutex_unlock(&self->playerMutex);
 }
@@ -3504,6 +5732,13 @@ static OSStatus OutputRenderCallback(void* inRefCon, AudioUnitRenderActionFlags*
 {
 	self->volume = value;
 	
+	if (engine != nil)
+	{
+		[engine setVolume:value forBus:engineBus];
+		
+		return;
+	}
+	
 #if (TARGET_OS_IPHONE)
 	if (self->mixerNode)
 	{
@@ -3519,6 +5754,8 @@ static OSStatus OutputRenderCallback(void* inRefCon, AudioUnitRenderActionFlags*
 		AudioUnitSetParameter(outputUnit, kHALOutputParam_Volume, kAudioUnitScope_Output, kOutputBus, self->volume, 0);
 	}
 #endif
+	
+	[self queueGraphCommand:STKAudioPlayerGraphCommandReconnect];
 }
 
 -(Float32) volume
@@ -3526,6 +5763,35 @@ static OSStatus OutputRenderCallback(void* inRefCon, AudioUnitRenderActionFlags*
 	return self->volume;
 }
 
+-(void) setPan:(Float32)value
+{
+	self->pan = value;
+	
+	if (engine != nil)
+	{
+		[engine setPan:value forBus:engineBus];
+		
+		return;
+	}
+	
+	if (self->mixerNode)
+	{
+		AudioUnitSetParameter(self->mixerUnit, kMultiChannelMixerParam_Pan, kAudioUnitScope_Input, 0, self->pan, 0);
+	}
+	
+	[self queueGraphCommand:STKAudioPlayerGraphCommandReconnect];
+}
+
+-(Float32) pan
+{
+	return self->pan;
+}
+
+-(STKAudioEngine*) engine
+{
+	return engine;
+}
+
 -(BOOL) equalizerEnabled
 {
     return self->equalizerEnabled;
@@ -3534,6 +5800,8 @@ static OSStatus OutputRenderCallback(void* inRefCon, AudioUnitRenderActionFlags*
 -(void) setEqualizerEnabled:(BOOL)value
 {
     self->equalizerEnabled = value;
+    
+    STKEqualizerSetEnabled(&equalizer, value);
 }
 
 
@@ -0,0 +1,134 @@
+//
+//  STKAudioPlayerStatistics.h
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "STKHistogram.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class STKQueueEntry;
+
+///
+/// Counters kept by STKAudioPlayer while it plays. The render thread records into them with relaxed atomic adds
+/// (see STKHistogram) so recording never waits and reading them never blocks the player
+///
+typedef struct
+{
+    uint64_t renderCallCount;
+    uint64_t renderDeadlineMissCount;
+    uint64_t framesRendered;
+    uint64_t framesZeroFilled;
+    uint64_t underrunCount;
+    uint64_t underrunFrames;
+    uint64_t bytesRead;
+    uint64_t readCallCount;
+    /// Nanoseconds spent in renderFrames:count: (including waiting for frames to be decoded)
+    uint64_t offlineRenderTime;
+    /// Times the playback thread's run loop woke up or it slept waiting for room in the packet queue
+    uint64_t playbackThreadWakeupCount;
+    /// Times the decode thread woke up from waiting for packets or room in the PCM buffer
+    uint64_t decodeThreadWakeupCount;
+    /// Progress callbacks (stream metadata) dropped because too many callbacks were waiting on the delegateQueue
+    uint64_t delegateCallbacksDropped;
+    /// CLOCK_MONOTONIC_RAW in nanoseconds when the counters were last reset
+    uint64_t resetTime;
+    /// Nanoseconds spent in each render callback
+    STKHistogram renderDuration;
+    /// PCM buffer fill in tenths of a percent sampled at each render callback
+    STKHistogram bufferFill;
+    /// Nanoseconds spent in each AudioConverterFillComplexBuffer call
+    STKHistogram decodeDuration;
+    /// Milliseconds from an item starting to read to its first frames being rendered
+    STKHistogram timeToFirstAudio;
+    /// Nanoseconds spent waiting to acquire the player's mutex
+    STKHistogram playerMutexWait;
+}
+STKAudioPlayerCounters;
+
+void STKAudioPlayerCountersReset(STKAudioPlayerCounters* counters);
+
+/// A copy of one of the player's histograms. Values are bucketed by powers of two
+@interface STKAudioPlayerHistogram : NSObject
+
+@property (readonly) UInt64 count;
+@property (readonly) UInt64 total;
+@property (readonly) UInt64 maximum;
+@property (readonly) double mean;
+
+-(instancetype) initWithHistogram:(const STKHistogram*)histogram;
+
+/// Returns an upper bound (within a factor of two) of the given percentile (0 - 100) of the recorded values
+-(UInt64) valueAtPercentile:(double)percentile;
+
+@end
+
+/// Statistics for a single queue item
+@interface STKAudioPlayerItemStatistics : NSObject
+
+@property (readonly) NSObject* queueItemId;
+/// Bytes read from the item's data source
+@property (readonly) UInt64 bytesRead;
+/// Number of reads made on the item's data source
+@property (readonly) UInt64 readCallCount;
+/// Seconds from the item starting to read to its first frames being decoded (-1 if not yet known)
+@property (readonly) double timeToFirstSample;
+/// Seconds from the item starting to read to its first frames being rendered (-1 if not yet known)
+@property (readonly) double timeToFirstAudio;
+/// Estimated download rate of the item's data source (0 if unknown)
+@property (readonly) double downloadBytesPerSecond;
+
+-(instancetype) initWithQueueEntry:(STKQueueEntry*)entry;
+
+@end
+
+/// A snapshot of an STKAudioPlayer's statistics since it was created or its statistics were last reset
+@interface STKAudioPlayerStatistics : NSObject
+
+@property (readonly) UInt64 renderCallCount;
+/// Number of render callbacks that took longer than the audio they rendered
+@property (readonly) UInt64 renderDeadlineMissCount;
+@property (readonly) UInt64 framesRendered;
+/// Number of frames rendered as silence because no audio was ready
+@property (readonly) UInt64 framesZeroFilled;
+/// Number of times playback ran out of audio and had to rebuffer
+@property (readonly) UInt64 underrunCount;
+/// Seconds of output spent rebuffering
+@property (readonly) double underrunDuration;
+@property (readonly) UInt64 bytesRead;
+@property (readonly) UInt64 readCallCount;
+/// Seconds of audio rendered with renderFrames:count: per second spent in it (e.g. 40 is 40x real time). 0 if nothing was rendered offline
+@property (readonly) double offlineRenderSpeed;
+/// Fraction (0 - 1) of the PCM buffer in use when the snapshot was taken
+@property (readonly) double bufferFillLevel;
+@property (readonly) UInt64 playbackThreadWakeupCount;
+@property (readonly) UInt64 decodeThreadWakeupCount;
+/// Wakeups of the playback and decode threads per minute since the statistics were reset. Idle playback with
+/// burstDecoding should keep this low
+@property (readonly) double wakeupsPerMinute;
+/// Number of progress callbacks (stream metadata) dropped because the delegateQueue fell too far behind.
+/// State changes are merged instead and other callbacks are never dropped
+@property (readonly) UInt64 delegateCallbacksDropped;
+
+/// Nanoseconds spent in each render callback
+@property (readonly) STKAudioPlayerHistogram* renderDuration;
+/// PCM buffer fill in tenths of a percent sampled at each render callback
+@property (readonly) STKAudioPlayerHistogram* bufferFill;
+/// Nanoseconds spent in each AudioConverterFillComplexBuffer call
+@property (readonly) STKAudioPlayerHistogram* decodeDuration;
+/// Milliseconds from each item starting to read to its first frames being rendered
+@property (readonly) STKAudioPlayerHistogram* timeToFirstAudio;
+/// Nanoseconds spent waiting to acquire the player's mutex
+@property (readonly) STKAudioPlayerHistogram* playerMutexWait;
+
+@property (readonly, nullable) STKAudioPlayerItemStatistics* currentlyPlayingItem;
+@property (readonly, nullable) STKAudioPlayerItemStatistics* currentlyReadingItem;
+
+-(instancetype) initWithCounters:(const STKAudioPlayerCounters*)counters sampleRate:(Float64)sampleRate bufferFillLevel:(double)bufferFillLevel currentlyPlayingEntry:(nullable STKQueueEntry*)currentlyPlayingEntry currentlyReadingEntry:(nullable STKQueueEntry*)currentlyReadingEntry;
+
+@end
+
+NS_ASSUME_NONNULL_END
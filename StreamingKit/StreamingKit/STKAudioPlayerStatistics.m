@@ -0,0 +1,161 @@
+//
+//  STKAudioPlayerStatistics.m
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import "STKAudioPlayerStatistics.h"
+#import "STKQueueEntry.h"
+
+void STKAudioPlayerCountersReset(STKAudioPlayerCounters* counters)
+{
+    __atomic_store_n(&counters->renderCallCount, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&counters->renderDeadlineMissCount, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&counters->framesRendered, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&counters->framesZeroFilled, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&counters->underrunCount, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&counters->underrunFrames, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&counters->bytesRead, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&counters->readCallCount, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&counters->offlineRenderTime, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&counters->playbackThreadWakeupCount, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&counters->decodeThreadWakeupCount, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&counters->delegateCallbacksDropped, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&counters->resetTime, clock_gettime_nsec_np(CLOCK_MONOTONIC_RAW), __ATOMIC_RELAXED);
+    
+    STKHistogramReset(&counters->renderDuration);
+    STKHistogramReset(&counters->bufferFill);
+    STKHistogramReset(&counters->decodeDuration);
+    STKHistogramReset(&counters->timeToFirstAudio);
+    STKHistogramReset(&counters->playerMutexWait);
+}
+
+@interface STKAudioPlayerHistogram()
+{
+    STKHistogram histogram;
+}
+@end
+
+@implementation STKAudioPlayerHistogram
+
+-(instancetype) initWithHistogram:(const STKHistogram*)histogramIn
+{
+    if (self = [super init])
+    {
+        STKHistogramCopy(histogramIn, &self->histogram);
+    }
+    
+    return self;
+}
+
+-(UInt64) count
+{
+    return histogram.count;
+}
+
+-(UInt64) total
+{
+    return histogram.total;
+}
+
+-(UInt64) maximum
+{
+    return histogram.maximum;
+}
+
+-(double) mean
+{
+    return histogram.count > 0 ? (double)histogram.total / (double)histogram.count : 0;
+}
+
+-(UInt64) valueAtPercentile:(double)percentile
+{
+    return STKHistogramPercentile(&histogram, percentile);
+}
+
+-(NSString*) description
+{
+    return [NSString stringWithFormat:@"count=%llu mean=%.0f p50=%llu p99=%llu max=%llu", histogram.count, self.mean, [self valueAtPercentile:50], [self valueAtPercentile:99], histogram.maximum];
+}
+
+@end
+
+@implementation STKAudioPlayerItemStatistics
+
+-(instancetype) initWithQueueEntry:(STKQueueEntry*)entry
+{
+    if (self = [super init])
+    {
+        self->_queueItemId = entry.queueItemId;
+        self->_bytesRead = STKCounterGet(&entry->bytesRead);
+        self->_readCallCount = STKCounterGet(&entry->readCallCount);
+        self->_timeToFirstSample = entry->timeToFirstSample;
+        self->_timeToFirstAudio = entry->timeToFirstAudio;
+        self->_downloadBytesPerSecond = entry.dataSource.downloadBytesPerSecond;
+    }
+    
+    return self;
+}
+
+@end
+
+@implementation STKAudioPlayerStatistics
+
+-(instancetype) initWithCounters:(const STKAudioPlayerCounters*)counters sampleRate:(Float64)sampleRate bufferFillLevel:(double)bufferFillLevel currentlyPlayingEntry:(STKQueueEntry*)currentlyPlayingEntry currentlyReadingEntry:(STKQueueEntry*)currentlyReadingEntry
+{
+    if (self = [super init])
+    {
+        self->_renderCallCount = STKCounterGet(&counters->renderCallCount);
+        self->_renderDeadlineMissCount = STKCounterGet(&counters->renderDeadlineMissCount);
+        self->_framesRendered = STKCounterGet(&counters->framesRendered);
+        self->_framesZeroFilled = STKCounterGet(&counters->framesZeroFilled);
+        self->_underrunCount = STKCounterGet(&counters->underrunCount);
+        self->_underrunDuration = sampleRate > 0 ? STKCounterGet(&counters->underrunFrames) / sampleRate : 0;
+        self->_bytesRead = STKCounterGet(&counters->bytesRead);
+        self->_readCallCount = STKCounterGet(&counters->readCallCount);
+        self->_bufferFillLevel = bufferFillLevel;
+        self->_playbackThreadWakeupCount = STKCounterGet(&counters->playbackThreadWakeupCount);
+        self->_decodeThreadWakeupCount = STKCounterGet(&counters->decodeThreadWakeupCount);
+        self->_delegateCallbacksDropped = STKCounterGet(&counters->delegateCallbacksDropped);
+        
+        uint64_t elapsed = clock_gettime_nsec_np(CLOCK_MONOTONIC_RAW) - STKCounterGet(&counters->resetTime);
+        
+        if (elapsed > 0)
+        {
+            self->_wakeupsPerMinute = (self->_playbackThreadWakeupCount + self->_decodeThreadWakeupCount) / (elapsed / (double)NSEC_PER_SEC / 60);
+        }
+        
+        uint64_t offlineRenderTime = STKCounterGet(&counters->offlineRenderTime);
+        
+        if (offlineRenderTime > 0 && sampleRate > 0)
+        {
+            self->_offlineRenderSpeed = (self->_framesRendered / sampleRate) / (offlineRenderTime / (double)NSEC_PER_SEC);
+        }
+        
+        self->_renderDuration = [[STKAudioPlayerHistogram alloc] initWithHistogram:&counters->renderDuration];
+        self->_bufferFill = [[STKAudioPlayerHistogram alloc] initWithHistogram:&counters->bufferFill];
+        self->_decodeDuration = [[STKAudioPlayerHistogram alloc] initWithHistogram:&counters->decodeDuration];
+        self->_timeToFirstAudio = [[STKAudioPlayerHistogram alloc] initWithHistogram:&counters->timeToFirstAudio];
+        self->_playerMutexWait = [[STKAudioPlayerHistogram alloc] initWithHistogram:&counters->playerMutexWait];
+        
+        if (currentlyPlayingEntry != nil)
+        {
+            self->_currentlyPlayingItem = [[STKAudioPlayerItemStatistics alloc] initWithQueueEntry:currentlyPlayingEntry];
+        }
+        
+        if (currentlyReadingEntry != nil)
+        {
+            self->_currentlyReadingItem = currentlyReadingEntry == currentlyPlayingEntry ? self->_currentlyPlayingItem : [[STKAudioPlayerItemStatistics alloc] initWithQueueEntry:currentlyReadingEntry];
+        }
+    }
+    
+    return self;
+}
+
+-(NSString*) description
+{
+    return [NSString stringWithFormat:@"renders=%llu deadlineMisses=%llu zeroFilled=%llu underruns=%llu (%.2fs) bytesRead=%llu reads=%llu fill=%.2f wakeups/min=%.1f delegateDropped=%llu render(ns): %@ decode(ns): %@ mutexWait(ns): %@", self.renderCallCount, self.renderDeadlineMissCount, self.framesZeroFilled, self.underrunCount, self.underrunDuration, self.bytesRead, self.readCallCount, self.bufferFillLevel, self.wakeupsPerMinute, self.delegateCallbacksDropped, self.renderDuration, self.decodeDuration, self.playerMutexWait];
+}
+
+@end
@@ -0,0 +1,163 @@
+//
+//  STKBandwidthEstimator.c
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#include "STKBandwidthEstimator.h"
+#include <math.h>
+
+#define STK_BANDWIDTH_SAMPLE_SECONDS (0.2)
+#define STK_BANDWIDTH_IDLE_SECONDS (0.5)
+#define STK_BANDWIDTH_FAST_HALF_LIFE_SECONDS (2.0)
+#define STK_BANDWIDTH_SLOW_HALF_LIFE_SECONDS (8.0)
+#define STK_BANDWIDTH_MINIMUM_WEIGHT_SECONDS (0.5)
+
+/// Ratio of download rate to media rate above which less than the configured buffer is needed
+#define STK_ADAPTIVE_COMFORTABLE_RATIO (2.0)
+/// Multiple of the configured buffer used when the download rate only just keeps up
+#define STK_ADAPTIVE_MARGINAL_FACTOR (3.0)
+
+void STKBandwidthEstimatorInit(STKBandwidthEstimator* estimator)
+{
+    estimator->fastEstimate = 0;
+    estimator->slowEstimate = 0;
+    estimator->totalWeight = 0;
+    estimator->windowStart = 0;
+    estimator->lastTime = 0;
+    estimator->windowBytes = 0;
+    estimator->totalBytes = 0;
+    estimator->sampleCount = 0;
+}
+
+void STKBandwidthEstimatorRestart(STKBandwidthEstimator* estimator)
+{
+    estimator->lastTime = 0;
+    estimator->windowBytes = 0;
+}
+
+static double Average(double average, double halfLife, double weight, double value)
+{
+    double alpha = pow(0.5, weight / halfLife);
+
+    return value * (1 - alpha) + average * alpha;
+}
+
+/// Removes the bias towards the initial 0 of an average that has only seen a little weight
+static double Unbiased(double average, double halfLife, double totalWeight)
+{
+    return average / (1 - pow(0.5, totalWeight / halfLife));
+}
+
+static void AddSample(STKBandwidthEstimator* estimator, double seconds, uint64_t bytes)
+{
+    double value = (double)bytes / seconds;
+
+    estimator->fastEstimate = Average(estimator->fastEstimate, STK_BANDWIDTH_FAST_HALF_LIFE_SECONDS, seconds, value);
+    estimator->slowEstimate = Average(estimator->slowEstimate, STK_BANDWIDTH_SLOW_HALF_LIFE_SECONDS, seconds, value);
+    estimator->totalWeight += seconds;
+    estimator->sampleCount++;
+}
+
+void STKBandwidthEstimatorAddBytes(STKBandwidthEstimator* estimator, uint64_t bytes, double now, bool saturated)
+{
+    estimator->totalBytes += bytes;
+
+    if (estimator->lastTime == 0)
+    {
+        // The first read's bytes arrived at an unknown time after the request
+
+        estimator->windowStart = now;
+        estimator->windowBytes = 0;
+    }
+    else if (saturated && now - estimator->lastTime > STK_BANDWIDTH_IDLE_SECONDS)
+    {
+        // A full read after the reader has been away means the bytes were waiting for an unknown time
+
+        estimator->windowStart = now;
+        estimator->windowBytes = 0;
+    }
+    else
+    {
+        estimator->windowBytes += bytes;
+    }
+
+    estimator->lastTime = now;
+
+    double seconds = now - estimator->windowStart;
+
+    if (seconds >= STK_BANDWIDTH_SAMPLE_SECONDS && estimator->windowBytes > 0)
+    {
+        AddSample(estimator, seconds, estimator->windowBytes);
+
+        estimator->windowStart = now;
+        estimator->windowBytes = 0;
+    }
+}
+
+double STKBandwidthEstimatorBytesPerSecond(const STKBandwidthEstimator* estimator)
+{
+    if (estimator->totalWeight < STK_BANDWIDTH_MINIMUM_WEIGHT_SECONDS)
+    {
+        return 0;
+    }
+
+    double fast = Unbiased(estimator->fastEstimate, STK_BANDWIDTH_FAST_HALF_LIFE_SECONDS, estimator->totalWeight);
+    double slow = Unbiased(estimator->slowEstimate, STK_BANDWIDTH_SLOW_HALF_LIFE_SECONDS, estimator->totalWeight);
+
+    return fast < slow ? fast : slow;
+}
+
+double STKAdaptiveBufferSeconds(double configuredSeconds, double ratio, double remainingSeconds, double minimumSeconds, double maximumSeconds)
+{
+    double retval;
+
+    if (configuredSeconds <= 0)
+    {
+        return 0;
+    }
+
+    if (ratio <= 0)
+    {
+        retval = configuredSeconds;
+    }
+    else if (ratio >= STK_ADAPTIVE_COMFORTABLE_RATIO)
+    {
+        retval = configuredSeconds * STK_ADAPTIVE_COMFORTABLE_RATIO / ratio;
+    }
+    else if (ratio >= 1)
+    {
+        double t = (STK_ADAPTIVE_COMFORTABLE_RATIO - ratio) / (STK_ADAPTIVE_COMFORTABLE_RATIO - 1);
+
+        retval = configuredSeconds * (1 + t * (STK_ADAPTIVE_MARGINAL_FACTOR - 1));
+    }
+    else
+    {
+        // Enough to cover the download falling behind for the rest of the stream
+
+        retval = configuredSeconds * STK_ADAPTIVE_MARGINAL_FACTOR + remainingSeconds * (1 - ratio);
+    }
+
+    if (minimumSeconds > configuredSeconds)
+    {
+        minimumSeconds = configuredSeconds;
+    }
+
+    if (maximumSeconds < configuredSeconds)
+    {
+        maximumSeconds = configuredSeconds;
+    }
+
+    if (retval < minimumSeconds)
+    {
+        retval = minimumSeconds;
+    }
+
+    if (retval > maximumSeconds)
+    {
+        retval = maximumSeconds;
+    }
+
+    return retval;
+}
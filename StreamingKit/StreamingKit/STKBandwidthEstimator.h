@@ -0,0 +1,59 @@
+//
+//  STKBandwidthEstimator.h
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+///
+/// Estimates download throughput from the reads made on a stream.
+/// Bytes are gathered into windows of at least STK_BANDWIDTH_SAMPLE_SECONDS and each window feeds a fast and a slow
+/// exponentially weighted moving average (weighted by the window's duration). The estimate is the lower of the two so
+/// it drops quickly when the link slows down and recovers carefully. Not thread safe.
+///
+typedef struct
+{
+    double fastEstimate;
+    double slowEstimate;
+    double totalWeight;
+    double windowStart;
+    double lastTime;
+    uint64_t windowBytes;
+    uint64_t totalBytes;
+    uint32_t sampleCount;
+}
+STKBandwidthEstimator;
+
+void STKBandwidthEstimatorInit(STKBandwidthEstimator* estimator);
+/// Starts a new window without forgetting the estimate (e.g. when a new request is made)
+void STKBandwidthEstimatorRestart(STKBandwidthEstimator* estimator);
+
+/// Adds a read of bytes at time now (in seconds). Pass saturated if the read filled the buffer it was given.
+/// A saturated read more than STK_BANDWIDTH_IDLE_SECONDS after the previous one means the reader was busy and the
+/// bytes were waiting so the gap is not counted against the link. Gaps before short reads are (the link stalled)
+void STKBandwidthEstimatorAddBytes(STKBandwidthEstimator* estimator, uint64_t bytes, double now, bool saturated);
+
+/// Estimated bytes per second or 0 if there aren't enough samples yet
+double STKBandwidthEstimatorBytesPerSecond(const STKBandwidthEstimator* estimator);
+
+///
+/// Returns the seconds of audio to buffer before playing, scaled from configuredSeconds by the ratio of the
+/// download rate to the media bit rate. Fast links buffer less (down to minimumSeconds). Links that are only just
+/// fast enough buffer more. Links slower than the media buffer enough to cover the shortfall over remainingSeconds.
+/// The result is kept between minimumSeconds and maximumSeconds but never moves past configuredSeconds because of
+/// either bound. A ratio of 0 (unknown) returns configuredSeconds
+///
+double STKAdaptiveBufferSeconds(double configuredSeconds, double ratio, double remainingSeconds, double minimumSeconds, double maximumSeconds);
+
+#ifdef __cplusplus
+}
+#endif
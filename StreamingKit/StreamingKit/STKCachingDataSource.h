@@ -0,0 +1,24 @@
+//
+//  STKCachingDataSource.h
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import "STKDataSourceWrapper.h"
+#import "STKDataSourceCache.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Wraps a data source (usually an STKAutoRecoveringHTTPDataSource) and keeps the bytes it reads in an STKDataSourceCache.
+/// Reads and seeks are served from the cache while the bytes are present and only the missing gaps are fetched from the
+/// inner data source. Streams without a cacheKey or a known length (e.g. live streams) pass straight through
+@interface STKCachingDataSource : STKDataSourceWrapper
+
+@property (readonly) STKDataSourceCache* cache;
+
+-(instancetype) initWithDataSource:(STKDataSource*)innerDataSource cache:(STKDataSourceCache*)cache;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,277 @@
+//
+//  STKCachingDataSource.m
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import "STKCachingDataSource.h"
+
+@interface STKCachingDataSource()
+{
+    SInt64 position;
+    int eventSerial;
+    BOOL readingFromCache;
+    NSRunLoop* eventsRunLoop;
+    STKDataSourceCacheItem* item;
+}
+
+@property (readwrite) STKDataSourceCache* cache;
+
+@end
+
+@implementation STKCachingDataSource
+
+-(instancetype) initWithDataSource:(STKDataSource*)innerDataSourceIn cache:(STKDataSourceCache*)cacheIn
+{
+    if (self = [super initWithDataSource:innerDataSourceIn])
+    {
+        self.cache = cacheIn;
+    }
+
+    return self;
+}
+
+-(void) dealloc
+{
+    [self closeItem];
+}
+
+-(void) openItemWithLength:(SInt64)length
+{
+    NSString* key = self.cacheKey;
+
+    if (item != nil || self.cache == nil || key == nil)
+    {
+        return;
+    }
+
+    item = [self.cache openItemWithKey:key length:length];
+}
+
+-(void) closeItem
+{
+    if (item != nil)
+    {
+        [self.cache closeItem:item];
+
+        item = nil;
+    }
+}
+
+-(void) scheduleCacheEvent
+{
+    NSRunLoop* runLoop = eventsRunLoop;
+
+    if (runLoop == nil)
+    {
+        return;
+    }
+
+    int serial = ++eventSerial;
+
+    CFRunLoopPerformBlock(runLoop.getCFRunLoop, NSRunLoopCommonModes, ^
+    {
+        if (serial != self->eventSerial || !self->readingFromCache)
+        {
+            return;
+        }
+
+        if (self->position >= self->item.length)
+        {
+            [self.delegate dataSourceEof:self];
+        }
+        else
+        {
+            [self.delegate dataSourceDataAvailable:self];
+        }
+    });
+
+    CFRunLoopWakeUp(runLoop.getCFRunLoop);
+}
+
+-(void) startReadingFromCache
+{
+    if (!readingFromCache)
+    {
+        readingFromCache = YES;
+
+        [self.innerDataSource close];
+    }
+
+    [self scheduleCacheEvent];
+}
+
+-(void) startReadingFromInnerDataSource
+{
+    readingFromCache = NO;
+    eventSerial++;
+
+    [super seekToOffset:position];
+}
+
+-(SInt64) length
+{
+    return item != nil ? item.length : self.innerDataSource.length;
+}
+
+-(SInt64) position
+{
+    return position;
+}
+
+-(BOOL) hasBytesAvailable
+{
+    if (readingFromCache)
+    {
+        return position < item.length;
+    }
+
+    return [super hasBytesAvailable];
+}
+
+-(BOOL) registerForEvents:(NSRunLoop*)runLoop
+{
+    eventsRunLoop = runLoop;
+
+    return [super registerForEvents:runLoop];
+}
+
+-(void) unregisterForEvents
+{
+    eventsRunLoop = nil;
+    eventSerial++;
+
+    [super unregisterForEvents];
+}
+
+-(void) close
+{
+    readingFromCache = NO;
+    eventSerial++;
+
+    [self closeItem];
+    [super close];
+}
+
+-(void) seekToOffset:(SInt64)offset
+{
+    position = offset;
+
+    [self openItemWithLength:0];
+
+    if (item != nil && (offset >= item.length || [self.cache item:item cachedLengthAtOffset:offset] > 0))
+    {
+        [self startReadingFromCache];
+
+        return;
+    }
+
+    [self startReadingFromInnerDataSource];
+}
+
+-(int) readIntoBuffer:(UInt8*)buffer withSize:(int)size
+{
+    if (readingFromCache)
+    {
+        int read = [self.cache readFromItem:item intoBuffer:buffer atOffset:position withSize:size];
+
+        position += read;
+
+        if (position < item.length && [self.cache item:item cachedLengthAtOffset:position] == 0)
+        {
+            // Only the gap is fetched. Reading switches back to the cache when the next cached range is reached
+
+            [self startReadingFromInnerDataSource];
+        }
+        else
+        {
+            [self scheduleCacheEvent];
+        }
+
+        return read;
+    }
+
+    position = self.innerDataSource.position;
+
+    if (item != nil)
+    {
+        SInt64 gap = [self.cache item:item nextCachedOffsetAfterOffset:position] - position;
+
+        if (gap > 0)
+        {
+            size = (int)MIN((SInt64)size, gap);
+        }
+    }
+
+    int read = [super readIntoBuffer:buffer withSize:size];
+
+    if (read <= 0)
+    {
+        return read;
+    }
+
+    SInt64 innerLength = self.innerDataSource.length;
+
+    if (item == nil)
+    {
+        [self openItemWithLength:innerLength];
+    }
+    else if (innerLength > 0 && innerLength != item.length)
+    {
+        // The stream has changed since it was cached
+
+        [self closeItem];
+    }
+
+    if (item != nil)
+    {
+        [self.cache writeToItem:item bytes:buffer length:read atOffset:position];
+    }
+
+    position += read;
+
+    if (item != nil && position < item.length && [self.cache item:item cachedLengthAtOffset:position] > 0)
+    {
+        [self startReadingFromCache];
+    }
+
+    return read;
+}
+
+-(void) dataSourceDataAvailable:(STKDataSource*)dataSource
+{
+    if (readingFromCache)
+    {
+        return;
+    }
+
+    [super dataSourceDataAvailable:dataSource];
+}
+
+-(void) dataSourceErrorOccured:(STKDataSource*)dataSource
+{
+    if (readingFromCache)
+    {
+        return;
+    }
+
+    [super dataSourceErrorOccured:dataSource];
+}
+
+-(void) dataSourceEof:(STKDataSource*)dataSource
+{
+    if (readingFromCache)
+    {
+        return;
+    }
+
+    [super dataSourceEof:dataSource];
+}
+
+-(NSString*) description
+{
+    return [NSString stringWithFormat:@"Caching %@", self.innerDataSource];
+}
+
+@end
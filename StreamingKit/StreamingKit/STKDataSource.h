@@ -55,6 +55,12 @@ NS_ASSUME_NONNULL_BEGIN
 @property (nonatomic, readwrite, assign) double durationHint;
 @property (readwrite, unsafe_unretained, nullable) id<STKDataSourceDelegate> delegate;
 @property (nonatomic, strong, nullable) NSURL *recordToFileUrl;
+/// Identifies the stream in on-disk caches or nil if it shouldn't be cached
+@property (readonly, nullable) NSString* cacheKey;
+/// Estimated download throughput or 0 if it is not known
+@property (readonly) double downloadBytesPerSecond;
+/// YES if readBytesNoCopy:withSize: can be used instead of readIntoBuffer:withSize:
+@property (readonly) BOOL supportsReadBytesNoCopy;
 
 -(BOOL) registerForEvents:(NSRunLoop*)runLoop;
 -(void) unregisterForEvents;
@@ -62,6 +68,9 @@ NS_ASSUME_NONNULL_BEGIN
 
 -(void) seekToOffset:(SInt64)offset;
 -(int) readIntoBuffer:(UInt8*)buffer withSize:(int)size;
+/// Reads like readIntoBuffer:withSize: but points bytes at the data source's own copy of the data instead of copying it.
+/// The bytes stay valid until the data source is closed
+-(int) readBytesNoCopy:(const UInt8* _Nullable* _Nonnull)bytes withSize:(int)size;
 -(AudioFileTypeID) audioFileTypeHint;
 
 @end
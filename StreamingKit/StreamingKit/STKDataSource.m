@@ -51,6 +51,13 @@
     return -1;
 }
 
+-(int) readBytesNoCopy:(const UInt8**)bytes withSize:(int)size
+{
+    *bytes = NULL;
+    
+    return -1;
+}
+
 -(SInt64) position
 {
     return 0;
@@ -79,9 +86,24 @@
     return 0;
 }
 
+-(double) downloadBytesPerSecond
+{
+    return 0;
+}
+
+-(BOOL) supportsReadBytesNoCopy
+{
+    return NO;
+}
+
 -(BOOL) supportsSeek
 {
     return YES;
 }
 
+-(NSString*) cacheKey
+{
+    return nil;
+}
+
 @end
@@ -0,0 +1,57 @@
+//
+//  STKDataSourceCache.h
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// A stream stored in an STKDataSourceCache. Items are created and accessed through the cache
+@interface STKDataSourceCacheItem : NSObject
+
+@property (readonly) NSString* key;
+@property (readonly) SInt64 length;
+
+@end
+
+/// Stores byte ranges of streams in sparse memory mapped files inside a directory.
+/// The least recently used streams are removed once the bytes stored exceed maximumSizeInBytes.
+/// Safe to share between data sources and players on any thread
+@interface STKDataSourceCache : NSObject
+
+@property (readonly) NSURL* directoryUrl;
+@property (readonly) UInt64 maximumSizeInBytes;
+/// Total number of bytes stored
+@property (readonly) UInt64 sizeInBytes;
+/// Number of reads served from the cache
+@property (readonly) UInt64 hitCount;
+/// Number of reads that had to be fetched from the underlying data source
+@property (readonly) UInt64 missCount;
+@property (readonly) UInt64 hitByteCount;
+@property (readonly) UInt64 missByteCount;
+
+-(instancetype) initWithDirectoryUrl:(NSURL*)directoryUrl maximumSizeInBytes:(UInt64)maximumSizeInBytes;
+
+/// Opens the item for key. Pass a length of 0 to only open an existing item.
+/// If the existing item has a different length it is replaced. Every open must be balanced by closeItem:
+-(nullable STKDataSourceCacheItem*) openItemWithKey:(NSString*)key length:(SInt64)length;
+-(void) closeItem:(STKDataSourceCacheItem*)item;
+
+/// Number of bytes stored contiguously from offset
+-(SInt64) item:(STKDataSourceCacheItem*)item cachedLengthAtOffset:(SInt64)offset;
+/// Offset of the next stored range after offset or the item length if there is none
+-(SInt64) item:(STKDataSourceCacheItem*)item nextCachedOffsetAfterOffset:(SInt64)offset;
+/// Reads stored bytes (counted as a hit). Returns the number of bytes read
+-(int) readFromItem:(STKDataSourceCacheItem*)item intoBuffer:(UInt8*)buffer atOffset:(SInt64)offset withSize:(int)size;
+/// Stores bytes fetched from the underlying data source (counted as a miss)
+-(void) writeToItem:(STKDataSourceCacheItem*)item bytes:(const UInt8*)bytes length:(int)length atOffset:(SInt64)offset;
+
+/// Removes every item that isn't open
+-(void) removeAllItems;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,541 @@
+//
+//  STKDataSourceCache.m
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import "STKDataSourceCache.h"
+#import "STKRangeMap.h"
+#import <CommonCrypto/CommonDigest.h>
+#import <pthread.h>
+#import <sys/mman.h>
+#import <fcntl.h>
+#import <unistd.h>
+
+#define STK_DATA_SOURCE_CACHE_INDEX_FILE_NAME (@"index.plist")
+
+@interface STKDataSourceCacheItem()
+{
+@public
+    int fileDescriptor;
+    UInt8* bytes;
+    int openCount;
+    BOOL rangesChanged;
+    CFAbsoluteTime lastAccessTime;
+    STKRangeMap ranges;
+    /// Neighbours in the cache's least recently used list (the cache's items dictionary owns the items)
+    __unsafe_unretained STKDataSourceCacheItem* older;
+    __unsafe_unretained STKDataSourceCacheItem* newer;
+}
+
+@property (readwrite) NSString* key;
+@property (readwrite) NSString* fileName;
+@property (readwrite) SInt64 length;
+
+@end
+
+@implementation STKDataSourceCacheItem
+
+-(instancetype) initWithKey:(NSString*)keyIn fileName:(NSString*)fileNameIn length:(SInt64)lengthIn
+{
+    if (self = [super init])
+    {
+        self.key = keyIn;
+        self.fileName = fileNameIn;
+        self.length = lengthIn;
+
+        fileDescriptor = -1;
+
+        STKRangeMapInit(&ranges);
+    }
+
+    return self;
+}
+
+-(void) dealloc
+{
+    if (bytes)
+    {
+        munmap(bytes, (size_t)self.length);
+    }
+
+    if (fileDescriptor >= 0)
+    {
+        close(fileDescriptor);
+    }
+
+    STKRangeMapDestroy(&ranges);
+}
+
+@end
+
+@interface STKDataSourceCache()
+{
+    pthread_mutex_t mutex;
+    UInt64 sizeInBytes;
+    UInt64 hitCount;
+    UInt64 missCount;
+    UInt64 hitByteCount;
+    UInt64 missByteCount;
+    BOOL indexChanged;
+    NSMutableDictionary<NSString*, STKDataSourceCacheItem*>* items;
+    __unsafe_unretained STKDataSourceCacheItem* oldestItem;
+    __unsafe_unretained STKDataSourceCacheItem* newestItem;
+}
+
+@property (readwrite) NSURL* directoryUrl;
+@property (readwrite) UInt64 maximumSizeInBytes;
+
+@end
+
+@implementation STKDataSourceCache
+
+-(instancetype) initWithDirectoryUrl:(NSURL*)directoryUrlIn maximumSizeInBytes:(UInt64)maximumSizeInBytesIn
+{
+    if (self = [super init])
+    {
+        self.directoryUrl = directoryUrlIn;
+        self.maximumSizeInBytes = maximumSizeInBytesIn;
+
+        pthread_mutex_init(&mutex, NULL);
+
+        items = [[NSMutableDictionary alloc] init];
+
+        [[NSFileManager defaultManager] createDirectoryAtURL:directoryUrlIn withIntermediateDirectories:YES attributes:nil error:nil];
+
+        [self loadIndex];
+    }
+
+    return self;
+}
+
+-(void) dealloc
+{
+    if (indexChanged)
+    {
+        [self saveIndex];
+    }
+
+    pthread_mutex_destroy(&mutex);
+}
+
++(NSString*) fileNameForKey:(NSString*)key
+{
+    unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+    NSData* keyData = [key dataUsingEncoding:NSUTF8StringEncoding];
+    NSMutableString* retval = [NSMutableString stringWithCapacity:CC_SHA256_DIGEST_LENGTH * 2];
+
+    CC_SHA256(keyData.bytes, (CC_LONG)keyData.length, digest);
+
+    for (int i = 0; i < CC_SHA256_DIGEST_LENGTH; i++)
+    {
+        [retval appendFormat:@"%02x", digest[i]];
+    }
+
+    return retval;
+}
+
+-(NSURL*) dataUrlForItem:(STKDataSourceCacheItem*)item
+{
+    return [self.directoryUrl URLByAppendingPathComponent:[item.fileName stringByAppendingPathExtension:@"data"]];
+}
+
+-(NSURL*) rangesUrlForItem:(STKDataSourceCacheItem*)item
+{
+    return [self.directoryUrl URLByAppendingPathComponent:[item.fileName stringByAppendingPathExtension:@"ranges"]];
+}
+
+#pragma mark Index
+
+-(void) loadIndex
+{
+    NSDictionary* index = [NSDictionary dictionaryWithContentsOfURL:[self.directoryUrl URLByAppendingPathComponent:STK_DATA_SOURCE_CACHE_INDEX_FILE_NAME]];
+
+    for (NSString* key in index)
+    {
+        NSDictionary* entry = index[key];
+
+        if (![entry isKindOfClass:[NSDictionary class]] || [entry[@"length"] longLongValue] <= 0)
+        {
+            continue;
+        }
+
+        SInt64 length = [entry[@"length"] longLongValue];
+
+        STKDataSourceCacheItem* item = [[STKDataSourceCacheItem alloc] initWithKey:key fileName:[STKDataSourceCache fileNameForKey:key] length:length];
+        NSData* rangesData = [NSData dataWithContentsOfURL:[self rangesUrlForItem:item]];
+
+        if (rangesData == nil || !STKRangeMapDeserialize(&item->ranges, rangesData.bytes, rangesData.length))
+        {
+            [self removeFilesForItem:item];
+
+            continue;
+        }
+
+        item->lastAccessTime = [entry[@"lastAccessTime"] doubleValue];
+
+        items[key] = item;
+        sizeInBytes += STKRangeMapTotal(&item->ranges);
+    }
+
+    // The index isn't ordered so the list is built from the access times once here
+
+    NSArray* loadedItems = [items.allValues sortedArrayUsingComparator:^NSComparisonResult(STKDataSourceCacheItem* left, STKDataSourceCacheItem* right)
+    {
+        return left->lastAccessTime < right->lastAccessTime ? NSOrderedAscending : (left->lastAccessTime > right->lastAccessTime ? NSOrderedDescending : NSOrderedSame);
+    }];
+
+    for (STKDataSourceCacheItem* item in loadedItems)
+    {
+        [self appendItemToLeastRecentlyUsedList:item];
+    }
+}
+
+/// Must be called with the mutex held
+-(void) saveIndex
+{
+    NSMutableDictionary* index = [[NSMutableDictionary alloc] initWithCapacity:items.count];
+
+    for (STKDataSourceCacheItem* item in items.allValues)
+    {
+        index[item.key] = @{ @"length": @(item.length), @"lastAccessTime": @(item->lastAccessTime) };
+    }
+
+    if ([index writeToURL:[self.directoryUrl URLByAppendingPathComponent:STK_DATA_SOURCE_CACHE_INDEX_FILE_NAME] atomically:YES])
+    {
+        indexChanged = NO;
+    }
+}
+
+/// Must be called with the mutex held
+-(void) saveRangesForItem:(STKDataSourceCacheItem*)item
+{
+    if (!item->rangesChanged)
+    {
+        return;
+    }
+
+    // Data is flushed first so the ranges never claim bytes that aren't on disk
+
+    if (item->bytes)
+    {
+        msync(item->bytes, (size_t)item.length, MS_SYNC);
+    }
+
+    NSMutableData* data = [NSMutableData dataWithLength:STKRangeMapSerializedSize(&item->ranges)];
+
+    STKRangeMapSerialize(&item->ranges, data.mutableBytes);
+
+    if ([data writeToURL:[self rangesUrlForItem:item] atomically:YES])
+    {
+        item->rangesChanged = NO;
+    }
+}
+
+-(void) removeFilesForItem:(STKDataSourceCacheItem*)item
+{
+    NSFileManager* fileManager = [NSFileManager defaultManager];
+
+    [fileManager removeItemAtURL:[self dataUrlForItem:item] error:nil];
+    [fileManager removeItemAtURL:[self rangesUrlForItem:item] error:nil];
+}
+
+#pragma mark Least recently used list
+
+/// Makes item the most recently used. Must be called with the mutex held
+-(void) appendItemToLeastRecentlyUsedList:(STKDataSourceCacheItem*)item
+{
+    item->older = newestItem;
+    item->newer = nil;
+
+    if (newestItem != nil)
+    {
+        newestItem->newer = item;
+    }
+    else
+    {
+        oldestItem = item;
+    }
+
+    newestItem = item;
+}
+
+/// Must be called with the mutex held
+-(void) removeItemFromLeastRecentlyUsedList:(STKDataSourceCacheItem*)item
+{
+    if (item->older != nil)
+    {
+        item->older->newer = item->newer;
+    }
+    else
+    {
+        oldestItem = item->newer;
+    }
+
+    if (item->newer != nil)
+    {
+        item->newer->older = item->older;
+    }
+    else
+    {
+        newestItem = item->older;
+    }
+
+    item->older = nil;
+    item->newer = nil;
+}
+
+/// Must be called with the mutex held
+-(void) removeItem:(STKDataSourceCacheItem*)item
+{
+    sizeInBytes -= STKRangeMapTotal(&item->ranges);
+
+    [self removeItemFromLeastRecentlyUsedList:item];
+    [items removeObjectForKey:item.key];
+    [self removeFilesForItem:item];
+
+    indexChanged = YES;
+}
+
+/// Removes the least recently used items that aren't open until the cache fits its budget. Must be called with the mutex held
+-(void) evict
+{
+    STKDataSourceCacheItem* item = oldestItem;
+
+    while (item != nil && sizeInBytes > self.maximumSizeInBytes)
+    {
+        STKDataSourceCacheItem* next = item->newer;
+
+        if (item->openCount == 0)
+        {
+            [self removeItem:item];
+        }
+
+        item = next;
+    }
+}
+
+#pragma mark Items
+
+-(STKDataSourceCacheItem*) openItemWithKey:(NSString*)key length:(SInt64)length
+{
+    pthread_mutex_lock(&mutex);
+
+    STKDataSourceCacheItem* item = items[key];
+
+    if (item != nil && length > 0 && item.length != length)
+    {
+        if (item->openCount > 0)
+        {
+            pthread_mutex_unlock(&mutex);
+
+            return nil;
+        }
+
+        [self removeItem:item];
+
+        item = nil;
+    }
+
+    if (item == nil)
+    {
+        if (length <= 0)
+        {
+            pthread_mutex_unlock(&mutex);
+
+            return nil;
+        }
+
+        item = [[STKDataSourceCacheItem alloc] initWithKey:key fileName:[STKDataSourceCache fileNameForKey:key] length:length];
+
+        items[key] = item;
+
+        [self appendItemToLeastRecentlyUsedList:item];
+
+        // New items are indexed straight away so their files are never orphaned
+
+        [self saveIndex];
+    }
+
+    if (item->openCount == 0)
+    {
+        item->fileDescriptor = open([self dataUrlForItem:item].fileSystemRepresentation, O_RDWR | O_CREAT, 0644);
+
+        if (item->fileDescriptor >= 0 && ftruncate(item->fileDescriptor, item.length) == 0)
+        {
+            void* bytes = mmap(NULL, (size_t)item.length, PROT_READ | PROT_WRITE, MAP_SHARED, item->fileDescriptor, 0);
+
+            item->bytes = bytes == MAP_FAILED ? NULL : bytes;
+        }
+
+        if (item->bytes == NULL)
+        {
+            [self removeItem:item];
+
+            pthread_mutex_unlock(&mutex);
+
+            return nil;
+        }
+    }
+
+    item->openCount++;
+    item->lastAccessTime = CFAbsoluteTimeGetCurrent();
+
+    // Access times are only written out when an item is closed
+
+    [self removeItemFromLeastRecentlyUsedList:item];
+    [self appendItemToLeastRecentlyUsedList:item];
+
+    indexChanged = YES;
+
+    pthread_mutex_unlock(&mutex);
+
+    return item;
+}
+
+-(void) closeItem:(STKDataSourceCacheItem*)item
+{
+    pthread_mutex_lock(&mutex);
+
+    if (item->openCount > 0 && --item->openCount == 0)
+    {
+        [self saveRangesForItem:item];
+
+        munmap(item->bytes, (size_t)item.length);
+        close(item->fileDescriptor);
+
+        item->bytes = NULL;
+        item->fileDescriptor = -1;
+
+        [self evict];
+
+        if (indexChanged)
+        {
+            [self saveIndex];
+        }
+    }
+
+    pthread_mutex_unlock(&mutex);
+}
+
+-(SInt64) item:(STKDataSourceCacheItem*)item cachedLengthAtOffset:(SInt64)offset
+{
+    pthread_mutex_lock(&mutex);
+
+    SInt64 retval = offset < 0 ? 0 : (SInt64)STKRangeMapContiguousLength(&item->ranges, offset);
+
+    pthread_mutex_unlock(&mutex);
+
+    return retval;
+}
+
+-(SInt64) item:(STKDataSourceCacheItem*)item nextCachedOffsetAfterOffset:(SInt64)offset
+{
+    pthread_mutex_lock(&mutex);
+
+    UInt64 retval = STKRangeMapNextStart(&item->ranges, offset < 0 ? 0 : offset);
+
+    pthread_mutex_unlock(&mutex);
+
+    return (SInt64)MIN(retval, (UInt64)item.length);
+}
+
+-(int) readFromItem:(STKDataSourceCacheItem*)item intoBuffer:(UInt8*)buffer atOffset:(SInt64)offset withSize:(int)size
+{
+    SInt64 available = [self item:item cachedLengthAtOffset:offset];
+    int retval = (int)MIN(available, (SInt64)size);
+
+    if (retval <= 0 || item->bytes == NULL)
+    {
+        return 0;
+    }
+
+    // Stored ranges are never removed while the item is open so the copy doesn't need the lock
+
+    memcpy(buffer, item->bytes + offset, retval);
+
+    pthread_mutex_lock(&mutex);
+    hitCount++;
+    hitByteCount += retval;
+    pthread_mutex_unlock(&mutex);
+
+    return retval;
+}
+
+-(void) writeToItem:(STKDataSourceCacheItem*)item bytes:(const UInt8*)bytes length:(int)length atOffset:(SInt64)offset
+{
+    if (length <= 0 || offset < 0 || item->bytes == NULL)
+    {
+        return;
+    }
+
+    length = (int)MIN((SInt64)length, item.length - offset);
+
+    if (length <= 0)
+    {
+        return;
+    }
+
+    memcpy(item->bytes + offset, bytes, length);
+
+    pthread_mutex_lock(&mutex);
+
+    UInt64 previousTotal = STKRangeMapTotal(&item->ranges);
+    UInt64 previousSizeInBytes = sizeInBytes;
+
+    if (STKRangeMapAdd(&item->ranges, offset, offset + length))
+    {
+        sizeInBytes += STKRangeMapTotal(&item->ranges) - previousTotal;
+        item->rangesChanged = YES;
+    }
+
+    missCount++;
+    missByteCount += length;
+
+    // Only evict when this write takes the cache over its budget. If the open items alone are over budget
+    // there is nothing to evict until one of them is closed
+
+    if (previousSizeInBytes <= self.maximumSizeInBytes && sizeInBytes > self.maximumSizeInBytes)
+    {
+        [self evict];
+    }
+
+    pthread_mutex_unlock(&mutex);
+}
+
+-(void) removeAllItems
+{
+    pthread_mutex_lock(&mutex);
+
+    for (STKDataSourceCacheItem* item in items.allValues)
+    {
+        if (item->openCount == 0)
+        {
+            [self removeItem:item];
+        }
+    }
+
+    [self saveIndex];
+
+    pthread_mutex_unlock(&mutex);
+}
+
+#pragma mark Statistics
+
+#define STK_DATA_SOURCE_CACHE_LOCKED_GETTER(type, name) \
+-(type) name \
+{ \
+    pthread_mutex_lock(&mutex); \
+    type retval = name; \
+    pthread_mutex_unlock(&mutex); \
+    return retval; \
+}
+
+STK_DATA_SOURCE_CACHE_LOCKED_GETTER(UInt64, sizeInBytes)
+STK_DATA_SOURCE_CACHE_LOCKED_GETTER(UInt64, hitCount)
+STK_DATA_SOURCE_CACHE_LOCKED_GETTER(UInt64, missCount)
+STK_DATA_SOURCE_CACHE_LOCKED_GETTER(UInt64, hitByteCount)
+STK_DATA_SOURCE_CACHE_LOCKED_GETTER(UInt64, missByteCount)
+
+@end
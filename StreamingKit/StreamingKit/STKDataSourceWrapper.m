@@ -57,6 +57,16 @@
     return self.innerDataSource.audioFileTypeHint;
 }
 
+-(NSString*) cacheKey
+{
+    return self.innerDataSource.cacheKey;
+}
+
+-(double) downloadBytesPerSecond
+{
+    return self.innerDataSource.downloadBytesPerSecond;
+}
+
 -(void) dealloc
 {
     self.innerDataSource.delegate = nil;
@@ -0,0 +1,36 @@
+//
+//  STKDelegateDispatcher.h
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "STKAudioPlayer.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef void (^STKStateChangeHandler)(STKAudioPlayerState state, STKAudioPlayerState previousState);
+
+///
+/// Delivers callbacks on a dispatch queue in the order they were dispatched without the dispatching thread waiting.
+/// Callbacks dispatched with dispatch: are always delivered. A state change dispatched straight after another that is
+/// still waiting is merged into it, and dropped if the state ends up where it started. Droppable callbacks (progress
+/// like stream metadata) are dropped once limit callbacks are waiting
+///
+@interface STKDelegateDispatcher : NSObject
+
+@property (readonly) dispatch_queue_t queue;
+
+-(instancetype) initWithQueue:(dispatch_queue_t)queue limit:(NSUInteger)limit;
+
+/// Queues a callback that is never dropped
+-(void) dispatch:(dispatch_block_t)block;
+/// Queues a callback unless limit callbacks are waiting. Returns NO if it was dropped
+-(BOOL) dispatchDroppable:(dispatch_block_t)block;
+/// Queues a state change for handler or merges it into the last callback if that's a state change
+-(void) dispatchStateChange:(STKAudioPlayerState)state previousState:(STKAudioPlayerState)previousState handler:(STKStateChangeHandler)handler;
+
+@end
+
+NS_ASSUME_NONNULL_END
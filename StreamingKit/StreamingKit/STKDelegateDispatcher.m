@@ -0,0 +1,179 @@
+//
+//  STKDelegateDispatcher.m
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import "STKDelegateDispatcher.h"
+#import "STKSpinLock.h"
+
+@interface STKDelegateCallback : NSObject
+{
+@public
+    dispatch_block_t block;
+
+    /// Set for state changes (block is nil)
+    STKStateChangeHandler stateChangeHandler;
+    STKAudioPlayerState state;
+    STKAudioPlayerState previousState;
+}
+@end
+
+@implementation STKDelegateCallback
+@end
+
+@interface STKDelegateDispatcher()
+{
+    os_unfair_lock lock;
+    NSUInteger limit;
+    NSMutableArray<STKDelegateCallback*>* pending;
+    /// YES from when a drain is queued until it finds nothing left so only one runs at a time, even on concurrent queues
+    BOOL draining;
+    BOOL loggedDrop;
+}
+@end
+
+@implementation STKDelegateDispatcher
+
+-(instancetype) initWithQueue:(dispatch_queue_t)queueIn limit:(NSUInteger)limitIn
+{
+    if (self = [super init])
+    {
+        _queue = queueIn;
+
+        lock = OS_UNFAIR_LOCK_INIT;
+        limit = MAX(limitIn, 1);
+        pending = [[NSMutableArray alloc] init];
+    }
+
+    return self;
+}
+
+/// Queues a drain if there isn't one already. Called with the lock held
+-(void) scheduleDrain
+{
+    if (draining)
+    {
+        return;
+    }
+
+    draining = YES;
+
+    dispatch_async(_queue, ^
+    {
+        [self drain];
+    });
+}
+
+-(void) drain
+{
+    while (true)
+    {
+        setLock(&lock);
+
+        NSArray<STKDelegateCallback*>* callbacks = pending;
+
+        if (callbacks.count == 0)
+        {
+            draining = NO;
+
+            lockUnlock(&lock);
+
+            return;
+        }
+
+        pending = [[NSMutableArray alloc] init];
+
+        lockUnlock(&lock);
+
+        for (STKDelegateCallback* callback in callbacks)
+        {
+            if (callback->block)
+            {
+                callback->block();
+            }
+            else
+            {
+                callback->stateChangeHandler(callback->state, callback->previousState);
+            }
+        }
+    }
+}
+
+/// Adds a callback. Called with the lock held
+-(void) addCallback:(STKDelegateCallback*)callback
+{
+    [pending addObject:callback];
+    [self scheduleDrain];
+}
+
+-(void) dispatch:(dispatch_block_t)block
+{
+    STKDelegateCallback* callback = [[STKDelegateCallback alloc] init];
+
+    callback->block = [block copy];
+
+    setLock(&lock);
+    [self addCallback:callback];
+    lockUnlock(&lock);
+}
+
+-(BOOL) dispatchDroppable:(dispatch_block_t)block
+{
+    STKDelegateCallback* callback = [[STKDelegateCallback alloc] init];
+
+    callback->block = [block copy];
+
+    setLock(&lock);
+
+    BOOL retval = pending.count < limit;
+
+    if (retval)
+    {
+        [self addCallback:callback];
+    }
+    else if (!loggedDrop)
+    {
+        loggedDrop = YES;
+
+        NSLog(@"STKDelegateDispatcher: More than %lu callbacks waiting. Dropping progress callbacks", (unsigned long)limit);
+    }
+
+    lockUnlock(&lock);
+
+    return retval;
+}
+
+-(void) dispatchStateChange:(STKAudioPlayerState)state previousState:(STKAudioPlayerState)previousState handler:(STKStateChangeHandler)handler
+{
+    setLock(&lock);
+
+    STKDelegateCallback* last = pending.lastObject;
+
+    if (last != nil && last->block == nil)
+    {
+        // Merged so the delegate sees one change from where the state was when it last heard
+
+        last->state = state;
+
+        if (last->state == last->previousState)
+        {
+            [pending removeLastObject];
+        }
+    }
+    else
+    {
+        STKDelegateCallback* callback = [[STKDelegateCallback alloc] init];
+
+        callback->stateChangeHandler = [handler copy];
+        callback->state = state;
+        callback->previousState = previousState;
+
+        [self addCallback:callback];
+    }
+
+    lockUnlock(&lock);
+}
+
+@end
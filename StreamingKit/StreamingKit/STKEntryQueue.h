@@ -0,0 +1,48 @@
+//
+//  STKEntryQueue.h
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "STKQueueEntry.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+///
+/// A first in first out queue of entries with O(1) enqueue, dequeue and removal by queue item id.
+/// Entries are linked through ivars of STKQueueEntry so an entry can only be in one queue at a time and its
+/// queueItemId mustn't change while it's queued. Entries with equal queue item ids are removed oldest first.
+/// Not thread safe apart from count and version which can be read from any thread
+///
+@interface STKEntryQueue : NSObject
+
+/// The number of entries (may be stale by the time it returns when read from another thread)
+@property (readonly) NSUInteger count;
+/// Changes whenever an entry is added or removed so a copy of the queue can tell if it's out of date
+@property (readonly) uint64_t version;
+
+/// Adds an entry to the back of the queue
+-(void) enqueue:(STKQueueEntry*)entry;
+/// Adds an entry to the front of the queue so it's dequeued next
+-(void) skipQueue:(STKQueueEntry*)entry;
+/// Moves every entry of queue to the front of this queue in the same order, leaving queue empty
+-(void) skipQueueWithQueue:(STKEntryQueue*)queue;
+/// Removes and returns the entry at the front of the queue
+-(nullable STKQueueEntry*) dequeue;
+/// Returns the entry at the front of the queue (the next to be dequeued)
+-(nullable STKQueueEntry*) peek;
+/// Returns the entry at the back of the queue (the most recently enqueued)
+-(nullable STKQueueEntry*) peekLast;
+/// Removes and returns the entry nearest the front with an equal queue item id
+-(nullable STKQueueEntry*) removeEntryWithQueueItemId:(NSObject*)queueItemId;
+-(void) removeAllEntries;
+
+/// Enumerates entries from the front of the queue or from the back with NSEnumerationReverse.
+/// The queue mustn't be changed by the block
+-(void) enumerateEntriesWithOptions:(NSEnumerationOptions)options usingBlock:(void (NS_NOESCAPE ^)(STKQueueEntry* entry, BOOL* stop))block;
+
+@end
+
+NS_ASSUME_NONNULL_END
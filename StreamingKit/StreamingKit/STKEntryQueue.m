@@ -0,0 +1,289 @@
+//
+//  STKEntryQueue.m
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import "STKEntryQueue.h"
+
+@interface STKEntryQueue()
+{
+    /// The queue holds a reference to each entry it links (taken with CFBridgingRetain) so long queues aren't
+    /// released through a chain of nested deallocs
+    __unsafe_unretained STKQueueEntry* head;
+    __unsafe_unretained STKQueueEntry* tail;
+    NSUInteger count;
+    uint64_t version;
+
+    /// The entry nearest the front for each queue item id. Entries with the same id are chained through
+    /// queueNextWithSameId in queue order and the first of them keeps the last in queueLastWithSameId
+    NSMapTable* firstEntryByQueueItemId;
+}
+@end
+
+@implementation STKEntryQueue
+
+-(instancetype) init
+{
+    if (self = [super init])
+    {
+        firstEntryByQueueItemId = [NSMapTable strongToStrongObjectsMapTable];
+    }
+
+    return self;
+}
+
+-(void) dealloc
+{
+    [self removeAllEntries];
+}
+
+-(NSUInteger) count
+{
+    return __atomic_load_n(&count, __ATOMIC_RELAXED);
+}
+
+-(uint64_t) version
+{
+    return __atomic_load_n(&version, __ATOMIC_ACQUIRE);
+}
+
+-(void) didChangeCountBy:(NSInteger)delta
+{
+    __atomic_store_n(&count, count + delta, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&version, 1, __ATOMIC_RELEASE);
+}
+
+#pragma mark Linking
+
+-(void) linkEntry:(STKQueueEntry*)entry atFront:(BOOL)front
+{
+    NSObject* queueItemId = entry.queueItemId;
+
+    entry->queuePrevious = front ? nil : tail;
+    entry->queueNext = front ? head : nil;
+    entry->queueNextWithSameId = nil;
+    entry->queueLastWithSameId = entry;
+
+    if (front)
+    {
+        if (head)
+        {
+            head->queuePrevious = entry;
+        }
+
+        head = entry;
+        tail = tail ? tail : entry;
+    }
+    else
+    {
+        if (tail)
+        {
+            tail->queueNext = entry;
+        }
+
+        tail = entry;
+        head = head ? head : entry;
+    }
+
+    if (queueItemId == nil)
+    {
+        return;
+    }
+
+    STKQueueEntry* first = [firstEntryByQueueItemId objectForKey:queueItemId];
+
+    if (first == nil)
+    {
+        [firstEntryByQueueItemId setObject:entry forKey:queueItemId];
+    }
+    else if (front)
+    {
+        entry->queueNextWithSameId = first;
+        entry->queueLastWithSameId = first->queueLastWithSameId;
+        first->queueLastWithSameId = nil;
+
+        [firstEntryByQueueItemId setObject:entry forKey:queueItemId];
+    }
+    else
+    {
+        first->queueLastWithSameId->queueNextWithSameId = entry;
+        first->queueLastWithSameId = entry;
+        entry->queueLastWithSameId = nil;
+    }
+}
+
+/// Unlinks an entry which must be the one nearest the front with its queue item id
+-(void) unlinkEntry:(STKQueueEntry*)entry
+{
+    NSObject* queueItemId = entry.queueItemId;
+
+    if (entry->queuePrevious)
+    {
+        entry->queuePrevious->queueNext = entry->queueNext;
+    }
+    else
+    {
+        head = entry->queueNext;
+    }
+
+    if (entry->queueNext)
+    {
+        entry->queueNext->queuePrevious = entry->queuePrevious;
+    }
+    else
+    {
+        tail = entry->queuePrevious;
+    }
+
+    if (queueItemId != nil)
+    {
+        STKQueueEntry* next = entry->queueNextWithSameId;
+
+        if (next)
+        {
+            next->queueLastWithSameId = entry->queueLastWithSameId;
+
+            [firstEntryByQueueItemId setObject:next forKey:queueItemId];
+        }
+        else
+        {
+            [firstEntryByQueueItemId removeObjectForKey:queueItemId];
+        }
+    }
+
+    entry->queuePrevious = nil;
+    entry->queueNext = nil;
+    entry->queueNextWithSameId = nil;
+    entry->queueLastWithSameId = nil;
+}
+
+#pragma mark Queueing
+
+-(void) enqueue:(STKQueueEntry*)entry
+{
+    CFBridgingRetain(entry);
+
+    [self linkEntry:entry atFront:NO];
+    [self didChangeCountBy:1];
+}
+
+-(void) skipQueue:(STKQueueEntry*)entry
+{
+    CFBridgingRetain(entry);
+
+    [self linkEntry:entry atFront:YES];
+    [self didChangeCountBy:1];
+}
+
+-(void) skipQueueWithQueue:(STKEntryQueue*)queue
+{
+    NSUInteger movedCount = queue->count;
+    STKQueueEntry* entry = queue->tail;
+
+    if (movedCount == 0)
+    {
+        return;
+    }
+
+    // The references held by the other queue are handed over
+
+    queue->head = nil;
+    queue->tail = nil;
+    [queue->firstEntryByQueueItemId removeAllObjects];
+    [queue didChangeCountBy:-(NSInteger)movedCount];
+
+    while (entry)
+    {
+        STKQueueEntry* previous = entry->queuePrevious;
+
+        [self linkEntry:entry atFront:YES];
+
+        entry = previous;
+    }
+
+    [self didChangeCountBy:movedCount];
+}
+
+-(STKQueueEntry*) dequeue
+{
+    STKQueueEntry* retval = head;
+
+    if (retval == nil)
+    {
+        return nil;
+    }
+
+    [self unlinkEntry:retval];
+    [self didChangeCountBy:-1];
+
+    return CFBridgingRelease((__bridge CFTypeRef)retval);
+}
+
+-(STKQueueEntry*) peek
+{
+    return head;
+}
+
+-(STKQueueEntry*) peekLast
+{
+    return tail;
+}
+
+-(STKQueueEntry*) removeEntryWithQueueItemId:(NSObject*)queueItemId
+{
+    STKQueueEntry* retval = [firstEntryByQueueItemId objectForKey:queueItemId];
+
+    if (retval == nil)
+    {
+        return nil;
+    }
+
+    [self unlinkEntry:retval];
+    [self didChangeCountBy:-1];
+
+    return CFBridgingRelease((__bridge CFTypeRef)retval);
+}
+
+-(void) removeAllEntries
+{
+    STKQueueEntry* entry = head;
+    NSUInteger removedCount = count;
+
+    head = nil;
+    tail = nil;
+    [firstEntryByQueueItemId removeAllObjects];
+
+    while (entry)
+    {
+        STKQueueEntry* next = entry->queueNext;
+
+        entry->queuePrevious = nil;
+        entry->queueNext = nil;
+        entry->queueNextWithSameId = nil;
+        entry->queueLastWithSameId = nil;
+
+        CFRelease((__bridge CFTypeRef)entry);
+
+        entry = next;
+    }
+
+    if (removedCount > 0)
+    {
+        [self didChangeCountBy:-(NSInteger)removedCount];
+    }
+}
+
+-(void) enumerateEntriesWithOptions:(NSEnumerationOptions)options usingBlock:(void (NS_NOESCAPE ^)(STKQueueEntry* entry, BOOL* stop))block
+{
+    BOOL reverse = (options & NSEnumerationReverse) != 0;
+    BOOL stop = NO;
+
+    for (STKQueueEntry* entry = reverse ? tail : head; entry != nil && !stop; entry = reverse ? entry->queuePrevious : entry->queueNext)
+    {
+        block(entry, &stop);
+    }
+}
+
+@end
@@ -0,0 +1,573 @@
+//
+//  STKEqualizer.c
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#include "STKEqualizer.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define STK_EQUALIZER_SIMD 1
+
+typedef __m128 STKEqualizerVector;
+
+static inline STKEqualizerVector VectorLoad(const float* p) { return _mm_loadu_ps(p); }
+static inline void VectorStore(float* p, STKEqualizerVector v) { _mm_storeu_ps(p, v); }
+static inline STKEqualizerVector VectorSubtract(STKEqualizerVector a, STKEqualizerVector b) { return _mm_sub_ps(a, b); }
+static inline STKEqualizerVector VectorMultiply(STKEqualizerVector a, STKEqualizerVector b) { return _mm_mul_ps(a, b); }
+static inline STKEqualizerVector VectorMultiplyAdd(STKEqualizerVector acc, STKEqualizerVector a, STKEqualizerVector b) { return _mm_add_ps(acc, _mm_mul_ps(a, b)); }
+/// 2 * a - b
+static inline STKEqualizerVector VectorDoubleSubtract(STKEqualizerVector a, STKEqualizerVector b) { return _mm_sub_ps(_mm_add_ps(a, a), b); }
+static inline float VectorLastLane(STKEqualizerVector v) { return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3))); }
+
+/// Moves every lane up one and puts value in the first lane
+static inline STKEqualizerVector VectorShiftIn(STKEqualizerVector v, float value)
+{
+    return _mm_move_ss(_mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 4)), _mm_set_ss(value));
+}
+
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define STK_EQUALIZER_SIMD 1
+
+typedef float32x4_t STKEqualizerVector;
+
+static inline STKEqualizerVector VectorLoad(const float* p) { return vld1q_f32(p); }
+static inline void VectorStore(float* p, STKEqualizerVector v) { vst1q_f32(p, v); }
+static inline STKEqualizerVector VectorSubtract(STKEqualizerVector a, STKEqualizerVector b) { return vsubq_f32(a, b); }
+static inline STKEqualizerVector VectorMultiply(STKEqualizerVector a, STKEqualizerVector b) { return vmulq_f32(a, b); }
+static inline STKEqualizerVector VectorMultiplyAdd(STKEqualizerVector acc, STKEqualizerVector a, STKEqualizerVector b) { return vmlaq_f32(acc, a, b); }
+/// 2 * a - b
+static inline STKEqualizerVector VectorDoubleSubtract(STKEqualizerVector a, STKEqualizerVector b) { return vsubq_f32(vaddq_f32(a, a), b); }
+static inline float VectorLastLane(STKEqualizerVector v) { return vgetq_lane_f32(v, 3); }
+
+/// Moves every lane up one and puts value in the first lane
+static inline STKEqualizerVector VectorShiftIn(STKEqualizerVector v, float value)
+{
+    return vextq_f32(vdupq_n_f32(value), v, 3);
+}
+
+#else
+#define STK_EQUALIZER_SIMD 0
+#endif
+
+#define STK_EQUALIZER_BANDWIDTH_OCTAVES (0.5)
+/// Bands this close to the Nyquist frequency or above it are left out
+#define STK_EQUALIZER_MAX_FREQUENCY_FRACTION (0.95)
+/// The fraction of the way a gain moves towards its target each block (about 10ms to get most of the way)
+#define STK_EQUALIZER_SMOOTHING (0.15f)
+#define STK_EQUALIZER_SNAP_DB (0.01f)
+/// Filter state smaller than this is flushed to zero so silence doesn't decay into slow denormals
+#define STK_EQUALIZER_DENORMAL_THRESHOLD (1e-15f)
+#define STK_EQUALIZER_STATE_PER_CHANNEL ((STK_EQUALIZER_MAX_BANDS + 1) * 2)
+
+/// M_PI and M_LN2 aren't part of standard C
+static const double kPi = 3.14159265358979323846;
+static const double kLn2 = 0.69314718055994530942;
+
+typedef float STKEqualizerCoefficients[4][STK_EQUALIZER_LANES];
+
+static inline void StoreFloat(float* p, float value)
+{
+    __atomic_store(p, &value, __ATOMIC_RELAXED);
+}
+
+static inline float LoadFloat(float* p)
+{
+    float value;
+
+    __atomic_load(p, &value, __ATOMIC_RELAXED);
+
+    return value;
+}
+
+static inline void StoreDouble(double* p, double value)
+{
+    __atomic_store(p, &value, __ATOMIC_RELAXED);
+}
+
+static inline double LoadDouble(double* p)
+{
+    double value;
+
+    __atomic_load(p, &value, __ATOMIC_RELAXED);
+
+    return value;
+}
+
+#pragma mark Filtering
+
+/// Trapezoidal state variable filter (Andrew Simper's formulation) with the bell output.
+/// The vector version below does the same operations in the same order
+static inline float FilterSample(STKEqualizerCoefficients c, uint32_t lane, float* z1, float* z2, float x)
+{
+    float v3 = x - z2[lane];
+    float v1 = c[0][lane] * z1[lane] + c[1][lane] * v3;
+    float v2 = (z2[lane] + c[1][lane] * z1[lane]) + c[2][lane] * v3;
+
+    z1[lane] = (v1 + v1) - z1[lane];
+    z2[lane] = (v2 + v2) - z2[lane];
+
+    return x + c[3][lane] * v1;
+}
+
+static void FilterLane(STKEqualizerCoefficients c, uint32_t lane, float* z1, float* z2, float* x, uint32_t start, uint32_t end)
+{
+    for (uint32_t i = start; i < end; i++)
+    {
+        x[i] = FilterSample(c, lane, z1, z2, x[i]);
+    }
+}
+
+#if STK_EQUALIZER_SIMD
+/// Filters count (at least STK_EQUALIZER_LANES) samples of each channel through every lane of a group in turn.
+/// Each lane runs a sample behind the lane before it so every step feeds a lane the sample the lane before it has
+/// just filtered. The samples where the lanes that are behind haven't started yet, or the lanes that are ahead have
+/// already finished, are filtered one lane at a time. The channels are stepped together so the processor can
+/// overlap their steps which otherwise wait on each other
+static void FilterStaggered(STKEqualizerCoefficients c, float (*z1)[STK_EQUALIZER_LANES], float (*z2)[STK_EQUALIZER_LANES], float* const* x, uint32_t channelCount, uint32_t count)
+{
+    const uint32_t lag = STK_EQUALIZER_LANES - 1;
+    STKEqualizerVector s1[STK_EQUALIZER_CHANNELS_PER_PASS];
+    STKEqualizerVector s2[STK_EQUALIZER_CHANNELS_PER_PASS];
+    STKEqualizerVector previous[STK_EQUALIZER_CHANNELS_PER_PASS];
+
+    for (uint32_t channel = 0; channel < channelCount; channel++)
+    {
+        for (uint32_t lane = 0; lane < lag; lane++)
+        {
+            FilterLane(c, lane, z1[channel], z2[channel], x[channel], 0, lag - lane);
+        }
+
+        // x[i] holds what lane lag - 1 - i last filtered
+
+        float started[STK_EQUALIZER_LANES] = { 0 };
+
+        for (uint32_t lane = 0; lane < lag; lane++)
+        {
+            started[lane] = x[channel][lag - 1 - lane];
+        }
+
+        s1[channel] = VectorLoad(z1[channel]);
+        s2[channel] = VectorLoad(z2[channel]);
+        previous[channel] = VectorLoad(started);
+    }
+
+    STKEqualizerVector a1 = VectorLoad(c[0]);
+    STKEqualizerVector a2 = VectorLoad(c[1]);
+    STKEqualizerVector a3 = VectorLoad(c[2]);
+    STKEqualizerVector m1 = VectorLoad(c[3]);
+
+    for (uint32_t i = lag; i < count; i++)
+    {
+        for (uint32_t channel = 0; channel < channelCount; channel++)
+        {
+            STKEqualizerVector input = VectorShiftIn(previous[channel], x[channel][i]);
+            STKEqualizerVector v3 = VectorSubtract(input, s2[channel]);
+            STKEqualizerVector v1 = VectorMultiplyAdd(VectorMultiply(a1, s1[channel]), a2, v3);
+            STKEqualizerVector v2 = VectorMultiplyAdd(VectorMultiplyAdd(s2[channel], a2, s1[channel]), a3, v3);
+            STKEqualizerVector y = VectorMultiplyAdd(input, m1, v1);
+
+            s1[channel] = VectorDoubleSubtract(v1, s1[channel]);
+            s2[channel] = VectorDoubleSubtract(v2, s2[channel]);
+
+            x[channel][i - lag] = VectorLastLane(y);
+            previous[channel] = y;
+        }
+    }
+
+    for (uint32_t channel = 0; channel < channelCount; channel++)
+    {
+        float finished[STK_EQUALIZER_LANES];
+
+        VectorStore(z1[channel], s1[channel]);
+        VectorStore(z2[channel], s2[channel]);
+        VectorStore(finished, previous[channel]);
+
+        for (uint32_t lane = 0; lane < lag; lane++)
+        {
+            x[channel][count - 1 - lane] = finished[lane];
+        }
+
+        for (uint32_t lane = 1; lane < STK_EQUALIZER_LANES; lane++)
+        {
+            FilterLane(c, lane, z1[channel], z2[channel], x[channel], count - lane, count);
+        }
+    }
+}
+#endif
+
+/// Filters count samples of up to STK_EQUALIZER_CHANNELS_PER_PASS channels starting at firstChannel through a group
+static void FilterGroup(STKEqualizer* equalizer, uint32_t group, uint32_t firstChannel, float* const* x, uint32_t channelCount, uint32_t count)
+{
+    STKEqualizerCoefficients* c = &equalizer->coefficients[group];
+    const uint8_t* bands = equalizer->laneBands + group * STK_EQUALIZER_LANES;
+    float z1[STK_EQUALIZER_CHANNELS_PER_PASS][STK_EQUALIZER_LANES];
+    float z2[STK_EQUALIZER_CHANNELS_PER_PASS][STK_EQUALIZER_LANES];
+
+    for (uint32_t channel = 0; channel < channelCount; channel++)
+    {
+        const float* state = equalizer->state + (firstChannel + channel) * STK_EQUALIZER_STATE_PER_CHANNEL;
+
+        for (uint32_t lane = 0; lane < STK_EQUALIZER_LANES; lane++)
+        {
+            z1[channel][lane] = state[bands[lane] * 2];
+            z2[channel][lane] = state[bands[lane] * 2 + 1];
+        }
+    }
+
+#if STK_EQUALIZER_SIMD
+    if (count >= STK_EQUALIZER_LANES)
+    {
+        FilterStaggered(*c, z1, z2, x, channelCount, count);
+    }
+    else
+#endif
+    {
+        for (uint32_t channel = 0; channel < channelCount; channel++)
+        {
+            for (uint32_t lane = 0; lane < STK_EQUALIZER_LANES; lane++)
+            {
+                if (bands[lane] != equalizer->bandCount)
+                {
+                    FilterLane(*c, lane, z1[channel], z2[channel], x[channel], 0, count);
+                }
+            }
+        }
+    }
+
+    for (uint32_t channel = 0; channel < channelCount; channel++)
+    {
+        float* state = equalizer->state + (firstChannel + channel) * STK_EQUALIZER_STATE_PER_CHANNEL;
+
+        for (uint32_t lane = 0; lane < STK_EQUALIZER_LANES; lane++)
+        {
+            state[bands[lane] * 2] = fabsf(z1[channel][lane]) < STK_EQUALIZER_DENORMAL_THRESHOLD ? 0 : z1[channel][lane];
+            state[bands[lane] * 2 + 1] = fabsf(z2[channel][lane]) < STK_EQUALIZER_DENORMAL_THRESHOLD ? 0 : z2[channel][lane];
+        }
+    }
+}
+
+#pragma mark Channels
+
+/// Returns count samples of a channel as floats to filter in place, copied into scratch unless they're non-interleaved floats
+static inline float* LoadChannel(STKEqualizer* equalizer, void* const* buffers, uint32_t channel, uint32_t offset, uint32_t count, float* scratch)
+{
+    uint32_t stride = equalizer->nonInterleaved ? 1 : equalizer->channelCount;
+    uint32_t start = equalizer->nonInterleaved ? offset : offset * equalizer->channelCount + channel;
+    void* samples = buffers[equalizer->nonInterleaved ? channel : 0];
+
+    if (equalizer->format == STKEqualizerSampleFormatFloat32)
+    {
+        const float* floats = (const float*)samples + start;
+
+        if (stride == 1)
+        {
+            return (float*)floats;
+        }
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            scratch[i] = floats[i * stride];
+        }
+    }
+    else
+    {
+        const int16_t* ints = (const int16_t*)samples + start;
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            scratch[i] = ints[i * stride];
+        }
+    }
+
+    return scratch;
+}
+
+static inline void StoreChannel(STKEqualizer* equalizer, void* const* buffers, uint32_t channel, uint32_t offset, uint32_t count, const float* scratch)
+{
+    uint32_t stride = equalizer->nonInterleaved ? 1 : equalizer->channelCount;
+    uint32_t start = equalizer->nonInterleaved ? offset : offset * equalizer->channelCount + channel;
+    void* samples = buffers[equalizer->nonInterleaved ? channel : 0];
+
+    if (equalizer->format == STKEqualizerSampleFormatFloat32)
+    {
+        float* floats = (float*)samples + start;
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            floats[i * stride] = scratch[i];
+        }
+    }
+    else
+    {
+        int16_t* ints = (int16_t*)samples + start;
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            float value = scratch[i];
+
+            value = value > 32767.0f ? 32767.0f : (value < -32768.0f ? -32768.0f : value);
+
+            ints[i * stride] = (int16_t)lrintf(value);
+        }
+    }
+}
+
+#pragma mark Bands
+
+static void CalculateBands(STKEqualizer* equalizer)
+{
+    double sampleRate = equalizer->processingSampleRate;
+
+    for (uint32_t band = 0; band < equalizer->bandCount; band++)
+    {
+        double frequency = equalizer->frequencies[band];
+
+        if (!(frequency > 0 && frequency < sampleRate / 2 * STK_EQUALIZER_MAX_FREQUENCY_FRACTION))
+        {
+            equalizer->tangents[band] = 0;
+
+            continue;
+        }
+
+        // The Q giving the bandwidth in octaves between the half gain points as in the Audio EQ Cookbook
+
+        double w0 = 2 * kPi * frequency / sampleRate;
+
+        equalizer->tangents[band] = tan(w0 / 2);
+        equalizer->inverseQs[band] = 2 * sinh(kLn2 / 2 * STK_EQUALIZER_BANDWIDTH_OCTAVES * w0 / sin(w0));
+    }
+
+    memset(equalizer->state, 0, sizeof(float) * STK_EQUALIZER_STATE_PER_CHANNEL * equalizer->channelCount);
+}
+
+static void SetLaneCoefficients(STKEqualizer* equalizer, uint32_t lane, double a1, double a2, double a3, double m1)
+{
+    float (*c)[STK_EQUALIZER_LANES] = equalizer->coefficients[lane / STK_EQUALIZER_LANES];
+    uint32_t index = lane % STK_EQUALIZER_LANES;
+
+    c[0][index] = (float)a1;
+    c[1][index] = (float)a2;
+    c[2][index] = (float)a3;
+    c[3][index] = (float)m1;
+}
+
+/// Packs the bands with a gain into groups. Bands left out lose their state so they start clean if they come back
+static void BuildGroups(STKEqualizer* equalizer)
+{
+    uint32_t lane = 0;
+
+    for (uint32_t band = 0; band < equalizer->bandCount; band++)
+    {
+        float gain = equalizer->gains[band];
+        double g = equalizer->tangents[band];
+
+        if (gain == 0 || g == 0)
+        {
+            for (uint32_t channel = 0; channel < equalizer->channelCount; channel++)
+            {
+                float* state = equalizer->state + channel * STK_EQUALIZER_STATE_PER_CHANNEL;
+
+                state[band * 2] = 0;
+                state[band * 2 + 1] = 0;
+            }
+
+            continue;
+        }
+
+        double a = pow(10, gain / 40.0);
+        double k = equalizer->inverseQs[band] / a;
+        double a1 = 1 / (1 + g * (g + k));
+
+        SetLaneCoefficients(equalizer, lane, a1, g * a1, g * g * a1, k * (a * a - 1));
+
+        equalizer->laneBands[lane++] = (uint8_t)band;
+    }
+
+    equalizer->groupCount = (lane + STK_EQUALIZER_LANES - 1) / STK_EQUALIZER_LANES;
+
+    // The rest of the last group passes samples through using the spare band's state which stays at zero
+
+    for (; lane < equalizer->groupCount * STK_EQUALIZER_LANES; lane++)
+    {
+        SetLaneCoefficients(equalizer, lane, 0, 0, 0, 0);
+
+        equalizer->laneBands[lane] = (uint8_t)equalizer->bandCount;
+    }
+}
+
+/// Moves the gains towards their targets and rebuilds the filters if they moved. Only reads the version once settled
+static void UpdateGains(STKEqualizer* equalizer)
+{
+    uint32_t version = __atomic_load_n(&equalizer->version, __ATOMIC_ACQUIRE);
+
+    if (version != equalizer->seenVersion)
+    {
+        equalizer->seenVersion = version;
+        equalizer->settled = false;
+    }
+
+    if (equalizer->settled)
+    {
+        return;
+    }
+
+    bool changed = false;
+    bool settled = true;
+    double sampleRate = LoadDouble(&equalizer->sampleRate);
+    bool enabled = __atomic_load_n(&equalizer->enabled, __ATOMIC_RELAXED);
+
+    if (sampleRate != equalizer->processingSampleRate)
+    {
+        equalizer->processingSampleRate = sampleRate;
+
+        CalculateBands(equalizer);
+
+        changed = true;
+    }
+
+    for (uint32_t band = 0; band < equalizer->bandCount; band++)
+    {
+        float target = enabled ? LoadFloat(&equalizer->targetGains[band]) : 0;
+        float gain = equalizer->gains[band];
+
+        if (gain == target)
+        {
+            continue;
+        }
+
+        gain = fabsf(target - gain) < STK_EQUALIZER_SNAP_DB ? target : gain + (target - gain) * STK_EQUALIZER_SMOOTHING;
+
+        equalizer->gains[band] = gain;
+
+        changed = true;
+        settled = settled && gain == target;
+    }
+
+    equalizer->settled = settled;
+
+    if (changed)
+    {
+        BuildGroups(equalizer);
+    }
+}
+
+#pragma mark Equalizer
+
+bool STKEqualizerInit(STKEqualizer* equalizer, uint32_t channelCount, STKEqualizerSampleFormat format, bool nonInterleaved, const float* frequencies, uint32_t bandCount, double sampleRate)
+{
+    memset(equalizer, 0, sizeof(*equalizer));
+
+    equalizer->state = calloc((size_t)STK_EQUALIZER_STATE_PER_CHANNEL * channelCount, sizeof(float));
+
+    if (equalizer->state == NULL)
+    {
+        return false;
+    }
+
+    equalizer->channelCount = channelCount;
+    equalizer->bandCount = bandCount < STK_EQUALIZER_MAX_BANDS ? bandCount : STK_EQUALIZER_MAX_BANDS;
+    equalizer->format = format;
+    equalizer->nonInterleaved = nonInterleaved;
+    equalizer->enabled = true;
+    equalizer->sampleRate = sampleRate;
+    equalizer->version = 1;
+
+    if (equalizer->bandCount > 0)
+    {
+        memcpy(equalizer->frequencies, frequencies, sizeof(float) * equalizer->bandCount);
+    }
+
+    return true;
+}
+
+void STKEqualizerDestroy(STKEqualizer* equalizer)
+{
+    free(equalizer->state);
+
+    equalizer->state = NULL;
+    equalizer->channelCount = 0;
+    equalizer->bandCount = 0;
+}
+
+void STKEqualizerSetGain(STKEqualizer* equalizer, uint32_t band, float gainDb)
+{
+    if (band >= equalizer->bandCount || gainDb != gainDb)
+    {
+        return;
+    }
+
+    gainDb = gainDb < STK_EQUALIZER_MIN_GAIN_DB ? STK_EQUALIZER_MIN_GAIN_DB : (gainDb > STK_EQUALIZER_MAX_GAIN_DB ? STK_EQUALIZER_MAX_GAIN_DB : gainDb);
+
+    StoreFloat(&equalizer->targetGains[band], gainDb);
+
+    __atomic_add_fetch(&equalizer->version, 1, __ATOMIC_RELEASE);
+}
+
+float STKEqualizerGain(STKEqualizer* equalizer, uint32_t band)
+{
+    return band < equalizer->bandCount ? LoadFloat(&equalizer->targetGains[band]) : 0;
+}
+
+void STKEqualizerSetEnabled(STKEqualizer* equalizer, bool enabled)
+{
+    __atomic_store_n(&equalizer->enabled, enabled, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&equalizer->version, 1, __ATOMIC_RELEASE);
+}
+
+void STKEqualizerSetSampleRate(STKEqualizer* equalizer, double sampleRate)
+{
+    StoreDouble(&equalizer->sampleRate, sampleRate);
+
+    __atomic_add_fetch(&equalizer->version, 1, __ATOMIC_RELEASE);
+}
+
+void STKEqualizerProcess(STKEqualizer* equalizer, void* const* buffers, uint32_t frameCount)
+{
+    for (uint32_t offset = 0; offset < frameCount; offset += STK_EQUALIZER_BLOCK_FRAMES)
+    {
+        UpdateGains(equalizer);
+
+        if (equalizer->groupCount == 0)
+        {
+            if (equalizer->settled)
+            {
+                return;
+            }
+
+            continue;
+        }
+
+        uint32_t count = frameCount - offset < STK_EQUALIZER_BLOCK_FRAMES ? frameCount - offset : STK_EQUALIZER_BLOCK_FRAMES;
+
+        for (uint32_t channel = 0; channel < equalizer->channelCount; channel += STK_EQUALIZER_CHANNELS_PER_PASS)
+        {
+            float* samples[STK_EQUALIZER_CHANNELS_PER_PASS];
+            uint32_t channelCount = equalizer->channelCount - channel < STK_EQUALIZER_CHANNELS_PER_PASS ? equalizer->channelCount - channel : STK_EQUALIZER_CHANNELS_PER_PASS;
+
+            for (uint32_t i = 0; i < channelCount; i++)
+            {
+                samples[i] = LoadChannel(equalizer, buffers, channel + i, offset, count, equalizer->scratch[i]);
+            }
+
+            for (uint32_t group = 0; group < equalizer->groupCount; group++)
+            {
+                FilterGroup(equalizer, group, channel, samples, channelCount, count);
+            }
+
+            for (uint32_t i = 0; i < channelCount; i++)
+            {
+                if (samples[i] == equalizer->scratch[i])
+                {
+                    StoreChannel(equalizer, buffers, channel + i, offset, count, samples[i]);
+                }
+            }
+        }
+    }
+}
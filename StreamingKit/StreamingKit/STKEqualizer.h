@@ -0,0 +1,97 @@
+//
+//  STKEqualizer.h
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STK_EQUALIZER_MAX_BANDS (24)
+#define STK_EQUALIZER_LANES (4)
+#define STK_EQUALIZER_MAX_GROUPS (STK_EQUALIZER_MAX_BANDS / STK_EQUALIZER_LANES)
+/// Gains move towards their targets once every this many frames
+#define STK_EQUALIZER_BLOCK_FRAMES (64)
+/// Channels filtered side by side
+#define STK_EQUALIZER_CHANNELS_PER_PASS (2)
+#define STK_EQUALIZER_MIN_GAIN_DB (-96.0f)
+#define STK_EQUALIZER_MAX_GAIN_DB (24.0f)
+
+typedef enum
+{
+    STKEqualizerSampleFormatInt16,
+    STKEqualizerSampleFormatFloat32
+}
+STKEqualizerSampleFormat;
+
+///
+/// Parametric equalizer made of a cascade of peaking filters (half an octave wide) for interleaved or
+/// non-interleaved PCM with any number of channels. Each band is a trapezoidal state variable filter which has the
+/// response of the usual peaking biquad but keeps its precision at low frequencies in single precision.
+///
+/// The bands with a gain are packed STK_EQUALIZER_LANES to a group. Each group runs as one SSE2/NEON (or scalar)
+/// filter with every lane a sample behind the lane before it so the bands of a group are filtered at the same time
+/// without adding latency. Gains can be set from any thread without locking and are smoothed on the render thread
+/// with the filter coefficients recalculated from the smoothed gains. With every gain at 0dB processing returns
+/// straight away.
+///
+typedef struct
+{
+    uint32_t channelCount;
+    uint32_t bandCount;
+    STKEqualizerSampleFormat format;
+    bool nonInterleaved;
+    float frequencies[STK_EQUALIZER_MAX_BANDS];
+
+    /// Written from any thread. Changes to any of them bump version
+    float targetGains[STK_EQUALIZER_MAX_BANDS];
+    bool enabled;
+    double sampleRate;
+    uint32_t version;
+
+    /// Render thread only
+    uint32_t seenVersion;
+    bool settled;
+    double processingSampleRate;
+    float gains[STK_EQUALIZER_MAX_BANDS];
+    /// The prewarped frequency of each band or 0 for bands that can't be filtered
+    double tangents[STK_EQUALIZER_MAX_BANDS];
+    double inverseQs[STK_EQUALIZER_MAX_BANDS];
+    uint32_t groupCount;
+    /// The band filtered by each lane of each group or bandCount for lanes that pass samples through
+    uint8_t laneBands[STK_EQUALIZER_MAX_BANDS];
+    /// a1, a2, a3 and m1 for each lane of each group
+    float coefficients[STK_EQUALIZER_MAX_GROUPS][4][STK_EQUALIZER_LANES];
+    /// The two state variables of each band (and a spare band for pass through lanes) of each channel
+    float* state;
+    float scratch[STK_EQUALIZER_CHANNELS_PER_PASS][STK_EQUALIZER_BLOCK_FRAMES];
+}
+STKEqualizer;
+
+/// Sets up bandCount bands (at most STK_EQUALIZER_MAX_BANDS) at the given frequencies with 0dB gains.
+/// Returns false if the allocation failed.
+bool STKEqualizerInit(STKEqualizer* equalizer, uint32_t channelCount, STKEqualizerSampleFormat format, bool nonInterleaved, const float* frequencies, uint32_t bandCount, double sampleRate);
+void STKEqualizerDestroy(STKEqualizer* equalizer);
+
+/// Sets the gain of a band in dB between STK_EQUALIZER_MIN_GAIN_DB and STK_EQUALIZER_MAX_GAIN_DB (any thread)
+void STKEqualizerSetGain(STKEqualizer* equalizer, uint32_t band, float gainDb);
+float STKEqualizerGain(STKEqualizer* equalizer, uint32_t band);
+/// Disabling fades every band to 0dB and enabling fades them back to their gains (any thread)
+void STKEqualizerSetEnabled(STKEqualizer* equalizer, bool enabled);
+/// The filters are recalculated and cleared before the next block (any thread)
+void STKEqualizerSetSampleRate(STKEqualizer* equalizer, double sampleRate);
+
+/// Filters frameCount frames in place (render thread only).
+/// buffers holds one pointer to the interleaved samples or one pointer per channel if the equalizer is non-interleaved.
+void STKEqualizerProcess(STKEqualizer* equalizer, void* const* buffers, uint32_t frameCount);
+
+#ifdef __cplusplus
+}
+#endif
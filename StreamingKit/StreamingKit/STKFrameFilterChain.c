@@ -0,0 +1,84 @@
+//
+//  STKFrameFilterChain.c
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#include "STKFrameFilterChain.h"
+#include <stdlib.h>
+#include <sched.h>
+
+STKFrameFilterChain* STKFrameFilterChainCreate(uint32_t count)
+{
+    STKFrameFilterChain* chain = calloc(1, sizeof(STKFrameFilterChain) + sizeof(STKFrameFilterChainStage) * count);
+
+    if (chain != NULL)
+    {
+        chain->count = count;
+    }
+
+    return chain;
+}
+
+void STKFrameFilterChainDestroy(STKFrameFilterChain* chain)
+{
+    free(chain);
+}
+
+void STKFrameFilterPipelineInit(STKFrameFilterPipeline* pipeline)
+{
+    pipeline->chain = NULL;
+    pipeline->readerEpoch = 0;
+}
+
+void STKFrameFilterPipelineDestroy(STKFrameFilterPipeline* pipeline)
+{
+    STKFrameFilterChainDestroy(pipeline->chain);
+
+    pipeline->chain = NULL;
+}
+
+void STKFrameFilterPipelineProcess(STKFrameFilterPipeline* pipeline, uint32_t channelsPerFrame, uint32_t bytesPerFrame, uint32_t frameCount, void* frames)
+{
+    // The epoch is odd while the render thread may be holding a chain pointer
+
+    __atomic_add_fetch(&pipeline->readerEpoch, 1, __ATOMIC_SEQ_CST);
+
+    STKFrameFilterChain* chain = __atomic_load_n(&pipeline->chain, __ATOMIC_SEQ_CST);
+
+    if (chain != NULL)
+    {
+        for (uint32_t i = 0; i < chain->count; i++)
+        {
+            chain->stages[i].function(chain->stages[i].context, channelsPerFrame, bytesPerFrame, frameCount, frames);
+        }
+    }
+
+    __atomic_add_fetch(&pipeline->readerEpoch, 1, __ATOMIC_RELEASE);
+}
+
+void STKFrameFilterPipelinePublish(STKFrameFilterPipeline* pipeline, STKFrameFilterChain* chain)
+{
+    STKFrameFilterChain* previous = __atomic_exchange_n(&pipeline->chain, chain, __ATOMIC_SEQ_CST);
+
+    if (previous == NULL)
+    {
+        return;
+    }
+
+    // Any reader that entered after the exchange sees the new chain so only a reader that is
+    // currently inside (odd epoch) can still be using the previous one. Wait for it to move on.
+
+    uint32_t epoch = __atomic_load_n(&pipeline->readerEpoch, __ATOMIC_SEQ_CST);
+
+    if (epoch & 1)
+    {
+        while (__atomic_load_n(&pipeline->readerEpoch, __ATOMIC_ACQUIRE) == epoch)
+        {
+            sched_yield();
+        }
+    }
+
+    STKFrameFilterChainDestroy(previous);
+}
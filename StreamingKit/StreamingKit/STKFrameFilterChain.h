@@ -0,0 +1,67 @@
+//
+//  STKFrameFilterChain.h
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*STKFrameFilterChainFunction)(void* context, uint32_t channelsPerFrame, uint32_t bytesPerFrame, uint32_t frameCount, void* frames);
+
+typedef struct
+{
+    STKFrameFilterChainFunction function;
+    void* context;
+}
+STKFrameFilterChainStage;
+
+///
+/// An immutable, preallocated list of filter stages. Chains are built off the audio thread and never
+/// modified once published.
+///
+typedef struct
+{
+    uint32_t count;
+    STKFrameFilterChainStage stages[];
+}
+STKFrameFilterChain;
+
+///
+/// Publishes frame filter chains to the render thread using read-copy-update.
+///
+/// The render thread runs the current chain with STKFrameFilterPipelineProcess which never locks, allocates
+/// or frees. Writers build a new chain and swap it in with STKFrameFilterPipelinePublish which waits for the
+/// render thread to leave any chain it may still be running before freeing the old chain on the calling thread.
+/// Writers must be serialized by the caller.
+///
+typedef struct
+{
+    STKFrameFilterChain* chain;
+    uint32_t readerEpoch;
+}
+STKFrameFilterPipeline;
+
+/// Allocates a chain with room for count stages. Returns NULL if the allocation failed.
+STKFrameFilterChain* STKFrameFilterChainCreate(uint32_t count);
+/// Frees a chain that is not published
+void STKFrameFilterChainDestroy(STKFrameFilterChain* chain);
+
+void STKFrameFilterPipelineInit(STKFrameFilterPipeline* pipeline);
+/// Frees the published chain. The render thread must no longer be using the pipeline.
+void STKFrameFilterPipelineDestroy(STKFrameFilterPipeline* pipeline);
+
+/// Runs every stage of the published chain over frames (render thread only)
+void STKFrameFilterPipelineProcess(STKFrameFilterPipeline* pipeline, uint32_t channelsPerFrame, uint32_t bytesPerFrame, uint32_t frameCount, void* frames);
+/// Replaces the published chain (NULL for no filters) and frees the previous one once the render thread is done with it
+void STKFrameFilterPipelinePublish(STKFrameFilterPipeline* pipeline, STKFrameFilterChain* chain);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,41 @@
+//
+//  STKHTTPConnectionPool.h
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Creates the read streams used by STKHTTPDataSource so that successive requests to the same host reuse
+/// keep-alive connections. Streams ask CFNetwork for persistent connections and carry the same proxy and SSL
+/// settings objects so an idle connection left by a finished response is handed to the next request
+/// (a seek, a reconnect or the next queue item) instead of repeating the TCP and TLS handshakes.
+/// A response that is abandoned part way through closes its connection so bounded Range requests
+/// (see rangeRequestSize) keep the connection reusable when a stream is read through to the end
+@interface STKHTTPConnectionPool : NSObject
+
++(STKHTTPConnectionPool*) sharedPool;
+
+/// Number of bytes asked for by each Range request to servers that accept ranges. The next range is requested
+/// on the same connection when a response finishes. Servers that ignore ranges send the whole file on the first
+/// response and are never asked for ranges again. 0 asks for the rest of the file (Default is 1MB)
+@property (readwrite) SInt64 rangeRequestSize;
+/// Number of seconds the system proxy settings are kept before they are read again (Default is 60)
+@property (readwrite) NSTimeInterval proxySettingsLifetime;
+
+/// Returns an unopened stream for the request with the shared connection settings for the url's host
+-(nullable CFReadStreamRef) createReadStreamForRequest:(CFHTTPMessageRef)message url:(NSURL*)url CF_RETURNS_RETAINED;
+/// Records the time from opening a request to the url to its response headers arriving
+-(void) recordTimeToFirstByte:(NSTimeInterval)timeToFirstByte forUrl:(NSURL*)url;
+
+/// Number of requests made to the host
+-(NSUInteger) requestCountForHost:(NSString*)host;
+/// Average time from opening a request to the host to its response headers arriving
+-(NSTimeInterval) averageTimeToFirstByteForHost:(NSString*)host;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,213 @@
+//
+//  STKHTTPConnectionPool.m
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import "STKHTTPConnectionPool.h"
+#import <pthread.h>
+
+#define STK_DEFAULT_PROXY_SETTINGS_LIFETIME (60)
+#define STK_DEFAULT_RANGE_REQUEST_SIZE (1024 * 1024)
+
+@interface STKHTTPConnectionPoolHost : NSObject
+{
+@public
+    NSUInteger requestCount;
+    NSUInteger timedRequestCount;
+    NSTimeInterval totalTimeToFirstByte;
+}
+@end
+
+@implementation STKHTTPConnectionPoolHost
+@end
+
+@interface STKHTTPConnectionPool()
+{
+    pthread_mutex_t mutex;
+    CFDictionaryRef proxySettings;
+    CFAbsoluteTime proxySettingsTime;
+    NSDictionary* sslSettings;
+    NSMutableDictionary* hosts;
+}
+@end
+
+@implementation STKHTTPConnectionPool
+
++(STKHTTPConnectionPool*) sharedPool
+{
+    static dispatch_once_t onceToken;
+    static STKHTTPConnectionPool* sharedPool;
+
+    dispatch_once(&onceToken, ^
+    {
+        sharedPool = [[STKHTTPConnectionPool alloc] init];
+    });
+
+    return sharedPool;
+}
+
+-(instancetype) init
+{
+    if (self = [super init])
+    {
+        pthread_mutex_init(&mutex, NULL);
+
+        self.proxySettingsLifetime = STK_DEFAULT_PROXY_SETTINGS_LIFETIME;
+        self.rangeRequestSize = STK_DEFAULT_RANGE_REQUEST_SIZE;
+
+        hosts = [[NSMutableDictionary alloc] init];
+        sslSettings = @
+        {
+            (__bridge NSString*)kCFStreamSSLLevel: (__bridge NSString*)kCFStreamSocketSecurityLevelNegotiatedSSL,
+            (__bridge NSString*)kCFStreamSSLValidatesCertificateChain: @NO
+        };
+    }
+
+    return self;
+}
+
+-(void) dealloc
+{
+    if (proxySettings)
+    {
+        CFRelease(proxySettings);
+    }
+
+    pthread_mutex_destroy(&mutex);
+}
+
+-(NSString*) keyForHost:(NSString*)host
+{
+    return host.lowercaseString ?: @"";
+}
+
+/// Returns the statistics for host. Must be called with the mutex held
+-(STKHTTPConnectionPoolHost*) entryForHost:(NSString*)host
+{
+    NSString* key = [self keyForHost:host];
+    STKHTTPConnectionPoolHost* entry = [hosts objectForKey:key];
+
+    if (entry == nil)
+    {
+        entry = [[STKHTTPConnectionPoolHost alloc] init];
+
+        [hosts setObject:entry forKey:key];
+    }
+
+    return entry;
+}
+
+-(CFReadStreamRef) createReadStreamForRequest:(CFHTTPMessageRef)message url:(NSURL*)url
+{
+    CFReadStreamRef stream = CFReadStreamCreateForHTTPRequest(NULL, message);
+
+    if (stream == NULL)
+    {
+        return NULL;
+    }
+
+    if (!CFReadStreamSetProperty(stream, kCFStreamPropertyHTTPShouldAutoredirect, kCFBooleanTrue))
+    {
+        CFRelease(stream);
+
+        return NULL;
+    }
+
+    CFReadStreamSetProperty(stream, (__bridge CFStringRef)NSStreamNetworkServiceTypeBackground, (__bridge CFStringRef)NSStreamNetworkServiceTypeBackground);
+    CFReadStreamSetProperty(stream, kCFStreamPropertyHTTPAttemptPersistentConnection, kCFBooleanTrue);
+
+    pthread_mutex_lock(&mutex);
+
+    // Connections are only shared between streams with equal proxy and SSL settings
+
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+
+    if (proxySettings == NULL || now - proxySettingsTime > self.proxySettingsLifetime)
+    {
+        CFDictionaryRef newProxySettings = CFNetworkCopySystemProxySettings();
+
+        if (proxySettings == NULL || newProxySettings == NULL || !CFEqual(proxySettings, newProxySettings))
+        {
+            if (proxySettings)
+            {
+                CFRelease(proxySettings);
+            }
+
+            proxySettings = newProxySettings;
+        }
+        else
+        {
+            CFRelease(newProxySettings);
+        }
+
+        proxySettingsTime = now;
+    }
+
+    if (proxySettings)
+    {
+        CFReadStreamSetProperty(stream, kCFStreamPropertyHTTPProxy, proxySettings);
+    }
+
+    [self entryForHost:url.host]->requestCount++;
+
+    pthread_mutex_unlock(&mutex);
+
+    if ([url.scheme caseInsensitiveCompare:@"https"] == NSOrderedSame)
+    {
+        CFReadStreamSetProperty(stream, kCFStreamPropertySSLSettings, (__bridge CFTypeRef)sslSettings);
+    }
+
+    return stream;
+}
+
+-(void) recordTimeToFirstByte:(NSTimeInterval)timeToFirstByte forUrl:(NSURL*)url
+{
+    pthread_mutex_lock(&mutex);
+
+    STKHTTPConnectionPoolHost* entry = [self entryForHost:url.host];
+
+    entry->timedRequestCount++;
+    entry->totalTimeToFirstByte += timeToFirstByte;
+
+    pthread_mutex_unlock(&mutex);
+}
+
+-(NSUInteger) requestCountForHost:(NSString*)host
+{
+    NSUInteger retval = 0;
+
+    pthread_mutex_lock(&mutex);
+
+    STKHTTPConnectionPoolHost* entry = [hosts objectForKey:[self keyForHost:host]];
+
+    if (entry != nil)
+    {
+        retval = entry->requestCount;
+    }
+
+    pthread_mutex_unlock(&mutex);
+
+    return retval;
+}
+
+-(NSTimeInterval) averageTimeToFirstByteForHost:(NSString*)host
+{
+    NSTimeInterval retval = 0;
+
+    pthread_mutex_lock(&mutex);
+
+    STKHTTPConnectionPoolHost* entry = [hosts objectForKey:[self keyForHost:host]];
+
+    if (entry != nil && entry->timedRequestCount > 0)
+    {
+        retval = entry->totalTimeToFirstByte / entry->timedRequestCount;
+    }
+
+    pthread_mutex_unlock(&mutex);
+
+    return retval;
+}
+
+@end
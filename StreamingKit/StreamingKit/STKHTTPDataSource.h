@@ -33,6 +33,7 @@
  **********************************************************************************/
 
 #import "STKCoreFoundationDataSource.h"
+#import "STKHTTPConnectionPool.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -46,6 +47,10 @@ typedef void(^STKAsyncURLProvider)(STKHTTPDataSource* dataSource, BOOL forSeek,
 
 @property (readonly, retain) NSURL* url;
 @property (readonly) UInt32 httpStatusCode;
+/// Seconds from opening the most recent request to its response headers arriving
+@property (readonly) NSTimeInterval timeToFirstByte;
+/// The pool requests are made through (Default is the shared pool)
+@property (readwrite, retain) STKHTTPConnectionPool* connectionPool;
 
 +(AudioFileTypeID) audioFileTypeHintFromMimeType:(NSString*)fileExtension;
 -(instancetype) initWithURL:(NSURL*)url;
@@ -34,6 +34,9 @@
 
 #import "STKHTTPDataSource.h"
 #import "STKLocalFileDataSource.h"
+#import "STKIcyDemuxer.h"
+#import "STKHTTPHeaderParser.h"
+#import "STKBandwidthEstimator.h"
 
 @interface STKHTTPDataSource()
 {
@@ -43,20 +46,22 @@
     SInt64 seekStart;
     SInt64 relativePosition;
     SInt64 fileLength;
+    SInt64 requestEnd;
+    BOOL rangeRequestsRejected;
+    CFAbsoluteTime requestStartTime;
+    NSTimeInterval timeToFirstByte;
     int discontinuous;
 	int requestSerialNumber;
     int prefixBytesRead;
     NSData* prefixBytes;
-    NSMutableData* iceHeaderData;
+    STKHTTPHeaderParser* headerParser;
+    STKHTTPChunkedDecoder chunkedDecoder;
+    BOOL chunked;
     BOOL iceHeaderSearchComplete;
     BOOL iceHeaderAvailable;
     BOOL httpHeaderNotAvailable;
-
-    NSMutableData *_metadataData;
-    int            _metadataOffset;
-    int            _metadataBytesRead;
-    int            _metadataStep;
-    int            _metadataLength;
+    STKIcyDemuxer icyDemuxer;
+    STKBandwidthEstimator bandwidthEstimator;
     
     NSURL* currentUrl;
     STKAsyncURLProvider asyncUrlProvider;
@@ -65,9 +70,17 @@
     NSDictionary* requestHeaders;
 }
 -(void) open;
+-(void) didReadIcyMetadata:(const uint8_t*)metadata length:(uint32_t)length;
 
 @end
 
+static void IcyMetadataCallback(void* context, const uint8_t* metadata, uint32_t length)
+{
+    STKHTTPDataSource* dataSource = (__bridge STKHTTPDataSource*)context;
+    
+    [dataSource didReadIcyMetadata:metadata length:length];
+}
+
 @implementation STKHTTPDataSource
 
 -(instancetype) initWithURL:(NSURL*)urlIn
@@ -100,7 +113,9 @@
         seekStart = 0;
         relativePosition = 0;
         fileLength = -1;
+        requestEnd = -1;
         
+        self.connectionPool = [STKHTTPConnectionPool sharedPool];
         self->asyncUrlProvider = [asyncUrlProviderIn copy];
         
         audioFileTypeHint = [STKLocalFileDataSource audioFileTypeHintFromFileExtension:self->currentUrl.pathExtension];
@@ -112,6 +127,18 @@
 -(void) dealloc
 {
     NSLog(@"STKHTTPDataSource dealloc");
+    
+    [self freeHeaderParser];
+}
+
+-(void) freeHeaderParser
+{
+    if (headerParser != NULL)
+    {
+        free(headerParser);
+        
+        headerParser = NULL;
+    }
 }
 
 -(NSURL*) url
@@ -119,6 +146,11 @@
     return self->currentUrl;
 }
 
+-(NSString*) cacheKey
+{
+    return self->currentUrl.absoluteString;
+}
+
 +(AudioFileTypeID) audioFileTypeHintFromMimeType:(NSString*)mimeType
 {
     static dispatch_once_t onceToken;
@@ -171,50 +203,45 @@
     return audioFileTypeHint;
 }
 
--(NSDictionary*) parseIceHeader:(NSData*)headerData
+-(NSString*) stringWithBytes:(const uint8_t*)bytes length:(uint32_t)length
+{
+    return [[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding]
+        ?: [[NSString alloc] initWithBytes:bytes length:length encoding:NSISOLatin1StringEncoding];
+}
+
+-(NSDictionary*) headersFromParser:(STKHTTPHeaderParser*)parser
 {
+    uint32_t offset = 0;
+    STKHTTPHeaderField field;
     NSMutableDictionary* retval = [[NSMutableDictionary alloc] init];
-    NSCharacterSet* characterSet = [NSCharacterSet characterSetWithCharactersInString:@"\r\n"];
-    NSString* fullString = [[NSString alloc] initWithData:headerData encoding:NSUTF8StringEncoding];
-    NSArray* strings = [fullString componentsSeparatedByCharactersInSet:characterSet];
     
-    httpHeaders = [NSMutableDictionary dictionary];
+    self->httpStatusCode = (UInt32)STKHTTPHeaderParserStatusCode(parser);
     
-    for (NSString* s in strings)
+    while (STKHTTPHeaderParserNextField(parser, &offset, &field))
     {
-        if (s.length == 0)
-        {
-            continue;
-        }
-        
-        if ([s hasPrefix:@"ICY "])
-        {
-            NSArray* parts = [s componentsSeparatedByString:@" "];
-            
-            if (parts.count >= 2)
-            {
-                self->httpStatusCode = [parts[1] intValue];
-            }
-            
-            continue;
-        }
-        
-        NSRange range = [s rangeOfString:@":"];
+        NSString* key = [self stringWithBytes:field.name length:field.nameLength];
+        NSString* value = [self stringWithBytes:field.value length:field.valueLength];
         
-        if (range.location == NSNotFound)
+        if (key != nil && value != nil)
         {
-            continue;
+            [retval setObject:value forKey:key];
         }
-        
-        NSString* key = [s substringWithRange: (NSRange){.location = 0, .length = range.location}];
-        NSString* value = [s substringFromIndex:range.location + 1];
-        
-        [retval setValue:value forKey:key];
     }
     
     return retval;
 }
 
+-(void) readAudioFileTypeHintFromHeaders
+{
+    NSString* contentType = [httpHeaders objectForKey:@"Content-Type"] ?: [httpHeaders objectForKey:@"content-type"];
+    AudioFileTypeID typeIdFromMimeType = [STKHTTPDataSource audioFileTypeHintFromMimeType:contentType];
+    
+    if (typeIdFromMimeType != 0)
+    {
+        audioFileTypeHint = typeIdFromMimeType;
+    }
+}
+
 -(BOOL) parseHttpHeader
 {
     if (!httpHeaderNotAvailable)
@@ -247,84 +274,81 @@
         
         if (!self->iceHeaderSearchComplete)
         {
-            UInt8 byte;
-            UInt8 terminal1[] = { '\n', '\n' };
-            UInt8 terminal2[] = { '\r', '\n', '\r', '\n' };
-
-            if (iceHeaderData == nil)
+            STKHTTPHeaderParserResult result = STKHTTPHeaderParserResultNeedMoreData;
+            
+            if (headerParser == NULL)
             {
-                iceHeaderData = [NSMutableData dataWithCapacity:1024];
+                headerParser = malloc(sizeof(STKHTTPHeaderParser));
+                
+                STKHTTPHeaderParserInit(headerParser);
             }
             
-            while (true)
+            // Whole blocks are read and any body bytes after the header are kept as prefix bytes
+            
+            while (result == STKHTTPHeaderParserResultNeedMoreData && [super hasBytesAvailable])
             {
-                if (![self hasBytesAvailable])
-                {
-                    break;
-                }
-                
-                int read = [super readIntoBuffer:&byte withSize:1];
+                uint32_t available;
+                uint8_t* bytes = STKHTTPHeaderParserWritePointer(headerParser, &available);
+                int read = [super readIntoBuffer:bytes withSize:(int)available];
                 
                 if (read <= 0)
                 {
                     break;
                 }
                 
-                [iceHeaderData appendBytes:&byte length:read];
-                
-                if (iceHeaderData.length >= sizeof(terminal1))
-                {
-                    if (memcmp(&terminal1[0], [self->iceHeaderData bytes] + iceHeaderData.length - sizeof(terminal1), sizeof(terminal1)) == 0)
-                    {
-                        self->iceHeaderAvailable = YES;
-                        self->iceHeaderSearchComplete = YES;
-                        
-                        break;
-                    }
-                }
-                
-                if (iceHeaderData.length >= sizeof(terminal2))
-                {
-                    if (memcmp(&terminal2[0], [self->iceHeaderData bytes] + iceHeaderData.length - sizeof(terminal2), sizeof(terminal2)) == 0)
-                    {
-                        self->iceHeaderAvailable = YES;
-                        self->iceHeaderSearchComplete = YES;
-                        
-                        break;
-                    }
-                }
-                
-                if (iceHeaderData.length >= 4)
-                {
-                    if (memcmp([self->iceHeaderData bytes], "ICY ", 4) != 0 && memcmp([self->iceHeaderData bytes], "HTTP", 4) != 0)
-                    {
-                        self->iceHeaderAvailable = NO;
-                        self->iceHeaderSearchComplete = YES;
-                        prefixBytes = iceHeaderData;
-                        
-                        return YES;
-                    }
-                }
+                result = STKHTTPHeaderParserCommit(headerParser, (uint32_t)read);
             }
             
-            if (!self->iceHeaderSearchComplete)
+            if (result == STKHTTPHeaderParserResultNeedMoreData)
             {
                 return NO;
             }
+            
+            if (result == STKHTTPHeaderParserResultTooLarge)
+            {
+                [self freeHeaderParser];
+                [self errorOccured];
+                
+                return NO;
+            }
+            
+            uint32_t bodyLength;
+            const uint8_t* body = STKHTTPHeaderParserBody(headerParser, &bodyLength);
+            
+            self->iceHeaderSearchComplete = YES;
+            self->iceHeaderAvailable = result == STKHTTPHeaderParserResultComplete;
+            self->prefixBytes = bodyLength > 0 ? [NSData dataWithBytes:body length:bodyLength] : nil;
+            self->prefixBytesRead = 0;
+            
+            if (!self->iceHeaderAvailable)
+            {
+                [self freeHeaderParser];
+                
+                return YES;
+            }
         }
 
-        httpHeaders = [self parseIceHeader:self->iceHeaderData];
+        httpHeaders = [self headersFromParser:headerParser];
+        
+        [self freeHeaderParser];
+        
+        // CFNetwork only decodes chunked bodies when it has parsed the header itself
+        
+        NSString* transferEncoding = [httpHeaders objectForKey:@"Transfer-Encoding"] ?: [httpHeaders objectForKey:@"transfer-encoding"];
         
-        self->iceHeaderData = nil;
+        chunked = transferEncoding != nil && [transferEncoding rangeOfString:@"chunked" options:NSCaseInsensitiveSearch].location != NSNotFound;
+        
+        if (chunked)
+        {
+            STKHTTPChunkedDecoderInit(&chunkedDecoder);
+        }
     }
     
     // check ICY headers
     NSString* icyHeaders = [httpHeaders objectForKey:@"Icy-Metaint"] ?: [httpHeaders objectForKey:@"icy-metaint"];
     if (icyHeaders != nil)
     {
-        _metadataBytesRead  = 0;
-        _metadataStep       = [icyHeaders intValue];
-        _metadataOffset     = _metadataStep;
+        STKIcyDemuxerInit(&icyDemuxer, (uint32_t)MAX([icyHeaders intValue], 0));
     }
 
     if (([httpHeaders objectForKey:@"Accept-Ranges"] ?: [httpHeaders objectForKey:@"accept-ranges"]) != nil)
@@ -334,6 +358,14 @@
     
     if (self.httpStatusCode == 200)
     {
+        if (requestEnd >= 0)
+        {
+            // The server ignored the Range so the rest of the file is on this response
+            
+            rangeRequestsRejected = YES;
+            requestEnd = -1;
+        }
+        
         if (seekStart == 0)
         {
             id value = [httpHeaders objectForKey:@"Content-Length"] ?: [httpHeaders objectForKey:@"content-length"];
@@ -341,29 +373,40 @@
             fileLength = (SInt64)[value longLongValue];
         }
         
-        NSString* contentType = [httpHeaders objectForKey:@"Content-Type"] ?: [httpHeaders objectForKey:@"content-type"] ;
-        AudioFileTypeID typeIdFromMimeType = [STKHTTPDataSource audioFileTypeHintFromMimeType:contentType];
-        
-        if (typeIdFromMimeType != 0)
-        {
-            audioFileTypeHint = typeIdFromMimeType;
-        }
+        [self readAudioFileTypeHintFromHeaders];
     }
     else if (self.httpStatusCode == 206)
     {
         NSString* contentRange = [httpHeaders objectForKey:@"Content-Range"] ?: [httpHeaders objectForKey:@"content-range"];
         NSArray* components = [contentRange componentsSeparatedByString:@"/"];
         
-        if (components.count == 2)
+        // Live and transcoding servers send an unknown total (bytes 0-1023/*) so the length is left unknown
+        
+        if (components.count == 2 && ![[components objectAtIndex:1] isEqualToString:@"*"])
+        {
+            fileLength = [[components objectAtIndex:1] longLongValue];
+        }
+        
+        self->supportsSeek = YES;
+        
+        // The first response is usually a bounded range (see STKHTTPConnectionPool.rangeRequestSize)
+        
+        if (seekStart == 0)
         {
-            fileLength = [[components objectAtIndex:1] integerValue];
+            [self readAudioFileTypeHintFromHeaders];
         }
     }
     else if (self.httpStatusCode == 416)
     {
-        if (self.length >= 0)
+        // A range past the end of a stream of unknown length means the end is where the range started
+        
+        if (fileLength >= 0)
+        {
+            seekStart = fileLength;
+        }
+        else
         {
-            seekStart = self.length;
+            fileLength = seekStart;
         }
         
         [self eof];
@@ -389,6 +432,14 @@
     
 	if (self.httpStatusCode == 0)
 	{
+        if (requestStartTime != 0)
+        {
+            timeToFirstByte = CFAbsoluteTimeGetCurrent() - requestStartTime;
+            requestStartTime = 0;
+            
+            [self.connectionPool recordTimeToFirstByte:timeToFirstByte forUrl:currentUrl];
+        }
+        
         if ([self parseHttpHeader])
         {
             if ([self hasBytesAvailable])
@@ -409,6 +460,11 @@
     }
 }
 
+-(BOOL) hasBytesAvailable
+{
+    return prefixBytes != nil || [super hasBytesAvailable];
+}
+
 -(SInt64) position
 {
     return seekStart + relativePosition;
@@ -419,6 +475,48 @@
     return fileLength >= 0 ? fileLength : 0;
 }
 
+-(void) eof
+{
+    if (requestEnd >= 0 && self.position >= requestEnd && (fileLength < 0 || requestEnd < fileLength))
+    {
+        // The response has been read through so its connection is free for the next range. Streams of unknown
+        // length keep asking until a range comes back short or past the end
+        
+        [self openNextRange];
+        
+        return;
+    }
+    
+    [super eof];
+}
+
+-(void) openNextRange
+{
+    NSRunLoop* savedEventsRunLoop = eventsRunLoop;
+    SInt64 offset = self.position;
+    
+    [self close];
+    
+    eventsRunLoop = savedEventsRunLoop;
+    
+    relativePosition = 0;
+    seekStart = offset;
+    requestSerialNumber++;
+    
+    [self resetResponseState];
+    [self openRequestForUrl:currentUrl];
+}
+
+/// Forgets what was parsed out of the previous response before another request is made
+-(void) resetResponseState
+{
+    prefixBytes = nil;
+    prefixBytesRead = 0;
+    chunked = NO;
+    iceHeaderSearchComplete = NO;
+    iceHeaderAvailable = NO;
+}
+
 -(void) reconnect
 {
     NSRunLoop* savedEventsRunLoop = eventsRunLoop;
@@ -444,6 +542,8 @@
     relativePosition = 0;
     seekStart = offset;
     
+    [self resetResponseState];
+    
     self->isInErrorState = NO;
     
     if (!self->supportsSeek && offset != self->relativePosition)
@@ -467,110 +567,53 @@
         return 0;
     }
     
+    int read;
+    
     if (prefixBytes != nil)
     {
-        int count = MIN(size, (int)prefixBytes.length - prefixBytesRead);
+        // Body bytes read along with the header
         
-        [prefixBytes getBytes:buffer length:count];
+        read = MIN(size, (int)prefixBytes.length - prefixBytesRead);
         
-        prefixBytesRead += count;
+        [prefixBytes getBytes:buffer range:NSMakeRange(prefixBytesRead, read)];
+        
+        prefixBytesRead += read;
         
         if (prefixBytesRead >= prefixBytes.length)
         {
             prefixBytes = nil;
         }
-        
-        return count;
     }
-    
-    int read;
-    
-    // read ICY stream metadata
-    // http://www.smackfu.com/stuff/programming/shoutcast.html
-    //
-    if(_metadataStep > 0)
+    else
     {
-        // read audio stream before next metadata chunk
-        if(_metadataOffset > 0)
-        {
-            read = [super readIntoBuffer:buffer withSize:MIN(_metadataOffset, size)];
-            if(read > 0)
-                _metadataOffset -= read;
-        }
-        // read metadata
-        else
+        read = [super readIntoBuffer:buffer withSize:size];
+        
+        if (read <= 0)
         {
-            // first we need to read one byte with length
-            if(_metadataLength == 0)
-            {
-                // read only 1 byte
-                UInt8 metadataLengthByte;
-                read = [super readIntoBuffer:&metadataLengthByte withSize:1];
-                
-                if(read > 0)
-                {
-                    _metadataLength = metadataLengthByte * 16;
-                    
-                    // prepare
-                    if(_metadataLength > 0)
-                    {
-                        _metadataData       = [NSMutableData dataWithLength:_metadataLength];
-                        _metadataBytesRead  = 0;
-                    }
-                    // reset
-                    else
-                    {
-                        _metadataOffset = _metadataStep;
-                        _metadataData   = nil;
-                        _metadataLength = 0;
-                    }
-                    
-                    // return 0, because no audio bytes read
-                    relativePosition += read;
-                    read = 0;
-                }
-            }
-            // read metadata bytes
-            else
-            {
-                read = [super readIntoBuffer:(_metadataData.mutableBytes + _metadataBytesRead)
-                                    withSize:_metadataLength - _metadataBytesRead];
-                
-                if(read > 0)
-                {
-                    _metadataBytesRead += read;
-                    
-                    // done reading, so process it
-                    if(_metadataBytesRead == _metadataLength)
-                    {
-                        if([self.delegate respondsToSelector:@selector(dataSource:didReadStreamMetadata:)])
-                            [self.delegate dataSource:self didReadStreamMetadata:[self _processIcyMetadata:_metadataData]];
-                        
-                        // reset
-                        _metadataData       = nil;
-                        _metadataOffset     = _metadataStep;
-                        _metadataLength     = 0;
-                        _metadataBytesRead  = 0;
-                    }
-
-                    // return 0, because no audio bytes read
-                    relativePosition += read;
-                    read = 0;
-                }
-            }
+            return read;
         }
+        
+        STKBandwidthEstimatorAddBytes(&bandwidthEstimator, (uint64_t)read, CFAbsoluteTimeGetCurrent(), read == size);
     }
-    else
+    
+    if (chunked)
     {
-        read = [super readIntoBuffer:buffer withSize:size];
+        read = (int)STKHTTPChunkedDecoderProcess(&chunkedDecoder, buffer, (uint32_t)read);
+        
+        if (chunkedDecoder.error)
+        {
+            return -1;
+        }
     }
     
-    if (read < 0)
-        return read;
+    // Position counts the metadata so it matches the offsets of the stream
     
     relativePosition += read;
     
-    return read;
+    // ICY stream metadata is stripped in place
+    // http://www.smackfu.com/stuff/programming/shoutcast.html
+    
+    return (int)STKIcyDemuxerProcess(&icyDemuxer, buffer, (uint32_t)read, IcyMetadataCallback, (__bridge void*)self);
 }
 
 -(void) open
@@ -599,83 +642,96 @@
             return;
         }
 
-        CFHTTPMessageRef message = CFHTTPMessageCreateRequest(NULL, (CFStringRef)@"GET", (__bridge CFURLRef)self->currentUrl, kCFHTTPVersion1_1);
+        [self openRequestForUrl:url];
+    });
+}
 
-        if (self->seekStart > 0 && self->supportsSeek)
-        {
-            CFHTTPMessageSetHeaderFieldValue(message, CFSTR("Range"), (__bridge CFStringRef)[NSString stringWithFormat:@"bytes=%lld-", self->seekStart]);
+-(void) openRequestForUrl:(NSURL*)url
+{
+    CFHTTPMessageRef message = CFHTTPMessageCreateRequest(NULL, (CFStringRef)@"GET", (__bridge CFURLRef)url, kCFHTTPVersion1_1);
+    SInt64 rangeRequestSize = self.connectionPool.rangeRequestSize;
 
-            self->discontinuous = YES;
-        }
+    requestEnd = -1;
 
-        for (NSString* key in self->requestHeaders)
-        {
-            NSString* value = [self->requestHeaders objectForKey:key];
-            
-            CFHTTPMessageSetHeaderFieldValue(message, (__bridge CFStringRef)key, (__bridge CFStringRef)value);
-        }
-        
-        CFHTTPMessageSetHeaderFieldValue(message, CFSTR("Accept"), CFSTR("*/*"));
-        CFHTTPMessageSetHeaderFieldValue(message, CFSTR("Icy-MetaData"), CFSTR("1"));
+    if (rangeRequestSize > 0 && !rangeRequestsRejected && (seekStart == 0 || supportsSeek))
+    {
+        requestEnd = fileLength > 0 ? MIN(seekStart + rangeRequestSize, fileLength) : seekStart + rangeRequestSize;
 
-        self->stream = CFReadStreamCreateForHTTPRequest(NULL, message);
-        
-        if (self->stream == nil)
+        if (requestEnd <= seekStart)
         {
-            CFRelease(message);
-
-            [self errorOccured];
-
-            return;
+            requestEnd = -1;
         }
- 
-        CFReadStreamSetProperty(self->stream, (__bridge CFStringRef)NSStreamNetworkServiceTypeBackground, (__bridge CFStringRef)NSStreamNetworkServiceTypeBackground);
+    }
 
-        if (!CFReadStreamSetProperty(self->stream, kCFStreamPropertyHTTPShouldAutoredirect, kCFBooleanTrue))
-        {
-            CFRelease(message);
+    if (requestEnd >= 0)
+    {
+        CFHTTPMessageSetHeaderFieldValue(message, CFSTR("Range"), (__bridge CFStringRef)[NSString stringWithFormat:@"bytes=%lld-%lld", seekStart, requestEnd - 1]);
+    }
+    else if (seekStart > 0 && supportsSeek)
+    {
+        CFHTTPMessageSetHeaderFieldValue(message, CFSTR("Range"), (__bridge CFStringRef)[NSString stringWithFormat:@"bytes=%lld-", seekStart]);
+    }
 
-            [self errorOccured];
+    if (seekStart > 0 && supportsSeek)
+    {
+        discontinuous = YES;
+    }
 
-            return;
-        }
+    for (NSString* key in requestHeaders)
+    {
+        NSString* value = [requestHeaders objectForKey:key];
+        
+        CFHTTPMessageSetHeaderFieldValue(message, (__bridge CFStringRef)key, (__bridge CFStringRef)value);
+    }
+    
+    CFHTTPMessageSetHeaderFieldValue(message, CFSTR("Accept"), CFSTR("*/*"));
+    CFHTTPMessageSetHeaderFieldValue(message, CFSTR("Icy-MetaData"), CFSTR("1"));
 
-        // Proxy support
-        CFDictionaryRef proxySettings = CFNetworkCopySystemProxySettings();
-        CFReadStreamSetProperty(self->stream, kCFStreamPropertyHTTPProxy, proxySettings);
-        CFRelease(proxySettings);
+    // Proxy, SSL and keep-alive settings come from the pool so the connection can be shared
+    
+    stream = [self.connectionPool createReadStreamForRequest:message url:url];
+    
+    CFRelease(message);
+    
+    if (stream == NULL)
+    {
+        [self errorOccured];
 
-        // SSL support
-        if ([self->currentUrl.scheme caseInsensitiveCompare:@"https"] == NSOrderedSame)
-        {
-            NSDictionary* sslSettings = [NSDictionary dictionaryWithObjectsAndKeys:
-                                         (NSString*)kCFStreamSocketSecurityLevelNegotiatedSSL, kCFStreamSSLLevel,
-                                         [NSNumber numberWithBool:NO], kCFStreamSSLValidatesCertificateChain,
-                                         nil];
-            CFReadStreamSetProperty(self->stream, kCFStreamPropertySSLSettings, (__bridge CFTypeRef)sslSettings);
-        }
+        return;
+    }
 
-        [self reregisterForEvents];
+    [self reregisterForEvents];
+    
+    httpStatusCode = 0;
+    requestStartTime = CFAbsoluteTimeGetCurrent();
+    
+    // The first bytes of the response arrive after the time to first byte so they don't measure the link
+    
+    STKBandwidthEstimatorRestart(&bandwidthEstimator);
+    
+    // Open
+    if (!CFReadStreamOpen(stream))
+    {
+        CFRelease(stream);
         
-		self->httpStatusCode = 0;
-		
-        // Open
-        if (!CFReadStreamOpen(self->stream))
-        {
-            CFRelease(self->stream);
-            CFRelease(message);
-            
-            self->stream = NULL;
+        stream = NULL;
 
-            [self errorOccured];
+        [self errorOccured];
 
-            return;
-        }
-        
-        self->isInErrorState = NO;
-        
-        CFRelease(message);
-    });
+        return;
+    }
+    
+    isInErrorState = NO;
+}
+
+-(double) downloadBytesPerSecond
+{
+    return STKBandwidthEstimatorBytesPerSecond(&bandwidthEstimator);
+}
+
+-(NSTimeInterval) timeToFirstByte
+{
+    return self->timeToFirstByte;
 }
 
 -(UInt32) httpStatusCode
@@ -700,25 +756,30 @@
 
 #pragma mark - Private
 
-- (NSDictionary*)_processIcyMetadata:(NSData*)data
+-(void) didReadIcyMetadata:(const uint8_t*)metadata length:(uint32_t)length
 {
-    NSMutableDictionary *metadata       = [NSMutableDictionary new];
-    NSString            *metadataString = [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
-    NSArray             *pairs          = [metadataString componentsSeparatedByString:@";"];
+    if (![self.delegate respondsToSelector:@selector(dataSource:didReadStreamMetadata:)])
+    {
+        return;
+    }
+    
+    uint32_t offset = 0;
+    STKIcyMetadataField field;
+    NSMutableDictionary* dictionary = [NSMutableDictionary new];
     
-    for(NSString *pair in pairs)
+    while (STKIcyMetadataNextField(metadata, length, &offset, &field))
     {
-        NSArray *components = [pair componentsSeparatedByString:@"="];
-        if(components.count < 2)
-            continue;
+        NSString* key = [[NSString alloc] initWithBytes:field.key length:field.keyLength encoding:NSUTF8StringEncoding];
+        NSString* value = [[NSString alloc] initWithBytes:field.value length:field.valueLength encoding:NSUTF8StringEncoding]
+            ?: [[NSString alloc] initWithBytes:field.value length:field.valueLength encoding:NSISOLatin1StringEncoding];
         
-        NSString *key   = components[0];
-        NSString *value = [pair substringWithRange:NSMakeRange(key.length + 2, pair.length - (key.length + 2) - 1)];
-        
-        [metadata setValue:value forKey:key];
+        if (key != nil && value != nil)
+        {
+            [dictionary setObject:value forKey:key];
+        }
     }
     
-    return metadata;
+    [self.delegate dataSource:self didReadStreamMetadata:dictionary];
 }
 
 @end
@@ -0,0 +1,464 @@
+//
+//  STKHTTPHeaderParser.c
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#include "STKHTTPHeaderParser.h"
+#include <string.h>
+
+void STKHTTPHeaderParserInit(STKHTTPHeaderParser* parser)
+{
+    parser->length = 0;
+    parser->scanned = 0;
+    parser->headerLength = 0;
+}
+
+uint8_t* STKHTTPHeaderParserWritePointer(STKHTTPHeaderParser* parser, uint32_t* available)
+{
+    *available = STK_HTTP_HEADER_MAXIMUM_LENGTH - parser->length;
+
+    return parser->buffer + parser->length;
+}
+
+STKHTTPHeaderParserResult STKHTTPHeaderParserCommit(STKHTTPHeaderParser* parser, uint32_t length)
+{
+    if (parser->headerLength > 0)
+    {
+        return STKHTTPHeaderParserResultComplete;
+    }
+
+    uint32_t previousLength = parser->length;
+
+    parser->length += length;
+
+    if (previousLength < 4 && parser->length >= 4)
+    {
+        if (memcmp(parser->buffer, "ICY ", 4) != 0 && memcmp(parser->buffer, "HTTP", 4) != 0)
+        {
+            return STKHTTPHeaderParserResultNotHTTP;
+        }
+    }
+
+    // Only line feeds can end the header so the scan jumps between them (memchr is vectorized by the C library)
+
+    const uint8_t* end = parser->buffer + parser->length;
+    const uint8_t* p = parser->buffer + parser->scanned;
+
+    while (p < end && (p = memchr(p, '\n', end - p)) != NULL)
+    {
+        uint32_t index = (uint32_t)(p - parser->buffer);
+
+        if ((index >= 1 && p[-1] == '\n') || (index >= 2 && p[-1] == '\r' && p[-2] == '\n'))
+        {
+            parser->headerLength = index + 1;
+            parser->scanned = parser->headerLength;
+
+            return STKHTTPHeaderParserResultComplete;
+        }
+
+        p++;
+    }
+
+    parser->scanned = parser->length;
+
+    if (parser->length >= STK_HTTP_HEADER_MAXIMUM_LENGTH)
+    {
+        return STKHTTPHeaderParserResultTooLarge;
+    }
+
+    return STKHTTPHeaderParserResultNeedMoreData;
+}
+
+STKHTTPHeaderParserResult STKHTTPHeaderParserAppend(STKHTTPHeaderParser* parser, const uint8_t* bytes, uint32_t length, uint32_t* consumed)
+{
+    uint32_t available;
+    uint8_t* destination = STKHTTPHeaderParserWritePointer(parser, &available);
+
+    if (parser->headerLength > 0)
+    {
+        *consumed = 0;
+
+        return STKHTTPHeaderParserResultComplete;
+    }
+
+    if (length > available)
+    {
+        length = available;
+    }
+
+    memcpy(destination, bytes, length);
+
+    *consumed = length;
+
+    return STKHTTPHeaderParserCommit(parser, length);
+}
+
+const uint8_t* STKHTTPHeaderParserBody(const STKHTTPHeaderParser* parser, uint32_t* length)
+{
+    *length = parser->length - parser->headerLength;
+
+    return parser->buffer + parser->headerLength;
+}
+
+int STKHTTPHeaderParserStatusCode(const STKHTTPHeaderParser* parser)
+{
+    const uint8_t* end = parser->buffer + (parser->headerLength > 0 ? parser->headerLength : parser->length);
+    const uint8_t* p = memchr(parser->buffer, ' ', end - parser->buffer);
+    int retval = 0;
+    int digits = 0;
+
+    if (p == NULL)
+    {
+        return 0;
+    }
+
+    for (p++; p < end && *p >= '0' && *p <= '9' && digits < 3; p++, digits++)
+    {
+        retval = retval * 10 + (*p - '0');
+    }
+
+    return digits == 3 ? retval : 0;
+}
+
+static bool IsSpace(uint8_t c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+bool STKHTTPHeaderParserNextField(const STKHTTPHeaderParser* parser, uint32_t* offset, STKHTTPHeaderField* field)
+{
+    const uint8_t* end = parser->buffer + parser->headerLength;
+    const uint8_t* line = parser->buffer + *offset;
+
+    if (*offset == 0)
+    {
+        // Skip the status line
+
+        line = memchr(parser->buffer, '\n', parser->headerLength);
+
+        if (line == NULL)
+        {
+            return false;
+        }
+
+        line++;
+    }
+
+    while (line < end)
+    {
+        const uint8_t* lineEnd = memchr(line, '\n', end - line);
+
+        if (lineEnd == NULL)
+        {
+            break;
+        }
+
+        const uint8_t* next = lineEnd + 1;
+
+        while (lineEnd > line && IsSpace(lineEnd[-1]))
+        {
+            lineEnd--;
+        }
+
+        if (lineEnd == line)
+        {
+            // The blank line that ends the header
+
+            break;
+        }
+
+        const uint8_t* colon = memchr(line, ':', lineEnd - line);
+
+        if (colon == NULL)
+        {
+            line = next;
+
+            continue;
+        }
+
+        const uint8_t* nameEnd = colon;
+        const uint8_t* value = colon + 1;
+
+        while (nameEnd > line && IsSpace(nameEnd[-1]))
+        {
+            nameEnd--;
+        }
+
+        while (value < lineEnd && IsSpace(*value))
+        {
+            value++;
+        }
+
+        field->name = line;
+        field->nameLength = (uint32_t)(nameEnd - line);
+        field->value = value;
+        field->valueLength = (uint32_t)(lineEnd - value);
+
+        *offset = (uint32_t)(next - parser->buffer);
+
+        return true;
+    }
+
+    *offset = parser->headerLength;
+
+    return false;
+}
+
+enum
+{
+    ChunkedStateSize,
+    ChunkedStateExtension,
+    ChunkedStateSizeLineFeed,
+    ChunkedStateData,
+    ChunkedStateDataCarriageReturn,
+    ChunkedStateDataLineFeed,
+    ChunkedStateTrailer,
+    ChunkedStateTrailerLine,
+    ChunkedStateTrailerLineFeed,
+    ChunkedStateDone
+};
+
+void STKHTTPChunkedDecoderInit(STKHTTPChunkedDecoder* decoder)
+{
+    decoder->chunkRemaining = 0;
+    decoder->state = ChunkedStateSize;
+    decoder->digits = 0;
+    decoder->complete = false;
+    decoder->error = false;
+}
+
+static int HexValue(uint8_t c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+
+    if (c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+
+    return -1;
+}
+
+static void EndOfSizeLine(STKHTTPChunkedDecoder* decoder)
+{
+    decoder->digits = 0;
+    decoder->state = decoder->chunkRemaining > 0 ? ChunkedStateData : ChunkedStateTrailer;
+}
+
+uint32_t STKHTTPChunkedDecoderProcess(STKHTTPChunkedDecoder* decoder, uint8_t* bytes, uint32_t length)
+{
+    uint32_t in = 0;
+    uint32_t out = 0;
+
+    while (in < length && !decoder->error)
+    {
+        uint8_t c = bytes[in];
+
+        switch (decoder->state)
+        {
+            case ChunkedStateSize:
+            {
+                int value = HexValue(c);
+
+                if (value >= 0)
+                {
+                    if (++decoder->digits > 15)
+                    {
+                        decoder->error = true;
+
+                        break;
+                    }
+
+                    decoder->chunkRemaining = (decoder->chunkRemaining << 4) | (uint64_t)value;
+                }
+                else if (decoder->digits == 0)
+                {
+                    decoder->error = true;
+                }
+                else if (c == ';' || c == ' ' || c == '\t')
+                {
+                    decoder->state = ChunkedStateExtension;
+                }
+                else if (c == '\r')
+                {
+                    decoder->state = ChunkedStateSizeLineFeed;
+                }
+                else if (c == '\n')
+                {
+                    EndOfSizeLine(decoder);
+                }
+                else
+                {
+                    decoder->error = true;
+                }
+
+                in++;
+
+                break;
+            }
+            case ChunkedStateExtension:
+            {
+                const uint8_t* lineFeed = memchr(bytes + in, '\n', length - in);
+
+                if (lineFeed == NULL)
+                {
+                    in = length;
+                }
+                else
+                {
+                    in = (uint32_t)(lineFeed - bytes) + 1;
+
+                    EndOfSizeLine(decoder);
+                }
+
+                break;
+            }
+            case ChunkedStateSizeLineFeed:
+            {
+                if (c != '\n')
+                {
+                    decoder->error = true;
+
+                    break;
+                }
+
+                in++;
+
+                EndOfSizeLine(decoder);
+
+                break;
+            }
+            case ChunkedStateData:
+            {
+                uint32_t count = length - in;
+
+                if (count > decoder->chunkRemaining)
+                {
+                    count = (uint32_t)decoder->chunkRemaining;
+                }
+
+                if (out != in)
+                {
+                    memmove(bytes + out, bytes + in, count);
+                }
+
+                in += count;
+                out += count;
+                decoder->chunkRemaining -= count;
+
+                if (decoder->chunkRemaining == 0)
+                {
+                    decoder->state = ChunkedStateDataCarriageReturn;
+                }
+
+                break;
+            }
+            case ChunkedStateDataCarriageReturn:
+            {
+                if (c == '\r')
+                {
+                    decoder->state = ChunkedStateDataLineFeed;
+                }
+                else if (c == '\n')
+                {
+                    decoder->state = ChunkedStateSize;
+                }
+                else
+                {
+                    decoder->error = true;
+
+                    break;
+                }
+
+                in++;
+
+                break;
+            }
+            case ChunkedStateDataLineFeed:
+            {
+                if (c != '\n')
+                {
+                    decoder->error = true;
+
+                    break;
+                }
+
+                in++;
+                decoder->state = ChunkedStateSize;
+
+                break;
+            }
+            case ChunkedStateTrailer:
+            {
+                in++;
+
+                if (c == '\r')
+                {
+                    decoder->state = ChunkedStateTrailerLineFeed;
+                }
+                else if (c == '\n')
+                {
+                    decoder->state = ChunkedStateDone;
+                    decoder->complete = true;
+                }
+                else
+                {
+                    decoder->state = ChunkedStateTrailerLine;
+                }
+
+                break;
+            }
+            case ChunkedStateTrailerLine:
+            {
+                const uint8_t* lineFeed = memchr(bytes + in, '\n', length - in);
+
+                if (lineFeed == NULL)
+                {
+                    in = length;
+                }
+                else
+                {
+                    in = (uint32_t)(lineFeed - bytes) + 1;
+                    decoder->state = ChunkedStateTrailer;
+                }
+
+                break;
+            }
+            case ChunkedStateTrailerLineFeed:
+            {
+                if (c != '\n')
+                {
+                    decoder->error = true;
+
+                    break;
+                }
+
+                in++;
+                decoder->state = ChunkedStateDone;
+                decoder->complete = true;
+
+                break;
+            }
+            default:
+            {
+                // Anything after the last chunk is not part of the body
+
+                in = length;
+
+                break;
+            }
+        }
+    }
+
+    return out;
+}
@@ -0,0 +1,90 @@
+//
+//  STKHTTPHeaderParser.h
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STK_HTTP_HEADER_MAXIMUM_LENGTH (16 * 1024)
+
+typedef enum
+{
+    STKHTTPHeaderParserResultNeedMoreData,
+    STKHTTPHeaderParserResultComplete,
+    /// The response doesn't start with a status line so all the bytes are body
+    STKHTTPHeaderParserResultNotHTTP,
+    STKHTTPHeaderParserResultTooLarge
+}
+STKHTTPHeaderParserResult;
+
+///
+/// Collects a raw HTTP or ICY (SHOUTcast "ICY 200 OK") response header from whole read blocks.
+/// Blocks are read straight into the parser's buffer and only the new bytes are scanned for the end of the header.
+/// Body bytes read past the header are kept for the caller. Not thread safe.
+///
+typedef struct
+{
+    uint32_t length;
+    uint32_t scanned;
+    /// Length including the blank line (0 until the header is complete)
+    uint32_t headerLength;
+    uint8_t buffer[STK_HTTP_HEADER_MAXIMUM_LENGTH];
+}
+STKHTTPHeaderParser;
+
+typedef struct
+{
+    const uint8_t* name;
+    uint32_t nameLength;
+    const uint8_t* value;
+    uint32_t valueLength;
+}
+STKHTTPHeaderField;
+
+void STKHTTPHeaderParserInit(STKHTTPHeaderParser* parser);
+
+/// Returns where the next block should be read to and how many bytes fit
+uint8_t* STKHTTPHeaderParserWritePointer(STKHTTPHeaderParser* parser, uint32_t* available);
+/// Adds length bytes written to the write pointer
+STKHTTPHeaderParserResult STKHTTPHeaderParserCommit(STKHTTPHeaderParser* parser, uint32_t length);
+/// Copies as many bytes as fit into the parser and sets *consumed to that count. Bytes copied past the header are body bytes
+STKHTTPHeaderParserResult STKHTTPHeaderParserAppend(STKHTTPHeaderParser* parser, const uint8_t* bytes, uint32_t length, uint32_t* consumed);
+
+/// Body bytes read after the header (all the bytes for STKHTTPHeaderParserResultNotHTTP)
+const uint8_t* STKHTTPHeaderParserBody(const STKHTTPHeaderParser* parser, uint32_t* length);
+/// Status code from the status line or 0 if it can't be read
+int STKHTTPHeaderParserStatusCode(const STKHTTPHeaderParser* parser);
+/// Reads the header field at *offset (start with 0) and advances offset past it. Returns false after the last field
+bool STKHTTPHeaderParserNextField(const STKHTTPHeaderParser* parser, uint32_t* offset, STKHTTPHeaderField* field);
+
+///
+/// Decodes a Transfer-Encoding: chunked body in place. Not thread safe.
+///
+typedef struct
+{
+    uint64_t chunkRemaining;
+    uint32_t state;
+    uint32_t digits;
+    /// Set once the last chunk and trailer have been read
+    bool complete;
+    /// Set if the body is not valid chunked encoding
+    bool error;
+}
+STKHTTPChunkedDecoder;
+
+void STKHTTPChunkedDecoderInit(STKHTTPChunkedDecoder* decoder);
+/// Removes the chunk framing from length bytes moving the data to the start of bytes. Returns the number of data bytes
+uint32_t STKHTTPChunkedDecoderProcess(STKHTTPChunkedDecoder* decoder, uint8_t* bytes, uint32_t length);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,93 @@
+//
+//  STKHistogram.c
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#include "STKHistogram.h"
+
+static uint32_t BucketForValue(uint64_t value)
+{
+    if (value == 0)
+    {
+        return 0;
+    }
+
+    uint32_t retval = 64 - (uint32_t)__builtin_clzll(value);
+
+    return retval < STK_HISTOGRAM_BUCKET_COUNT ? retval : STK_HISTOGRAM_BUCKET_COUNT - 1;
+}
+
+void STKHistogramRecord(STKHistogram* histogram, uint64_t value)
+{
+    __atomic_fetch_add(&histogram->buckets[BucketForValue(value)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&histogram->total, value, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&histogram->count, 1, __ATOMIC_RELAXED);
+
+    // The maximum only grows so the exchange only fails when another thread records a larger value at the same time
+
+    uint64_t maximum = __atomic_load_n(&histogram->maximum, __ATOMIC_RELAXED);
+
+    while (value > maximum && !__atomic_compare_exchange_n(&histogram->maximum, &maximum, value, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+}
+
+void STKHistogramCopy(const STKHistogram* histogram, STKHistogram* copy)
+{
+    copy->count = __atomic_load_n(&histogram->count, __ATOMIC_RELAXED);
+    copy->total = __atomic_load_n(&histogram->total, __ATOMIC_RELAXED);
+    copy->maximum = __atomic_load_n(&histogram->maximum, __ATOMIC_RELAXED);
+
+    for (uint32_t i = 0; i < STK_HISTOGRAM_BUCKET_COUNT; i++)
+    {
+        copy->buckets[i] = __atomic_load_n(&histogram->buckets[i], __ATOMIC_RELAXED);
+    }
+}
+
+void STKHistogramReset(STKHistogram* histogram)
+{
+    __atomic_store_n(&histogram->count, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&histogram->total, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&histogram->maximum, 0, __ATOMIC_RELAXED);
+
+    for (uint32_t i = 0; i < STK_HISTOGRAM_BUCKET_COUNT; i++)
+    {
+        __atomic_store_n(&histogram->buckets[i], 0, __ATOMIC_RELAXED);
+    }
+}
+
+uint64_t STKHistogramPercentile(const STKHistogram* histogram, double percentile)
+{
+    uint64_t count = 0;
+
+    for (uint32_t i = 0; i < STK_HISTOGRAM_BUCKET_COUNT; i++)
+    {
+        count += histogram->buckets[i];
+    }
+
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    double target = count * (percentile < 0 ? 0 : percentile > 100 ? 100 : percentile) / 100;
+    uint64_t seen = 0;
+
+    for (uint32_t i = 0; i < STK_HISTOGRAM_BUCKET_COUNT; i++)
+    {
+        seen += histogram->buckets[i];
+
+        if (seen > 0 && seen >= target)
+        {
+            // The last bucket also holds every larger value. The maximum is exact so it bounds the bucket holding it
+
+            uint64_t upper = i == 0 ? 0 : (i == STK_HISTOGRAM_BUCKET_COUNT - 1 ? UINT64_MAX : ((uint64_t)1 << i) - 1);
+
+            return upper < histogram->maximum ? upper : histogram->maximum;
+        }
+    }
+
+    return histogram->maximum;
+}
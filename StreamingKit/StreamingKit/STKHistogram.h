@@ -0,0 +1,54 @@
+//
+//  STKHistogram.h
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STK_HISTOGRAM_BUCKET_COUNT (64)
+
+///
+/// Counts values into power of two buckets. Bucket 0 holds 0 and bucket i holds values in [2^(i-1), 2^i).
+/// Recording is a handful of relaxed atomic adds and is wait-free for a histogram with a single writer (such as
+/// the audio render thread). Any number of threads may record and read at the same time. Reads are not a consistent snapshot of every field
+/// but each field is exact so counts may only be off by the values recorded during the copy.
+///
+typedef struct
+{
+    uint64_t count;
+    uint64_t total;
+    uint64_t maximum;
+    uint64_t buckets[STK_HISTOGRAM_BUCKET_COUNT];
+}
+STKHistogram;
+
+void STKHistogramRecord(STKHistogram* histogram, uint64_t value);
+/// Copies the histogram with atomic loads
+void STKHistogramCopy(const STKHistogram* histogram, STKHistogram* copy);
+void STKHistogramReset(STKHistogram* histogram);
+
+/// Returns the upper bound of the bucket holding the percentile (0 - 100) of the values or 0 if there are none
+uint64_t STKHistogramPercentile(const STKHistogram* histogram, double percentile);
+
+static inline void STKCounterAdd(uint64_t* counter, uint64_t value)
+{
+    __atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t STKCounterGet(const uint64_t* counter)
+{
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+#ifdef __cplusplus
+}
+#endif
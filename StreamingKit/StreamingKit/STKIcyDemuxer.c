@@ -0,0 +1,186 @@
+//
+//  STKIcyDemuxer.c
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#include "STKIcyDemuxer.h"
+#include <string.h>
+
+void STKIcyDemuxerInit(STKIcyDemuxer* demuxer, uint32_t metaint)
+{
+    demuxer->metaint = metaint;
+    demuxer->audioRemaining = metaint;
+    demuxer->metadataRemaining = 0;
+    demuxer->metadataLength = 0;
+    demuxer->readingMetadata = false;
+}
+
+uint32_t STKIcyDemuxerProcess(STKIcyDemuxer* demuxer, uint8_t* bytes, uint32_t length, STKIcyMetadataCallback callback, void* context)
+{
+    if (demuxer->metaint == 0)
+    {
+        return length;
+    }
+
+    uint32_t in = 0;
+    uint32_t out = 0;
+
+    while (in < length)
+    {
+        if (!demuxer->readingMetadata)
+        {
+            uint32_t count = length - in;
+
+            if (count > demuxer->audioRemaining)
+            {
+                count = demuxer->audioRemaining;
+            }
+
+            // Audio before the first block in a read is already in place
+
+            if (out != in)
+            {
+                memmove(bytes + out, bytes + in, count);
+            }
+
+            in += count;
+            out += count;
+            demuxer->audioRemaining -= count;
+
+            if (demuxer->audioRemaining == 0)
+            {
+                demuxer->readingMetadata = true;
+                demuxer->metadataLength = 0;
+                demuxer->metadataRemaining = 0;
+            }
+        }
+        else if (demuxer->metadataLength == 0)
+        {
+            demuxer->metadataLength = (uint32_t)bytes[in++] * 16;
+            demuxer->metadataRemaining = demuxer->metadataLength;
+
+            if (demuxer->metadataLength == 0)
+            {
+                demuxer->readingMetadata = false;
+                demuxer->audioRemaining = demuxer->metaint;
+            }
+        }
+        else
+        {
+            uint32_t count = length - in;
+
+            if (count > demuxer->metadataRemaining)
+            {
+                count = demuxer->metadataRemaining;
+            }
+
+            memcpy(demuxer->metadata + (demuxer->metadataLength - demuxer->metadataRemaining), bytes + in, count);
+
+            in += count;
+            demuxer->metadataRemaining -= count;
+
+            if (demuxer->metadataRemaining == 0)
+            {
+                if (callback)
+                {
+                    callback(context, demuxer->metadata, demuxer->metadataLength);
+                }
+
+                demuxer->readingMetadata = false;
+                demuxer->metadataLength = 0;
+                demuxer->audioRemaining = demuxer->metaint;
+            }
+        }
+    }
+
+    return out;
+}
+
+static const uint8_t* FindValueEnd(const uint8_t* value, const uint8_t* end)
+{
+    if (value < end && *value == '\'')
+    {
+        // A quoted value ends at a quote followed by ';' or the end of the block
+
+        for (const uint8_t* p = value + 1; p < end; p++)
+        {
+            p = memchr(p, '\'', end - p);
+
+            if (p == NULL)
+            {
+                break;
+            }
+
+            if (p + 1 == end || p[1] == ';' || p[1] == '\0')
+            {
+                return p + 1;
+            }
+        }
+    }
+
+    const uint8_t* p = memchr(value, ';', end - value);
+
+    return p != NULL ? p : end;
+}
+
+bool STKIcyMetadataNextField(const uint8_t* metadata, uint32_t length, uint32_t* offset, STKIcyMetadataField* field)
+{
+    const uint8_t* end = metadata + length;
+    const uint8_t* nul = memchr(metadata, '\0', length);
+
+    if (nul != NULL)
+    {
+        end = nul;
+    }
+
+    const uint8_t* p = metadata + *offset;
+
+    while (p < end)
+    {
+        while (p < end && (*p == ';' || *p == ' ' || *p == '\r' || *p == '\n'))
+        {
+            p++;
+        }
+
+        if (p >= end)
+        {
+            break;
+        }
+
+        const uint8_t* valueEnd;
+        const uint8_t* equals = memchr(p, '=', end - p);
+        const uint8_t* semicolon = memchr(p, ';', end - p);
+
+        if (equals == NULL || (semicolon != NULL && semicolon < equals))
+        {
+            // Not a key value pair
+
+            p = semicolon != NULL ? semicolon + 1 : end;
+
+            continue;
+        }
+
+        field->key = p;
+        field->keyLength = (uint32_t)(equals - p);
+        field->value = equals + 1;
+
+        valueEnd = FindValueEnd(field->value, end);
+        field->valueLength = (uint32_t)(valueEnd - field->value);
+
+        if (field->valueLength >= 2 && field->value[0] == '\'' && field->value[field->valueLength - 1] == '\'')
+        {
+            field->value++;
+            field->valueLength -= 2;
+        }
+
+        *offset = (uint32_t)(valueEnd - metadata);
+
+        return true;
+    }
+
+    *offset = (uint32_t)(end - metadata);
+
+    return false;
+}
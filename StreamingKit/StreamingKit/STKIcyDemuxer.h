@@ -0,0 +1,65 @@
+//
+//  STKIcyDemuxer.h
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STK_ICY_METADATA_MAXIMUM_LENGTH (255 * 16)
+
+///
+/// Removes SHOUTcast/Icecast metadata blocks from a stream in a single pass.
+/// Every metaint audio bytes are followed by a length byte (in units of 16 bytes) and that many bytes of metadata.
+/// Blocks are collected in a fixed buffer so no memory is allocated while demuxing. Not thread safe.
+///
+typedef struct
+{
+    uint32_t metaint;
+    /// Audio bytes left before the next length byte
+    uint32_t audioRemaining;
+    /// Metadata bytes left in the current block (0 when reading audio or the length byte)
+    uint32_t metadataRemaining;
+    uint32_t metadataLength;
+    bool readingMetadata;
+    uint8_t metadata[STK_ICY_METADATA_MAXIMUM_LENGTH];
+}
+STKIcyDemuxer;
+
+/// Called with each complete non-empty metadata block. The bytes are only valid during the call
+typedef void (*STKIcyMetadataCallback)(void* context, const uint8_t* metadata, uint32_t length);
+
+void STKIcyDemuxerInit(STKIcyDemuxer* demuxer, uint32_t metaint);
+
+/// Strips metadata from the length bytes read into bytes, moving the audio that follows a block down so the audio
+/// is contiguous from the start of bytes. Returns the number of audio bytes (0 if all the bytes were metadata)
+uint32_t STKIcyDemuxerProcess(STKIcyDemuxer* demuxer, uint8_t* bytes, uint32_t length, STKIcyMetadataCallback callback, void* context);
+
+///
+/// A key and value inside a metadata block such as StreamTitle='Artist - Title';
+///
+typedef struct
+{
+    const uint8_t* key;
+    uint32_t keyLength;
+    /// Without the surrounding quotes
+    const uint8_t* value;
+    uint32_t valueLength;
+}
+STKIcyMetadataField;
+
+/// Reads the field at *offset and advances offset past it. Quoted values may contain ';'.
+/// Returns false when there are no more fields (the block is padded with zeros)
+bool STKIcyMetadataNextField(const uint8_t* metadata, uint32_t length, uint32_t* offset, STKIcyMetadataField* field);
+
+#ifdef __cplusplus
+}
+#endif
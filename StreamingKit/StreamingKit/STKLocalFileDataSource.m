@@ -235,6 +235,11 @@
     }
 }
 
+-(NSString*) cacheKey
+{
+    return self->filePath;
+}
+
 -(NSString*) description
 {
     return self->filePath;
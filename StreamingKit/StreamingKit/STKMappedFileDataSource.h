@@ -0,0 +1,27 @@
+//
+//  STKMappedFileDataSource.h
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import "STKDataSource.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Reads a local file through a read-only memory mapping. Reads return pointers into the mapping (see readBytesNoCopy:withSize:)
+/// so the bytes are parsed where they are without being copied, and seeking only moves the position.
+/// There is no stream to schedule: a run loop source added to the run loop registered for events is signalled after each
+/// seek and read, which the run loop handles on its next pass without being woken up.
+/// The file is mapped when the data source is first seeked and unmapped when it is closed. The file mustn't be truncated while
+/// it's mapped: the size is checked before each read, which turns truncations between reads into failed reads, but a page
+/// cut off from the file while the bytes of a read are being parsed crashes. STKAudioPlayer only uses it for file URLs with mapLocalFiles
+@interface STKMappedFileDataSource : STKDataSource
+
+@property (readonly, copy) NSString* filePath;
+
+-(instancetype) initWithFilePath:(NSString*)filePath;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,352 @@
+//
+//  STKMappedFileDataSource.m
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import "STKMappedFileDataSource.h"
+#import "STKLocalFileDataSource.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define STK_MAPPED_FILE_READAHEAD_SIZE (2 * 1024 * 1024)
+
+@interface STKMappedFileDataSource()
+{
+    BOOL mapped;
+    /// Kept open while mapped to check the file hasn't been truncated
+    int fd;
+    const UInt8* bytes;
+    SInt64 length;
+    SInt64 position;
+    /// The kernel has been asked to read the file in up to here
+    SInt64 readaheadPosition;
+    /// YES from when the event source is signalled until it's handled. Cleared to drop an event that no longer applies
+    BOOL eventPending;
+    CFRunLoopSourceRef eventSource;
+    NSRunLoop* eventsRunLoop;
+    AudioFileTypeID audioFileTypeHint;
+}
+@property (readwrite, copy) NSString* filePath;
+@end
+
+@implementation STKMappedFileDataSource
+
+-(instancetype) initWithFilePath:(NSString*)filePathIn
+{
+    if (self = [super init])
+    {
+        self.filePath = filePathIn;
+
+        fd = -1;
+
+        audioFileTypeHint = [STKLocalFileDataSource audioFileTypeHintFromFileExtension:filePathIn.pathExtension];
+    }
+
+    return self;
+}
+
+-(void) dealloc
+{
+    [self unregisterForEvents];
+    [self close];
+}
+
+-(BOOL) map
+{
+    struct stat info;
+    int file = open(self.filePath.fileSystemRepresentation, O_RDONLY);
+
+    if (file < 0)
+    {
+        return NO;
+    }
+
+    // Anything but a regular file (such as a pipe) can't be mapped or can change size under the mapping
+
+    if (fstat(file, &info) != 0 || !S_ISREG(info.st_mode))
+    {
+        close(file);
+
+        return NO;
+    }
+
+    length = info.st_size;
+
+    // Empty files can't be mapped and are simply at their end
+
+    if (length > 0)
+    {
+        void* address = mmap(NULL, (size_t)length, PROT_READ, MAP_PRIVATE, file, 0);
+
+        if (address == MAP_FAILED)
+        {
+            close(file);
+
+            length = 0;
+
+            return NO;
+        }
+
+        madvise(address, (size_t)length, MADV_SEQUENTIAL);
+
+        bytes = address;
+    }
+
+    fd = file;
+    mapped = YES;
+
+    return YES;
+}
+
+/// Unmaps the file if it has become shorter than the mapping so reads fail instead of touching pages past its end
+-(BOOL) checkNotTruncated
+{
+    struct stat info;
+
+    if (fstat(fd, &info) == 0 && info.st_size >= length)
+    {
+        return YES;
+    }
+
+    NSLog(@"STKMappedFileDataSource: %@ was truncated while mapped", self.filePath);
+
+    [self close];
+
+    return NO;
+}
+
+-(void) close
+{
+    eventPending = NO;
+
+    if (bytes != NULL)
+    {
+        munmap((void*)bytes, (size_t)length);
+
+        bytes = NULL;
+    }
+
+    if (fd >= 0)
+    {
+        close(fd);
+
+        fd = -1;
+    }
+
+    readaheadPosition = 0;
+    mapped = NO;
+}
+
+-(void) readAheadFrom:(SInt64)offset
+{
+    if (bytes == NULL || offset >= length)
+    {
+        return;
+    }
+
+    SInt64 start = offset & ~((SInt64)getpagesize() - 1);
+    SInt64 end = MIN(offset + STK_MAPPED_FILE_READAHEAD_SIZE, length);
+
+    madvise((void*)(bytes + start), (size_t)(end - start), MADV_WILLNEED);
+
+    readaheadPosition = end;
+}
+
+-(void) handleEvent
+{
+    if (!eventPending)
+    {
+        return;
+    }
+
+    eventPending = NO;
+
+    if (!mapped)
+    {
+        [self.delegate dataSourceErrorOccured:self];
+    }
+    else if (position >= length)
+    {
+        [self.delegate dataSourceEof:self];
+    }
+    else
+    {
+        [self.delegate dataSourceDataAvailable:self];
+    }
+}
+
+static void EventSourcePerform(void* info)
+{
+    STKMappedFileDataSource* dataSource = (__bridge STKMappedFileDataSource*)info;
+
+    [dataSource handleEvent];
+}
+
+/// Signals the event source. Reads happen on the events run loop's thread so it handles the event on its next pass
+/// without being woken. Seeks may come from other threads so they wake it
+-(void) scheduleEventAndWakeUp:(BOOL)wakeUp
+{
+    if (eventSource == NULL)
+    {
+        return;
+    }
+
+    eventPending = YES;
+
+    CFRunLoopSourceSignal(eventSource);
+
+    if (wakeUp)
+    {
+        CFRunLoopWakeUp(eventsRunLoop.getCFRunLoop);
+    }
+}
+
+-(BOOL) registerForEvents:(NSRunLoop*)runLoop
+{
+    [self unregisterForEvents];
+
+    // The source doesn't retain the data source, which removes the source before it goes away
+
+    CFRunLoopSourceContext context = { .info = (__bridge void*)self, .perform = EventSourcePerform };
+
+    eventsRunLoop = runLoop;
+    eventSource = CFRunLoopSourceCreate(NULL, 0, &context);
+
+    CFRunLoopAddSource(runLoop.getCFRunLoop, eventSource, kCFRunLoopCommonModes);
+
+    return YES;
+}
+
+-(void) unregisterForEvents
+{
+    if (eventSource != NULL)
+    {
+        CFRunLoopSourceInvalidate(eventSource);
+        CFRelease(eventSource);
+
+        eventSource = NULL;
+    }
+
+    eventsRunLoop = nil;
+    eventPending = NO;
+}
+
+-(void) seekToOffset:(SInt64)offset
+{
+    // A file truncated since it was mapped is mapped again at its new size
+
+    if (mapped && length > 0)
+    {
+        [self checkNotTruncated];
+    }
+
+    if (!mapped && ![self map])
+    {
+        [self scheduleEventAndWakeUp:YES];
+
+        return;
+    }
+
+    position = MIN(MAX(offset, 0), length);
+
+    [self readAheadFrom:position];
+    [self scheduleEventAndWakeUp:YES];
+}
+
+-(BOOL) supportsReadBytesNoCopy
+{
+    return YES;
+}
+
+-(int) readBytesNoCopy:(const UInt8**)bytesOut withSize:(int)size
+{
+    if (!mapped)
+    {
+        *bytesOut = NULL;
+
+        return -1;
+    }
+
+    int read = (int)MIN((SInt64)MAX(size, 0), length - position);
+
+    if (read == 0)
+    {
+        *bytesOut = NULL;
+
+        return 0;
+    }
+
+    // An fstat costs far less than copying the read would. A truncated file fails the read and is mapped again at its
+    // new size when the player seeks back to the position
+
+    if (![self checkNotTruncated])
+    {
+        *bytesOut = NULL;
+
+        return -1;
+    }
+
+    // The next window is asked for while half of this one is left so the pages are in before parsing gets to them
+
+    if (position + read + STK_MAPPED_FILE_READAHEAD_SIZE / 2 >= readaheadPosition)
+    {
+        [self readAheadFrom:MAX(position, readaheadPosition)];
+    }
+
+    *bytesOut = bytes + position;
+
+    position += read;
+
+    [self scheduleEventAndWakeUp:NO];
+
+    return read;
+}
+
+-(int) readIntoBuffer:(UInt8*)buffer withSize:(int)size
+{
+    const UInt8* source;
+    int read = [self readBytesNoCopy:&source withSize:size];
+
+    if (read > 0)
+    {
+        memcpy(buffer, source, read);
+    }
+
+    return read;
+}
+
+-(SInt64) position
+{
+    return position;
+}
+
+-(SInt64) length
+{
+    return length;
+}
+
+-(BOOL) hasBytesAvailable
+{
+    return mapped && position < length;
+}
+
+-(AudioFileTypeID) audioFileTypeHint
+{
+    return audioFileTypeHint;
+}
+
+-(NSString*) cacheKey
+{
+    return self.filePath;
+}
+
+-(NSString*) description
+{
+    return self.filePath;
+}
+
+@end
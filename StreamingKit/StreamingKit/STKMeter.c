@@ -0,0 +1,287 @@
+//
+//  STKMeter.c
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#include "STKMeter.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define STK_METER_SIMD 1
+
+typedef __m128 STKMeterVector;
+
+static inline STKMeterVector VectorZero(void) { return _mm_setzero_ps(); }
+static inline STKMeterVector VectorLoadFloat32(const float* p) { return _mm_loadu_ps(p); }
+static inline STKMeterVector VectorAbs(STKMeterVector v) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), v); }
+static inline STKMeterVector VectorMax(STKMeterVector a, STKMeterVector b) { return _mm_max_ps(a, b); }
+static inline STKMeterVector VectorMultiplyAdd(STKMeterVector acc, STKMeterVector a, STKMeterVector b) { return _mm_add_ps(acc, _mm_mul_ps(a, b)); }
+static inline void VectorStore(float* p, STKMeterVector v) { _mm_storeu_ps(p, v); }
+
+static inline STKMeterVector VectorLoadInt16(const int16_t* p)
+{
+    __m128i x = _mm_loadl_epi64((const __m128i*)p);
+
+    return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+}
+
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define STK_METER_SIMD 1
+
+typedef float32x4_t STKMeterVector;
+
+static inline STKMeterVector VectorZero(void) { return vdupq_n_f32(0); }
+static inline STKMeterVector VectorLoadFloat32(const float* p) { return vld1q_f32(p); }
+static inline STKMeterVector VectorLoadInt16(const int16_t* p) { return vcvtq_f32_s32(vmovl_s16(vld1_s16(p))); }
+static inline STKMeterVector VectorAbs(STKMeterVector v) { return vabsq_f32(v); }
+static inline STKMeterVector VectorMax(STKMeterVector a, STKMeterVector b) { return vmaxq_f32(a, b); }
+static inline STKMeterVector VectorMultiplyAdd(STKMeterVector acc, STKMeterVector a, STKMeterVector b) { return vmlaq_f32(acc, a, b); }
+static inline void VectorStore(float* p, STKMeterVector v) { vst1q_f32(p, v); }
+
+#else
+#define STK_METER_SIMD 0
+#endif
+
+#define STK_METER_LANES (4)
+#define STK_METER_MAX_ACCUMULATORS (16)
+
+static inline void StoreFloat(float* p, float value)
+{
+    __atomic_store(p, &value, __ATOMIC_RELAXED);
+}
+
+static inline float LoadFloat(float* p)
+{
+    float value;
+
+    __atomic_load(p, &value, __ATOMIC_RELAXED);
+
+    return value;
+}
+
+static inline float PowerToDecibels(float power)
+{
+    if (!(power > 0))
+    {
+        return STK_METER_DB_MIN;
+    }
+
+    float decibels = 10.0f * log10f(power);
+
+    return decibels < STK_METER_DB_MIN ? STK_METER_DB_MIN : (decibels > 0 ? 0 : decibels);
+}
+
+static inline float LoadSample(const void* samples, uint32_t index, STKMeterSampleFormat format)
+{
+    return format == STKMeterSampleFormatInt16 ? ((const int16_t*)samples)[index] : ((const float*)samples)[index];
+}
+
+#if STK_METER_SIMD
+static inline STKMeterVector LoadVector(const void* samples, uint32_t index, STKMeterSampleFormat format)
+{
+    return format == STKMeterSampleFormatInt16 ? VectorLoadInt16((const int16_t*)samples + index) : VectorLoadFloat32((const float*)samples + index);
+}
+
+static uint32_t GreatestCommonDivisor(uint32_t a, uint32_t b)
+{
+    while (b != 0)
+    {
+        uint32_t t = a % b;
+
+        a = b;
+        b = t;
+    }
+
+    return a;
+}
+#endif
+
+/// Accumulates the peak absolute value and sum of squares of each channel into peaks and sums
+static inline void Measure(const void* samples, uint32_t sampleCount, uint32_t channelCount, STKMeterSampleFormat format, float* peaks, float* sums)
+{
+    uint32_t i = 0;
+
+#if STK_METER_SIMD
+    // Each vector holds STK_METER_LANES consecutive samples. Stepping by lcm(channelCount, STK_METER_LANES)
+    // keeps every lane of a given accumulator on the same channel so they can be folded per channel at the end
+
+    uint32_t accumulatorCount = channelCount / GreatestCommonDivisor(channelCount, STK_METER_LANES);
+    uint32_t stride = accumulatorCount * STK_METER_LANES;
+
+    if (accumulatorCount <= STK_METER_MAX_ACCUMULATORS && sampleCount >= stride)
+    {
+        STKMeterVector peakAccumulators[STK_METER_MAX_ACCUMULATORS];
+        STKMeterVector sumAccumulators[STK_METER_MAX_ACCUMULATORS];
+
+        for (uint32_t k = 0; k < accumulatorCount; k++)
+        {
+            peakAccumulators[k] = VectorZero();
+            sumAccumulators[k] = VectorZero();
+        }
+
+        for (; i + stride <= sampleCount; i += stride)
+        {
+            for (uint32_t k = 0; k < accumulatorCount; k++)
+            {
+                STKMeterVector value = LoadVector(samples, i + k * STK_METER_LANES, format);
+
+                peakAccumulators[k] = VectorMax(peakAccumulators[k], VectorAbs(value));
+                sumAccumulators[k] = VectorMultiplyAdd(sumAccumulators[k], value, value);
+            }
+        }
+
+        for (uint32_t k = 0; k < accumulatorCount; k++)
+        {
+            float peakLanes[STK_METER_LANES];
+            float sumLanes[STK_METER_LANES];
+
+            VectorStore(peakLanes, peakAccumulators[k]);
+            VectorStore(sumLanes, sumAccumulators[k]);
+
+            for (uint32_t lane = 0; lane < STK_METER_LANES; lane++)
+            {
+                uint32_t channel = (k * STK_METER_LANES + lane) % channelCount;
+
+                peaks[channel] = peakLanes[lane] > peaks[channel] ? peakLanes[lane] : peaks[channel];
+                sums[channel] += sumLanes[lane];
+            }
+        }
+    }
+#endif
+
+    // i is a multiple of channelCount here so the remainder starts on the first channel
+
+    for (uint32_t channel = 0; i < sampleCount; i++)
+    {
+        float value = LoadSample(samples, i, format);
+        float magnitude = fabsf(value);
+
+        peaks[channel] = magnitude > peaks[channel] ? magnitude : peaks[channel];
+        sums[channel] += value * value;
+
+        if (++channel == channelCount)
+        {
+            channel = 0;
+        }
+    }
+}
+
+bool STKMeterInit(STKMeter* meter, uint32_t channelCount, STKMeterSampleFormat format, bool nonInterleaved)
+{
+    memset(meter, 0, sizeof(*meter));
+
+    if (channelCount == 0)
+    {
+        return false;
+    }
+
+    float* storage = calloc((size_t)channelCount * 4, sizeof(float));
+
+    if (storage == NULL)
+    {
+        return false;
+    }
+
+    meter->channelCount = channelCount;
+    meter->format = format;
+    meter->nonInterleaved = nonInterleaved;
+    meter->peakPowerDb = storage;
+    meter->averagePowerDb = storage + channelCount;
+    meter->scratch = storage + channelCount * 2;
+
+    STKMeterReset(meter);
+
+    return true;
+}
+
+void STKMeterDestroy(STKMeter* meter)
+{
+    free(meter->peakPowerDb);
+
+    memset(meter, 0, sizeof(*meter));
+}
+
+void STKMeterReset(STKMeter* meter)
+{
+    for (uint32_t i = 0; i < meter->channelCount; i++)
+    {
+        StoreFloat(&meter->peakPowerDb[i], STK_METER_DB_MIN);
+        StoreFloat(&meter->averagePowerDb[i], STK_METER_DB_MIN);
+    }
+}
+
+void STKMeterProcess(STKMeter* meter, const void* const* buffers, uint32_t frameCount)
+{
+    uint32_t channelCount = meter->channelCount;
+    STKMeterSampleFormat format = meter->format;
+
+    if (frameCount == 0)
+    {
+        return;
+    }
+
+    float* peaks = meter->scratch;
+    float* sums = meter->scratch + channelCount;
+
+    memset(meter->scratch, 0, sizeof(float) * channelCount * 2);
+
+    // Separate call sites so each format gets its own specialised loop
+
+    if (meter->nonInterleaved)
+    {
+        for (uint32_t channel = 0; channel < channelCount; channel++)
+        {
+            if (format == STKMeterSampleFormatInt16)
+            {
+                Measure(buffers[channel], frameCount, 1, STKMeterSampleFormatInt16, peaks + channel, sums + channel);
+            }
+            else
+            {
+                Measure(buffers[channel], frameCount, 1, STKMeterSampleFormatFloat32, peaks + channel, sums + channel);
+            }
+        }
+    }
+    else if (format == STKMeterSampleFormatInt16)
+    {
+        Measure(buffers[0], frameCount * channelCount, channelCount, STKMeterSampleFormatInt16, peaks, sums);
+    }
+    else
+    {
+        Measure(buffers[0], frameCount * channelCount, channelCount, STKMeterSampleFormatFloat32, peaks, sums);
+    }
+
+    float scale = format == STKMeterSampleFormatInt16 ? 1.0f / 32768.0f : 1.0f;
+    float powerScale = scale * scale;
+
+    for (uint32_t channel = 0; channel < channelCount; channel++)
+    {
+        StoreFloat(&meter->peakPowerDb[channel], PowerToDecibels(peaks[channel] * peaks[channel] * powerScale));
+        StoreFloat(&meter->averagePowerDb[channel], PowerToDecibels(sums[channel] / frameCount * powerScale));
+    }
+}
+
+float STKMeterPeakPowerDb(STKMeter* meter, uint32_t channel)
+{
+    if (channel >= meter->channelCount)
+    {
+        return STK_METER_DB_MIN;
+    }
+
+    return LoadFloat(&meter->peakPowerDb[channel]);
+}
+
+float STKMeterAveragePowerDb(STKMeter* meter, uint32_t channel)
+{
+    if (channel >= meter->channelCount)
+    {
+        return STK_METER_DB_MIN;
+    }
+
+    return LoadFloat(&meter->averagePowerDb[channel]);
+}
@@ -0,0 +1,62 @@
+//
+//  STKMeter.h
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STK_METER_DB_MIN (-60.0f)
+
+typedef enum
+{
+    STKMeterSampleFormatInt16,
+    STKMeterSampleFormatFloat32
+}
+STKMeterSampleFormat;
+
+///
+/// Peak and RMS level meter for interleaved or non-interleaved PCM with any number of channels.
+///
+/// STKMeterProcess measures a whole block with SSE2/NEON (or a scalar fallback) and only converts to
+/// decibels once per channel per block. Results are published with atomic stores so readers on other
+/// threads never lock.
+///
+typedef struct
+{
+    uint32_t channelCount;
+    STKMeterSampleFormat format;
+    bool nonInterleaved;
+    float* peakPowerDb;
+    float* averagePowerDb;
+    /// Per channel peak and sum of squares (render thread only)
+    float* scratch;
+}
+STKMeter;
+
+/// Allocates storage for channelCount channels and resets the meter. Returns false if the allocation failed.
+bool STKMeterInit(STKMeter* meter, uint32_t channelCount, STKMeterSampleFormat format, bool nonInterleaved);
+void STKMeterDestroy(STKMeter* meter);
+/// Resets all channels to STK_METER_DB_MIN (any thread)
+void STKMeterReset(STKMeter* meter);
+
+/// Measures frameCount frames and publishes the results (render thread only).
+/// buffers holds one pointer to the interleaved samples or one pointer per channel if the meter is non-interleaved.
+void STKMeterProcess(STKMeter* meter, const void* const* buffers, uint32_t frameCount);
+
+/// Peak power of the last block in dBFS between STK_METER_DB_MIN and 0 (any thread)
+float STKMeterPeakPowerDb(STKMeter* meter, uint32_t channel);
+/// RMS power of the last block in dBFS between STK_METER_DB_MIN and 0 (any thread)
+float STKMeterAveragePowerDb(STKMeter* meter, uint32_t channel);
+
+#ifdef __cplusplus
+}
+#endif
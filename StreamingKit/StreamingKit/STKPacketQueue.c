@@ -0,0 +1,259 @@
+//
+//  STKPacketQueue.c
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#include "STKPacketQueue.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define STK_LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STK_LOAD_RELAXED(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define STK_STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+typedef struct
+{
+    uint32_t size;
+    uint32_t type;
+    uint32_t count;
+    uint32_t descriptionsSize;
+    uint32_t dataSize;
+    uint32_t reserved;
+    uint64_t frames;
+    void* context;
+}
+RecordHeader;
+
+static inline uint32_t Align(uint32_t value)
+{
+    return (value + 7) & ~(uint32_t)7;
+}
+
+static inline RecordHeader* HeaderAt(STKPacketQueue* queue, uint64_t index)
+{
+    return (RecordHeader*)(queue->buffer + index % queue->capacity);
+}
+
+static inline uint8_t* DescriptionsOf(RecordHeader* header)
+{
+    return (uint8_t*)header + sizeof(RecordHeader);
+}
+
+static inline uint8_t* DataOf(RecordHeader* header, uint32_t descriptionsSize)
+{
+    return DescriptionsOf(header) + Align(descriptionsSize);
+}
+
+bool STKPacketQueueInit(STKPacketQueue* queue, uint32_t capacity)
+{
+    memset(queue, 0, sizeof(*queue));
+
+    capacity = Align(capacity);
+
+    if (capacity < sizeof(RecordHeader))
+    {
+        return false;
+    }
+
+    queue->buffer = malloc(capacity);
+
+    if (queue->buffer == NULL)
+    {
+        return false;
+    }
+
+    queue->capacity = capacity;
+
+    return true;
+}
+
+void STKPacketQueueDestroy(STKPacketQueue* queue)
+{
+    free(queue->buffer);
+
+    memset(queue, 0, sizeof(*queue));
+}
+
+uint32_t STKPacketQueueRecordSize(uint32_t descriptionsSize, uint32_t dataSize)
+{
+    return (uint32_t)sizeof(RecordHeader) + Align(descriptionsSize) + Align(dataSize);
+}
+
+uint32_t STKPacketQueueUsedBytes(STKPacketQueue* queue)
+{
+    return (uint32_t)(STK_LOAD_ACQUIRE(&queue->writeIndex) - STK_LOAD_ACQUIRE(&queue->readIndex));
+}
+
+uint32_t STKPacketQueueFreeBytes(STKPacketQueue* queue)
+{
+    return queue->capacity - STKPacketQueueUsedBytes(queue);
+}
+
+uint64_t STKPacketQueueFrameCount(STKPacketQueue* queue)
+{
+    uint64_t popped = STK_LOAD_ACQUIRE(&queue->framesPopped);
+    uint64_t pushed = STK_LOAD_ACQUIRE(&queue->framesPushed);
+
+    return pushed > popped ? pushed - popped : 0;
+}
+
+bool STKPacketQueueIsEmpty(STKPacketQueue* queue)
+{
+    return STK_LOAD_ACQUIRE(&queue->writeIndex) == STK_LOAD_ACQUIRE(&queue->readIndex);
+}
+
+bool STKPacketQueueBeginPush(STKPacketQueue* queue, uint32_t descriptionsSize, uint32_t dataSize, void** descriptions, void** data)
+{
+    uint32_t size = STKPacketQueueRecordSize(descriptionsSize, dataSize);
+
+    if (queue->buffer == NULL || size > queue->capacity)
+    {
+        return false;
+    }
+
+    uint64_t write = STK_LOAD_RELAXED(&queue->writeIndex);
+    uint64_t read = STK_LOAD_ACQUIRE(&queue->readIndex);
+    uint32_t tail = queue->capacity - (uint32_t)(write % queue->capacity);
+
+    // Payloads are used in place so a record that would wrap starts at the beginning of the buffer instead
+
+    uint64_t recordIndex = size > tail ? write + tail : write;
+
+    if (recordIndex + size - read > queue->capacity)
+    {
+        return false;
+    }
+
+    queue->pendingIndex = recordIndex;
+    queue->pendingDescriptionsSize = descriptionsSize;
+    queue->pendingDataSize = dataSize;
+
+    RecordHeader* header = HeaderAt(queue, recordIndex);
+
+    *descriptions = DescriptionsOf(header);
+    *data = DataOf(header, descriptionsSize);
+
+    return true;
+}
+
+void STKPacketQueueEndPush(STKPacketQueue* queue, uint32_t type, uint32_t count, uint64_t frames, void* context)
+{
+    uint64_t write = STK_LOAD_RELAXED(&queue->writeIndex);
+    uint32_t tail = (uint32_t)(queue->pendingIndex - write);
+
+    // Space too small for a header is skipped by the consumer without one
+
+    if (tail >= sizeof(RecordHeader))
+    {
+        RecordHeader* padding = HeaderAt(queue, write);
+
+        padding->size = tail;
+        padding->type = STK_PACKET_QUEUE_RECORD_PADDING;
+    }
+
+    RecordHeader* header = HeaderAt(queue, queue->pendingIndex);
+
+    header->size = STKPacketQueueRecordSize(queue->pendingDescriptionsSize, queue->pendingDataSize);
+    header->type = type;
+    header->count = count;
+    header->descriptionsSize = queue->pendingDescriptionsSize;
+    header->dataSize = queue->pendingDataSize;
+    header->frames = frames;
+    header->context = context;
+
+    __atomic_fetch_add(&queue->framesPushed, frames, __ATOMIC_RELEASE);
+
+    STK_STORE_RELEASE(&queue->writeIndex, queue->pendingIndex + header->size);
+}
+
+bool STKPacketQueuePush(STKPacketQueue* queue, uint32_t type, uint32_t count, uint64_t frames, void* context)
+{
+    void* descriptions;
+    void* data;
+
+    if (!STKPacketQueueBeginPush(queue, 0, 0, &descriptions, &data))
+    {
+        return false;
+    }
+
+    STKPacketQueueEndPush(queue, type, count, frames, context);
+
+    return true;
+}
+
+/// Moves the read index past any padding and returns the header of the oldest record or NULL if there is none
+static RecordHeader* OldestRecord(STKPacketQueue* queue)
+{
+    uint64_t read = STK_LOAD_RELAXED(&queue->readIndex);
+    uint64_t write = STK_LOAD_ACQUIRE(&queue->writeIndex);
+    RecordHeader* retval = NULL;
+
+    while (read != write)
+    {
+        uint32_t tail = queue->capacity - (uint32_t)(read % queue->capacity);
+
+        if (tail < sizeof(RecordHeader))
+        {
+            read += tail;
+
+            continue;
+        }
+
+        RecordHeader* header = HeaderAt(queue, read);
+
+        if (header->type == STK_PACKET_QUEUE_RECORD_PADDING)
+        {
+            read += header->size;
+
+            continue;
+        }
+
+        retval = header;
+
+        break;
+    }
+
+    if (read != STK_LOAD_RELAXED(&queue->readIndex))
+    {
+        STK_STORE_RELEASE(&queue->readIndex, read);
+    }
+
+    return retval;
+}
+
+bool STKPacketQueuePeek(STKPacketQueue* queue, STKPacketQueueRecord* record)
+{
+    RecordHeader* header = OldestRecord(queue);
+
+    if (header == NULL)
+    {
+        return false;
+    }
+
+    record->type = header->type;
+    record->count = header->count;
+    record->frames = header->frames;
+    record->context = header->context;
+    record->descriptions = DescriptionsOf(header);
+    record->descriptionsSize = header->descriptionsSize;
+    record->data = DataOf(header, header->descriptionsSize);
+    record->dataSize = header->dataSize;
+
+    return true;
+}
+
+void STKPacketQueuePop(STKPacketQueue* queue)
+{
+    RecordHeader* header = OldestRecord(queue);
+
+    if (header == NULL)
+    {
+        return;
+    }
+
+    __atomic_fetch_add(&queue->framesPopped, header->frames, __ATOMIC_RELEASE);
+
+    STK_STORE_RELEASE(&queue->readIndex, STK_LOAD_RELAXED(&queue->readIndex) + header->size);
+}
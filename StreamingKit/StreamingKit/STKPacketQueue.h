@@ -0,0 +1,93 @@
+//
+//  STKPacketQueue.h
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Reserved for the filler at the end of the buffer when a record doesn't fit before it wraps
+#define STK_PACKET_QUEUE_RECORD_PADDING (0xffffffff)
+
+///
+/// Single-producer/single-consumer lock-free queue of variable length records in a fixed size buffer.
+///
+/// Each record has a type, a count and frame count, a context pointer and two byte payloads (such as packet
+/// descriptions and packet data) that are stored contiguously so the consumer can use them in place.
+/// The producer reserves space with STKPacketQueueBeginPush, copies into it and publishes it with
+/// STKPacketQueueEndPush. The consumer looks at the oldest record with STKPacketQueuePeek and releases it
+/// with STKPacketQueuePop. Neither side takes a lock or waits; the caller decides what to do when the queue is
+/// full or empty. Indexes are monotonically increasing 64-bit byte counters so the used count is write - read.
+///
+typedef struct
+{
+    uint8_t* buffer;
+    uint32_t capacity;
+
+    uint64_t writeIndex;
+    uint64_t readIndex;
+    uint64_t framesPushed;
+    uint64_t framesPopped;
+
+    /// Producer only: the record reserved by STKPacketQueueBeginPush
+    uint64_t pendingIndex;
+    uint32_t pendingDescriptionsSize;
+    uint32_t pendingDataSize;
+}
+STKPacketQueue;
+
+typedef struct
+{
+    uint32_t type;
+    uint32_t count;
+    uint64_t frames;
+    void* context;
+    const void* descriptions;
+    uint32_t descriptionsSize;
+    const void* data;
+    uint32_t dataSize;
+}
+STKPacketQueueRecord;
+
+/// Allocates capacity bytes (rounded up to a multiple of 8). Returns false if the allocation failed
+bool STKPacketQueueInit(STKPacketQueue* queue, uint32_t capacity);
+/// Frees the storage allocated by STKPacketQueueInit
+void STKPacketQueueDestroy(STKPacketQueue* queue);
+
+/// The number of bytes of storage a record with the given payloads takes up
+uint32_t STKPacketQueueRecordSize(uint32_t descriptionsSize, uint32_t dataSize);
+/// The number of bytes used by records (any thread, may be stale by the time it returns)
+uint32_t STKPacketQueueUsedBytes(STKPacketQueue* queue);
+/// The number of bytes not used by records. A record this size may still not fit if it would wrap (any thread)
+uint32_t STKPacketQueueFreeBytes(STKPacketQueue* queue);
+/// The sum of the frames of all queued records (any thread, may be stale by the time it returns)
+uint64_t STKPacketQueueFrameCount(STKPacketQueue* queue);
+/// Returns true if there are no records to consume (any thread, may be stale by the time it returns)
+bool STKPacketQueueIsEmpty(STKPacketQueue* queue);
+
+/// Reserves a record with room for descriptionsSize and dataSize bytes and returns where to copy them.
+/// Returns false if there isn't enough contiguous room (producer only)
+bool STKPacketQueueBeginPush(STKPacketQueue* queue, uint32_t descriptionsSize, uint32_t dataSize, void** descriptions, void** data);
+/// Publishes the record reserved by STKPacketQueueBeginPush (producer only)
+void STKPacketQueueEndPush(STKPacketQueue* queue, uint32_t type, uint32_t count, uint64_t frames, void* context);
+/// Pushes a record without payloads. Returns false if there isn't room (producer only)
+bool STKPacketQueuePush(STKPacketQueue* queue, uint32_t type, uint32_t count, uint64_t frames, void* context);
+
+/// Gets the oldest record without releasing it. The payloads stay valid until STKPacketQueuePop.
+/// Returns false if the queue is empty (consumer only)
+bool STKPacketQueuePeek(STKPacketQueue* queue, STKPacketQueueRecord* record);
+/// Releases the oldest record (consumer only)
+void STKPacketQueuePop(STKPacketQueue* queue);
+
+#ifdef __cplusplus
+}
+#endif
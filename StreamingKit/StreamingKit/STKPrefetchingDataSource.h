@@ -0,0 +1,32 @@
+//
+//  STKPrefetchingDataSource.h
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import "STKDataSourceWrapper.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Wraps a data source and reads the start of it ahead of time so it starts from memory.
+/// Prefetching reads until at least byteCount bytes and the audio header (format and data offset) are in memory
+/// or maximumByteCount is reached and then leaves the connection open. When the data source is later registered
+/// for events and seeked into the prefetched bytes they are read from memory before reading carries on from the connection
+@interface STKPrefetchingDataSource : STKDataSourceWrapper
+
+@property (readonly) BOOL isPrefetching;
+/// Number of bytes held in memory
+@property (readonly) NSUInteger prefetchedByteCount;
+/// YES once the format and data offset have been parsed from the prefetched bytes
+@property (readonly) BOOL parsedHeader;
+@property (readonly) AudioStreamBasicDescription audioStreamBasicDescription;
+@property (readonly) UInt64 audioDataOffset;
+
+-(void) prefetchOnRunLoop:(NSRunLoop*)runLoop byteCount:(NSUInteger)byteCount maximumByteCount:(NSUInteger)maximumByteCount;
+/// Stops prefetching, closes the connection and releases the prefetched bytes (ignored once the data source is in use)
+-(void) cancelPrefetch;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,376 @@
+//
+//  STKPrefetchingDataSource.m
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import "STKPrefetchingDataSource.h"
+
+#define STK_PREFETCH_READ_SIZE (16 * 1024)
+
+@interface STKPrefetchingDataSource()
+{
+    NSMutableData* buffer;
+    SInt64 position;
+    NSUInteger byteCount;
+    NSUInteger maximumByteCount;
+    BOOL prefetching;
+    BOOL servingFromBuffer;
+    BOOL innerEof;
+    BOOL registeredForPrefetch;
+    int eventSerial;
+    NSRunLoop* eventsRunLoop;
+    AudioFileStreamID audioFileStream;
+}
+
+@property (readwrite) BOOL parsedHeader;
+@property (readwrite) AudioStreamBasicDescription audioStreamBasicDescription;
+@property (readwrite) UInt64 audioDataOffset;
+
+-(void) handlePropertyChangeForFileStream:(AudioFileStreamID)inAudioFileStream fileStreamPropertyID:(AudioFileStreamPropertyID)inPropertyID;
+
+@end
+
+static void PrefetchPropertyListenerProc(void* clientData, AudioFileStreamID audioFileStream, AudioFileStreamPropertyID propertyId, UInt32* flags)
+{
+    STKPrefetchingDataSource* dataSource = (__bridge STKPrefetchingDataSource*)clientData;
+
+    [dataSource handlePropertyChangeForFileStream:audioFileStream fileStreamPropertyID:propertyId];
+}
+
+static void PrefetchPacketsProc(void* clientData, UInt32 numberBytes, UInt32 numberPackets, const void* inputData, AudioStreamPacketDescription* packetDescriptions)
+{
+}
+
+@implementation STKPrefetchingDataSource
+
+-(void) dealloc
+{
+    [self closeAudioFileStream];
+}
+
+-(BOOL) isPrefetching
+{
+    return prefetching;
+}
+
+-(NSUInteger) prefetchedByteCount
+{
+    return buffer.length;
+}
+
+-(void) closeAudioFileStream
+{
+    if (audioFileStream)
+    {
+        AudioFileStreamClose(audioFileStream);
+
+        audioFileStream = 0;
+    }
+}
+
+-(void) discardPrefetch
+{
+    prefetching = NO;
+    servingFromBuffer = NO;
+    buffer = nil;
+
+    [self closeAudioFileStream];
+}
+
+-(void) prefetchOnRunLoop:(NSRunLoop*)runLoop byteCount:(NSUInteger)byteCountIn maximumByteCount:(NSUInteger)maximumByteCountIn
+{
+    if (prefetching || buffer != nil || eventsRunLoop != nil)
+    {
+        return;
+    }
+
+    byteCount = byteCountIn;
+    maximumByteCount = MAX(byteCountIn, maximumByteCountIn);
+    buffer = [[NSMutableData alloc] initWithCapacity:byteCount];
+    prefetching = YES;
+    innerEof = NO;
+    registeredForPrefetch = YES;
+
+    [super registerForEvents:runLoop];
+    [super seekToOffset:0];
+}
+
+-(void) cancelPrefetch
+{
+    if (eventsRunLoop != nil || (!prefetching && buffer == nil))
+    {
+        return;
+    }
+
+    [self discardPrefetch];
+
+    registeredForPrefetch = NO;
+
+    [super unregisterForEvents];
+    [super close];
+}
+
+-(BOOL) hasPrefetchedEnough
+{
+    return innerEof || buffer.length >= maximumByteCount || (buffer.length >= byteCount && self.parsedHeader);
+}
+
+-(void) readPrefetch
+{
+    while (prefetching && ![self hasPrefetchedEnough] && [super hasBytesAvailable])
+    {
+        NSUInteger offset = buffer.length;
+        int size = (int)MIN((NSUInteger)STK_PREFETCH_READ_SIZE, maximumByteCount - offset);
+
+        buffer.length = offset + size;
+
+        int read = [super readIntoBuffer:(UInt8*)buffer.mutableBytes + offset withSize:size];
+
+        buffer.length = offset + MAX(read, 0);
+
+        if (read < 0)
+        {
+            // Reading starts over from the connection when the data source is used
+
+            [self cancelPrefetch];
+
+            return;
+        }
+
+        if (read == 0)
+        {
+            break;
+        }
+
+        [self parseBytes:(UInt8*)buffer.mutableBytes + offset length:read];
+    }
+
+    if (prefetching && [self hasPrefetchedEnough])
+    {
+        // The rest is left with the connection until the data source is used
+
+        prefetching = NO;
+
+        [self closeAudioFileStream];
+    }
+}
+
+-(void) parseBytes:(const UInt8*)bytes length:(int)length
+{
+    if (self.parsedHeader)
+    {
+        return;
+    }
+
+    if (audioFileStream == 0)
+    {
+        if (AudioFileStreamOpen((__bridge void*)self, PrefetchPropertyListenerProc, PrefetchPacketsProc, self.audioFileTypeHint, &audioFileStream))
+        {
+            return;
+        }
+    }
+
+    if (AudioFileStreamParseBytes(audioFileStream, length, bytes, 0))
+    {
+        [self closeAudioFileStream];
+    }
+}
+
+-(void) handlePropertyChangeForFileStream:(AudioFileStreamID)inAudioFileStream fileStreamPropertyID:(AudioFileStreamPropertyID)inPropertyID
+{
+    if (inPropertyID == kAudioFileStreamProperty_DataFormat)
+    {
+        AudioStreamBasicDescription asbd;
+        UInt32 size = sizeof(asbd);
+
+        if (AudioFileStreamGetProperty(inAudioFileStream, kAudioFileStreamProperty_DataFormat, &size, &asbd) == 0)
+        {
+            self.audioStreamBasicDescription = asbd;
+        }
+    }
+    else if (inPropertyID == kAudioFileStreamProperty_DataOffset)
+    {
+        SInt64 offset;
+        UInt32 size = sizeof(offset);
+
+        if (AudioFileStreamGetProperty(inAudioFileStream, kAudioFileStreamProperty_DataOffset, &size, &offset) == 0)
+        {
+            self.audioDataOffset = offset;
+        }
+    }
+    else if (inPropertyID == kAudioFileStreamProperty_ReadyToProducePackets)
+    {
+        self.parsedHeader = YES;
+    }
+}
+
+-(void) scheduleEvent
+{
+    NSRunLoop* runLoop = eventsRunLoop;
+
+    if (runLoop == nil)
+    {
+        return;
+    }
+
+    int serial = ++eventSerial;
+
+    CFRunLoopPerformBlock(runLoop.getCFRunLoop, NSRunLoopCommonModes, ^
+    {
+        if (serial != self->eventSerial)
+        {
+            return;
+        }
+
+        if (self->servingFromBuffer || (!self->innerEof && [self.innerDataSource hasBytesAvailable]))
+        {
+            [self.delegate dataSourceDataAvailable:self];
+        }
+        else if (self->innerEof)
+        {
+            [self.delegate dataSourceEof:self];
+        }
+    });
+
+    CFRunLoopWakeUp(runLoop.getCFRunLoop);
+}
+
+-(SInt64) position
+{
+    return servingFromBuffer ? position : [super position];
+}
+
+-(BOOL) hasBytesAvailable
+{
+    return servingFromBuffer || [super hasBytesAvailable];
+}
+
+-(BOOL) registerForEvents:(NSRunLoop*)runLoop
+{
+    eventsRunLoop = runLoop;
+
+    if (registeredForPrefetch)
+    {
+        return YES;
+    }
+
+    return [super registerForEvents:runLoop];
+}
+
+-(void) unregisterForEvents
+{
+    eventsRunLoop = nil;
+    registeredForPrefetch = NO;
+    eventSerial++;
+
+    [super unregisterForEvents];
+}
+
+-(void) close
+{
+    [self discardPrefetch];
+
+    [super close];
+}
+
+-(void) seekToOffset:(SInt64)offset
+{
+    eventSerial++;
+    prefetching = NO;
+
+    [self closeAudioFileStream];
+
+    if (buffer != nil && offset >= 0 && offset < (SInt64)buffer.length)
+    {
+        position = offset;
+        servingFromBuffer = YES;
+
+        [self scheduleEvent];
+
+        return;
+    }
+
+    innerEof = NO;
+
+    [self discardPrefetch];
+
+    [super seekToOffset:offset];
+}
+
+-(int) readIntoBuffer:(UInt8*)bufferOut withSize:(int)size
+{
+    if (!servingFromBuffer)
+    {
+        return [super readIntoBuffer:bufferOut withSize:size];
+    }
+
+    int read = (int)MIN((SInt64)size, (SInt64)buffer.length - position);
+
+    memcpy(bufferOut, (const UInt8*)buffer.bytes + position, read);
+
+    position += read;
+
+    if (position >= (SInt64)buffer.length)
+    {
+        // The connection is already positioned at the end of the prefetched bytes
+
+        [self discardPrefetch];
+    }
+
+    [self scheduleEvent];
+
+    return read;
+}
+
+-(void) dataSourceDataAvailable:(STKDataSource*)dataSource
+{
+    if (prefetching)
+    {
+        [self readPrefetch];
+
+        return;
+    }
+
+    if (servingFromBuffer || eventsRunLoop == nil)
+    {
+        return;
+    }
+
+    [super dataSourceDataAvailable:dataSource];
+}
+
+-(void) dataSourceErrorOccured:(STKDataSource*)dataSource
+{
+    if (eventsRunLoop == nil)
+    {
+        [self cancelPrefetch];
+
+        return;
+    }
+
+    [super dataSourceErrorOccured:dataSource];
+}
+
+-(void) dataSourceEof:(STKDataSource*)dataSource
+{
+    if (eventsRunLoop == nil || servingFromBuffer)
+    {
+        innerEof = YES;
+        prefetching = NO;
+
+        [self closeAudioFileStream];
+
+        return;
+    }
+
+    [super dataSourceEof:dataSource];
+}
+
+-(NSString*) description
+{
+    return [NSString stringWithFormat:@"Prefetching %@", self.innerDataSource];
+}
+
+@end
@@ -8,6 +8,7 @@
 
 #import "STKDataSource.h"
 #import "STKSpinLock.h"
+#import "STKSeekTable.h"
 #import "AudioToolbox/AudioToolbox.h"
 
 NS_ASSUME_NONNULL_BEGIN
@@ -31,6 +32,20 @@ NS_ASSUME_NONNULL_BEGIN
 	volatile int processedPacketsSizeTotal;
     AudioStreamBasicDescription audioStreamBasicDescription;
     double durationHint;
+    CFAbsoluteTime readStartTime;
+    double timeToFirstSample;
+    double timeToFirstAudio;
+    uint64_t bytesRead;
+    uint64_t readCallCount;
+    STKSeekTable seekTable;
+    UInt32 seekTablePersistedCount;
+    UInt32 packetsToDiscard;
+    
+    /// Links owned by the STKEntryQueue the entry is in (if any)
+    __unsafe_unretained STKQueueEntry* queuePrevious;
+    __unsafe_unretained STKQueueEntry* queueNext;
+    __unsafe_unretained STKQueueEntry* queueNextWithSameId;
+    __unsafe_unretained STKQueueEntry* queueLastWithSameId;
 }
 
 @property (readonly) UInt64 audioDataLengthInBytes;
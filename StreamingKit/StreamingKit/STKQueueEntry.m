@@ -11,6 +11,7 @@
 
 #define STK_BIT_RATE_ESTIMATION_MIN_PACKETS_MIN (2)
 #define STK_BIT_RATE_ESTIMATION_MIN_PACKETS_PREFERRED (64)
+#define STK_SEEK_TABLE_PACKET_INTERVAL (16)
 
 @implementation STKQueueEntry
 
@@ -24,11 +25,20 @@
         self.queueItemId = queueItemIdIn;
         self->lastFrameQueued = -1;
         self->durationHint = dataSourceIn.durationHint;
+        self->timeToFirstSample = -1;
+        self->timeToFirstAudio = -1;
+        
+        STKSeekTableInit(&self->seekTable, STK_SEEK_TABLE_PACKET_INTERVAL);
     }
     
     return self;
 }
 
+-(void) dealloc
+{
+    STKSeekTableDestroy(&self->seekTable);
+}
+
 -(void) reset
 {
     setLock(&self->spinLock);
@@ -63,6 +73,13 @@
 {
     if (durationHint > 0.0) return durationHint;
     
+    double headerDuration = STKSeekTableHeaderDuration(&self->seekTable);
+    
+    if (headerDuration > 0)
+    {
+        return headerDuration;
+    }
+    
     if (self->sampleRate <= 0)
     {
         return 0;
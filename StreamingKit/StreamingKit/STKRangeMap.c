@@ -0,0 +1,193 @@
+//
+//  STKRangeMap.c
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#include "STKRangeMap.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define STK_RANGE_MAP_MAGIC (0x314d5253)
+
+/// Index of the first range whose end is at or after offset
+static uint32_t FindRange(const STKRangeMap* map, uint64_t offset)
+{
+    uint32_t low = 0;
+    uint32_t high = map->count;
+
+    while (low < high)
+    {
+        uint32_t middle = low + (high - low) / 2;
+
+        if (map->ranges[middle * 2 + 1] < offset)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+void STKRangeMapInit(STKRangeMap* map)
+{
+    memset(map, 0, sizeof(*map));
+}
+
+void STKRangeMapDestroy(STKRangeMap* map)
+{
+    free(map->ranges);
+
+    memset(map, 0, sizeof(*map));
+}
+
+void STKRangeMapClear(STKRangeMap* map)
+{
+    map->count = 0;
+    map->total = 0;
+}
+
+bool STKRangeMapAdd(STKRangeMap* map, uint64_t start, uint64_t end)
+{
+    if (end <= start)
+    {
+        return true;
+    }
+
+    uint32_t first = FindRange(map, start);
+    uint32_t last = first;
+
+    // Every range from first to last touches [start, end) and is merged into it
+
+    while (last < map->count && map->ranges[last * 2] <= end)
+    {
+        last++;
+    }
+
+    if (first == last)
+    {
+        if (map->count == map->capacity)
+        {
+            uint32_t capacity = map->capacity > 0 ? map->capacity * 2 : 16;
+            uint64_t* ranges = realloc(map->ranges, capacity * 2 * sizeof(uint64_t));
+
+            if (ranges == NULL)
+            {
+                return false;
+            }
+
+            map->ranges = ranges;
+            map->capacity = capacity;
+        }
+
+        memmove(map->ranges + (first + 1) * 2, map->ranges + first * 2, (map->count - first) * 2 * sizeof(uint64_t));
+
+        map->ranges[first * 2] = start;
+        map->ranges[first * 2 + 1] = end;
+        map->count++;
+        map->total += end - start;
+
+        return true;
+    }
+
+    uint64_t mergedStart = map->ranges[first * 2] < start ? map->ranges[first * 2] : start;
+    uint64_t mergedEnd = map->ranges[(last - 1) * 2 + 1] > end ? map->ranges[(last - 1) * 2 + 1] : end;
+
+    for (uint32_t i = first; i < last; i++)
+    {
+        map->total -= map->ranges[i * 2 + 1] - map->ranges[i * 2];
+    }
+
+    map->ranges[first * 2] = mergedStart;
+    map->ranges[first * 2 + 1] = mergedEnd;
+    map->total += mergedEnd - mergedStart;
+
+    memmove(map->ranges + (first + 1) * 2, map->ranges + last * 2, (map->count - last) * 2 * sizeof(uint64_t));
+    map->count -= last - first - 1;
+
+    return true;
+}
+
+uint64_t STKRangeMapContiguousLength(const STKRangeMap* map, uint64_t offset)
+{
+    uint32_t index = FindRange(map, offset + 1);
+
+    if (index == map->count || map->ranges[index * 2] > offset)
+    {
+        return 0;
+    }
+
+    return map->ranges[index * 2 + 1] - offset;
+}
+
+uint64_t STKRangeMapNextStart(const STKRangeMap* map, uint64_t offset)
+{
+    uint32_t index = FindRange(map, offset + 1);
+
+    if (index < map->count && map->ranges[index * 2] <= offset)
+    {
+        index++;
+    }
+
+    return index < map->count ? map->ranges[index * 2] : UINT64_MAX;
+}
+
+uint64_t STKRangeMapTotal(const STKRangeMap* map)
+{
+    return map->total;
+}
+
+size_t STKRangeMapSerializedSize(const STKRangeMap* map)
+{
+    return 2 * sizeof(uint32_t) + map->count * 2 * sizeof(uint64_t);
+}
+
+void STKRangeMapSerialize(const STKRangeMap* map, void* buffer)
+{
+    uint32_t header[2] = { STK_RANGE_MAP_MAGIC, map->count };
+
+    memcpy(buffer, header, sizeof(header));
+    memcpy((uint8_t*)buffer + sizeof(header), map->ranges, map->count * 2 * sizeof(uint64_t));
+}
+
+bool STKRangeMapDeserialize(STKRangeMap* map, const void* buffer, size_t length)
+{
+    uint32_t header[2];
+
+    STKRangeMapClear(map);
+
+    if (length < sizeof(header))
+    {
+        return false;
+    }
+
+    memcpy(header, buffer, sizeof(header));
+
+    if (header[0] != STK_RANGE_MAP_MAGIC || length != sizeof(header) + (size_t)header[1] * 2 * sizeof(uint64_t))
+    {
+        return false;
+    }
+
+    const uint8_t* source = (const uint8_t*)buffer + sizeof(header);
+
+    for (uint32_t i = 0; i < header[1]; i++)
+    {
+        uint64_t range[2];
+
+        memcpy(range, source + i * sizeof(range), sizeof(range));
+
+        if (!STKRangeMapAdd(map, range[0], range[1]))
+        {
+            STKRangeMapClear(map);
+
+            return false;
+        }
+    }
+
+    return true;
+}
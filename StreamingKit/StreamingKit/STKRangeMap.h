@@ -0,0 +1,52 @@
+//
+//  STKRangeMap.h
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+///
+/// Sorted set of non-overlapping half open byte ranges used to track which parts of a sparse cache file hold data.
+/// Adjacent and overlapping ranges are merged as they are added. Not thread safe.
+///
+typedef struct
+{
+    uint32_t count;
+    uint32_t capacity;
+    /// Pairs of start and end offsets
+    uint64_t* ranges;
+    uint64_t total;
+}
+STKRangeMap;
+
+void STKRangeMapInit(STKRangeMap* map);
+void STKRangeMapDestroy(STKRangeMap* map);
+void STKRangeMapClear(STKRangeMap* map);
+
+/// Adds [start, end). Returns false if the allocation failed
+bool STKRangeMapAdd(STKRangeMap* map, uint64_t start, uint64_t end);
+/// Number of contiguous bytes present from offset (0 if offset is not present)
+uint64_t STKRangeMapContiguousLength(const STKRangeMap* map, uint64_t offset);
+/// Start of the first range after offset or UINT64_MAX if there is none
+uint64_t STKRangeMapNextStart(const STKRangeMap* map, uint64_t offset);
+/// Total number of bytes present
+uint64_t STKRangeMapTotal(const STKRangeMap* map);
+
+size_t STKRangeMapSerializedSize(const STKRangeMap* map);
+void STKRangeMapSerialize(const STKRangeMap* map, void* buffer);
+/// Replaces the contents of map. Returns false (leaving map empty) if the data is invalid
+bool STKRangeMapDeserialize(STKRangeMap* map, const void* buffer, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,44 @@
+//
+//  STKRecordingWriter.h
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <AudioToolbox/AudioToolbox.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+///
+/// Writes a recording to a CAF file on a thread of its own so encoding and file I/O stay off the thread producing the audio.
+/// Blocks are copied into a bounded queue. A block that doesn't fit because the writer has fallen behind is dropped rather
+/// than making the producer wait. Decoded frames are encoded as AAC and compressed packets are written as they are.
+/// Frames or packets must come from one thread at a time
+///
+@interface STKRecordingWriter : NSObject
+
+@property (readonly) NSURL* url;
+/// The number of blocks dropped because the queue was full
+@property (readonly) UInt64 droppedBlockCount;
+
+/// Creates a writer that encodes frames in the given PCM format as AAC. Returns nil if the file or encoder can't be created
+-(nullable instancetype) initWithUrl:(NSURL*)url pcmFormat:(AudioStreamBasicDescription)format queueSize:(UInt32)queueSize;
+/// Creates a writer that writes packets in the given compressed format without re-encoding them.
+/// Returns nil if the format can't be stored in a CAF file
+-(nullable instancetype) initWithUrl:(NSURL*)url packetFormat:(AudioStreamBasicDescription)format magicCookie:(nullable NSData*)magicCookie queueSize:(UInt32)queueSize;
+
+/// YES if the writer takes packets rather than frames
+@property (readonly) BOOL passthrough;
+
+/// Queues frames (one buffer per plane) to be encoded. Returns NO if they were dropped
+-(BOOL) writeFrames:(const AudioBufferList*)bufferList count:(UInt32)frameCount;
+/// Queues packets to be written. Descriptions may be NULL for constant bit rate formats. Returns NO if they were dropped
+-(BOOL) writePackets:(const void*)data size:(UInt32)size descriptions:(nullable const AudioStreamPacketDescription*)descriptions count:(UInt32)count;
+
+/// Finishes writing what's queued and closes the file in the background. Nothing more can be written
+-(void) close;
+
+@end
+
+NS_ASSUME_NONNULL_END
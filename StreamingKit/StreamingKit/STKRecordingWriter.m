@@ -0,0 +1,473 @@
+//
+//  STKRecordingWriter.m
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import "STKRecordingWriter.h"
+#import "STKPacketQueue.h"
+#import <pthread.h>
+
+#define STK_RECORDING_OUTPUT_BUFFER_SIZE (32 * 1024)
+
+#define OSSTATUS_PRINTF_PLACEHOLDER @"%c%c%c%c"
+#define OSSTATUS_PRINTF_VALUE(status) (char)(((status) >> 24) & 0xFF), (char)(((status) >> 16) & 0xFF), (char)(((status) >> 8) & 0xFF), (char)((status) & 0xFF)
+
+typedef enum
+{
+    /// Decoded frames with each plane stored one after the other. count is the number of frames
+    STKRecordingBlockFrames = 1,
+    /// Compressed packets and their descriptions (if any). count is the number of packets
+    STKRecordingBlockPackets
+}
+STKRecordingBlockType;
+
+typedef struct
+{
+    const AudioBufferList* bufferList;
+    UInt32 frameCount;
+    BOOL done;
+}
+EncoderInput;
+
+static OSStatus EncoderInputCallback(AudioConverterRef inAudioConverter, UInt32* ioNumberDataPackets, AudioBufferList* ioData, AudioStreamPacketDescription** outDataPacketDescription, void* inUserData)
+{
+    EncoderInput* input = (EncoderInput*)inUserData;
+
+    if (input->done)
+    {
+        *ioNumberDataPackets = 0;
+
+        return 100;
+    }
+
+    for (UInt32 i = 0; i < MIN(ioData->mNumberBuffers, input->bufferList->mNumberBuffers); i++)
+    {
+        ioData->mBuffers[i] = input->bufferList->mBuffers[i];
+    }
+
+    *ioNumberDataPackets = input->frameCount;
+    input->done = YES;
+
+    return 0;
+}
+
+@interface STKRecordingWriter()
+{
+    AudioFileID audioFileId;
+    SInt64 packetPosition;
+    AudioStreamBasicDescription pcmFormat;
+    AudioStreamBasicDescription fileFormat;
+
+    /// Encoding to AAC (not used for passthrough)
+    AudioConverterRef encoder;
+    AudioBufferList* inputBufferList;
+    UInt8* outputBuffer;
+    UInt32 outputBufferSize;
+    UInt32 outputPacketsPerBuffer;
+    AudioStreamPacketDescription* outputPacketDescriptions;
+
+    STKPacketQueue queue;
+    pthread_mutex_t queueMutex;
+    pthread_cond_t queueCondition;
+    BOOL closing;
+    UInt64 droppedBlockCount;
+}
+@end
+
+@implementation STKRecordingWriter
+
+-(instancetype) initWithUrl:(NSURL*)url queueSize:(UInt32)queueSize
+{
+    if (self = [super init])
+    {
+        _url = url;
+
+        pthread_mutex_init(&queueMutex, NULL);
+        pthread_cond_init(&queueCondition, NULL);
+
+        if (!STKPacketQueueInit(&queue, queueSize))
+        {
+            return nil;
+        }
+    }
+
+    return self;
+}
+
+-(instancetype) initWithUrl:(NSURL*)url pcmFormat:(AudioStreamBasicDescription)format queueSize:(UInt32)queueSize
+{
+    if (self = [self initWithUrl:url queueSize:queueSize])
+    {
+        OSStatus status;
+        UInt32 planeCount = (format.mFormatFlags & kAudioFormatFlagIsNonInterleaved) ? format.mChannelsPerFrame : 1;
+
+        pcmFormat = format;
+        fileFormat = (AudioStreamBasicDescription)
+        {
+            .mFormatID = kAudioFormatMPEG4AAC,
+            .mFormatFlags = kMPEG4Object_AAC_LC,
+            .mChannelsPerFrame = format.mChannelsPerFrame,
+            .mSampleRate = format.mSampleRate,
+        };
+
+        UInt32 size = sizeof(fileFormat);
+
+        AudioFormatGetProperty(kAudioFormatProperty_FormatInfo, 0, NULL, &size, &fileFormat);
+
+        status = AudioConverterNew(&pcmFormat, &fileFormat, &encoder);
+
+        if (status)
+        {
+            NSLog(@"STKRecordingWriter failed to create a recording audio converter");
+
+            return nil;
+        }
+
+        UInt32 maximumPacketSize = fileFormat.mBytesPerPacket;
+
+        if (maximumPacketSize == 0)
+        {
+            size = sizeof(maximumPacketSize);
+
+            if (AudioConverterGetProperty(encoder, kAudioConverterPropertyMaximumOutputPacketSize, &size, &maximumPacketSize) || maximumPacketSize == 0)
+            {
+                NSLog(@"STKRecordingWriter: Can't support this output format for recording");
+
+                return nil;
+            }
+        }
+
+        outputBufferSize = MAX(STK_RECORDING_OUTPUT_BUFFER_SIZE, maximumPacketSize);
+        outputPacketsPerBuffer = outputBufferSize / maximumPacketSize;
+        outputBuffer = malloc(outputBufferSize);
+        outputPacketDescriptions = malloc(sizeof(AudioStreamPacketDescription) * outputPacketsPerBuffer);
+
+        inputBufferList = calloc(1, offsetof(AudioBufferList, mBuffers) + sizeof(AudioBuffer) * planeCount);
+        inputBufferList->mNumberBuffers = planeCount;
+
+        if (![self createFile])
+        {
+            return nil;
+        }
+
+        // Decoders need the encoder's cookie to play the file back
+
+        [self writeMagicCookie:[self encoderMagicCookie]];
+        [self startThread];
+    }
+
+    return self;
+}
+
+-(instancetype) initWithUrl:(NSURL*)url packetFormat:(AudioStreamBasicDescription)format magicCookie:(NSData*)magicCookie queueSize:(UInt32)queueSize
+{
+    if (self = [self initWithUrl:url queueSize:queueSize])
+    {
+        _passthrough = YES;
+
+        fileFormat = format;
+
+        if (![self createFile])
+        {
+            return nil;
+        }
+
+        [self writeMagicCookie:magicCookie];
+        [self startThread];
+    }
+
+    return self;
+}
+
+-(void) dealloc
+{
+    [self closeFile];
+
+    free(inputBufferList);
+
+    STKPacketQueueDestroy(&queue);
+
+    pthread_mutex_destroy(&queueMutex);
+    pthread_cond_destroy(&queueCondition);
+}
+
+-(BOOL) createFile
+{
+    OSStatus status = AudioFileCreateWithURL((__bridge CFURLRef)_url, kAudioFileCAFType, &fileFormat, kAudioFileFlags_EraseFile, &audioFileId);
+
+    if (status)
+    {
+        NSLog(@"STKRecordingWriter failed to create a recording audio file at %@", _url);
+
+        audioFileId = NULL;
+
+        return NO;
+    }
+
+    return YES;
+}
+
+-(NSData*) encoderMagicCookie
+{
+    UInt32 size = 0;
+
+    if (AudioConverterGetPropertyInfo(encoder, kAudioConverterCompressionMagicCookie, &size, NULL) || size == 0)
+    {
+        return nil;
+    }
+
+    NSMutableData* retval = [NSMutableData dataWithLength:size];
+
+    if (AudioConverterGetProperty(encoder, kAudioConverterCompressionMagicCookie, &size, retval.mutableBytes))
+    {
+        return nil;
+    }
+
+    retval.length = size;
+
+    return retval;
+}
+
+-(void) writeMagicCookie:(NSData*)magicCookie
+{
+    if (magicCookie.length > 0)
+    {
+        AudioFileSetProperty(audioFileId, kAudioFilePropertyMagicCookieData, (UInt32)magicCookie.length, magicCookie.bytes);
+    }
+}
+
+-(void) closeFile
+{
+    if (audioFileId)
+    {
+        AudioFileClose(audioFileId);
+        audioFileId = NULL;
+    }
+
+    if (encoder)
+    {
+        AudioConverterDispose(encoder);
+        encoder = nil;
+    }
+
+    free(outputBuffer);
+    outputBuffer = NULL;
+
+    free(outputPacketDescriptions);
+    outputPacketDescriptions = NULL;
+}
+
+-(UInt64) droppedBlockCount
+{
+    return __atomic_load_n(&droppedBlockCount, __ATOMIC_RELAXED);
+}
+
+#pragma mark Producer
+
+/// Reserves room for a block or counts it as dropped
+-(BOOL) beginBlockWithDescriptionsSize:(UInt32)descriptionsSize dataSize:(UInt32)dataSize descriptions:(void**)descriptions data:(void**)data
+{
+    if (closing || !STKPacketQueueBeginPush(&queue, descriptionsSize, dataSize, descriptions, data))
+    {
+        __atomic_fetch_add(&droppedBlockCount, 1, __ATOMIC_RELAXED);
+
+        return NO;
+    }
+
+    return YES;
+}
+
+-(void) endBlockWithType:(STKRecordingBlockType)type count:(UInt32)count
+{
+    STKPacketQueueEndPush(&queue, type, count, 0, NULL);
+
+    pthread_mutex_lock(&queueMutex);
+    pthread_cond_signal(&queueCondition);
+    pthread_mutex_unlock(&queueMutex);
+}
+
+-(BOOL) writeFrames:(const AudioBufferList*)bufferList count:(UInt32)frameCount
+{
+    void* descriptions;
+    void* data;
+    UInt32 planeSize = frameCount * pcmFormat.mBytesPerFrame;
+
+    if (_passthrough || frameCount == 0)
+    {
+        return NO;
+    }
+
+    if (![self beginBlockWithDescriptionsSize:0 dataSize:planeSize * inputBufferList->mNumberBuffers descriptions:&descriptions data:&data])
+    {
+        return NO;
+    }
+
+    for (UInt32 i = 0; i < inputBufferList->mNumberBuffers; i++)
+    {
+        memcpy((UInt8*)data + planeSize * i, bufferList->mBuffers[MIN(i, bufferList->mNumberBuffers - 1)].mData, planeSize);
+    }
+
+    [self endBlockWithType:STKRecordingBlockFrames count:frameCount];
+
+    return YES;
+}
+
+-(BOOL) writePackets:(const void*)data size:(UInt32)size descriptions:(const AudioStreamPacketDescription*)descriptionsIn count:(UInt32)count
+{
+    void* descriptions;
+    void* destination;
+    UInt32 descriptionsSize = descriptionsIn ? count * sizeof(AudioStreamPacketDescription) : 0;
+
+    if (!_passthrough || count == 0)
+    {
+        return NO;
+    }
+
+    if (![self beginBlockWithDescriptionsSize:descriptionsSize dataSize:size descriptions:&descriptions data:&destination])
+    {
+        return NO;
+    }
+
+    memcpy(descriptions, descriptionsIn, descriptionsSize);
+    memcpy(destination, data, size);
+
+    [self endBlockWithType:STKRecordingBlockPackets count:count];
+
+    return YES;
+}
+
+-(void) close
+{
+    pthread_mutex_lock(&queueMutex);
+    closing = YES;
+    pthread_cond_signal(&queueCondition);
+    pthread_mutex_unlock(&queueMutex);
+}
+
+#pragma mark Writer thread
+
+-(void) startThread
+{
+    // The thread keeps the writer alive until the file is closed
+
+    [[[NSThread alloc] initWithTarget:self selector:@selector(writeUntilClosed) object:nil] start];
+}
+
+-(void) writeUntilClosed
+{
+    @autoreleasepool
+    {
+        STKPacketQueueRecord record;
+
+        while (true)
+        {
+            pthread_mutex_lock(&queueMutex);
+
+            while (STKPacketQueueIsEmpty(&queue) && !closing)
+            {
+                pthread_cond_wait(&queueCondition, &queueMutex);
+            }
+
+            BOOL finished = closing && STKPacketQueueIsEmpty(&queue);
+
+            pthread_mutex_unlock(&queueMutex);
+
+            if (finished)
+            {
+                break;
+            }
+
+            while (STKPacketQueuePeek(&queue, &record))
+            {
+                if (record.type == STKRecordingBlockFrames)
+                {
+                    [self encodeFrames:&record];
+                }
+                else
+                {
+                    [self writePacketsToFile:record.data size:record.dataSize descriptions:record.descriptionsSize > 0 ? record.descriptions : NULL count:record.count];
+                }
+
+                STKPacketQueuePop(&queue);
+            }
+        }
+
+        if (encoder)
+        {
+            [self writeMagicCookie:[self encoderMagicCookie]];
+        }
+
+        [self closeFile];
+
+        UInt64 dropped = self.droppedBlockCount;
+
+        if (dropped > 0)
+        {
+            NSLog(@"STKRecordingWriter dropped %llu blocks recording to %@", dropped, _url);
+        }
+    }
+}
+
+-(void) encodeFrames:(STKPacketQueueRecord*)record
+{
+    OSStatus status;
+    UInt32 planeSize = record->count * pcmFormat.mBytesPerFrame;
+    EncoderInput input = { .bufferList = inputBufferList, .frameCount = record->count, .done = NO };
+
+    for (UInt32 i = 0; i < inputBufferList->mNumberBuffers; i++)
+    {
+        inputBufferList->mBuffers[i].mData = (UInt8*)record->data + planeSize * i;
+        inputBufferList->mBuffers[i].mDataByteSize = planeSize;
+        inputBufferList->mBuffers[i].mNumberChannels = pcmFormat.mChannelsPerFrame / inputBufferList->mNumberBuffers;
+    }
+
+    AudioBufferList output;
+
+    output.mNumberBuffers = 1;
+
+    while (true)
+    {
+        UInt32 packetCount = outputPacketsPerBuffer;
+
+        output.mBuffers[0].mNumberChannels = fileFormat.mChannelsPerFrame;
+        output.mBuffers[0].mDataByteSize = outputBufferSize;
+        output.mBuffers[0].mData = outputBuffer;
+
+        status = AudioConverterFillComplexBuffer(encoder, EncoderInputCallback, &input, &packetCount, &output, outputPacketDescriptions);
+
+        if (status != 0 && status != 100)
+        {
+            NSLog(@"STKRecordingWriter: Unexpected error during recording audio file conversion");
+
+            break;
+        }
+
+        if (packetCount > 0)
+        {
+            [self writePacketsToFile:output.mBuffers[0].mData size:output.mBuffers[0].mDataByteSize descriptions:outputPacketDescriptions count:packetCount];
+        }
+
+        if (status == 100 || packetCount == 0)
+        {
+            break;
+        }
+    }
+}
+
+-(void) writePacketsToFile:(const void*)data size:(UInt32)size descriptions:(const AudioStreamPacketDescription*)descriptions count:(UInt32)count
+{
+    OSStatus status = AudioFileWritePackets(audioFileId, NO, size, descriptions, packetPosition, &count, data);
+
+    if (status)
+    {
+        NSLog(@"STKRecordingWriter failed on AudioFileWritePackets with error \"" OSSTATUS_PRINTF_PLACEHOLDER "\"", OSSTATUS_PRINTF_VALUE(status));
+
+        return;
+    }
+
+    packetPosition += count;
+}
+
+@end
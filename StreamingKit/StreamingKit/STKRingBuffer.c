@@ -0,0 +1,232 @@
+//
+//  STKRingBuffer.c
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#include "STKRingBuffer.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define STK_LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STK_LOAD_RELAXED(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define STK_STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+/// The read index as the consumer will see it, with flushed frames skipped
+static inline uint64_t EffectiveReadIndex(STKRingBuffer* ring)
+{
+    uint64_t read = STK_LOAD_ACQUIRE(&ring->readIndex);
+    uint64_t flush = STK_LOAD_ACQUIRE(&ring->flushIndex);
+
+    return flush > read ? flush : read;
+}
+
+/// Skips flushed frames, which hands them back to the producer (consumer only)
+static inline uint64_t ConsumerReadIndex(STKRingBuffer* ring)
+{
+    uint64_t read = STK_LOAD_RELAXED(&ring->readIndex);
+    uint64_t flush = STK_LOAD_ACQUIRE(&ring->flushIndex);
+
+    if (flush > read)
+    {
+        read = flush;
+
+        STK_STORE_RELEASE(&ring->readIndex, read);
+    }
+
+    return read;
+}
+
+bool STKRingBufferInit(STKRingBuffer* ring, uint32_t frameCount, uint32_t bytesPerFrame, uint32_t planeCount)
+{
+    memset(ring, 0, sizeof(*ring));
+
+    if (frameCount == 0 || bytesPerFrame == 0 || planeCount == 0)
+    {
+        return false;
+    }
+
+    ring->buffer = calloc((size_t)frameCount * planeCount, bytesPerFrame);
+
+    if (ring->buffer == NULL)
+    {
+        return false;
+    }
+
+    ring->frameCount = frameCount;
+    ring->bytesPerFrame = bytesPerFrame;
+    ring->planeCount = planeCount;
+
+    return true;
+}
+
+void STKRingBufferDestroy(STKRingBuffer* ring)
+{
+    free(ring->buffer);
+
+    memset(ring, 0, sizeof(*ring));
+}
+
+void STKRingBufferFlush(STKRingBuffer* ring)
+{
+    uint64_t write = STK_LOAD_ACQUIRE(&ring->writeIndex);
+    uint64_t flush = STK_LOAD_RELAXED(&ring->flushIndex);
+
+    while (flush < write)
+    {
+        if (__atomic_compare_exchange_n(&ring->flushIndex, &flush, write, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        {
+            break;
+        }
+    }
+}
+
+void STKRingBufferReset(STKRingBuffer* ring)
+{
+    STKRingBufferFlush(ring);
+    ConsumerReadIndex(ring);
+}
+
+uint32_t STKRingBufferUsedFrameCount(STKRingBuffer* ring)
+{
+    uint64_t read = EffectiveReadIndex(ring);
+    uint64_t write = STK_LOAD_ACQUIRE(&ring->writeIndex);
+
+    if (write <= read)
+    {
+        return 0;
+    }
+
+    uint64_t used = write - read;
+
+    return used > ring->frameCount ? ring->frameCount : (uint32_t)used;
+}
+
+uint32_t STKRingBufferFreeFrameCount(STKRingBuffer* ring)
+{
+    uint64_t read = STK_LOAD_ACQUIRE(&ring->readIndex);
+    uint64_t write = STK_LOAD_ACQUIRE(&ring->writeIndex);
+
+    return ring->frameCount - (uint32_t)(write - read);
+}
+
+size_t STKRingBufferPlaneStride(STKRingBuffer* ring)
+{
+    return (size_t)ring->frameCount * ring->bytesPerFrame;
+}
+
+uint32_t STKRingBufferBeginWrite(STKRingBuffer* ring, void** region)
+{
+    // Flushed frames only become free once the consumer has moved past them as it may be copying them right now
+
+    uint64_t write = STK_LOAD_RELAXED(&ring->writeIndex);
+    uint64_t read = STK_LOAD_ACQUIRE(&ring->readIndex);
+    uint32_t offset = (uint32_t)(write % ring->frameCount);
+    uint32_t available = ring->frameCount - (uint32_t)(write - read);
+    uint32_t contiguous = ring->frameCount - offset;
+
+    *region = ring->buffer + ((size_t)offset * ring->bytesPerFrame);
+
+    return available < contiguous ? available : contiguous;
+}
+
+void STKRingBufferEndWrite(STKRingBuffer* ring, uint32_t frames)
+{
+    uint64_t write = STK_LOAD_RELAXED(&ring->writeIndex);
+
+    STK_STORE_RELEASE(&ring->writeIndex, write + frames);
+}
+
+bool STKRingBufferSyncConsumer(STKRingBuffer* ring)
+{
+    uint64_t read = STK_LOAD_RELAXED(&ring->readIndex);
+
+    return ConsumerReadIndex(ring) != read;
+}
+
+uint32_t STKRingBufferBeginRead(STKRingBuffer* ring, const void** region)
+{
+    uint64_t read = ConsumerReadIndex(ring);
+    uint64_t write = STK_LOAD_ACQUIRE(&ring->writeIndex);
+    uint32_t offset = (uint32_t)(read % ring->frameCount);
+    uint32_t used = (uint32_t)(write - read);
+    uint32_t contiguous = ring->frameCount - offset;
+
+    *region = ring->buffer + ((size_t)offset * ring->bytesPerFrame);
+
+    return used < contiguous ? used : contiguous;
+}
+
+void STKRingBufferEndRead(STKRingBuffer* ring, uint32_t frames)
+{
+    uint64_t read = STK_LOAD_RELAXED(&ring->readIndex);
+
+    STK_STORE_RELEASE(&ring->readIndex, read + frames);
+}
+
+uint32_t STKRingBufferRead(STKRingBuffer* ring, void* const* destinations, uint32_t frames)
+{
+    uint32_t total = 0;
+    size_t planeStride = STKRingBufferPlaneStride(ring);
+
+    while (total < frames)
+    {
+        const void* region;
+        uint32_t available = STKRingBufferBeginRead(ring, &region);
+
+        if (available == 0)
+        {
+            break;
+        }
+
+        uint32_t count = frames - total < available ? frames - total : available;
+
+        if (destinations != NULL)
+        {
+            for (uint32_t plane = 0; plane < ring->planeCount; plane++)
+            {
+                memcpy((uint8_t*)destinations[plane] + ((size_t)total * ring->bytesPerFrame), (const uint8_t*)region + planeStride * plane, (size_t)count * ring->bytesPerFrame);
+            }
+        }
+
+        STKRingBufferEndRead(ring, count);
+
+        total += count;
+    }
+
+    return total;
+}
+
+uint32_t STKRingBufferPeek(STKRingBuffer* ring, uint32_t offset, void* const* destinations, uint32_t frames)
+{
+    uint64_t read = ConsumerReadIndex(ring);
+    uint64_t write = STK_LOAD_ACQUIRE(&ring->writeIndex);
+    size_t planeStride = STKRingBufferPlaneStride(ring);
+
+    if (write <= read + offset)
+    {
+        return 0;
+    }
+
+    uint64_t position = read + offset;
+    uint32_t available = (uint32_t)(write - position);
+    uint32_t total = frames < available ? frames : available;
+    uint32_t copied = 0;
+
+    while (copied < total)
+    {
+        uint32_t index = (uint32_t)((position + copied) % ring->frameCount);
+        uint32_t contiguous = ring->frameCount - index;
+        uint32_t count = total - copied < contiguous ? total - copied : contiguous;
+
+        for (uint32_t plane = 0; plane < ring->planeCount; plane++)
+        {
+            memcpy((uint8_t*)destinations[plane] + ((size_t)copied * ring->bytesPerFrame), ring->buffer + planeStride * plane + ((size_t)index * ring->bytesPerFrame), (size_t)count * ring->bytesPerFrame);
+        }
+
+        copied += count;
+    }
+
+    return total;
+}
@@ -0,0 +1,86 @@
+//
+//  STKRingBuffer.h
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+///
+/// Single-producer/single-consumer lock-free ring buffer of fixed size frames.
+///
+/// The producer (decoding thread) writes directly into contiguous regions returned by STKRingBufferBeginWrite
+/// and publishes them with STKRingBufferEndWrite. The consumer (render thread) does the reverse with
+/// STKRingBufferBeginRead/STKRingBufferEndRead or STKRingBufferRead. Neither side takes a lock or waits.
+///
+/// Indexes are monotonically increasing 64-bit frame counters so the used count is always write - read.
+/// STKRingBufferFlush may be called from any thread and discards everything written so far. The consumer
+/// skips over the flushed frames the next time it reads and only then are they handed back to the producer,
+/// so the producer never writes over frames the consumer may still be copying.
+///
+/// Non-interleaved audio is stored as planeCount planes that share the same indexes. Regions always point
+/// into the first plane; the same region in plane n is STKRingBufferPlaneStride(ring) * n bytes further on.
+///
+typedef struct
+{
+    uint8_t* buffer;
+    uint32_t frameCount;
+    uint32_t bytesPerFrame;
+    uint32_t planeCount;
+
+    uint64_t writeIndex;
+    uint64_t readIndex;
+    uint64_t flushIndex;
+}
+STKRingBuffer;
+
+/// Allocates storage for frameCount frames in each plane. Returns false if the allocation failed.
+bool STKRingBufferInit(STKRingBuffer* ring, uint32_t frameCount, uint32_t bytesPerFrame, uint32_t planeCount);
+/// Frees the storage allocated by STKRingBufferInit
+void STKRingBufferDestroy(STKRingBuffer* ring);
+
+/// Discards all frames written so far (any thread). The space is freed once the consumer next reads
+void STKRingBufferFlush(STKRingBuffer* ring);
+/// Discards all frames written so far and frees the space straight away. Only for callers that know the consumer
+/// isn't reading (e.g. because they hold the lock the consumer reads under)
+void STKRingBufferReset(STKRingBuffer* ring);
+/// The number of frames available to the consumer (any thread, may be stale by the time it returns)
+uint32_t STKRingBufferUsedFrameCount(STKRingBuffer* ring);
+/// The number of frames available to the producer. Flushed frames the consumer hasn't skipped yet aren't free
+/// (any thread, may be stale by the time it returns)
+uint32_t STKRingBufferFreeFrameCount(STKRingBuffer* ring);
+/// The distance in bytes between planes
+size_t STKRingBufferPlaneStride(STKRingBuffer* ring);
+
+/// Returns the number of contiguous frames that can be written at *region (producer only)
+uint32_t STKRingBufferBeginWrite(STKRingBuffer* ring, void** region);
+/// Publishes frames written into the region returned by STKRingBufferBeginWrite (producer only)
+void STKRingBufferEndWrite(STKRingBuffer* ring, uint32_t frames);
+
+/// Skips flushed frames, which hands their space back to the producer, without reading anything. Consumers that
+/// only read when frames are used call this first so a flushed full buffer doesn't leave both sides waiting (consumer only).
+/// Returns true if any frames were skipped
+bool STKRingBufferSyncConsumer(STKRingBuffer* ring);
+/// Returns the number of contiguous frames that can be read from *region (consumer only)
+uint32_t STKRingBufferBeginRead(STKRingBuffer* ring, const void** region);
+/// Releases frames read from the region returned by STKRingBufferBeginRead (consumer only)
+void STKRingBufferEndRead(STKRingBuffer* ring, uint32_t frames);
+/// Copies up to frames frames into destinations (one per plane) handling wrap around.
+/// Frames are discarded if destinations is NULL (consumer only)
+uint32_t STKRingBufferRead(STKRingBuffer* ring, void* const* destinations, uint32_t frames);
+/// Copies up to frames frames starting offset frames after the next frame to be read into destinations
+/// (one per plane) without releasing them (consumer only)
+uint32_t STKRingBufferPeek(STKRingBuffer* ring, uint32_t offset, void* const* destinations, uint32_t frames);
+
+#ifdef __cplusplus
+}
+#endif
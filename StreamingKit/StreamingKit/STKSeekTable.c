@@ -0,0 +1,512 @@
+//
+//  STKSeekTable.c
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#include "STKSeekTable.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define STK_SEEK_TABLE_SCAN_SIZE (2048)
+#define STK_SEEK_TABLE_MAGIC (0x314b5453)
+#define STK_SEEK_TABLE_SERIALIZED_HEADER_SIZE (4 * sizeof(uint32_t))
+
+typedef struct
+{
+    uint32_t version;
+    uint32_t sampleRate;
+    uint32_t samplesPerFrame;
+    uint32_t frameLength;
+    uint32_t sideInfoLength;
+}
+STKMpegFrameHeader;
+
+static uint32_t ReadBigEndian(const uint8_t* bytes, uint32_t size)
+{
+    uint32_t retval = 0;
+
+    for (uint32_t i = 0; i < size; i++)
+    {
+        retval = (retval << 8) | bytes[i];
+    }
+
+    return retval;
+}
+
+/// Parses an MPEG Layer III frame header (the only layer that carries Xing/VBRI headers)
+static bool ParseMpegFrameHeader(const uint8_t* bytes, STKMpegFrameHeader* header)
+{
+    static const uint16_t bitRates[2][15] =
+    {
+        { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 },
+        { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 }
+    };
+    static const uint32_t sampleRates[3] = { 44100, 48000, 32000 };
+
+    if (bytes[0] != 0xff || (bytes[1] & 0xe0) != 0xe0)
+    {
+        return false;
+    }
+
+    uint32_t version = (bytes[1] >> 3) & 3;
+    uint32_t layer = (bytes[1] >> 1) & 3;
+    uint32_t bitRateIndex = bytes[2] >> 4;
+    uint32_t sampleRateIndex = (bytes[2] >> 2) & 3;
+    uint32_t padding = (bytes[2] >> 1) & 1;
+    bool mono = (bytes[3] >> 6) == 3;
+
+    if (version == 1 || layer != 1 || bitRateIndex == 0 || bitRateIndex == 15 || sampleRateIndex == 3)
+    {
+        return false;
+    }
+
+    bool mpeg1 = version == 3;
+    uint32_t bitRate = bitRates[mpeg1 ? 0 : 1][bitRateIndex] * 1000;
+
+    header->version = version;
+    header->sampleRate = sampleRates[sampleRateIndex] >> (mpeg1 ? 0 : (version == 2 ? 1 : 2));
+    header->samplesPerFrame = mpeg1 ? 1152 : 576;
+    header->frameLength = (mpeg1 ? 144 : 72) * bitRate / header->sampleRate + padding;
+    header->sideInfoLength = mpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17);
+
+    return true;
+}
+
+static void ParseVbrHeader(STKSeekTable* table, const uint8_t* frame, uint32_t length, const STKMpegFrameHeader* header, uint64_t frameOffset)
+{
+    uint32_t xingOffset = 4 + header->sideInfoLength;
+
+    if (xingOffset + 8 <= length && (memcmp(frame + xingOffset, "Xing", 4) == 0 || memcmp(frame + xingOffset, "Info", 4) == 0))
+    {
+        uint32_t flags = ReadBigEndian(frame + xingOffset + 4, 4);
+        uint32_t position = xingOffset + 8;
+
+        if ((flags & 1) && position + 4 <= length)
+        {
+            table->headerFrameCount = ReadBigEndian(frame + position, 4);
+            position += 4;
+        }
+
+        if ((flags & 2) && position + 4 <= length)
+        {
+            table->headerByteCount = ReadBigEndian(frame + position, 4);
+            position += 4;
+        }
+
+        if ((flags & 4) && position + 100 <= length)
+        {
+            memcpy(table->xingToc, frame + position, 100);
+            table->hasXingToc = true;
+        }
+
+        table->headerFound = true;
+    }
+    else if (36 + 26 <= length && memcmp(frame + 36, "VBRI", 4) == 0)
+    {
+        const uint8_t* vbri = frame + 36;
+        uint32_t entryCount = ReadBigEndian(vbri + 18, 2);
+        uint32_t scale = ReadBigEndian(vbri + 20, 2);
+        uint32_t entrySize = ReadBigEndian(vbri + 22, 2);
+        uint32_t framesPerEntry = ReadBigEndian(vbri + 24, 2);
+
+        table->headerByteCount = ReadBigEndian(vbri + 10, 4);
+        table->headerFrameCount = ReadBigEndian(vbri + 14, 4);
+
+        if (entrySize >= 1 && entrySize <= 4 && entryCount > 0 && framesPerEntry > 0 && 36 + 26 + entryCount * entrySize <= length)
+        {
+            table->vbriToc = malloc((entryCount + 1) * sizeof(uint32_t));
+
+            if (table->vbriToc)
+            {
+                uint64_t offset = 0;
+
+                table->vbriToc[0] = 0;
+
+                for (uint32_t i = 0; i < entryCount; i++)
+                {
+                    offset += (uint64_t)ReadBigEndian(vbri + 26 + i * entrySize, entrySize) * scale;
+                    table->vbriToc[i + 1] = offset > UINT32_MAX ? UINT32_MAX : (uint32_t)offset;
+                }
+
+                table->vbriTocCount = entryCount + 1;
+                table->vbriFramesPerEntry = framesPerEntry;
+            }
+        }
+
+        table->headerFound = true;
+    }
+
+    if (table->headerFound)
+    {
+        table->headerFrameOffset = frameOffset;
+        table->headerFrameLength = header->frameLength;
+        table->headerSamplesPerFrame = header->samplesPerFrame;
+        table->headerSampleRate = header->sampleRate;
+    }
+}
+
+/// Looks for the first frame in the scan buffer. Returns false if more bytes are needed
+static bool ScanFirstFrame(STKSeekTable* table, bool complete)
+{
+    const uint8_t* bytes = table->scanBuffer;
+    uint32_t length = table->scanLength;
+
+    for (uint32_t i = 0; i + 4 <= length; i++)
+    {
+        STKMpegFrameHeader header, next;
+
+        if (!ParseMpegFrameHeader(bytes + i, &header))
+        {
+            continue;
+        }
+
+        // A frame is only trusted if the next frame follows where it should
+
+        if (i + header.frameLength + 4 > length)
+        {
+            if (!complete)
+            {
+                return false;
+            }
+        }
+        else if (!ParseMpegFrameHeader(bytes + i + header.frameLength, &next) || next.version != header.version || next.sampleRate != header.sampleRate)
+        {
+            continue;
+        }
+
+        ParseVbrHeader(table, bytes + i, length - i < header.frameLength ? length - i : header.frameLength, &header, table->scanStart + i);
+
+        return true;
+    }
+
+    return complete;
+}
+
+static void FinishScan(STKSeekTable* table)
+{
+    free(table->scanBuffer);
+
+    table->scanBuffer = NULL;
+    table->scanLength = 0;
+
+    __atomic_store_n(&table->headerScanned, true, __ATOMIC_RELEASE);
+}
+
+void STKSeekTableInit(STKSeekTable* table, uint32_t packetInterval)
+{
+    memset(table, 0, sizeof(*table));
+
+    table->packetInterval = packetInterval > 0 ? packetInterval : 1;
+    table->cursorPacket = -1;
+}
+
+void STKSeekTableDestroy(STKSeekTable* table)
+{
+    free(table->offsets);
+    free(table->vbriToc);
+    free(table->scanBuffer);
+
+    table->offsets = NULL;
+    table->vbriToc = NULL;
+    table->scanBuffer = NULL;
+    table->count = 0;
+    table->capacity = 0;
+}
+
+void STKSeekTableSetCursor(STKSeekTable* table, int64_t packet, uint64_t byteOffset)
+{
+    table->cursorPacket = packet;
+    table->cursorOffset = byteOffset;
+}
+
+void STKSeekTableSetCursorAtStart(STKSeekTable* table, uint64_t audioDataOffset)
+{
+    if (table->headerFound && table->headerFrameOffset == audioDataOffset)
+    {
+        STKSeekTableSetCursor(table, 0, table->headerFrameLength);
+    }
+    else
+    {
+        STKSeekTableSetCursor(table, 0, 0);
+    }
+}
+
+void STKSeekTableAddPacket(STKSeekTable* table, uint32_t byteSize)
+{
+    if (table->cursorPacket < 0)
+    {
+        return;
+    }
+
+    if (table->cursorPacket % table->packetInterval == 0 && (uint64_t)table->cursorPacket / table->packetInterval == table->count)
+    {
+        if (table->cursorOffset > UINT32_MAX)
+        {
+            table->cursorPacket = -1;
+
+            return;
+        }
+
+        if (table->count == table->capacity)
+        {
+            uint32_t capacity = table->capacity > 0 ? table->capacity * 2 : 256;
+            uint32_t* offsets = realloc(table->offsets, capacity * sizeof(uint32_t));
+
+            if (offsets == NULL)
+            {
+                table->cursorPacket = -1;
+
+                return;
+            }
+
+            table->offsets = offsets;
+            table->capacity = capacity;
+        }
+
+        table->offsets[table->count++] = (uint32_t)table->cursorOffset;
+    }
+
+    table->cursorPacket++;
+    table->cursorOffset += byteSize;
+}
+
+bool STKSeekTableLookup(const STKSeekTable* table, uint64_t packet, uint64_t* packetOut, uint64_t* byteOffsetOut)
+{
+    uint64_t index = packet / table->packetInterval;
+
+    if (index >= table->count)
+    {
+        return false;
+    }
+
+    *packetOut = index * table->packetInterval;
+    *byteOffsetOut = table->offsets[index];
+
+    return true;
+}
+
+void STKSeekTableScanHeader(STKSeekTable* table, const uint8_t* bytes, uint32_t length, uint64_t streamOffset)
+{
+    if (table->headerScanned || length == 0)
+    {
+        return;
+    }
+
+    if (streamOffset == 0)
+    {
+        // The stream is being read again from the start
+
+        table->scanLength = 0;
+        table->scanStart = 0;
+        table->scanNextOffset = 0;
+    }
+    else if (streamOffset != table->scanNextOffset)
+    {
+        FinishScan(table);
+
+        return;
+    }
+
+    table->scanNextOffset += length;
+
+    if (table->scanBuffer == NULL)
+    {
+        table->scanBuffer = malloc(STK_SEEK_TABLE_SCAN_SIZE);
+
+        if (table->scanBuffer == NULL)
+        {
+            FinishScan(table);
+
+            return;
+        }
+    }
+
+    if (streamOffset < 10 && table->scanStart == 0)
+    {
+        // The 10 byte ID3v2 header may be split across reads so it's collected before anything is scanned
+
+        uint32_t headerBytes = length < 10 - streamOffset ? length : 10 - (uint32_t)streamOffset;
+
+        memcpy(table->scanBuffer + streamOffset, bytes, headerBytes);
+
+        if (streamOffset + length < 10)
+        {
+            table->scanLength += length;
+
+            return;
+        }
+
+        const uint8_t* header = table->scanBuffer;
+
+        if (memcmp(header, "ID3", 3) == 0)
+        {
+            uint32_t tagSize = ((uint32_t)(header[6] & 0x7f) << 21) | ((uint32_t)(header[7] & 0x7f) << 14) | ((uint32_t)(header[8] & 0x7f) << 7) | (header[9] & 0x7f);
+
+            table->scanStart = 10 + tagSize + ((header[5] & 0x10) ? 10 : 0);
+            table->scanLength = 0;
+        }
+    }
+
+    if (streamOffset + length <= table->scanStart)
+    {
+        return;
+    }
+
+    uint32_t skip = streamOffset < table->scanStart ? (uint32_t)(table->scanStart - streamOffset) : 0;
+    uint32_t bytesToCopy = length - skip;
+
+    if (bytesToCopy > STK_SEEK_TABLE_SCAN_SIZE - table->scanLength)
+    {
+        bytesToCopy = STK_SEEK_TABLE_SCAN_SIZE - table->scanLength;
+    }
+
+    memcpy(table->scanBuffer + table->scanLength, bytes + skip, bytesToCopy);
+    table->scanLength += bytesToCopy;
+
+    if (ScanFirstFrame(table, table->scanLength == STK_SEEK_TABLE_SCAN_SIZE))
+    {
+        FinishScan(table);
+    }
+}
+
+uint64_t STKSeekTableHeaderFrameCount(const STKSeekTable* table)
+{
+    if (!__atomic_load_n(&table->headerScanned, __ATOMIC_ACQUIRE) || !table->headerFound)
+    {
+        return 0;
+    }
+
+    return table->headerFrameCount;
+}
+
+double STKSeekTableHeaderDuration(const STKSeekTable* table)
+{
+    uint64_t frameCount = STKSeekTableHeaderFrameCount(table);
+
+    if (frameCount == 0 || table->headerSampleRate == 0)
+    {
+        return 0;
+    }
+
+    return (double)frameCount * table->headerSamplesPerFrame / table->headerSampleRate;
+}
+
+bool STKSeekTableEstimateOffset(const STKSeekTable* table, double fraction, uint64_t streamLength, uint64_t* streamOffsetOut)
+{
+    if (!table->headerScanned || !table->headerFound)
+    {
+        return false;
+    }
+
+    fraction = fraction < 0 ? 0 : (fraction > 1 ? 1 : fraction);
+
+    if (table->hasXingToc)
+    {
+        uint64_t byteCount = table->headerByteCount;
+
+        if (byteCount == 0)
+        {
+            byteCount = streamLength > table->headerFrameOffset ? streamLength - table->headerFrameOffset : 0;
+        }
+
+        if (byteCount == 0)
+        {
+            return false;
+        }
+
+        double percent = fraction * 100;
+        uint32_t index = percent >= 99 ? 99 : (uint32_t)percent;
+        double start = table->xingToc[index];
+        double end = index < 99 ? table->xingToc[index + 1] : 256;
+        double position = start + (end - start) * (percent - index);
+
+        *streamOffsetOut = table->headerFrameOffset + (uint64_t)(position / 256 * byteCount);
+
+        return true;
+    }
+
+    if (table->vbriTocCount > 1 && table->headerFrameCount > 0)
+    {
+        double segment = fraction * table->headerFrameCount / table->vbriFramesPerEntry;
+        uint32_t index = segment >= table->vbriTocCount - 2 ? table->vbriTocCount - 2 : (uint32_t)segment;
+        double remainder = segment - index > 1 ? 1 : segment - index;
+        double start = table->vbriToc[index];
+        double end = table->vbriToc[index + 1];
+
+        *streamOffsetOut = table->headerFrameOffset + (uint64_t)(start + (end - start) * remainder);
+
+        return true;
+    }
+
+    return false;
+}
+
+size_t STKSeekTableSerializedSize(const STKSeekTable* table)
+{
+    return STK_SEEK_TABLE_SERIALIZED_HEADER_SIZE + table->count * sizeof(uint32_t);
+}
+
+void STKSeekTableSerialize(const STKSeekTable* table, void* buffer)
+{
+    uint32_t header[4] = { STK_SEEK_TABLE_MAGIC, table->packetInterval, table->count, 0 };
+
+    memcpy(buffer, header, sizeof(header));
+    memcpy((uint8_t*)buffer + sizeof(header), table->offsets, table->count * sizeof(uint32_t));
+}
+
+bool STKSeekTableDeserialize(STKSeekTable* table, const void* buffer, size_t length)
+{
+    uint32_t header[4];
+
+    if (length < sizeof(header))
+    {
+        return false;
+    }
+
+    memcpy(header, buffer, sizeof(header));
+
+    if (header[0] != STK_SEEK_TABLE_MAGIC || header[1] != table->packetInterval || length != sizeof(header) + (size_t)header[2] * sizeof(uint32_t))
+    {
+        return false;
+    }
+
+    uint32_t count = header[2];
+    const uint8_t* source = (const uint8_t*)buffer + sizeof(header);
+    uint32_t previous = 0;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t offset;
+
+        memcpy(&offset, source + i * sizeof(uint32_t), sizeof(offset));
+
+        if (offset < previous)
+        {
+            return false;
+        }
+
+        previous = offset;
+    }
+
+    if (count <= table->count)
+    {
+        return true;
+    }
+
+    uint32_t* offsets = realloc(table->offsets, count * sizeof(uint32_t));
+
+    if (offsets == NULL)
+    {
+        return false;
+    }
+
+    memcpy(offsets, source, count * sizeof(uint32_t));
+
+    table->offsets = offsets;
+    table->count = count;
+    table->capacity = count;
+
+    return true;
+}
@@ -0,0 +1,96 @@
+//
+//  STKSeekTable.h
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+///
+/// Packet to byte offset index for variable bit rate streams.
+///
+/// While a stream is parsed contiguously the byte offset of every packetInterval'th packet is recorded
+/// (relative to the start of the audio data) so later seeks within the parsed range land exactly on a
+/// known packet. Seeks beyond the parsed range can use the Xing/Info or VBRI table of contents when the
+/// stream has one. Tables can be serialized so they survive between sessions.
+///
+/// All functions except STKSeekTableHeaderFrameCount must be called from the thread that parses the stream.
+///
+typedef struct
+{
+    uint32_t packetInterval;
+    uint32_t count;
+    uint32_t capacity;
+    /// Byte offset of packet i * packetInterval relative to the start of the audio data
+    uint32_t* offsets;
+
+    /// Next packet expected from the parser and its byte offset or -1 if the position is unknown
+    int64_t cursorPacket;
+    uint64_t cursorOffset;
+
+    /// Xing/Info or VBRI header state
+    bool headerScanned;
+    bool headerFound;
+    uint64_t headerFrameOffset;
+    uint32_t headerFrameLength;
+    uint32_t headerSamplesPerFrame;
+    uint32_t headerSampleRate;
+    uint64_t headerFrameCount;
+    uint64_t headerByteCount;
+    bool hasXingToc;
+    uint8_t xingToc[100];
+    /// VBRI segment start offsets relative to the header frame
+    uint32_t vbriTocCount;
+    uint32_t vbriFramesPerEntry;
+    uint32_t* vbriToc;
+
+    /// Bytes collected while looking for the header (freed once the header has been scanned)
+    uint8_t* scanBuffer;
+    uint32_t scanLength;
+    uint64_t scanStart;
+    uint64_t scanNextOffset;
+}
+STKSeekTable;
+
+void STKSeekTableInit(STKSeekTable* table, uint32_t packetInterval);
+void STKSeekTableDestroy(STKSeekTable* table);
+
+/// Sets the packet the parser will produce next and its byte offset relative to the start of the audio data.
+/// Pass a packet of -1 when the position is unknown (e.g. after an estimated seek) to stop recording
+void STKSeekTableSetCursor(STKSeekTable* table, int64_t packet, uint64_t byteOffset);
+/// Positions the cursor at the first packet of the stream, after the Xing/VBRI frame if the parser skips it
+void STKSeekTableSetCursorAtStart(STKSeekTable* table, uint64_t audioDataOffset);
+/// Records the next packet produced by the parser
+void STKSeekTableAddPacket(STKSeekTable* table, uint32_t byteSize);
+
+/// Finds the closest recorded packet at or before packet. Returns false if packet is past the recorded range
+bool STKSeekTableLookup(const STKSeekTable* table, uint64_t packet, uint64_t* packetOut, uint64_t* byteOffsetOut);
+
+/// Scans bytes read from the stream for an ID3v2 tag followed by an MPEG frame carrying a Xing/Info or VBRI
+/// header. streamOffset is the offset of bytes within the whole stream. Scanning stops at the first MPEG frame
+void STKSeekTableScanHeader(STKSeekTable* table, const uint8_t* bytes, uint32_t length, uint64_t streamOffset);
+/// Number of MPEG frames declared by the Xing/VBRI header or 0 (any thread once the header has been scanned)
+uint64_t STKSeekTableHeaderFrameCount(const STKSeekTable* table);
+/// Duration declared by the Xing/VBRI header in seconds or 0
+double STKSeekTableHeaderDuration(const STKSeekTable* table);
+/// Estimates the stream offset of a position (0 to 1 of the duration) from the Xing/VBRI table of contents.
+/// streamLength is used if the header does not declare the stream size. Returns false if there is no table of contents
+bool STKSeekTableEstimateOffset(const STKSeekTable* table, double fraction, uint64_t streamLength, uint64_t* streamOffsetOut);
+
+size_t STKSeekTableSerializedSize(const STKSeekTable* table);
+void STKSeekTableSerialize(const STKSeekTable* table, void* buffer);
+/// Loads a serialized table if it records more packets than table does. Returns false if the data is invalid
+bool STKSeekTableDeserialize(STKSeekTable* table, const void* buffer, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,247 @@
+//
+//  STKAudioEngineTests.m
+//  StreamingKitTests
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <sys/resource.h>
+#import "STKAudioPlayer.h"
+#import "STKAudioEngine.h"
+#import "STKAudioPlayerStatistics.h"
+#import "STKTestAudioFile.h"
+
+#define STK_TEST_PLAYER_COUNT (8)
+#define STK_TEST_PLAY_SECONDS (3)
+
+@interface STKAudioEngineTests : XCTestCase
+{
+    NSURL* url;
+}
+@end
+
+@implementation STKAudioEngineTests
+
+-(void) setUp
+{
+    [super setUp];
+
+    url = [STKTestAudioFile writeWaveFileWithSamples:[STKTestAudioFile sineWaveSamplesWithFrameCount:44100 * 10 frequency:440]];
+}
+
+-(void) tearDown
+{
+    [[NSFileManager defaultManager] removeItemAtURL:url error:nil];
+
+    [super tearDown];
+}
+
+/// Seconds of processor time used by the process so far
+static double ProcessorSeconds(void)
+{
+    struct rusage usage;
+
+    getrusage(RUSAGE_SELF, &usage);
+
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+/// Runs the current run loop until every player is playing or timeout passes. Returns NO on timeout
+-(BOOL) waitForPlayers:(NSArray<STKAudioPlayer*>*)players timeout:(NSTimeInterval)timeout
+{
+    NSDate* deadline = [NSDate dateWithTimeIntervalSinceNow:timeout];
+
+    while ([deadline timeIntervalSinceNow] > 0)
+    {
+        BOOL playing = YES;
+
+        for (STKAudioPlayer* player in players)
+        {
+            playing = playing && player.state == STKAudioPlayerStatePlaying;
+        }
+
+        if (playing)
+        {
+            return YES;
+        }
+
+        [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.01]];
+    }
+
+    return NO;
+}
+
+-(void) testPlayersAttachUpToTheMaximumInputCount
+{
+    STKAudioEngine* engine = [[STKAudioEngine alloc] initWithSampleRate:0 maximumInputCount:2];
+    STKAudioPlayerOptions options = { 0 };
+    STKAudioPlayer* first = [[STKAudioPlayer alloc] initWithOptions:options engine:engine];
+    STKAudioPlayer* second = [[STKAudioPlayer alloc] initWithOptions:options engine:engine];
+
+    XCTAssertEqual(engine.sampleRate, 44100);
+    XCTAssertEqual(first.engine, engine);
+    XCTAssertEqual(second.engine, engine);
+    XCTAssertEqual(engine.inputCount, 2);
+
+    // Players that don't fit get an audio graph of their own
+
+    STKAudioPlayer* third = [[STKAudioPlayer alloc] initWithOptions:options engine:engine];
+
+    XCTAssertNil(third.engine);
+    XCTAssertEqual(engine.inputCount, 2);
+
+    [first dispose];
+    first = nil;
+
+    XCTAssertEqual(engine.inputCount, 1);
+
+    STKAudioPlayer* fourth = [[STKAudioPlayer alloc] initWithOptions:options engine:engine];
+
+    XCTAssertEqual(fourth.engine, engine);
+
+    [second dispose];
+    [third dispose];
+    [fourth dispose];
+}
+
+-(void) testOfflinePlayersDontAttach
+{
+    STKAudioEngine* engine = [[STKAudioEngine alloc] init];
+    STKAudioPlayerOptions options = { .offlineRendering = YES };
+    STKAudioPlayer* player = [[STKAudioPlayer alloc] initWithOptions:options engine:engine];
+
+    XCTAssertNil(player.engine);
+    XCTAssertEqual(engine.inputCount, 0);
+
+    [player dispose];
+}
+
+-(void) testPlayersPlayThroughTheEngine
+{
+    STKAudioEngine* engine = [[STKAudioEngine alloc] init];
+    STKAudioPlayer* player = [[STKAudioPlayer alloc] initWithOptions:(STKAudioPlayerOptions){ 0 } engine:engine];
+
+    player.pan = -0.5f;
+
+    [player playURL:url];
+
+    XCTAssertTrue([self waitForPlayers:@[player] timeout:5]);
+    XCTAssertTrue(engine.running);
+    XCTAssertEqual(player.pan, -0.5f);
+
+    [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.5]];
+
+    XCTAssertGreaterThan(player.statistics.framesRendered, 0);
+    XCTAssertGreaterThan(engine.renderDuration.count, 0);
+
+    [player dispose];
+}
+
+-(void) testSeekDiscardsFramesDecodedBeforeIt
+{
+    // Silence with a tone at the end so frames left over from before the seek can be heard on the meter
+
+    NSMutableData* samples = [[NSMutableData alloc] initWithLength:44100 * 20 * sizeof(SInt16) * 2];
+
+    [samples appendData:[STKTestAudioFile sineWaveSamplesWithFrameCount:44100 * 10 frequency:440]];
+
+    NSURL* toneUrl = [STKTestAudioFile writeWaveFileWithSamples:samples];
+    STKAudioEngine* engine = [[STKAudioEngine alloc] init];
+    STKAudioPlayer* player = [[STKAudioPlayer alloc] initWithOptions:(STKAudioPlayerOptions){ 0 } engine:engine];
+
+    player.meteringEnabled = YES;
+
+    [player playURL:toneUrl];
+
+    XCTAssertTrue([self waitForPlayers:@[player] timeout:5]);
+
+    // Lets the decode thread fill the buffer with seconds of silence the seek has to throw away
+
+    [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.5]];
+
+    XCTAssertLessThan([player peakPowerInDecibelsForChannel:0], -50);
+
+    [player seekToTime:25];
+
+    XCTAssertTrue([self waitForPlayers:@[player] timeout:5]);
+
+    [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.5]];
+
+    XCTAssertGreaterThan([player peakPowerInDecibelsForChannel:0], -20);
+    XCTAssertEqualWithAccuracy(player.progress, 25.5, 1);
+
+    [player dispose];
+
+    [[NSFileManager defaultManager] removeItemAtURL:toneUrl error:nil];
+}
+
+/// Plays the same items on players with their own graphs and on players sharing an engine and returns the processor
+/// seconds used per second of playback. renderTime is set to the nanoseconds spent rendering per second of playback
+-(double) processorLoadOfPlayersWithEngine:(STKAudioEngine*)engine renderTime:(double*)renderTime
+{
+    NSMutableArray<STKAudioPlayer*>* players = [[NSMutableArray alloc] init];
+
+    for (int i = 0; i < STK_TEST_PLAYER_COUNT; i++)
+    {
+        STKAudioPlayer* player = [[STKAudioPlayer alloc] initWithOptions:(STKAudioPlayerOptions){ 0 } engine:engine];
+
+        player.volume = 1.0 / STK_TEST_PLAYER_COUNT;
+
+        [player playURL:url];
+        [players addObject:player];
+    }
+
+    XCTAssertTrue([self waitForPlayers:players timeout:10]);
+
+    [engine resetStatistics];
+
+    for (STKAudioPlayer* player in players)
+    {
+        [player resetStatistics];
+    }
+
+    double start = ProcessorSeconds();
+
+    [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:STK_TEST_PLAY_SECONDS]];
+
+    double retval = (ProcessorSeconds() - start) / STK_TEST_PLAY_SECONDS;
+
+    // An engine's histogram covers the whole mix. Players with their own graph each render in a cycle of their own
+
+    double total = engine != nil ? engine.renderDuration.total : 0;
+
+    for (STKAudioPlayer* player in players)
+    {
+        XCTAssertEqual(player.engine, engine);
+
+        if (engine == nil)
+        {
+            total += player.statistics.renderDuration.total;
+        }
+
+        [player dispose];
+    }
+
+    *renderTime = total / STK_TEST_PLAY_SECONDS;
+
+    return retval;
+}
+
+-(void) testEngineCostComparedWithStandalonePlayers
+{
+    double standaloneRenderTime;
+    double engineRenderTime;
+    STKAudioEngine* engine = [[STKAudioEngine alloc] initWithSampleRate:0 maximumInputCount:STK_TEST_PLAYER_COUNT];
+
+    double standaloneLoad = [self processorLoadOfPlayersWithEngine:nil renderTime:&standaloneRenderTime];
+    double engineLoad = [self processorLoadOfPlayersWithEngine:engine renderTime:&engineRenderTime];
+
+    NSLog(@"%d standalone players: %.1f%% processor, %.2fms rendering per second", STK_TEST_PLAYER_COUNT, standaloneLoad * 100, standaloneRenderTime / 1e6);
+    NSLog(@"%d players on an engine: %.1f%% processor, %.2fms rendering per second", STK_TEST_PLAYER_COUNT, engineLoad * 100, engineRenderTime / 1e6);
+
+    XCTAssertGreaterThan(engineRenderTime, 0);
+    XCTAssertEqual(engine.inputCount, 0);
+}
+
+@end
@@ -0,0 +1,215 @@
+//
+//  STKBurstDecodingTests.m
+//  StreamingKitTests
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "STKAudioPlayer.h"
+#import "STKAudioPlayerStatistics.h"
+#import "STKTestAudioFile.h"
+
+#define STK_TEST_RENDER_FRAMES (1024)
+#define STK_TEST_SAMPLE_RATE (44100)
+#define STK_TEST_PACED_SECONDS (8)
+
+@interface STKBurstDecodingTests : XCTestCase
+{
+    NSURL* url;
+}
+@end
+
+@implementation STKBurstDecodingTests
+
+-(void) setUp
+{
+    [super setUp];
+
+    url = [STKTestAudioFile writeWaveFileWithSamples:[STKTestAudioFile sineWaveSamplesWithFrameCount:STK_TEST_SAMPLE_RATE * 30 frequency:440]];
+}
+
+-(void) tearDown
+{
+    [[NSFileManager defaultManager] removeItemAtURL:url error:nil];
+
+    [super tearDown];
+}
+
+/// An offline player with a 2 second buffer that refills from below a quarter of it to three quarters
+-(STKAudioPlayer*) createPlayerWithBurstDecoding:(BOOL)burstDecoding
+{
+    STKAudioPlayerOptions options = { .offlineRendering = YES, .bufferSizeInSeconds = 2, .burstDecoding = burstDecoding, .burstLowWatermark = 0.25, .burstHighWatermark = 0.75 };
+
+    return [[STKAudioPlayer alloc] initWithOptions:options];
+}
+
+-(UInt32) renderChunkOfPlayer:(STKAudioPlayer*)player
+{
+    SInt16 samples[STK_TEST_RENDER_FRAMES * 2];
+    AudioBufferList bufferList = { .mNumberBuffers = 1, .mBuffers[0] = { 2, sizeof(samples), samples } };
+
+    return [player renderFrames:&bufferList count:STK_TEST_RENDER_FRAMES];
+}
+
+/// Renders until the PCM buffer is below fillLevel. The decoder must stay idle above fillLevel or this may not end
+-(void) renderPlayer:(STKAudioPlayer*)player untilFillBelow:(double)fillLevel
+{
+    while (player.statistics.bufferFillLevel >= fillLevel)
+    {
+        XCTAssertEqual([self renderChunkOfPlayer:player], STK_TEST_RENDER_FRAMES);
+    }
+}
+
+/// Waits for the decoder to fill the PCM buffer to at least fillLevel. Returns NO on timeout
+-(BOOL) waitForPlayer:(STKAudioPlayer*)player toFillTo:(double)fillLevel timeout:(NSTimeInterval)timeout
+{
+    NSDate* deadline = [NSDate dateWithTimeIntervalSinceNow:timeout];
+
+    while (player.statistics.bufferFillLevel < fillLevel)
+    {
+        if ([deadline timeIntervalSinceNow] < 0)
+        {
+            return NO;
+        }
+
+        [NSThread sleepForTimeInterval:0.01];
+    }
+
+    return YES;
+}
+
+/// Starts playing and renders once so the player is playing with its decoder idle at the high watermark or above
+-(STKAudioPlayer*) startPlayerWithBurstDecoding:(BOOL)burstDecoding
+{
+    STKAudioPlayer* player = [self createPlayerWithBurstDecoding:burstDecoding];
+
+    [player playURL:url];
+
+    XCTAssertEqual([self renderChunkOfPlayer:player], STK_TEST_RENDER_FRAMES);
+    XCTAssertTrue([self waitForPlayer:player toFillTo:0.74 timeout:5]);
+
+    [NSThread sleepForTimeInterval:0.2];
+
+    return player;
+}
+
+-(void) testDecodingWaitsForTheLowWatermarkAndRefillsToTheHighWatermark
+{
+    STKAudioPlayer* player = [self startPlayerWithBurstDecoding:YES];
+
+    // Below half of the buffer (where the decoder would refill without burstDecoding) but above the low watermark
+
+    [self renderPlayer:player untilFillBelow:0.4];
+
+    double fillLevel = player.statistics.bufferFillLevel;
+    UInt64 decodeWakeups = player.statistics.decodeThreadWakeupCount;
+
+    [NSThread sleepForTimeInterval:0.3];
+
+    XCTAssertEqual(player.statistics.bufferFillLevel, fillLevel);
+    XCTAssertEqual(player.statistics.decodeThreadWakeupCount, decodeWakeups);
+
+    // Crossing the low watermark wakes the decoder and it refills up to the high watermark and no further
+
+    UInt64 bytesRead = player.statistics.bytesRead;
+
+    [self renderPlayer:player untilFillBelow:0.25];
+
+    XCTAssertTrue([self waitForPlayer:player toFillTo:0.74 timeout:5]);
+
+    [NSThread sleepForTimeInterval:0.2];
+
+    XCTAssertLessThanOrEqual(player.statistics.bufferFillLevel, 0.751);
+    XCTAssertGreaterThan(player.statistics.decodeThreadWakeupCount, decodeWakeups);
+
+    // The refill didn't drain the packet queue below its low watermark so reading stays paused
+
+    XCTAssertEqual(player.statistics.bytesRead, bytesRead);
+
+    [player dispose];
+}
+
+-(void) testReadingResumesInOneBurstBelowThePacketQueueLowWatermark
+{
+    STKAudioPlayer* player = [self startPlayerWithBurstDecoding:YES];
+    UInt64 bytesRead = player.statistics.bytesRead;
+    UInt64 increase = 0;
+
+    // Each refill takes a second of audio out of the packet queue. Reading waits until it's below a quarter full
+
+    for (int refill = 0; refill < 10 && increase == 0; refill++)
+    {
+        [self renderPlayer:player untilFillBelow:0.25];
+
+        XCTAssertTrue([self waitForPlayer:player toFillTo:0.74 timeout:5]);
+
+        [NSThread sleepForTimeInterval:0.2];
+
+        increase = player.statistics.bytesRead - bytesRead;
+    }
+
+    // Enough to fill most of the 512KB queue again rather than a read or two
+
+    XCTAssertGreaterThan(increase, 256 * 1024);
+
+    [player dispose];
+}
+
+-(void) testDecodingRefillsFromHalfWithoutBurstDecoding
+{
+    STKAudioPlayer* player = [self startPlayerWithBurstDecoding:NO];
+    UInt64 bytesRead = player.statistics.bytesRead;
+
+    // The render that takes the buffer below half wakes the decoder, which tops it up right away. Reading resumes as
+    // soon as the packet queue has room for a large read
+
+    [self renderPlayer:player untilFillBelow:0.5];
+
+    XCTAssertTrue([self waitForPlayer:player toFillTo:0.98 timeout:5]);
+
+    [NSThread sleepForTimeInterval:0.2];
+
+    XCTAssertGreaterThan(player.statistics.bytesRead, bytesRead);
+
+    [player dispose];
+}
+
+/// Renders at real time as an output device would and returns the wakeups per minute of the playback and decode threads
+-(double) wakeupsPerMinuteWithBurstDecoding:(BOOL)burstDecoding
+{
+    STKAudioPlayer* player = [self startPlayerWithBurstDecoding:burstDecoding];
+    NSDate* start = [NSDate date];
+    UInt64 framesRendered = 0;
+
+    [player resetStatistics];
+
+    while (framesRendered < STK_TEST_SAMPLE_RATE * STK_TEST_PACED_SECONDS)
+    {
+        framesRendered += [self renderChunkOfPlayer:player];
+
+        [NSThread sleepUntilDate:[start dateByAddingTimeInterval:(double)framesRendered / STK_TEST_SAMPLE_RATE]];
+    }
+
+    STKAudioPlayerStatistics* statistics = player.statistics;
+
+    XCTAssertEqual(statistics.framesZeroFilled, 0);
+
+    NSLog(@"burstDecoding %@: %.1f wakeups per minute (%llu playback, %llu decode), %llu reads", burstDecoding ? @"on" : @"off", statistics.wakeupsPerMinute, statistics.playbackThreadWakeupCount, statistics.decodeThreadWakeupCount, statistics.readCallCount);
+
+    [player dispose];
+
+    return statistics.wakeupsPerMinute;
+}
+
+-(void) testWakeupsPerMinuteWithAndWithoutBurstDecoding
+{
+    double continuous = [self wakeupsPerMinuteWithBurstDecoding:NO];
+    double burst = [self wakeupsPerMinuteWithBurstDecoding:YES];
+
+    NSLog(@"burstDecoding wakes the threads %.1fx less often", burst > 0 ? continuous / burst : 0);
+
+    XCTAssertLessThan(burst, continuous);
+}
+
+@end
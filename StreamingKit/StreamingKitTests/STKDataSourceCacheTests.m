@@ -0,0 +1,254 @@
+//
+//  STKDataSourceCacheTests.m
+//  StreamingKitTests
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "STKDataSourceCache.h"
+#import "STKCachingDataSource.h"
+#import "STKHTTPDataSource.h"
+#import "STKTestHTTPServer.h"
+#import "STKTestDataSourceReader.h"
+
+@interface STKDataSourceCacheTests : XCTestCase
+{
+    NSURL* directoryUrl;
+    STKTestHTTPServer* server;
+}
+@end
+
+@implementation STKDataSourceCacheTests
+
+-(void) setUp
+{
+    [super setUp];
+
+    directoryUrl = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:[NSString stringWithFormat:@"STKDataSourceCacheTests-%@", [NSUUID UUID].UUIDString]]];
+}
+
+-(void) tearDown
+{
+    [server stop];
+
+    [[NSFileManager defaultManager] removeItemAtURL:directoryUrl error:nil];
+
+    [super tearDown];
+}
+
+-(NSData*) randomDataWithLength:(NSUInteger)length
+{
+    NSMutableData* data = [NSMutableData dataWithLength:length];
+
+    arc4random_buf(data.mutableBytes, length);
+
+    return data;
+}
+
+/// Opens the item for key, fills it and closes it again
+-(void) storeItemWithKey:(NSString*)key length:(SInt64)length inCache:(STKDataSourceCache*)cache
+{
+    NSData* data = [self randomDataWithLength:(NSUInteger)length];
+    STKDataSourceCacheItem* item = [cache openItemWithKey:key length:length];
+
+    XCTAssertNotNil(item);
+
+    [cache writeToItem:item bytes:data.bytes length:(int)data.length atOffset:0];
+    [cache closeItem:item];
+}
+
+-(BOOL) cache:(STKDataSourceCache*)cache containsKey:(NSString*)key
+{
+    STKDataSourceCacheItem* item = [cache openItemWithKey:key length:0];
+
+    if (item == nil)
+    {
+        return NO;
+    }
+
+    [cache closeItem:item];
+
+    return YES;
+}
+
+-(void) testReadsBackWrittenRanges
+{
+    STKDataSourceCache* cache = [[STKDataSourceCache alloc] initWithDirectoryUrl:directoryUrl maximumSizeInBytes:1024 * 1024];
+    NSData* data = [self randomDataWithLength:10000];
+    UInt8 buffer[10000];
+
+    STKDataSourceCacheItem* item = [cache openItemWithKey:@"a" length:10000];
+
+    [cache writeToItem:item bytes:data.bytes length:1000 atOffset:0];
+    [cache writeToItem:item bytes:(const UInt8*)data.bytes + 5000 length:2000 atOffset:5000];
+
+    XCTAssertEqual([cache item:item cachedLengthAtOffset:0], 1000);
+    XCTAssertEqual([cache item:item cachedLengthAtOffset:1000], 0);
+    XCTAssertEqual([cache item:item nextCachedOffsetAfterOffset:1000], 5000);
+    XCTAssertEqual([cache item:item nextCachedOffsetAfterOffset:5000], 10000);
+    XCTAssertEqual(cache.sizeInBytes, 3000);
+
+    XCTAssertEqual([cache readFromItem:item intoBuffer:buffer atOffset:5500 withSize:10000], 1500);
+    XCTAssertEqual(memcmp(buffer, (const UInt8*)data.bytes + 5500, 1500), 0);
+    XCTAssertEqual([cache readFromItem:item intoBuffer:buffer atOffset:2000 withSize:100], 0);
+
+    [cache closeItem:item];
+}
+
+-(void) testEvictsLeastRecentlyUsedItems
+{
+    STKDataSourceCache* cache = [[STKDataSourceCache alloc] initWithDirectoryUrl:directoryUrl maximumSizeInBytes:3000];
+
+    [self storeItemWithKey:@"a" length:1000 inCache:cache];
+    [self storeItemWithKey:@"b" length:1000 inCache:cache];
+    [self storeItemWithKey:@"c" length:1000 inCache:cache];
+
+    // Opening a makes b the least recently used
+
+    XCTAssertTrue([self cache:cache containsKey:@"a"]);
+
+    [self storeItemWithKey:@"d" length:1000 inCache:cache];
+
+    XCTAssertFalse([self cache:cache containsKey:@"b"]);
+    XCTAssertTrue([self cache:cache containsKey:@"a"]);
+    XCTAssertTrue([self cache:cache containsKey:@"c"]);
+    XCTAssertTrue([self cache:cache containsKey:@"d"]);
+    XCTAssertEqual(cache.sizeInBytes, 3000);
+}
+
+-(void) testDoesNotEvictOpenItems
+{
+    STKDataSourceCache* cache = [[STKDataSourceCache alloc] initWithDirectoryUrl:directoryUrl maximumSizeInBytes:1000];
+    NSData* data = [self randomDataWithLength:1000];
+
+    STKDataSourceCacheItem* a = [cache openItemWithKey:@"a" length:1000];
+    STKDataSourceCacheItem* b = [cache openItemWithKey:@"b" length:1000];
+
+    [cache writeToItem:a bytes:data.bytes length:1000 atOffset:0];
+    [cache writeToItem:b bytes:data.bytes length:1000 atOffset:0];
+
+    XCTAssertEqual(cache.sizeInBytes, 2000);
+
+    // a is evicted as soon as it is closed
+
+    [cache closeItem:a];
+
+    XCTAssertEqual(cache.sizeInBytes, 1000);
+    XCTAssertEqual([cache item:b cachedLengthAtOffset:0], 1000);
+
+    [cache closeItem:b];
+
+    XCTAssertFalse([self cache:cache containsKey:@"a"]);
+    XCTAssertTrue([self cache:cache containsKey:@"b"]);
+}
+
+-(void) testIndexSurvivesReopening
+{
+    @autoreleasepool
+    {
+        STKDataSourceCache* cache = [[STKDataSourceCache alloc] initWithDirectoryUrl:directoryUrl maximumSizeInBytes:3000];
+
+        // Access times are all that order the items once they are reloaded so they mustn't tie
+
+        for (NSString* key in @[ @"a", @"b", @"c" ])
+        {
+            [self storeItemWithKey:key length:1000 inCache:cache];
+            [NSThread sleepForTimeInterval:0.01];
+        }
+
+        XCTAssertTrue([self cache:cache containsKey:@"a"]);
+    }
+
+    STKDataSourceCache* cache = [[STKDataSourceCache alloc] initWithDirectoryUrl:directoryUrl maximumSizeInBytes:3000];
+
+    XCTAssertEqual(cache.sizeInBytes, 3000);
+
+    // The access order is restored so b is still the first to go
+
+    [self storeItemWithKey:@"d" length:1000 inCache:cache];
+
+    XCTAssertFalse([self cache:cache containsKey:@"b"]);
+    XCTAssertTrue([self cache:cache containsKey:@"a"]);
+    XCTAssertTrue([self cache:cache containsKey:@"c"]);
+}
+
+-(void) testCachingDataSourceServesRepeatReadsFromTheCache
+{
+    NSData* data = [self randomDataWithLength:512 * 1024];
+    STKDataSourceCache* cache = [[STKDataSourceCache alloc] initWithDirectoryUrl:directoryUrl maximumSizeInBytes:4 * 1024 * 1024];
+
+    server = [[STKTestHTTPServer alloc] initWithData:data];
+
+    XCTAssertNotNil(server);
+
+    STKCachingDataSource* first = [[STKCachingDataSource alloc] initWithDataSource:[[STKHTTPDataSource alloc] initWithURL:server.url] cache:cache];
+
+    XCTAssertEqualObjects([[[STKTestDataSourceReader alloc] initWithDataSource:first] readFromOffset:0 timeout:10], data);
+
+    [first close];
+
+    NSUInteger requestCount = server.requestCount;
+
+    STKCachingDataSource* second = [[STKCachingDataSource alloc] initWithDataSource:[[STKHTTPDataSource alloc] initWithURL:server.url] cache:cache];
+
+    XCTAssertEqualObjects([[[STKTestDataSourceReader alloc] initWithDataSource:second] readFromOffset:0 timeout:10], data);
+    XCTAssertEqual(server.requestCount, requestCount);
+    XCTAssertEqual(cache.hitByteCount, data.length);
+
+    [second close];
+}
+
+-(void) testCachingDataSourceOnlyFetchesGaps
+{
+    NSData* data = [self randomDataWithLength:512 * 1024];
+    STKDataSourceCache* cache = [[STKDataSourceCache alloc] initWithDirectoryUrl:directoryUrl maximumSizeInBytes:4 * 1024 * 1024];
+
+    server = [[STKTestHTTPServer alloc] initWithData:data];
+
+    XCTAssertNotNil(server);
+
+    // The start is read (so the server is known to accept ranges), then the second half and then the whole stream
+
+    STKCachingDataSource* dataSource = [[STKCachingDataSource alloc] initWithDataSource:[[STKHTTPDataSource alloc] initWithURL:server.url] cache:cache];
+    STKTestDataSourceReader* reader = [[STKTestDataSourceReader alloc] initWithDataSource:dataSource];
+
+    XCTAssertEqualObjects([reader readFromOffset:0 length:64 * 1024 timeout:10], [data subdataWithRange:NSMakeRange(0, 64 * 1024)]);
+    XCTAssertEqualObjects([reader readFromOffset:256 * 1024 timeout:10], [data subdataWithRange:NSMakeRange(256 * 1024, 256 * 1024)]);
+    XCTAssertEqualObjects([reader readFromOffset:0 timeout:10], data);
+
+    // Every byte came from the server exactly once
+
+    XCTAssertEqual(cache.missByteCount, data.length);
+    XCTAssertEqual(cache.hitByteCount, 64 * 1024 + 256 * 1024);
+    XCTAssertEqual(cache.sizeInBytes, data.length);
+
+    [dataSource close];
+}
+
+-(void) testWritePerformanceWhileOverBudget
+{
+    STKDataSourceCache* cache = [[STKDataSourceCache alloc] initWithDirectoryUrl:directoryUrl maximumSizeInBytes:1000 * 1024];
+    NSData* data = [self randomDataWithLength:4096];
+
+    for (int i = 0; i < 1000; i++)
+    {
+        [self storeItemWithKey:[NSString stringWithFormat:@"%d", i] length:1024 inCache:cache];
+    }
+
+    // Writes to a stream bigger than the budget shouldn't rescan the other items each time
+
+    STKDataSourceCacheItem* item = [cache openItemWithKey:@"large" length:64 * 1024 * 1024];
+
+    [self measureBlock:^
+    {
+        for (SInt64 offset = 0; offset < 64 * 1024 * 1024; offset += data.length)
+        {
+            [cache writeToItem:item bytes:data.bytes length:(int)data.length atOffset:offset];
+        }
+    }];
+
+    [cache closeItem:item];
+}
+
+@end
@@ -0,0 +1,126 @@
+//
+//  STKDelegateDispatcherTests.m
+//  StreamingKitTests
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "STKDelegateDispatcher.h"
+
+@interface STKDelegateDispatcherTests : XCTestCase
+@end
+
+@implementation STKDelegateDispatcherTests
+{
+    dispatch_queue_t queue;
+    NSMutableArray<NSString*>* delivered;
+}
+
+-(void) setUp
+{
+    queue = dispatch_queue_create("STKDelegateDispatcherTests", DISPATCH_QUEUE_SERIAL);
+    delivered = [[NSMutableArray alloc] init];
+
+    // Held until the test has dispatched everything so the callbacks pile up as if the delegate had fallen behind
+
+    dispatch_suspend(queue);
+}
+
+-(NSArray<NSString*>*) deliver
+{
+    dispatch_resume(queue);
+    dispatch_sync(queue, ^{});
+
+    return delivered;
+}
+
+-(void) dispatch:(NSString*)name with:(STKDelegateDispatcher*)dispatcher
+{
+    [dispatcher dispatch:^
+    {
+        [self->delivered addObject:name];
+    }];
+}
+
+-(void) dispatchState:(STKAudioPlayerState)state from:(STKAudioPlayerState)previousState with:(STKDelegateDispatcher*)dispatcher
+{
+    [dispatcher dispatchStateChange:state previousState:previousState handler:^(STKAudioPlayerState state, STKAudioPlayerState previousState)
+    {
+        [self->delivered addObject:[NSString stringWithFormat:@"%ld->%ld", (long)previousState, (long)state]];
+    }];
+}
+
+-(void) testDeliversInOrderAndMergesStateChanges
+{
+    STKDelegateDispatcher* dispatcher = [[STKDelegateDispatcher alloc] initWithQueue:queue limit:16];
+    NSString* readyToBuffering = [NSString stringWithFormat:@"%ld->%ld", (long)STKAudioPlayerStateReady, (long)STKAudioPlayerStateBuffering];
+    NSString* bufferingToPaused = [NSString stringWithFormat:@"%ld->%ld", (long)STKAudioPlayerStateBuffering, (long)STKAudioPlayerStatePaused];
+
+    [self dispatchState:STKAudioPlayerStateBuffering from:STKAudioPlayerStateReady with:dispatcher];
+    [self dispatch:@"started" with:dispatcher];
+
+    // Changes straight after one another reach the delegate as one
+
+    [self dispatchState:STKAudioPlayerStatePlaying from:STKAudioPlayerStateBuffering with:dispatcher];
+    [self dispatchState:STKAudioPlayerStatePaused from:STKAudioPlayerStatePlaying with:dispatcher];
+    [self dispatch:@"finished" with:dispatcher];
+
+    // Changes that end where they started aren't delivered at all
+
+    [self dispatchState:STKAudioPlayerStatePlaying from:STKAudioPlayerStatePaused with:dispatcher];
+    [self dispatchState:STKAudioPlayerStatePaused from:STKAudioPlayerStatePlaying with:dispatcher];
+
+    NSArray* expected = @[readyToBuffering, @"started", bufferingToPaused, @"finished"];
+
+    XCTAssertEqualObjects([self deliver], expected);
+}
+
+-(void) testOnlyDroppableCallbacksAreDropped
+{
+    STKDelegateDispatcher* dispatcher = [[STKDelegateDispatcher alloc] initWithQueue:queue limit:4];
+    NSMutableArray* expected = [[NSMutableArray alloc] init];
+    int dropped = 0;
+
+    for (int i = 0; i < 100; i++)
+    {
+        NSString* name = [NSString stringWithFormat:@"metadata %d", i];
+
+        if ([dispatcher dispatchDroppable:^{ [self->delivered addObject:name]; }])
+        {
+            [expected addObject:name];
+        }
+        else
+        {
+            dropped++;
+        }
+
+        name = [NSString stringWithFormat:@"finished %d", i];
+
+        [self dispatch:name with:dispatcher];
+        [expected addObject:name];
+    }
+
+    XCTAssertEqual(dropped, 98);
+    XCTAssertEqualObjects([self deliver], expected);
+
+    // Room is made once the delegate catches up
+
+    XCTAssertTrue([dispatcher dispatchDroppable:^{}]);
+}
+
+-(void) testStateChangesAreNeverDropped
+{
+    STKDelegateDispatcher* dispatcher = [[STKDelegateDispatcher alloc] initWithQueue:queue limit:1];
+
+    [self dispatch:@"started" with:dispatcher];
+    [self dispatchState:STKAudioPlayerStateBuffering from:STKAudioPlayerStatePlaying with:dispatcher];
+    [self dispatch:@"error" with:dispatcher];
+    [self dispatchState:STKAudioPlayerStateError from:STKAudioPlayerStateBuffering with:dispatcher];
+
+    NSArray* expected = @[@"started", [NSString stringWithFormat:@"%ld->%ld", (long)STKAudioPlayerStatePlaying, (long)STKAudioPlayerStateBuffering], @"error", [NSString stringWithFormat:@"%ld->%ld", (long)STKAudioPlayerStateBuffering, (long)STKAudioPlayerStateError]];
+
+    XCTAssertEqualObjects([self deliver], expected);
+}
+
+@end
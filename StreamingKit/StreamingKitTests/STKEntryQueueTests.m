@@ -0,0 +1,227 @@
+//
+//  STKEntryQueueTests.m
+//  StreamingKitTests
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "STKEntryQueue.h"
+#import "STKDataSource.h"
+
+#define STK_TEST_BENCHMARK_ENTRY_COUNT (10000)
+
+@interface STKEntryQueueTests : XCTestCase
+@end
+
+@implementation STKEntryQueueTests
+
+static STKQueueEntry* CreateEntry(NSObject* queueItemId)
+{
+    return [[STKQueueEntry alloc] initWithDataSource:[[STKDataSource alloc] init] andQueueItemId:queueItemId];
+}
+
+static NSArray<STKQueueEntry*>* EntriesOfQueue(STKEntryQueue* queue, NSEnumerationOptions options)
+{
+    NSMutableArray* retval = [[NSMutableArray alloc] init];
+
+    [queue enumerateEntriesWithOptions:options usingBlock:^(STKQueueEntry* entry, BOOL* stop)
+    {
+        [retval addObject:entry];
+    }];
+
+    return retval;
+}
+
+/// Checks the queue holds the entries of model in the same order when enumerated both ways
+-(void) checkQueue:(STKEntryQueue*)queue matches:(NSArray<STKQueueEntry*>*)model
+{
+    XCTAssertEqual(queue.count, model.count);
+    XCTAssertEqualObjects(EntriesOfQueue(queue, 0), model);
+    XCTAssertEqualObjects(EntriesOfQueue(queue, NSEnumerationReverse), model.reverseObjectEnumerator.allObjects);
+    XCTAssertEqual(queue.peek, model.firstObject);
+    XCTAssertEqual(queue.peekLast, model.lastObject);
+}
+
+-(void) testOrder
+{
+    STKEntryQueue* queue = [[STKEntryQueue alloc] init];
+    STKQueueEntry* a = CreateEntry(@"a");
+    STKQueueEntry* b = CreateEntry(@"b");
+    STKQueueEntry* c = CreateEntry(@"c");
+
+    XCTAssertNil([queue dequeue]);
+    XCTAssertNil(queue.peek);
+
+    [queue enqueue:a];
+    [queue enqueue:b];
+    [queue skipQueue:c];
+
+    [self checkQueue:queue matches:@[c, a, b]];
+
+    XCTAssertEqual([queue dequeue], c);
+    XCTAssertEqual([queue dequeue], a);
+    XCTAssertEqual([queue dequeue], b);
+    XCTAssertNil([queue dequeue]);
+    XCTAssertEqual(queue.count, 0);
+}
+
+-(void) testSkipQueueWithQueue
+{
+    STKEntryQueue* queue = [[STKEntryQueue alloc] init];
+    STKEntryQueue* other = [[STKEntryQueue alloc] init];
+    STKQueueEntry* a = CreateEntry(@"a");
+    STKQueueEntry* b = CreateEntry(@"b");
+    STKQueueEntry* c = CreateEntry(@"c");
+
+    [queue enqueue:a];
+    [other enqueue:b];
+    [other enqueue:c];
+
+    uint64_t version = queue.version;
+
+    [queue skipQueueWithQueue:other];
+
+    [self checkQueue:queue matches:@[b, c, a]];
+    [self checkQueue:other matches:@[]];
+
+    XCTAssertNotEqual(queue.version, version);
+
+    // The moved entries can still be found by queue item id
+
+    XCTAssertEqual([queue removeEntryWithQueueItemId:@"c"], c);
+    XCTAssertNil([other removeEntryWithQueueItemId:@"b"]);
+
+    [self checkQueue:queue matches:@[b, a]];
+}
+
+-(void) testRemoveByQueueItemId
+{
+    STKEntryQueue* queue = [[STKEntryQueue alloc] init];
+    STKQueueEntry* first = CreateEntry(@"same");
+    STKQueueEntry* other = CreateEntry(@"other");
+    STKQueueEntry* second = CreateEntry([@"same" mutableCopy]);
+
+    [queue enqueue:first];
+    [queue enqueue:other];
+    [queue enqueue:second];
+
+    // Ids are compared with isEqual: and the oldest goes first
+
+    XCTAssertEqual([queue removeEntryWithQueueItemId:@"same"], first);
+    XCTAssertEqual([queue removeEntryWithQueueItemId:@"same"], second);
+    XCTAssertNil([queue removeEntryWithQueueItemId:@"same"]);
+    XCTAssertNil([queue removeEntryWithQueueItemId:@"missing"]);
+
+    [self checkQueue:queue matches:@[other]];
+
+    // Removed entries can be queued again
+
+    [queue enqueue:first];
+    [queue removeAllEntries];
+
+    [self checkQueue:queue matches:@[]];
+
+    [queue enqueue:first];
+
+    [self checkQueue:queue matches:@[first]];
+}
+
+-(void) testRandomOperationsMatchAnArray
+{
+    STKEntryQueue* queue = [[STKEntryQueue alloc] init];
+    NSMutableArray<STKQueueEntry*>* model = [[NSMutableArray alloc] init];
+    uint32_t nextId = 0;
+
+    srandom(7);
+
+    for (int i = 0; i < 5000; i++)
+    {
+        uint64_t version = queue.version;
+        NSUInteger count = model.count;
+        long operation = random() % 5;
+
+        if (operation == 0 || operation == 1)
+        {
+            STKQueueEntry* entry = CreateEntry(@(nextId++ % 50));
+
+            [queue enqueue:entry];
+            [model addObject:entry];
+        }
+        else if (operation == 2)
+        {
+            STKQueueEntry* entry = CreateEntry(@(nextId++ % 50));
+
+            [queue skipQueue:entry];
+            [model insertObject:entry atIndex:0];
+        }
+        else if (operation == 3)
+        {
+            XCTAssertEqual([queue dequeue], model.firstObject);
+
+            if (model.count > 0)
+            {
+                [model removeObjectAtIndex:0];
+            }
+        }
+        else
+        {
+            NSNumber* queueItemId = @(random() % 50);
+            NSUInteger index = [model indexOfObjectPassingTest:^BOOL(STKQueueEntry* entry, NSUInteger index, BOOL* stop)
+            {
+                return [entry.queueItemId isEqual:queueItemId];
+            }];
+
+            STKQueueEntry* removed = [queue removeEntryWithQueueItemId:queueItemId];
+
+            if (index == NSNotFound)
+            {
+                XCTAssertNil(removed);
+            }
+            else
+            {
+                XCTAssertEqual(removed, model[index]);
+
+                [model removeObjectAtIndex:index];
+            }
+        }
+
+        // Every operation here adds or removes an entry if it changes the queue at all
+
+        XCTAssertEqual(queue.version != version, model.count != count);
+
+        [self checkQueue:queue matches:model];
+    }
+}
+
+/// Queues 10,000 entries and removes them by queue item id from the middle out, which the arrays it replaced did in O(n)
+-(void) testRemovalPerformance
+{
+    NSMutableArray<STKQueueEntry*>* entries = [[NSMutableArray alloc] initWithCapacity:STK_TEST_BENCHMARK_ENTRY_COUNT];
+
+    for (int i = 0; i < STK_TEST_BENCHMARK_ENTRY_COUNT; i++)
+    {
+        [entries addObject:CreateEntry(@(i))];
+    }
+
+    [self measureBlock:^
+    {
+        STKEntryQueue* queue = [[STKEntryQueue alloc] init];
+
+        for (STKQueueEntry* entry in entries)
+        {
+            [queue enqueue:entry];
+        }
+
+        for (int i = 0; i < STK_TEST_BENCHMARK_ENTRY_COUNT; i++)
+        {
+            int index = STK_TEST_BENCHMARK_ENTRY_COUNT / 2 + (i % 2 ? -(i + 1) / 2 : i / 2);
+
+            XCTAssertNotNil([queue removeEntryWithQueueItemId:@(index)]);
+        }
+
+        XCTAssertEqual(queue.count, 0);
+    }];
+}
+
+@end
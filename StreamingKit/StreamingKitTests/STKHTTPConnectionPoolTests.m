@@ -0,0 +1,171 @@
+//
+//  STKHTTPConnectionPoolTests.m
+//  StreamingKitTests
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "STKHTTPConnectionPool.h"
+#import "STKHTTPDataSource.h"
+#import "STKTestHTTPServer.h"
+#import "STKTestDataSourceReader.h"
+
+@interface STKHTTPConnectionPoolTests : XCTestCase
+{
+    NSData* data;
+    STKTestHTTPServer* server;
+    STKHTTPConnectionPool* pool;
+}
+@end
+
+@implementation STKHTTPConnectionPoolTests
+
+-(void) setUp
+{
+    [super setUp];
+
+    NSMutableData* randomData = [NSMutableData dataWithLength:1024 * 1024];
+
+    arc4random_buf(randomData.mutableBytes, randomData.length);
+
+    data = randomData;
+    server = [[STKTestHTTPServer alloc] initWithData:data];
+
+    // A private pool so requests made by other tests don't count
+
+    pool = [[STKHTTPConnectionPool alloc] init];
+    pool.rangeRequestSize = 128 * 1024;
+}
+
+-(void) tearDown
+{
+    [server stop];
+
+    [super tearDown];
+}
+
+-(STKHTTPDataSource*) createDataSource
+{
+    STKHTTPDataSource* dataSource = [[STKHTTPDataSource alloc] initWithURL:server.url];
+
+    dataSource.connectionPool = pool;
+
+    return dataSource;
+}
+
+/// Reads the whole stream through a new data source on the test pool
+-(NSData*) readStream
+{
+    STKHTTPDataSource* dataSource = [self createDataSource];
+    NSData* retval = [[[STKTestDataSourceReader alloc] initWithDataSource:dataSource] readFromOffset:0 timeout:10];
+
+    [dataSource close];
+
+    return retval;
+}
+
+-(void) testDefaultsToBoundedRanges
+{
+    XCTAssertEqual([[STKHTTPConnectionPool alloc] init].rangeRequestSize, 1024 * 1024);
+}
+
+-(void) testRangesReuseOneConnection
+{
+    XCTAssertNotNil(server);
+
+    XCTAssertEqualObjects([self readStream], data);
+    XCTAssertEqual(server.requestCount, 8);
+    XCTAssertEqual(server.connectionCount, 1);
+    XCTAssertEqual([pool requestCountForHost:server.url.host], 8);
+}
+
+-(void) testConsecutiveStreamsReuseTheConnection
+{
+    XCTAssertNotNil(server);
+
+    pool.rangeRequestSize = data.length;
+
+    XCTAssertEqualObjects([self readStream], data);
+    XCTAssertEqualObjects([self readStream], data);
+    XCTAssertEqual(server.requestCount, 2);
+    XCTAssertEqual(server.connectionCount, 1);
+}
+
+-(void) testSeekReadsTheRestOfTheStream
+{
+    XCTAssertNotNil(server);
+
+    STKHTTPDataSource* dataSource = [self createDataSource];
+    STKTestDataSourceReader* reader = [[STKTestDataSourceReader alloc] initWithDataSource:dataSource];
+
+    // Streams can only seek once a response has said the server accepts ranges
+
+    XCTAssertEqualObjects([reader readFromOffset:0 length:1000 timeout:10], [data subdataWithRange:NSMakeRange(0, 1000)]);
+    XCTAssertEqualObjects([reader readFromOffset:300 * 1024 timeout:10], [data subdataWithRange:NSMakeRange(300 * 1024, data.length - 300 * 1024)]);
+
+    [dataSource close];
+}
+
+-(void) testServerThatIgnoresRangesIsAskedOnce
+{
+    XCTAssertNotNil(server);
+
+    server.ignoresRanges = YES;
+
+    XCTAssertEqualObjects([self readStream], data);
+    XCTAssertEqual(server.requestCount, 1);
+}
+
+-(void) testRangesOfUnknownTotalLength
+{
+    XCTAssertNotNil(server);
+
+    server.hidesLength = YES;
+
+    STKHTTPDataSource* dataSource = [self createDataSource];
+
+    // Ranges are asked for until one comes back past the end (the file is a whole number of ranges)
+
+    XCTAssertEqualObjects([[[STKTestDataSourceReader alloc] initWithDataSource:dataSource] readFromOffset:0 timeout:10], data);
+    XCTAssertEqual(dataSource.length, (SInt64)data.length);
+    XCTAssertEqual(server.requestCount, 9);
+    XCTAssertEqual(server.connectionCount, 1);
+
+    [dataSource close];
+}
+
+-(void) testShortRangeOfUnknownTotalLengthEndsTheStream
+{
+    NSData* shortData = [data subdataWithRange:NSMakeRange(0, 300 * 1024 + 17)];
+    STKTestHTTPServer* shortServer = [[STKTestHTTPServer alloc] initWithData:shortData];
+
+    XCTAssertNotNil(shortServer);
+
+    shortServer.hidesLength = YES;
+
+    STKHTTPDataSource* dataSource = [[STKHTTPDataSource alloc] initWithURL:shortServer.url];
+
+    dataSource.connectionPool = pool;
+
+    XCTAssertEqualObjects([[[STKTestDataSourceReader alloc] initWithDataSource:dataSource] readFromOffset:0 timeout:10], shortData);
+    XCTAssertEqual(shortServer.requestCount, 3);
+
+    [dataSource close];
+    [shortServer stop];
+}
+
+-(void) testServerThatClosesConnections
+{
+    XCTAssertNotNil(server);
+
+    // The counts tell reuse apart from a new connection per request
+
+    server.closesConnections = YES;
+
+    XCTAssertEqualObjects([self readStream], data);
+    XCTAssertEqual(server.requestCount, 8);
+    XCTAssertEqual(server.connectionCount, 8);
+}
+
+@end
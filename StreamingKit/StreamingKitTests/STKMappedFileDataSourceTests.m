@@ -0,0 +1,237 @@
+//
+//  STKMappedFileDataSourceTests.m
+//  StreamingKitTests
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "STKMappedFileDataSource.h"
+#import "STKLocalFileDataSource.h"
+#import "STKAudioPlayer.h"
+#include <unistd.h>
+
+#define STK_TEST_READ_SIZE (64 * 1024)
+#define STK_TEST_BENCHMARK_FILE_SIZE (32 * 1024 * 1024)
+
+@interface STKMappedFileDataSourceTests : XCTestCase<STKDataSourceDelegate>
+@end
+
+@implementation STKMappedFileDataSourceTests
+{
+    NSString* filePath;
+    NSMutableData* readData;
+    /// Truncates the file to this size once this much has been read (0 to leave it alone)
+    SInt64 truncateAt;
+    int dataAvailableCount;
+    int readErrorCount;
+    BOOL finished;
+    BOOL failed;
+}
+
+-(void) setUp
+{
+    filePath = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSString stringWithFormat:@"%@.mp3", [NSUUID UUID].UUIDString]];
+    readData = [[NSMutableData alloc] init];
+}
+
+-(void) tearDown
+{
+    [[NSFileManager defaultManager] removeItemAtPath:filePath error:NULL];
+}
+
+-(NSData*) writeFileWithLength:(NSUInteger)length
+{
+    NSMutableData* data = [[NSMutableData alloc] initWithLength:length];
+    UInt8* bytes = data.mutableBytes;
+
+    for (NSUInteger i = 0; i < length; i++)
+    {
+        bytes[i] = (UInt8)(i * 31 + i / 4096);
+    }
+
+    [data writeToFile:filePath atomically:NO];
+
+    return data;
+}
+
+-(void) dataSourceDataAvailable:(STKDataSource*)dataSource
+{
+    const UInt8* bytes;
+
+    dataAvailableCount++;
+
+    if (truncateAt > 0 && (SInt64)readData.length >= truncateAt)
+    {
+        truncate(filePath.fileSystemRepresentation, truncateAt);
+
+        truncateAt = 0;
+    }
+
+    int read = [dataSource readBytesNoCopy:&bytes withSize:STK_TEST_READ_SIZE];
+
+    if (read > 0)
+    {
+        [readData appendBytes:bytes length:read];
+    }
+    else if (read < 0)
+    {
+        // As the player does
+
+        readErrorCount++;
+
+        [dataSource seekToOffset:dataSource.position];
+    }
+}
+
+-(void) dataSourceErrorOccured:(STKDataSource*)dataSource
+{
+    failed = YES;
+}
+
+-(void) dataSourceEof:(STKDataSource*)dataSource
+{
+    finished = YES;
+}
+
+-(void) dataSource:(STKDataSource*)dataSource didReadStreamMetadata:(NSDictionary*)metadata
+{
+}
+
+/// Seeks to offset and handles events on the current run loop until the data source ends or fails
+-(void) readAll:(STKDataSource*)dataSource from:(SInt64)offset
+{
+    NSDate* timeout = [NSDate dateWithTimeIntervalSinceNow:10];
+
+    dataSource.delegate = self;
+
+    [dataSource registerForEvents:[NSRunLoop currentRunLoop]];
+    [dataSource seekToOffset:offset];
+
+    while (!finished && !failed && [timeout timeIntervalSinceNow] > 0)
+    {
+        [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:timeout];
+    }
+
+    [dataSource unregisterForEvents];
+}
+
+-(void) testReadsTheFileWithOneEventPerRead
+{
+    NSData* expected = [self writeFileWithLength:5 * 1024 * 1024 + 123];
+    STKMappedFileDataSource* dataSource = [[STKMappedFileDataSource alloc] initWithFilePath:filePath];
+
+    [self readAll:dataSource from:0];
+
+    XCTAssertTrue(finished);
+    XCTAssertFalse(failed);
+    XCTAssertEqualObjects(readData, expected);
+    XCTAssertEqual(dataSource.length, (SInt64)expected.length);
+    XCTAssertEqual(dataAvailableCount, (int)((expected.length + STK_TEST_READ_SIZE - 1) / STK_TEST_READ_SIZE));
+    XCTAssertEqual(dataSource.audioFileTypeHint, kAudioFileMP3Type);
+}
+
+-(void) testSeeksPastTheStart
+{
+    NSData* expected = [self writeFileWithLength:300000];
+    STKMappedFileDataSource* dataSource = [[STKMappedFileDataSource alloc] initWithFilePath:filePath];
+
+    [self readAll:dataSource from:100000];
+
+    XCTAssertTrue(finished);
+    XCTAssertEqualObjects(readData, [expected subdataWithRange:NSMakeRange(100000, 200000)]);
+}
+
+-(void) testTruncatedFileEndsInsteadOfCrashing
+{
+    NSData* expected = [self writeFileWithLength:8 * 1024 * 1024];
+    STKMappedFileDataSource* dataSource = [[STKMappedFileDataSource alloc] initWithFilePath:filePath];
+
+    // Truncated to the reading position between two reads
+
+    truncateAt = 1024 * 1024;
+
+    [self readAll:dataSource from:0];
+
+    XCTAssertTrue(finished);
+    XCTAssertFalse(failed);
+    XCTAssertEqual(readErrorCount, 1);
+    XCTAssertEqual(dataSource.length, 1024 * 1024);
+    XCTAssertEqualObjects([readData subdataWithRange:NSMakeRange(0, 1024 * 1024)], [expected subdataWithRange:NSMakeRange(0, 1024 * 1024)]);
+}
+
+-(void) testMissingFileFails
+{
+    STKMappedFileDataSource* dataSource = [[STKMappedFileDataSource alloc] initWithFilePath:[filePath stringByAppendingString:@".missing"]];
+
+    [self readAll:dataSource from:0];
+
+    XCTAssertTrue(failed);
+    XCTAssertFalse(dataSource.hasBytesAvailable);
+}
+
+-(void) testFileURLsAreOnlyMappedWhenAskedFor
+{
+    NSURL* url = [NSURL fileURLWithPath:filePath];
+
+    XCTAssertTrue([[STKAudioPlayer dataSourceFromURL:url] isKindOfClass:[STKLocalFileDataSource class]]);
+}
+
+/// Reads a 32MB file in 64KB reads through the mapping and touches every cache line as a parser would
+-(void) testMappedReadPerformance
+{
+    [self writeFileWithLength:STK_TEST_BENCHMARK_FILE_SIZE];
+
+    [self measureBlock:^
+    {
+        STKMappedFileDataSource* dataSource = [[STKMappedFileDataSource alloc] initWithFilePath:self->filePath];
+        const UInt8* bytes;
+        UInt64 sum = 0;
+        int read;
+
+        [dataSource seekToOffset:0];
+
+        while ((read = [dataSource readBytesNoCopy:&bytes withSize:STK_TEST_READ_SIZE]) > 0)
+        {
+            for (int i = 0; i < read; i += 64)
+            {
+                sum += bytes[i];
+            }
+        }
+
+        XCTAssertEqual(dataSource.position, STK_TEST_BENCHMARK_FILE_SIZE);
+        XCTAssertNotEqual(sum, 0);
+    }];
+}
+
+/// The same reads copied out of the file stream STKLocalFileDataSource reads through
+-(void) testStreamReadPerformance
+{
+    [self writeFileWithLength:STK_TEST_BENCHMARK_FILE_SIZE];
+
+    [self measureBlock:^
+    {
+        STKLocalFileDataSource* dataSource = [[STKLocalFileDataSource alloc] initWithFilePath:self->filePath];
+        UInt8* buffer = malloc(STK_TEST_READ_SIZE);
+        UInt64 sum = 0;
+        int read;
+
+        [dataSource seekToOffset:0];
+
+        while ((read = [dataSource readIntoBuffer:buffer withSize:STK_TEST_READ_SIZE]) > 0)
+        {
+            for (int i = 0; i < read; i += 64)
+            {
+                sum += buffer[i];
+            }
+        }
+
+        free(buffer);
+        [dataSource close];
+
+        XCTAssertEqual(dataSource.position, STK_TEST_BENCHMARK_FILE_SIZE);
+        XCTAssertNotEqual(sum, 0);
+    }];
+}
+
+@end
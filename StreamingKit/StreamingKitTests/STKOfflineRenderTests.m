@@ -0,0 +1,217 @@
+//
+//  STKOfflineRenderTests.m
+//  StreamingKitTests
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "STKAudioPlayer.h"
+#import "STKAudioPlayerStatistics.h"
+#import "STKTestAudioFile.h"
+
+#define STK_TEST_RENDER_FRAMES (1024)
+
+@interface STKOfflineRenderTests : XCTestCase
+{
+    NSMutableArray<NSURL*>* files;
+}
+@end
+
+@implementation STKOfflineRenderTests
+
+-(void) setUp
+{
+    [super setUp];
+
+    files = [[NSMutableArray alloc] init];
+}
+
+-(void) tearDown
+{
+    for (NSURL* url in files)
+    {
+        [[NSFileManager defaultManager] removeItemAtURL:url error:nil];
+    }
+
+    [super tearDown];
+}
+
+-(STKAudioPlayer*) createPlayer
+{
+    STKAudioPlayerOptions options = { .offlineRendering = YES };
+
+    return [[STKAudioPlayer alloc] initWithOptions:options];
+}
+
+-(NSURL*) writeFileWithSamples:(NSData*)samples
+{
+    NSURL* url = [STKTestAudioFile writeWaveFileWithSamples:samples];
+
+    [files addObject:url];
+
+    return url;
+}
+
+/// Pulls frames from the player until it has nothing left to play and returns them
+-(NSData*) renderAllFramesOfPlayer:(STKAudioPlayer*)player
+{
+    NSMutableData* retval = [[NSMutableData alloc] init];
+    SInt16 samples[STK_TEST_RENDER_FRAMES * 2];
+    AudioBufferList bufferList;
+
+    while (true)
+    {
+        bufferList.mNumberBuffers = 1;
+        bufferList.mBuffers[0].mNumberChannels = 2;
+        bufferList.mBuffers[0].mDataByteSize = sizeof(samples);
+        bufferList.mBuffers[0].mData = samples;
+
+        UInt32 frameCount = [player renderFrames:&bufferList count:STK_TEST_RENDER_FRAMES];
+
+        if (frameCount == 0)
+        {
+            break;
+        }
+
+        [retval appendBytes:samples length:frameCount * sizeof(SInt16) * 2];
+    }
+
+    return retval;
+}
+
+-(void) testRendersEveryFrame
+{
+    NSData* samples = [STKTestAudioFile sineWaveSamplesWithFrameCount:44100 * 3 + 123 frequency:440];
+    STKAudioPlayer* player = [self createPlayer];
+
+    [player playURL:[self writeFileWithSamples:samples]];
+
+    NSData* rendered = [self renderAllFramesOfPlayer:player];
+
+    XCTAssertEqual(rendered.length, samples.length);
+    XCTAssertEqualObjects(rendered, samples);
+    XCTAssertEqual(player.statistics.framesRendered, samples.length / 4);
+    XCTAssertGreaterThan(player.statistics.offlineRenderSpeed, 1);
+
+    [player dispose];
+}
+
+-(void) testRendersQueuedItemsBackToBack
+{
+    NSData* first = [STKTestAudioFile sineWaveSamplesWithFrameCount:44100 frequency:440];
+    NSData* second = [STKTestAudioFile sineWaveSamplesWithFrameCount:44100 / 2 frequency:1000];
+    NSMutableData* expected = [first mutableCopy];
+    STKAudioPlayer* player = [self createPlayer];
+
+    [expected appendData:second];
+
+    [player playURL:[self writeFileWithSamples:first]];
+    [player queueURL:[self writeFileWithSamples:second]];
+
+    XCTAssertEqualObjects([self renderAllFramesOfPlayer:player], expected);
+
+    [player dispose];
+}
+
+-(void) testRendersNothingWhenStopped
+{
+    STKAudioPlayer* player = [self createPlayer];
+    SInt16 samples[STK_TEST_RENDER_FRAMES * 2];
+    AudioBufferList bufferList = { .mNumberBuffers = 1, .mBuffers[0] = { 2, sizeof(samples), samples } };
+
+    XCTAssertEqual([player renderFrames:&bufferList count:STK_TEST_RENDER_FRAMES], 0);
+
+    [player playURL:[self writeFileWithSamples:[STKTestAudioFile sineWaveSamplesWithFrameCount:44100 * 10 frequency:440]]];
+
+    XCTAssertEqual([player renderFrames:&bufferList count:STK_TEST_RENDER_FRAMES], STK_TEST_RENDER_FRAMES);
+
+    [player stop];
+
+    XCTAssertEqual([player renderFrames:&bufferList count:STK_TEST_RENDER_FRAMES], 0);
+
+    [player dispose];
+}
+
+/// Interleaved stereo Int16 samples that hold their own frame index (low 15 bits on the left, the rest on the right)
+-(NSData*) countingSamplesWithFrameCount:(UInt32)frameCount
+{
+    NSMutableData* retval = [[NSMutableData alloc] initWithLength:frameCount * sizeof(SInt16) * 2];
+    SInt16* samples = retval.mutableBytes;
+
+    for (UInt32 i = 0; i < frameCount; i++)
+    {
+        samples[i * 2] = (SInt16)(i & 0x7fff);
+        samples[i * 2 + 1] = (SInt16)(i >> 15);
+    }
+
+    return retval;
+}
+
+-(void) testSeekDiscardsFramesDecodedBeforeIt
+{
+    UInt32 frameCount = 44100 * 10;
+    UInt32 seekFrame = 44100 * 8;
+    STKAudioPlayer* player = [self createPlayer];
+    SInt16 samples[STK_TEST_RENDER_FRAMES * 2];
+    AudioBufferList bufferList = { .mNumberBuffers = 1, .mBuffers[0] = { 2, sizeof(samples), samples } };
+
+    [player playURL:[self writeFileWithSamples:[self countingSamplesWithFrameCount:frameCount]]];
+
+    XCTAssertEqual([player renderFrames:&bufferList count:STK_TEST_RENDER_FRAMES], STK_TEST_RENDER_FRAMES);
+
+    // Lets the decode thread fill the buffer with frames the seek has to throw away
+
+    [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.5]];
+
+    [player seekToTime:(double)seekFrame / 44100];
+
+    [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.5]];
+
+    NSData* rendered = [self renderAllFramesOfPlayer:player];
+    const SInt16* renderedSamples = rendered.bytes;
+    UInt32 renderedFrameCount = (UInt32)(rendered.length / (sizeof(SInt16) * 2));
+
+    XCTAssertGreaterThan(renderedFrameCount, 0);
+
+    UInt32 first = (UInt16)renderedSamples[0] | ((UInt32)renderedSamples[1] << 15);
+
+    XCTAssertEqualWithAccuracy((double)first, (double)seekFrame, 4410);
+
+    for (UInt32 i = 1; i < renderedFrameCount; i++)
+    {
+        UInt32 index = (UInt16)renderedSamples[i * 2] | ((UInt32)renderedSamples[i * 2 + 1] << 15);
+
+        if (index != first + i)
+        {
+            XCTFail(@"Frame %u is %u instead of %u", i, index, first + i);
+
+            break;
+        }
+    }
+
+    XCTAssertEqual(first + renderedFrameCount, frameCount);
+
+    [player dispose];
+}
+
+/// Renders a minute of audio. The decode thread signals once per queued chunk so the time includes the cost of waking the caller
+-(void) testOfflineRenderPerformance
+{
+    NSURL* url = [self writeFileWithSamples:[STKTestAudioFile sineWaveSamplesWithFrameCount:44100 * 60 frequency:440]];
+
+    [self measureBlock:^
+    {
+        STKAudioPlayer* player = [self createPlayer];
+
+        [player playURL:url];
+
+        XCTAssertEqual([self renderAllFramesOfPlayer:player].length, 44100 * 60 * 4);
+
+        NSLog(@"Offline render speed %.0fx real time", player.statistics.offlineRenderSpeed);
+
+        [player dispose];
+    }];
+}
+
+@end
@@ -0,0 +1,172 @@
+//
+//  STKRenderContentionTests.m
+//  StreamingKitTests
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "STKAudioPlayer.h"
+#import "STKAudioPlayerStatistics.h"
+#import "STKLocalFileDataSource.h"
+#import "STKTestAudioFile.h"
+
+#define STK_TEST_ITEM_COUNT (40)
+#define STK_TEST_SEEK_DELAY_MICROSECONDS (20000)
+#define STK_TEST_RENDER_FRAMES (512)
+
+/// A local file that takes a while to open. The player opens the next item's data source with the player mutex held
+/// so each track boundary keeps the playback thread on the mutex for STK_TEST_SEEK_DELAY_MICROSECONDS
+@interface STKTestSlowSeekingDataSource : STKLocalFileDataSource
+@end
+
+@implementation STKTestSlowSeekingDataSource
+
+-(void) seekToOffset:(SInt64)offset
+{
+    usleep(STK_TEST_SEEK_DELAY_MICROSECONDS);
+
+    [super seekToOffset:offset];
+}
+
+@end
+
+@interface STKRenderContentionTests : XCTestCase<STKAudioPlayerDelegate>
+{
+    NSMutableArray<NSURL*>* files;
+    NSMutableArray<NSObject*>* finishedItems;
+}
+@end
+
+@implementation STKRenderContentionTests
+
+-(void) setUp
+{
+    [super setUp];
+
+    files = [[NSMutableArray alloc] init];
+    finishedItems = [[NSMutableArray alloc] init];
+}
+
+-(void) tearDown
+{
+    for (NSURL* url in files)
+    {
+        [[NSFileManager defaultManager] removeItemAtURL:url error:nil];
+    }
+
+    [super tearDown];
+}
+
+-(void) audioPlayer:(STKAudioPlayer*)audioPlayer didStartPlayingQueueItemId:(NSObject*)queueItemId
+{
+}
+
+-(void) audioPlayer:(STKAudioPlayer*)audioPlayer didFinishBufferingSourceWithQueueItemId:(NSObject*)queueItemId
+{
+}
+
+-(void) audioPlayer:(STKAudioPlayer*)audioPlayer stateChanged:(STKAudioPlayerState)state previousState:(STKAudioPlayerState)previousState
+{
+}
+
+-(void) audioPlayer:(STKAudioPlayer*)audioPlayer didFinishPlayingQueueItemId:(NSObject*)queueItemId withReason:(STKAudioPlayerStopReason)stopReason andProgress:(double)progress andDuration:(double)duration
+{
+    @synchronized (finishedItems)
+    {
+        if (stopReason == STKAudioPlayerStopReasonEof)
+        {
+            [finishedItems addObject:queueItemId];
+        }
+    }
+}
+
+-(void) audioPlayer:(STKAudioPlayer*)audioPlayer unexpectedError:(STKAudioPlayerErrorCode)errorCode
+{
+    XCTFail(@"Unexpected error %d", (int)errorCode);
+}
+
+/// Plays many short items back to back while each track boundary holds the player mutex. The render path (pulled here
+/// with renderFrames:count:, which runs the same code as the render callback) must count every frame of every item
+/// and never wait for the mutex
+-(void) testTrackBoundariesDontBlockRendering
+{
+    STKAudioPlayerOptions options = { .offlineRendering = YES };
+    STKAudioPlayer* player = [[STKAudioPlayer alloc] initWithOptions:options];
+    NSMutableArray<NSObject*>* queueItemIds = [[NSMutableArray alloc] init];
+    UInt64 expectedFrameCount = 0;
+
+    player.delegate = self;
+    player.delegateQueue = dispatch_queue_create("STKRenderContentionTests", DISPATCH_QUEUE_SERIAL);
+
+    for (int i = 0; i < STK_TEST_ITEM_COUNT; i++)
+    {
+        UInt32 frameCount = 4410 + arc4random_uniform(8820);
+        NSURL* url = [STKTestAudioFile writeWaveFileWithSamples:[STKTestAudioFile sineWaveSamplesWithFrameCount:frameCount frequency:220 + i * 10]];
+        NSObject* queueItemId = @(i);
+
+        [files addObject:url];
+        [queueItemIds addObject:queueItemId];
+
+        STKDataSource* dataSource = [[STKTestSlowSeekingDataSource alloc] initWithFilePath:url.path];
+
+        // Playing the first item straight away means renderFrames:count: waits for it rather than returning 0
+
+        if (i == 0)
+        {
+            [player playDataSource:dataSource withQueueItemID:queueItemId];
+        }
+        else
+        {
+            [player queueDataSource:dataSource withQueueItemId:queueItemId];
+        }
+
+        expectedFrameCount += frameCount;
+    }
+
+    SInt16 samples[STK_TEST_RENDER_FRAMES * 2];
+    AudioBufferList bufferList = { .mNumberBuffers = 1, .mBuffers[0] = { 2, sizeof(samples), samples } };
+    UInt64 renderedFrameCount = 0;
+    UInt32 frameCount;
+
+    while ((frameCount = [player renderFrames:&bufferList count:STK_TEST_RENDER_FRAMES]) > 0)
+    {
+        renderedFrameCount += frameCount;
+    }
+
+    STKAudioPlayerStatistics* statistics = player.statistics;
+
+    NSLog(@"Render duration: mean %.0fns, 99th percentile %lluns, maximum %lluns", statistics.renderDuration.mean, [statistics.renderDuration valueAtPercentile:99], statistics.renderDuration.maximum);
+
+    XCTAssertEqual(renderedFrameCount, expectedFrameCount);
+
+    // Rendering never waited out a track boundary
+
+    XCTAssertLessThan(statistics.renderDuration.maximum, STK_TEST_SEEK_DELAY_MICROSECONDS * 1000 / 4);
+
+    // The playback thread finished every item from the events the render path queued
+
+    NSDate* deadline = [NSDate dateWithTimeIntervalSinceNow:5];
+
+    while ([deadline timeIntervalSinceNow] > 0)
+    {
+        @synchronized (finishedItems)
+        {
+            if (finishedItems.count >= STK_TEST_ITEM_COUNT)
+            {
+                break;
+            }
+        }
+
+        [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.01]];
+    }
+
+    @synchronized (finishedItems)
+    {
+        XCTAssertEqualObjects(finishedItems, queueItemIds);
+    }
+
+    [player dispose];
+}
+
+@end
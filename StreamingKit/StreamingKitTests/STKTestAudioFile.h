@@ -0,0 +1,23 @@
+//
+//  STKTestAudioFile.h
+//  StreamingKitTests
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Writes audio files for tests in the player's default PCM format (44.1kHz interleaved stereo Int16) so the frames a
+/// player renders can be compared with the samples that were written
+@interface STKTestAudioFile : NSObject
+
+/// Interleaved stereo Int16 samples of a sine wave at frequency (the right channel is inverted)
++(NSData*) sineWaveSamplesWithFrameCount:(UInt32)frameCount frequency:(double)frequency;
+/// Writes samples to a new WAVE file in the temporary directory and returns its URL
++(NSURL*) writeWaveFileWithSamples:(NSData*)samples;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,71 @@
+//
+//  STKTestAudioFile.m
+//  StreamingKitTests
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import "STKTestAudioFile.h"
+
+#define STK_TEST_AUDIO_FILE_SAMPLE_RATE (44100)
+#define STK_TEST_AUDIO_FILE_CHANNELS (2)
+
+static void AppendUInt32(NSMutableData* data, UInt32 value)
+{
+    value = CFSwapInt32HostToLittle(value);
+
+    [data appendBytes:&value length:sizeof(value)];
+}
+
+static void AppendUInt16(NSMutableData* data, UInt16 value)
+{
+    value = CFSwapInt16HostToLittle(value);
+
+    [data appendBytes:&value length:sizeof(value)];
+}
+
+@implementation STKTestAudioFile
+
++(NSData*) sineWaveSamplesWithFrameCount:(UInt32)frameCount frequency:(double)frequency
+{
+    NSMutableData* retval = [NSMutableData dataWithLength:frameCount * STK_TEST_AUDIO_FILE_CHANNELS * sizeof(SInt16)];
+    SInt16* samples = retval.mutableBytes;
+
+    for (UInt32 i = 0; i < frameCount; i++)
+    {
+        SInt16 value = (SInt16)lrint(sin(2 * M_PI * frequency * i / STK_TEST_AUDIO_FILE_SAMPLE_RATE) * 16384);
+
+        samples[i * 2] = value;
+        samples[i * 2 + 1] = -value;
+    }
+
+    return retval;
+}
+
++(NSURL*) writeWaveFileWithSamples:(NSData*)samples
+{
+    NSMutableData* data = [[NSMutableData alloc] initWithCapacity:44 + samples.length];
+    UInt32 bytesPerFrame = STK_TEST_AUDIO_FILE_CHANNELS * sizeof(SInt16);
+
+    [data appendBytes:"RIFF" length:4];
+    AppendUInt32(data, (UInt32)(36 + samples.length));
+    [data appendBytes:"WAVEfmt " length:8];
+    AppendUInt32(data, 16);
+    AppendUInt16(data, 1);
+    AppendUInt16(data, STK_TEST_AUDIO_FILE_CHANNELS);
+    AppendUInt32(data, STK_TEST_AUDIO_FILE_SAMPLE_RATE);
+    AppendUInt32(data, STK_TEST_AUDIO_FILE_SAMPLE_RATE * bytesPerFrame);
+    AppendUInt16(data, bytesPerFrame);
+    AppendUInt16(data, 16);
+    [data appendBytes:"data" length:4];
+    AppendUInt32(data, (UInt32)samples.length);
+    [data appendData:samples];
+
+    NSURL* url = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:[NSString stringWithFormat:@"%@.wav", [NSUUID UUID].UUIDString]]];
+
+    [data writeToURL:url atomically:YES];
+
+    return url;
+}
+
+@end
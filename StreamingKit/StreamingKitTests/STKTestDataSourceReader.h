@@ -0,0 +1,26 @@
+//
+//  STKTestDataSourceReader.h
+//  StreamingKitTests
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import "STKDataSource.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Reads a data source on the current thread's run loop the way the player does: one read per data available event
+@interface STKTestDataSourceReader : NSObject<STKDataSourceDelegate>
+
+@property (readonly) STKDataSource* dataSource;
+
+-(instancetype) initWithDataSource:(STKDataSource*)dataSource;
+
+/// Seeks to offset and reads until the end of the stream. Returns nil if the data source failed or timeout passed first
+-(nullable NSData*) readFromOffset:(SInt64)offset timeout:(NSTimeInterval)timeout;
+/// Seeks to offset and reads until length bytes have been read or the stream ends
+-(nullable NSData*) readFromOffset:(SInt64)offset length:(SInt64)length timeout:(NSTimeInterval)timeout;
+
+@end
+
+NS_ASSUME_NONNULL_END
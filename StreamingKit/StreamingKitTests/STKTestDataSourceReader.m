@@ -0,0 +1,114 @@
+//
+//  STKTestDataSourceReader.m
+//  StreamingKitTests
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import "STKTestDataSourceReader.h"
+
+@interface STKTestDataSourceReader()
+{
+    BOOL finished;
+    BOOL failed;
+    SInt64 remaining;
+    NSMutableData* bytesRead;
+}
+
+@property (readwrite) STKDataSource* dataSource;
+
+@end
+
+@implementation STKTestDataSourceReader
+
+-(instancetype) initWithDataSource:(STKDataSource*)dataSourceIn
+{
+    if (self = [super init])
+    {
+        self.dataSource = dataSourceIn;
+        self.dataSource.delegate = self;
+    }
+
+    return self;
+}
+
+-(void) dealloc
+{
+    if (self.dataSource.delegate == self)
+    {
+        self.dataSource.delegate = nil;
+    }
+}
+
+-(NSData*) readFromOffset:(SInt64)offset timeout:(NSTimeInterval)timeout
+{
+    return [self readFromOffset:offset length:INT64_MAX timeout:timeout];
+}
+
+-(NSData*) readFromOffset:(SInt64)offset length:(SInt64)length timeout:(NSTimeInterval)timeout
+{
+    NSDate* deadline = [NSDate dateWithTimeIntervalSinceNow:timeout];
+
+    finished = NO;
+    failed = NO;
+    remaining = length;
+    bytesRead = [[NSMutableData alloc] init];
+
+    [self.dataSource registerForEvents:[NSRunLoop currentRunLoop]];
+    [self.dataSource seekToOffset:offset];
+
+    while (!finished && [deadline timeIntervalSinceNow] > 0)
+    {
+        [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:0.01]];
+    }
+
+    [self.dataSource unregisterForEvents];
+
+    return finished && !failed ? bytesRead : nil;
+}
+
+-(void) dataSourceDataAvailable:(STKDataSource*)dataSource
+{
+    UInt8 buffer[64 * 1024];
+
+    if (finished)
+    {
+        return;
+    }
+
+    int read = [dataSource readIntoBuffer:buffer withSize:(int)MIN((SInt64)sizeof(buffer), remaining)];
+
+    if (read < 0)
+    {
+        failed = YES;
+        finished = YES;
+
+        return;
+    }
+
+    [bytesRead appendBytes:buffer length:read];
+
+    remaining -= read;
+
+    if (remaining <= 0)
+    {
+        finished = YES;
+    }
+}
+
+-(void) dataSourceErrorOccured:(STKDataSource*)dataSource
+{
+    failed = YES;
+    finished = YES;
+}
+
+-(void) dataSourceEof:(STKDataSource*)dataSource
+{
+    finished = YES;
+}
+
+-(void) dataSource:(STKDataSource*)dataSource didReadStreamMetadata:(NSDictionary*)metadata
+{
+}
+
+@end
@@ -0,0 +1,38 @@
+//
+//  STKTestHTTPServer.h
+//  StreamingKitTests
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// HTTP/1.1 server on the loopback interface that serves one file for tests.
+/// Supports single Range requests and keep-alive connections and counts the connections and requests it sees
+@interface STKTestHTTPServer : NSObject
+
+/// URL of the served file
+@property (readonly) NSURL* url;
+@property (readonly) NSData* data;
+/// Answer every request with Connection: close (Default is NO)
+@property (readwrite) BOOL closesConnections;
+/// Answer Range requests with the whole file like servers without range support (Default is NO)
+@property (readwrite) BOOL ignoresRanges;
+/// Answer Range requests with an unknown total (Content-Range: bytes 0-1023/*) like live and transcoding servers (Default is NO)
+@property (readwrite) BOOL hidesLength;
+/// Number of TCP connections accepted
+@property (readonly) NSUInteger connectionCount;
+@property (readonly) NSUInteger requestCount;
+/// Number of body bytes written to connections
+@property (readonly) UInt64 bytesSent;
+
+/// Starts listening on an ephemeral port. Returns nil if the socket couldn't be set up
+-(nullable instancetype) initWithData:(NSData*)data;
+/// Closes the listening socket and every open connection
+-(void) stop;
+
+@end
+
+NS_ASSUME_NONNULL_END
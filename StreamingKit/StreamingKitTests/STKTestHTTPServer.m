@@ -0,0 +1,283 @@
+//
+//  STKTestHTTPServer.m
+//  StreamingKitTests
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#import "STKTestHTTPServer.h"
+#import <pthread.h>
+#import <sys/socket.h>
+#import <netinet/in.h>
+#import <arpa/inet.h>
+#import <unistd.h>
+
+#define STK_TEST_HTTP_SERVER_SEND_SIZE (16 * 1024)
+
+static BOOL SendAll(int socket, const void* bytes, size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t sent = send(socket, bytes, length, 0);
+
+        if (sent <= 0)
+        {
+            return NO;
+        }
+
+        bytes = (const UInt8*)bytes + sent;
+        length -= sent;
+    }
+
+    return YES;
+}
+
+@interface STKTestHTTPServer()
+{
+    int listenSocket;
+    pthread_mutex_t mutex;
+    dispatch_source_t acceptSource;
+    NSMutableSet<NSNumber*>* clientSockets;
+    NSUInteger connectionCount;
+    NSUInteger requestCount;
+    UInt64 bytesSent;
+}
+
+@property (readwrite) NSURL* url;
+@property (readwrite) NSData* data;
+
+@end
+
+@implementation STKTestHTTPServer
+
+-(instancetype) initWithData:(NSData*)dataIn
+{
+    if (self = [super init])
+    {
+        self.data = dataIn;
+
+        pthread_mutex_init(&mutex, NULL);
+
+        clientSockets = [[NSMutableSet alloc] init];
+
+        struct sockaddr_in address = { 0 };
+        socklen_t addressLength = sizeof(address);
+
+        address.sin_len = sizeof(address);
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+
+        if (listenSocket < 0
+            || bind(listenSocket, (struct sockaddr*)&address, sizeof(address)) != 0
+            || listen(listenSocket, 16) != 0
+            || getsockname(listenSocket, (struct sockaddr*)&address, &addressLength) != 0)
+        {
+            if (listenSocket >= 0)
+            {
+                close(listenSocket);
+            }
+
+            return nil;
+        }
+
+        self.url = [NSURL URLWithString:[NSString stringWithFormat:@"http://127.0.0.1:%d/test.mp3", ntohs(address.sin_port)]];
+
+        int socketToClose = listenSocket;
+        __weak STKTestHTTPServer* weakSelf = self;
+
+        acceptSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, listenSocket, 0, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0));
+
+        dispatch_source_set_event_handler(acceptSource, ^
+        {
+            [weakSelf acceptConnection];
+        });
+
+        dispatch_source_set_cancel_handler(acceptSource, ^
+        {
+            close(socketToClose);
+        });
+
+        dispatch_resume(acceptSource);
+    }
+
+    return self;
+}
+
+-(void) dealloc
+{
+    [self stop];
+
+    pthread_mutex_destroy(&mutex);
+}
+
+-(void) stop
+{
+    pthread_mutex_lock(&mutex);
+
+    if (acceptSource != nil)
+    {
+        dispatch_source_cancel(acceptSource);
+
+        acceptSource = nil;
+    }
+
+    // Each connection closes its own socket once its blocked read returns
+
+    for (NSNumber* clientSocket in clientSockets)
+    {
+        shutdown(clientSocket.intValue, SHUT_RDWR);
+    }
+
+    pthread_mutex_unlock(&mutex);
+}
+
+-(void) acceptConnection
+{
+    int clientSocket = accept(listenSocket, NULL, NULL);
+
+    if (clientSocket < 0)
+    {
+        return;
+    }
+
+    int on = 1;
+
+    setsockopt(clientSocket, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+
+    pthread_mutex_lock(&mutex);
+
+    connectionCount++;
+
+    [clientSockets addObject:@(clientSocket)];
+
+    pthread_mutex_unlock(&mutex);
+
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^
+    {
+        NSMutableData* pending = [[NSMutableData alloc] init];
+
+        while ([self serveRequestOnSocket:clientSocket pending:pending])
+        {
+        }
+
+        pthread_mutex_lock(&self->mutex);
+
+        [self->clientSockets removeObject:@(clientSocket)];
+
+        pthread_mutex_unlock(&self->mutex);
+
+        close(clientSocket);
+    });
+}
+
+/// Reads one request and writes its response. Returns NO once the connection should be closed
+-(BOOL) serveRequestOnSocket:(int)clientSocket pending:(NSMutableData*)pending
+{
+    NSData* terminator = [@"\r\n\r\n" dataUsingEncoding:NSASCIIStringEncoding];
+    NSRange terminatorRange;
+
+    while ((terminatorRange = [pending rangeOfData:terminator options:0 range:NSMakeRange(0, pending.length)]).location == NSNotFound)
+    {
+        UInt8 buffer[4096];
+        ssize_t read = recv(clientSocket, buffer, sizeof(buffer), 0);
+
+        if (read <= 0)
+        {
+            return NO;
+        }
+
+        [pending appendBytes:buffer length:read];
+    }
+
+    NSString* request = [[NSString alloc] initWithBytes:pending.bytes length:terminatorRange.location encoding:NSASCIIStringEncoding];
+
+    [pending replaceBytesInRange:NSMakeRange(0, NSMaxRange(terminatorRange)) withBytes:NULL length:0];
+
+    SInt64 length = (SInt64)self.data.length;
+    SInt64 start = 0;
+    SInt64 end = length - 1;
+    BOOL partial = NO;
+    NSString* rangePrefix = @"range: bytes=";
+
+    for (NSString* line in self.ignoresRanges ? @[] : [request componentsSeparatedByString:@"\r\n"])
+    {
+        if (line.length > rangePrefix.length && [[line substringToIndex:rangePrefix.length] caseInsensitiveCompare:rangePrefix] == NSOrderedSame)
+        {
+            NSArray* bounds = [[line substringFromIndex:rangePrefix.length] componentsSeparatedByString:@"-"];
+
+            start = [bounds[0] longLongValue];
+
+            if (bounds.count > 1 && [bounds[1] length] > 0)
+            {
+                end = MIN([bounds[1] longLongValue], length - 1);
+            }
+
+            partial = YES;
+        }
+    }
+
+    BOOL closesConnection = self.closesConnections;
+    NSString* connection = closesConnection ? @"close" : @"keep-alive";
+    NSString* total = self.hidesLength ? @"*" : [NSString stringWithFormat:@"%lld", length];
+    NSString* header;
+
+    pthread_mutex_lock(&mutex);
+    requestCount++;
+    pthread_mutex_unlock(&mutex);
+
+    if (start >= length || end < start)
+    {
+        header = [NSString stringWithFormat:@"HTTP/1.1 416 Range Not Satisfiable\r\nContent-Range: bytes */%@\r\nContent-Length: 0\r\nConnection: %@\r\n\r\n", total, connection];
+
+        start = 0;
+        end = -1;
+    }
+    else if (partial)
+    {
+        header = [NSString stringWithFormat:@"HTTP/1.1 206 Partial Content\r\nContent-Type: audio/mpeg\r\nAccept-Ranges: bytes\r\nContent-Range: bytes %lld-%lld/%@\r\nContent-Length: %lld\r\nConnection: %@\r\n\r\n", start, end, total, end - start + 1, connection];
+    }
+    else
+    {
+        header = [NSString stringWithFormat:@"HTTP/1.1 200 OK\r\nContent-Type: audio/mpeg\r\nAccept-Ranges: bytes\r\nContent-Length: %lld\r\nConnection: %@\r\n\r\n", length, connection];
+    }
+
+    NSData* headerData = [header dataUsingEncoding:NSASCIIStringEncoding];
+
+    if (!SendAll(clientSocket, headerData.bytes, headerData.length))
+    {
+        return NO;
+    }
+
+    for (SInt64 offset = start; offset <= end; offset += STK_TEST_HTTP_SERVER_SEND_SIZE)
+    {
+        size_t size = (size_t)MIN((SInt64)STK_TEST_HTTP_SERVER_SEND_SIZE, end + 1 - offset);
+
+        if (!SendAll(clientSocket, (const UInt8*)self.data.bytes + offset, size))
+        {
+            return NO;
+        }
+
+        pthread_mutex_lock(&mutex);
+        bytesSent += size;
+        pthread_mutex_unlock(&mutex);
+    }
+
+    return !closesConnection;
+}
+
+#define STK_TEST_HTTP_SERVER_LOCKED_GETTER(type, name) \
+-(type) name \
+{ \
+    pthread_mutex_lock(&mutex); \
+    type retval = name; \
+    pthread_mutex_unlock(&mutex); \
+    return retval; \
+}
+
+STK_TEST_HTTP_SERVER_LOCKED_GETTER(NSUInteger, connectionCount)
+STK_TEST_HTTP_SERVER_LOCKED_GETTER(NSUInteger, requestCount)
+STK_TEST_HTTP_SERVER_LOCKED_GETTER(UInt64, bytesSent)
+
+@end
@@ -0,0 +1,286 @@
+//
+//  STKBandwidthEstimatorTests.c
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#include "STKBandwidthEstimator.h"
+#include "STKTest.h"
+#include <math.h>
+
+/// Reads bytesPerSecond in reads every interval seconds from start until end. Returns the time of the last read
+static double Feed(STKBandwidthEstimator* estimator, double bytesPerSecond, double interval, double start, double end)
+{
+    double now;
+
+    for (now = start; now < end; now += interval)
+    {
+        STKBandwidthEstimatorAddBytes(estimator, (uint64_t)(bytesPerSecond * interval), now, false);
+    }
+
+    return now - interval;
+}
+
+static void TestConstantRate(void)
+{
+    STKBandwidthEstimator estimator;
+
+    STKBandwidthEstimatorInit(&estimator);
+
+    // Nothing is estimated until there's half a second of samples
+
+    Feed(&estimator, 50000, 0.01, 1, 1.3);
+
+    STK_CHECK(STKBandwidthEstimatorBytesPerSecond(&estimator) == 0, "estimate %f before enough samples", STKBandwidthEstimatorBytesPerSecond(&estimator));
+
+    // Without the bias towards the initial 0 the first estimates are already close
+
+    Feed(&estimator, 50000, 0.01, 1.3, 2);
+
+    double estimate = STKBandwidthEstimatorBytesPerSecond(&estimator);
+
+    STK_CHECK(fabs(estimate - 50000) < 2500, "estimate %f after 1s", estimate);
+
+    Feed(&estimator, 50000, 0.01, 2, 30);
+
+    estimate = STKBandwidthEstimatorBytesPerSecond(&estimator);
+
+    STK_CHECK(fabs(estimate - 50000) < 500, "estimate %f after 30s", estimate);
+    STK_CHECK(estimator.totalBytes > 50000 * 28, "%llu bytes counted", (unsigned long long)estimator.totalBytes);
+}
+
+static void TestDropsQuicklyAndRecoversSlowly(void)
+{
+    STKBandwidthEstimator estimator;
+
+    STKBandwidthEstimatorInit(&estimator);
+
+    double now = Feed(&estimator, 100000, 0.01, 1, 60);
+
+    // The fast average follows a drop within a few half lives
+
+    now = Feed(&estimator, 14000, 0.01, now + 0.01, now + 8);
+
+    double dropped = STKBandwidthEstimatorBytesPerSecond(&estimator);
+
+    STK_CHECK(dropped < 25000, "estimate %f 8s after dropping to 14000", dropped);
+
+    now = Feed(&estimator, 14000, 0.01, now + 0.01, now + 60);
+
+    // The slow average holds the estimate back when the link recovers
+
+    Feed(&estimator, 100000, 0.01, now + 0.01, now + 4);
+
+    double recovered = STKBandwidthEstimatorBytesPerSecond(&estimator);
+
+    STK_CHECK(recovered > 14000 && recovered < 60000, "estimate %f 4s after recovering to 100000", recovered);
+}
+
+static void TestGaps(void)
+{
+    STKBandwidthEstimator busy;
+    STKBandwidthEstimator stalled;
+
+    STKBandwidthEstimatorInit(&busy);
+    STKBandwidthEstimatorInit(&stalled);
+
+    double now = Feed(&busy, 50000, 0.01, 1, 10);
+
+    Feed(&stalled, 50000, 0.01, 1, 10);
+
+    // A full read after the reader was away for 3s doesn't say anything about the link
+
+    STKBandwidthEstimatorAddBytes(&busy, 16384, now + 3, true);
+    Feed(&busy, 50000, 0.01, now + 3.01, now + 4);
+
+    // A short read after 3s means the link stalled
+
+    STKBandwidthEstimatorAddBytes(&stalled, 500, now + 3, false);
+    Feed(&stalled, 50000, 0.01, now + 3.01, now + 4);
+
+    double busyEstimate = STKBandwidthEstimatorBytesPerSecond(&busy);
+    double stalledEstimate = STKBandwidthEstimatorBytesPerSecond(&stalled);
+
+    STK_CHECK(fabs(busyEstimate - 50000) < 2500, "estimate %f after the reader was busy", busyEstimate);
+    STK_CHECK(stalledEstimate < 40000, "estimate %f after the link stalled", stalledEstimate);
+
+    // A restart (a new request) doesn't count the time before the first read of the response
+
+    STKBandwidthEstimatorRestart(&busy);
+    Feed(&busy, 50000, 0.01, now + 10, now + 11);
+
+    busyEstimate = STKBandwidthEstimatorBytesPerSecond(&busy);
+
+    STK_CHECK(fabs(busyEstimate - 50000) < 2500, "estimate %f after a restart", busyEstimate);
+}
+
+static void TestAdaptiveBufferSeconds(void)
+{
+    // Unknown rates use the configured value
+
+    STK_CHECK(STKAdaptiveBufferSeconds(2, 0, 100, 0.25, 7.5) == 2, "unknown rate");
+    STK_CHECK(STKAdaptiveBufferSeconds(0, 4, 100, 0.25, 7.5) == 0, "nothing configured");
+
+    // Fast links buffer less down to the minimum
+
+    STK_CHECK(STKAdaptiveBufferSeconds(2, 2, 100, 0.25, 7.5) == 2, "comfortable ratio");
+    STK_CHECK(STKAdaptiveBufferSeconds(2, 4, 100, 0.25, 7.5) == 1, "twice the comfortable ratio");
+    STK_CHECK(STKAdaptiveBufferSeconds(2, 100, 100, 0.25, 7.5) == 0.25, "minimum");
+
+    // Links that only just keep up buffer more up to the maximum
+
+    STK_CHECK(STKAdaptiveBufferSeconds(2, 1.5, 100, 0.25, 7.5) == 4, "marginal ratio");
+    STK_CHECK(STKAdaptiveBufferSeconds(2, 1, 100, 0.25, 7.5) == 6, "rate equal to the media");
+    STK_CHECK(STKAdaptiveBufferSeconds(5, 1, 100, 0.25, 7.5) == 7.5, "maximum");
+
+    // Slow links cover the shortfall over the rest of the stream
+
+    STK_CHECK(STKAdaptiveBufferSeconds(1, 0.9, 20, 0.25, 100) == 5, "shortfall");
+    STK_CHECK(STKAdaptiveBufferSeconds(1, 0.5, 1000, 0.25, 7.5) == 7.5, "shortfall past the maximum");
+
+    // The bounds never move the result past the configured value
+
+    STK_CHECK(STKAdaptiveBufferSeconds(10, 1, 100, 0.25, 7.5) == 10, "maximum below the configured value");
+    STK_CHECK(STKAdaptiveBufferSeconds(0.1, 100, 100, 0.25, 7.5) == 0.1, "minimum above the configured value");
+}
+
+typedef struct
+{
+    const char* name;
+    double (*bytesPerSecond)(double now);
+}
+Profile;
+
+static double jitter[4096];
+
+static double Fast(double now) { (void)now; return 250000; }
+static double Good(double now) { (void)now; return 50000; }
+static double Marginal(double now) { return 16000 * 1.1 * jitter[(int)(now / 2) % 4096]; }
+static double Poor(double now) { (void)now; return 12800; }
+static double Bursty(double now) { return fmod(now, 4) < 2 ? 60000 : 0; }
+static double Dropping(double now) { return now < 60 ? 100000 : 14000; }
+
+/// Plays 5 minutes of 128kbps audio over simulated links with fixed and adaptive start and rebuffer thresholds
+/// (1s and 7.5s configured, 10s buffer, 16KB reads) and prints the startup time, rebuffers and time spent stalled
+static void Benchmark(void)
+{
+    Profile profiles[] =
+    {
+        { "fast 2Mbps", Fast },
+        { "good 400kbps", Good },
+        { "marginal ~1.1x", Marginal },
+        { "poor 0.8x", Poor },
+        { "bursty on/off", Bursty },
+        { "drop at 60s", Dropping }
+    };
+    const double mediaBytesPerSecond = 16000;
+    const double duration = 300;
+    const double step = 0.01;
+    const double bufferSeconds = 10;
+    const double readSize = 16384;
+    uint32_t random = 7;
+
+    // Marginal links swing between 0.2x and 2x every 2 seconds
+
+    for (int i = 0; i < 4096; i++)
+    {
+        jitter[i] = 0.2 + 1.8 * (STKTestRandom(&random) % 1000) / 1000.0;
+    }
+
+    printf("%-16s %-9s %8s %9s %8s\n", "profile", "policy", "startup", "rebuffers", "stalled");
+
+    for (size_t i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++)
+    {
+        for (int adaptive = 0; adaptive < 2; adaptive++)
+        {
+            STKBandwidthEstimator estimator;
+            double waiting = 0;
+            double downloaded = 0;
+            double buffered = 0;
+            double played = 0;
+            double startup = -1;
+            double stalled = 0;
+            double now = 1;
+            int rebuffers = 0;
+            int state = 0;
+
+            STKBandwidthEstimatorInit(&estimator);
+
+            while (played < duration - step && now < 2000)
+            {
+                double arrived = fmin(profiles[i].bytesPerSecond(now) * step, mediaBytesPerSecond * duration - downloaded - waiting);
+
+                waiting += fmax(arrived, 0);
+
+                // The reader takes up to a read's worth of bytes when the buffer has room
+
+                if (waiting >= 1 && (bufferSeconds - buffered) * mediaBytesPerSecond >= readSize)
+                {
+                    double read = fmin(waiting, readSize);
+
+                    waiting -= read;
+                    downloaded += read;
+                    buffered += read / mediaBytesPerSecond;
+
+                    STKBandwidthEstimatorAddBytes(&estimator, (uint64_t)read, now, read >= readSize);
+                }
+
+                double ratio = adaptive ? STKBandwidthEstimatorBytesPerSecond(&estimator) / mediaBytesPerSecond : 0;
+                double startSeconds = STKAdaptiveBufferSeconds(1, ratio, duration - played, 0.25, bufferSeconds * 0.75);
+                double resumeSeconds = STKAdaptiveBufferSeconds(7.5, ratio, duration - played, 0.25, bufferSeconds * 0.75);
+                bool complete = downloaded >= mediaBytesPerSecond * duration - 1;
+
+                if (state == 0 && (buffered >= startSeconds || complete))
+                {
+                    state = 1;
+                    startup = now - 1;
+                }
+                else if (state == 2)
+                {
+                    stalled += step;
+
+                    if (buffered >= resumeSeconds || complete)
+                    {
+                        state = 1;
+                    }
+                }
+
+                if (state == 1)
+                {
+                    double playing = fmin(step, buffered);
+
+                    buffered -= playing;
+                    played += playing;
+
+                    if (buffered <= 0 && played < duration - step)
+                    {
+                        state = 2;
+                        rebuffers++;
+                    }
+                }
+
+                now += step;
+            }
+
+            printf("%-16s %-9s %7.2fs %9d %7.1fs\n", profiles[i].name, adaptive ? "adaptive" : "fixed", startup, rebuffers, stalled);
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (STKTestIsBenchmark(argc, argv))
+    {
+        Benchmark();
+
+        return 0;
+    }
+
+    STK_RUN_TEST(TestConstantRate);
+    STK_RUN_TEST(TestDropsQuicklyAndRecoversSlowly);
+    STK_RUN_TEST(TestGaps);
+    STK_RUN_TEST(TestAdaptiveBufferSeconds);
+
+    return 0;
+}
@@ -0,0 +1,442 @@
+//
+//  STKEqualizerTests.c
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#include "STKEqualizer.h"
+#include "STKTest.h"
+#include <math.h>
+
+#define SAMPLE_RATE (44100.0)
+#define REFERENCE_FRAME_COUNT (20000)
+#define MAX_CHANNELS (8)
+
+static const double kPi = 3.14159265358979323846;
+static const double kLn2 = 0.69314718055994530942;
+
+/// The last two can't be filtered at 44.1kHz and must be left out
+static const float frequencies[] = { 32, 64, 125, 250, 500, 1000, 2000, 4000, 8000, 16000, 20000, 21500 };
+static const float gains[] = { 6, -3, 12, 0, -12, 3, 9, -6, 4, -9, 5, 2 };
+
+/// The peaking biquad of the Audio EQ Cookbook (half an octave wide) in double precision
+typedef struct
+{
+    double b0, b1, b2, a1, a2;
+    double z1, z2;
+}
+ReferenceFilter;
+
+static bool ReferenceFilterInit(ReferenceFilter* filter, double frequency, double gainDb)
+{
+    if (gainDb == 0 || frequency >= SAMPLE_RATE / 2 * 0.95)
+    {
+        return false;
+    }
+
+    double w0 = 2 * kPi * frequency / SAMPLE_RATE;
+    double alpha = sin(w0) * sinh(kLn2 / 2 * 0.5 * w0 / sin(w0));
+    double a = pow(10, gainDb / 40);
+    double a0 = 1 + alpha / a;
+
+    filter->b0 = (1 + alpha * a) / a0;
+    filter->b1 = -2 * cos(w0) / a0;
+    filter->b2 = (1 - alpha * a) / a0;
+    filter->a1 = -2 * cos(w0) / a0;
+    filter->a2 = (1 - alpha / a) / a0;
+    filter->z1 = 0;
+    filter->z2 = 0;
+
+    return true;
+}
+
+static double ReferenceFilterRun(ReferenceFilter* filter, double x)
+{
+    double y = filter->b0 * x + filter->z1;
+
+    filter->z1 = filter->b1 * x - filter->a1 * y + filter->z2;
+    filter->z2 = filter->b2 * x - filter->a2 * y;
+
+    return y;
+}
+
+/// The magnitude of the response of the reference cascade at frequency
+static double ReferenceMagnitude(uint32_t bandCount, double frequency)
+{
+    double w = 2 * kPi * frequency / SAMPLE_RATE;
+    double magnitude = 1;
+
+    for (uint32_t i = 0; i < bandCount; i++)
+    {
+        ReferenceFilter f;
+
+        if (!ReferenceFilterInit(&f, frequencies[i], gains[i]))
+        {
+            continue;
+        }
+
+        double numeratorReal = f.b0 + f.b1 * cos(w) + f.b2 * cos(2 * w);
+        double numeratorImaginary = -f.b1 * sin(w) - f.b2 * sin(2 * w);
+        double denominatorReal = 1 + f.a1 * cos(w) + f.a2 * cos(2 * w);
+        double denominatorImaginary = -f.a1 * sin(w) - f.a2 * sin(2 * w);
+
+        magnitude *= sqrt((numeratorReal * numeratorReal + numeratorImaginary * numeratorImaginary) / (denominatorReal * denominatorReal + denominatorImaginary * denominatorImaginary));
+    }
+
+    return magnitude;
+}
+
+/// Points buffers at frame offset of samples laid out as the equalizer expects (frameCount frames per channel)
+static void SetBuffers(STKEqualizer* equalizer, void* samples, uint32_t frameCount, uint32_t offset, void** buffers)
+{
+    size_t sampleSize = equalizer->format == STKEqualizerSampleFormatFloat32 ? sizeof(float) : sizeof(int16_t);
+
+    if (equalizer->nonInterleaved)
+    {
+        for (uint32_t i = 0; i < equalizer->channelCount; i++)
+        {
+            buffers[i] = (uint8_t*)samples + ((size_t)i * frameCount + offset) * sampleSize;
+        }
+    }
+    else
+    {
+        buffers[0] = (uint8_t*)samples + (size_t)offset * equalizer->channelCount * sampleSize;
+    }
+}
+
+/// Processes silence until the gains have reached their targets, which leaves the filter state at zero
+static void Settle(STKEqualizer* equalizer)
+{
+    void* silence = calloc((size_t)4096 * equalizer->channelCount, sizeof(float));
+    void* buffers[MAX_CHANNELS];
+
+    for (int i = 0; i < 200; i++)
+    {
+        SetBuffers(equalizer, silence, 4096, 0, buffers);
+        STKEqualizerProcess(equalizer, buffers, 4096);
+    }
+
+    free(silence);
+}
+
+/// Filters noise in blocks of blockFrames and compares it with the reference cascade
+static void CheckMatchesReference(uint32_t bandCount, uint32_t blockFrames, STKEqualizerSampleFormat format, bool nonInterleaved, uint32_t channelCount)
+{
+    STKEqualizer equalizer;
+    uint32_t sampleCount = REFERENCE_FRAME_COUNT * channelCount;
+    float* floats = malloc(sizeof(float) * sampleCount);
+    int16_t* ints = malloc(sizeof(int16_t) * sampleCount);
+    double* expected = malloc(sizeof(double) * sampleCount);
+    void* buffers[MAX_CHANNELS];
+    uint32_t random = 1;
+
+    STK_CHECK(STKEqualizerInit(&equalizer, channelCount, format, nonInterleaved, frequencies, bandCount, SAMPLE_RATE), "init");
+
+    for (uint32_t i = 0; i < bandCount; i++)
+    {
+        STKEqualizerSetGain(&equalizer, i, gains[i]);
+    }
+
+    Settle(&equalizer);
+
+    for (uint32_t channel = 0; channel < channelCount; channel++)
+    {
+        ReferenceFilter filters[STK_EQUALIZER_MAX_BANDS];
+        bool used[STK_EQUALIZER_MAX_BANDS];
+
+        for (uint32_t i = 0; i < bandCount; i++)
+        {
+            used[i] = ReferenceFilterInit(&filters[i], frequencies[i], gains[i]);
+        }
+
+        for (uint32_t frame = 0; frame < REFERENCE_FRAME_COUNT; frame++)
+        {
+            double noise = (STKTestRandom(&random) % 100000) / 100000.0 - 0.5;
+            double x = format == STKEqualizerSampleFormatFloat32 ? noise * 0.5 : (int)(noise * 8000);
+            uint32_t index = nonInterleaved ? channel * REFERENCE_FRAME_COUNT + frame : frame * channelCount + channel;
+            double y = x;
+
+            for (uint32_t i = 0; i < bandCount; i++)
+            {
+                if (used[i])
+                {
+                    y = ReferenceFilterRun(&filters[i], y);
+                }
+            }
+
+            floats[index] = (float)x;
+            ints[index] = (int16_t)x;
+            expected[index] = format == STKEqualizerSampleFormatFloat32 ? y : fmax(-32768, fmin(32767, y));
+        }
+    }
+
+    void* samples = format == STKEqualizerSampleFormatFloat32 ? (void*)floats : (void*)ints;
+
+    for (uint32_t offset = 0; offset < REFERENCE_FRAME_COUNT; offset += blockFrames)
+    {
+        uint32_t frameCount = REFERENCE_FRAME_COUNT - offset < blockFrames ? REFERENCE_FRAME_COUNT - offset : blockFrames;
+
+        SetBuffers(&equalizer, samples, REFERENCE_FRAME_COUNT, offset, buffers);
+        STKEqualizerProcess(&equalizer, buffers, frameCount);
+    }
+
+    double maximumError = 0;
+    double maximumValue = 0;
+
+    for (uint32_t i = 0; i < sampleCount; i++)
+    {
+        double actual = format == STKEqualizerSampleFormatFloat32 ? floats[i] : ints[i];
+
+        maximumError = fmax(maximumError, fabs(actual - expected[i]));
+        maximumValue = fmax(maximumValue, fabs(expected[i]));
+    }
+
+    // Float output is within single precision rounding of the peak and Int16 output within one step of it
+
+    double tolerance = format == STKEqualizerSampleFormatFloat32 ? 2e-5 * maximumValue : 1.01;
+
+    STK_CHECK(maximumError <= tolerance, "%u bands in blocks of %u (format %d, non-interleaved %d, %u channels) off by %g", bandCount, blockFrames, format, nonInterleaved, channelCount, maximumError);
+
+    free(floats);
+    free(ints);
+    free(expected);
+    STKEqualizerDestroy(&equalizer);
+}
+
+static void TestMatchesReference(void)
+{
+    static const uint32_t blockSizes[] = { 1, 2, 3, 4, 5, 7, 63, 64, 65, 512, 4096 };
+
+    // Block sizes either side of the lane count and the gain smoothing block
+
+    for (size_t i = 0; i < sizeof(blockSizes) / sizeof(blockSizes[0]); i++)
+    {
+        CheckMatchesReference(12, blockSizes[i], STKEqualizerSampleFormatInt16, false, 2);
+        CheckMatchesReference(12, blockSizes[i], STKEqualizerSampleFormatInt16, true, 2);
+        CheckMatchesReference(12, blockSizes[i], STKEqualizerSampleFormatFloat32, false, 2);
+        CheckMatchesReference(12, blockSizes[i], STKEqualizerSampleFormatFloat32, true, 2);
+    }
+
+    // Partly filled groups and odd channel counts
+
+    CheckMatchesReference(1, 512, STKEqualizerSampleFormatFloat32, false, 1);
+    CheckMatchesReference(4, 33, STKEqualizerSampleFormatFloat32, false, 3);
+    CheckMatchesReference(5, 100, STKEqualizerSampleFormatFloat32, true, 6);
+    CheckMatchesReference(9, 17, STKEqualizerSampleFormatInt16, false, 1);
+}
+
+static void TestFrequencyResponse(void)
+{
+    static const double probes[] = { 20, 32, 50, 100, 125, 440, 1000, 3000, 4000, 10000, 16000, 19000 };
+    STKEqualizer equalizer;
+    uint32_t frameCount = (uint32_t)SAMPLE_RATE;
+    float* samples = malloc(sizeof(float) * frameCount);
+
+    STK_CHECK(STKEqualizerInit(&equalizer, 1, STKEqualizerSampleFormatFloat32, true, frequencies, 12, SAMPLE_RATE), "init");
+
+    for (uint32_t i = 0; i < 12; i++)
+    {
+        STKEqualizerSetGain(&equalizer, i, gains[i]);
+    }
+
+    Settle(&equalizer);
+
+    for (size_t p = 0; p < sizeof(probes) / sizeof(probes[0]); p++)
+    {
+        void* buffers[1] = { samples };
+        double power = 0;
+
+        for (uint32_t n = 0; n < frameCount; n++)
+        {
+            samples[n] = (float)(0.25 * sin(2 * kPi * probes[p] * n / SAMPLE_RATE));
+        }
+
+        STKEqualizerProcess(&equalizer, buffers, frameCount);
+
+        // Measured over the second half once the filters have rung in
+
+        for (uint32_t n = frameCount / 2; n < frameCount; n++)
+        {
+            power += samples[n] * samples[n];
+        }
+
+        double measured = 20 * log10(sqrt(2 * power / (frameCount - frameCount / 2)) / 0.25);
+        double expected = 20 * log10(ReferenceMagnitude(12, probes[p]));
+
+        STK_CHECK(fabs(measured - expected) < 0.05, "%gHz measured %.3fdB expected %.3fdB", probes[p], measured, expected);
+    }
+
+    free(samples);
+    STKEqualizerDestroy(&equalizer);
+}
+
+static void TestBypass(void)
+{
+    STKEqualizer equalizer;
+    int16_t samples[2 * 1000];
+    int16_t original[2 * 1000];
+    void* buffers[1] = { samples };
+    uint32_t random = 2;
+
+    STK_CHECK(STKEqualizerInit(&equalizer, 2, STKEqualizerSampleFormatInt16, false, frequencies, 10, SAMPLE_RATE), "init");
+
+    for (int i = 0; i < 2000; i++)
+    {
+        samples[i] = original[i] = (int16_t)(STKTestRandom(&random) % 60000 - 30000);
+    }
+
+    // Every gain at 0dB leaves the samples exactly as they were
+
+    STKEqualizerProcess(&equalizer, buffers, 1000);
+
+    STK_CHECK(memcmp(samples, original, sizeof(samples)) == 0, "bypass changed samples");
+
+    STKEqualizerSetGain(&equalizer, 3, 6);
+    STKEqualizerProcess(&equalizer, buffers, 1000);
+
+    STK_CHECK(memcmp(samples, original, sizeof(samples)) != 0, "a gain changed nothing");
+
+    // As does returning to 0dB once the gain has faded out
+
+    STKEqualizerSetGain(&equalizer, 3, 0);
+    Settle(&equalizer);
+
+    STK_CHECK(equalizer.groupCount == 0 && equalizer.settled, "not bypassed after returning to 0dB");
+
+    memcpy(samples, original, sizeof(samples));
+    STKEqualizerProcess(&equalizer, buffers, 1000);
+
+    STK_CHECK(memcmp(samples, original, sizeof(samples)) == 0, "bypass after returning to 0dB changed samples");
+
+    // Disabling fades the gains out and enabling fades them back in
+
+    STKEqualizerSetGain(&equalizer, 3, 6);
+    STKEqualizerSetEnabled(&equalizer, false);
+    Settle(&equalizer);
+
+    STK_CHECK(equalizer.groupCount == 0, "disabled but not bypassed");
+    STK_CHECK(STKEqualizerGain(&equalizer, 3) == 6, "gain %f kept while disabled", STKEqualizerGain(&equalizer, 3));
+
+    STKEqualizerSetEnabled(&equalizer, true);
+    Settle(&equalizer);
+
+    STK_CHECK(equalizer.groupCount == 1 && equalizer.gains[3] == 6, "gain %f after enabling", equalizer.gains[3]);
+
+    STKEqualizerDestroy(&equalizer);
+}
+
+/// A gain step ramps in so no sample moves further from the last than the boosted sine wave allows
+static void TestGainSmoothing(void)
+{
+    STKEqualizer equalizer;
+    uint32_t frameCount = (uint32_t)SAMPLE_RATE;
+    float* samples = malloc(sizeof(float) * frameCount);
+    void* buffers[1] = { samples };
+    double largestStep = 0;
+
+    STK_CHECK(STKEqualizerInit(&equalizer, 1, STKEqualizerSampleFormatFloat32, true, frequencies, 10, SAMPLE_RATE), "init");
+
+    for (uint32_t n = 0; n < frameCount; n++)
+    {
+        samples[n] = (float)(0.1 * sin(2 * kPi * 1000 * n / SAMPLE_RATE));
+    }
+
+    STKEqualizerProcess(&equalizer, buffers, 4410);
+    STKEqualizerSetGain(&equalizer, 5, STK_EQUALIZER_MAX_GAIN_DB);
+
+    buffers[0] = samples + 4410;
+
+    STKEqualizerProcess(&equalizer, buffers, frameCount - 4410);
+
+    for (uint32_t n = 1; n < frameCount; n++)
+    {
+        largestStep = fmax(largestStep, fabs(samples[n] - samples[n - 1]));
+    }
+
+    double bound = 0.1 * pow(10, STK_EQUALIZER_MAX_GAIN_DB / 20) * 2 * kPi * 1000 / SAMPLE_RATE * 1.1;
+
+    STK_CHECK(largestStep < bound, "largest step %g (at most %g)", largestStep, bound);
+
+    free(samples);
+    STKEqualizerDestroy(&equalizer);
+}
+
+/// Prints the cycles per frame of processing 512 frame buffers
+static void BenchmarkEqualizer(const char* name, uint32_t bandCount, uint32_t channelCount, STKEqualizerSampleFormat format, bool nonInterleaved)
+{
+    STKEqualizer equalizer;
+    const uint32_t frameCount = 512;
+    void* samples = calloc((size_t)frameCount * channelCount, sizeof(float));
+    void* buffers[MAX_CHANNELS];
+    unsigned long long best = ~0ULL;
+    uint32_t random = 3;
+
+    STKEqualizerInit(&equalizer, channelCount, format, nonInterleaved, frequencies, bandCount, SAMPLE_RATE);
+
+    for (uint32_t i = 0; i < bandCount; i++)
+    {
+        STKEqualizerSetGain(&equalizer, i, (i % 3) - 1.5f + (i % 2) * 4);
+    }
+
+    Settle(&equalizer);
+
+    for (uint32_t i = 0; i < frameCount * channelCount; i++)
+    {
+        if (format == STKEqualizerSampleFormatFloat32)
+        {
+            ((float*)samples)[i] = (STKTestRandom(&random) % 1000) / 2000.0f;
+        }
+        else
+        {
+            ((int16_t*)samples)[i] = (int16_t)(STKTestRandom(&random) % 2000);
+        }
+    }
+
+    SetBuffers(&equalizer, samples, frameCount, 0, buffers);
+
+    for (int round = 0; round < 20; round++)
+    {
+        unsigned long long start = STKTestCycles();
+
+        for (int i = 0; i < 200; i++)
+        {
+            STKEqualizerProcess(&equalizer, buffers, frameCount);
+        }
+
+        unsigned long long cycles = STKTestCycles() - start;
+
+        best = cycles < best ? cycles : best;
+    }
+
+    printf("%-40s %7.2f cycles per frame\n", name, (double)best / (200.0 * frameCount));
+
+    free(samples);
+    STKEqualizerDestroy(&equalizer);
+}
+
+static void Benchmark(void)
+{
+    BenchmarkEqualizer("bypassed, stereo int16", 0, 2, STKEqualizerSampleFormatInt16, false);
+    BenchmarkEqualizer("1 band, stereo int16", 1, 2, STKEqualizerSampleFormatInt16, false);
+    BenchmarkEqualizer("4 bands, stereo int16", 4, 2, STKEqualizerSampleFormatInt16, false);
+    BenchmarkEqualizer("10 bands, stereo int16", 10, 2, STKEqualizerSampleFormatInt16, false);
+    BenchmarkEqualizer("10 bands, stereo float non-interleaved", 10, 2, STKEqualizerSampleFormatFloat32, true);
+}
+
+int main(int argc, char** argv)
+{
+    if (STKTestIsBenchmark(argc, argv))
+    {
+        Benchmark();
+
+        return 0;
+    }
+
+    STK_RUN_TEST(TestMatchesReference);
+    STK_RUN_TEST(TestFrequencyResponse);
+    STK_RUN_TEST(TestBypass);
+    STK_RUN_TEST(TestGainSmoothing);
+
+    return 0;
+}
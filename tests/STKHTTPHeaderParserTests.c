@@ -0,0 +1,333 @@
+//
+//  STKHTTPHeaderParserTests.c
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#include "STKHTTPHeaderParser.h"
+#include "STKTest.h"
+
+static STKHTTPHeaderParser parser;
+
+/// Feeds response to the parser in blocks of up to maximumBlockSize bytes (0 for one block) and checks the status,
+/// the fields (printed as name=value| pairs) and the body bytes that follow the header. A status of -1 expects NotHTTP
+static void CheckHeader(const char* response, uint32_t maximumBlockSize, int status, const char* expectedFields, const char* expectedBody, uint32_t* random)
+{
+    uint32_t length = (uint32_t)strlen(response);
+    uint32_t position = 0;
+    STKHTTPHeaderParserResult result = STKHTTPHeaderParserResultNeedMoreData;
+
+    STKHTTPHeaderParserInit(&parser);
+
+    while (position < length && result == STKHTTPHeaderParserResultNeedMoreData)
+    {
+        uint32_t available;
+        uint32_t size = maximumBlockSize > 0 ? 1 + STKTestRandom(random) % maximumBlockSize : length - position;
+        uint8_t* writePointer = STKHTTPHeaderParserWritePointer(&parser, &available);
+
+        size = size > length - position ? length - position : size;
+
+        STK_CHECK(size <= available, "%u bytes don't fit in %u", size, available);
+
+        memcpy(writePointer, response + position, size);
+
+        position += size;
+        result = STKHTTPHeaderParserCommit(&parser, size);
+    }
+
+    if (status < 0)
+    {
+        STK_CHECK(result == STKHTTPHeaderParserResultNotHTTP, "result %d for %s", result, response);
+
+        return;
+    }
+
+    STK_CHECK(result == STKHTTPHeaderParserResultComplete, "result %d for %s", result, response);
+    STK_CHECK(STKHTTPHeaderParserStatusCode(&parser) == status, "status %d for %s", STKHTTPHeaderParserStatusCode(&parser), response);
+
+    char fields[1024] = "";
+    uint32_t offset = 0;
+    STKHTTPHeaderField field;
+
+    while (STKHTTPHeaderParserNextField(&parser, &offset, &field))
+    {
+        strncat(fields, (const char*)field.name, field.nameLength);
+        strcat(fields, "=");
+        strncat(fields, (const char*)field.value, field.valueLength);
+        strcat(fields, "|");
+    }
+
+    STK_CHECK(strcmp(fields, expectedFields) == 0, "fields %s expected %s", fields, expectedFields);
+
+    // The body is what the parser read past the header followed by whatever wasn't fed to it
+
+    char body[1024];
+    uint32_t bodyLength;
+    const uint8_t* bodyBytes = STKHTTPHeaderParserBody(&parser, &bodyLength);
+
+    memcpy(body, bodyBytes, bodyLength);
+    memcpy(body + bodyLength, response + position, length - position);
+    body[bodyLength + length - position] = 0;
+
+    STK_CHECK(strcmp(body, expectedBody) == 0, "body '%s' expected '%s'", body, expectedBody);
+}
+
+static void TestHeaders(void)
+{
+    uint32_t random = 2;
+
+    for (uint32_t i = 0; i < 500; i++)
+    {
+        uint32_t maximumBlockSize = i % 5 == 0 ? 0 : 1 + i % 13;
+
+        CheckHeader("ICY 200 OK\r\nicy-metaint: 16000\r\nContent-Type:audio/mpeg \r\nbogus\r\n\r\nBODY", maximumBlockSize, 200, "icy-metaint=16000|Content-Type=audio/mpeg|", "BODY", &random);
+        CheckHeader("HTTP/1.1 206 Partial\nTransfer-Encoding: chunked\n\nxyz", maximumBlockSize, 206, "Transfer-Encoding=chunked|", "xyz", &random);
+        CheckHeader("HTTP/1.0 200 OK\r\nX-Empty:\r\n\r\n", maximumBlockSize, 200, "X-Empty=|", "", &random);
+        CheckHeader("ICY 404 Not Found\r\n\r\n", maximumBlockSize, 404, "", "", &random);
+        CheckHeader("\xff\xfb\x90\x44" "data", maximumBlockSize, -1, "", "", &random);
+    }
+}
+
+static void TestHeaderTooLarge(void)
+{
+    static uint8_t header[STK_HTTP_HEADER_MAXIMUM_LENGTH + 64];
+    uint32_t consumed;
+
+    memset(header, 'a', sizeof(header));
+    memcpy(header, "HTTP/1.1 200 OK\r\nX-Long: ", 25);
+
+    STKHTTPHeaderParserInit(&parser);
+
+    STK_CHECK(STKHTTPHeaderParserAppend(&parser, header, sizeof(header), &consumed) == STKHTTPHeaderParserResultTooLarge, "header larger than the buffer");
+    STK_CHECK(consumed <= STK_HTTP_HEADER_MAXIMUM_LENGTH, "consumed %u", consumed);
+}
+
+static void TestAppend(void)
+{
+    static const char response[] = "HTTP/1.1 200 OK\r\nContent-Length: 4\r\n\r\nBODY";
+    uint32_t consumed;
+    uint32_t bodyLength;
+
+    STKHTTPHeaderParserInit(&parser);
+
+    STK_CHECK(STKHTTPHeaderParserAppend(&parser, (const uint8_t*)response, 10, &consumed) == STKHTTPHeaderParserResultNeedMoreData && consumed == 10, "first part");
+    STK_CHECK(STKHTTPHeaderParserAppend(&parser, (const uint8_t*)response + 10, sizeof(response) - 11, &consumed) == STKHTTPHeaderParserResultComplete, "second part");
+    STK_CHECK(consumed == sizeof(response) - 11, "consumed %u", consumed);
+
+    const uint8_t* body = STKHTTPHeaderParserBody(&parser, &bodyLength);
+
+    STK_CHECK(bodyLength == 4 && memcmp(body, "BODY", 4) == 0, "body");
+}
+
+/// Chunk encodes data with random chunk sizes, hex case, extensions and trailers followed by bytes that aren't part of the body
+static size_t EncodeChunked(const uint8_t* data, size_t length, uint8_t* encoded, uint32_t* random)
+{
+    size_t encodedLength = 0;
+
+    for (size_t i = 0; i < length;)
+    {
+        size_t size = 1 + STKTestRandom(random) % 300;
+
+        size = size > length - i ? length - i : size;
+
+        encodedLength += sprintf((char*)encoded + encodedLength, STKTestRandom(random) % 2 ? "%zx" : "%zX", size);
+
+        if (STKTestRandom(random) % 4 == 0)
+        {
+            encodedLength += sprintf((char*)encoded + encodedLength, ";ext=%u", STKTestRandom(random));
+        }
+
+        encodedLength += sprintf((char*)encoded + encodedLength, "\r\n");
+
+        memcpy(encoded + encodedLength, data + i, size);
+
+        encodedLength += size;
+        i += size;
+
+        encodedLength += sprintf((char*)encoded + encodedLength, "\r\n");
+    }
+
+    encodedLength += sprintf((char*)encoded + encodedLength, "0\r\n");
+
+    if (STKTestRandom(random) % 2)
+    {
+        encodedLength += sprintf((char*)encoded + encodedLength, "X-Trailer: 1\r\n");
+    }
+
+    encodedLength += sprintf((char*)encoded + encodedLength, "\r\nGARBAGE");
+
+    return encodedLength;
+}
+
+static void TestChunkedBodies(void)
+{
+    size_t capacity = 200000;
+    uint8_t* data = malloc(capacity);
+    uint8_t* encoded = malloc(capacity * 2 + 100000);
+    uint8_t* buffer = malloc(capacity * 2 + 100000);
+    uint8_t* decoded = malloc(capacity);
+    uint32_t random = 3;
+
+    for (int round = 0; round < 300; round++)
+    {
+        size_t length = STKTestRandom(&random) % capacity;
+        size_t decodedLength = 0;
+        STKHTTPChunkedDecoder decoder;
+
+        for (size_t i = 0; i < length; i++)
+        {
+            data[i] = (uint8_t)STKTestRandom(&random);
+        }
+
+        size_t encodedLength = EncodeChunked(data, length, encoded, &random);
+
+        STKHTTPChunkedDecoderInit(&decoder);
+
+        // Reads are often a few bytes so sizes, extensions and line endings are split
+
+        for (size_t position = 0; position < encodedLength;)
+        {
+            size_t size = 1 + STKTestRandom(&random) % (STKTestRandom(&random) % 2 ? 5 : 70000);
+
+            size = size > encodedLength - position ? encodedLength - position : size;
+
+            memcpy(buffer, encoded + position, size);
+
+            uint32_t read = STKHTTPChunkedDecoderProcess(&decoder, buffer, (uint32_t)size);
+
+            memcpy(decoded + decodedLength, buffer, read);
+
+            decodedLength += read;
+            position += size;
+        }
+
+        STK_CHECK(!decoder.error && decoder.complete, "error %d complete %d (round %d)", decoder.error, decoder.complete, round);
+        STK_CHECK(decodedLength == length && memcmp(decoded, data, length) == 0, "decoded %zu of %zu bytes (round %d)", decodedLength, length, round);
+    }
+
+    free(data);
+    free(encoded);
+    free(buffer);
+    free(decoded);
+}
+
+static void TestInvalidChunks(void)
+{
+    uint8_t badSize[] = "zz\r\n";
+    uint8_t missingLineEnd[] = "3\r\nabcX";
+    STKHTTPChunkedDecoder decoder;
+
+    STKHTTPChunkedDecoderInit(&decoder);
+    STKHTTPChunkedDecoderProcess(&decoder, badSize, 4);
+    STK_CHECK(decoder.error, "bad chunk size");
+
+    STKHTTPChunkedDecoderInit(&decoder);
+    STKHTTPChunkedDecoderProcess(&decoder, missingLineEnd, 7);
+    STK_CHECK(decoder.error, "chunk without a line end");
+}
+
+static void Benchmark(void)
+{
+    char header[2048];
+    int headerLength = sprintf(header, "ICY 200 OK\r\n");
+    int iterations = 200000;
+    volatile uint32_t sink = 0;
+
+    for (int i = 0; i < 20; i++)
+    {
+        headerLength += sprintf(header + headerLength, "icy-field-%d: some value for the header %d\r\n", i, i);
+    }
+
+    headerLength += sprintf(header + headerLength, "\r\n");
+
+    double start = STKTestSeconds();
+
+    for (int i = 0; i < iterations; i++)
+    {
+        uint32_t consumed;
+
+        STKHTTPHeaderParserInit(&parser);
+        STKHTTPHeaderParserAppend(&parser, (const uint8_t*)header, (uint32_t)headerLength, &consumed);
+
+        sink += parser.headerLength;
+    }
+
+    double block = STKTestSeconds() - start;
+
+    // The byte at a time scan used before the parser (without the cost of its one byte reads)
+
+    start = STKTestSeconds();
+
+    for (int i = 0; i < iterations; i++)
+    {
+        uint8_t accumulated[2048];
+        int length = 0;
+
+        for (int j = 0; j < headerLength; j++)
+        {
+            accumulated[length++] = header[j];
+
+            if ((length >= 2 && memcmp(accumulated + length - 2, "\n\n", 2) == 0) || (length >= 4 && memcmp(accumulated + length - 4, "\r\n\r\n", 4) == 0))
+            {
+                break;
+            }
+        }
+
+        sink += length;
+    }
+
+    double byteAtATime = STKTestSeconds() - start;
+
+    printf("%d byte ICY header: %.0f ns parsed as a block, %.0f ns scanned a byte at a time\n", headerLength, block * 1e9 / iterations, byteAtATime * 1e9 / iterations);
+
+    // Chunked decoding of 4KB chunks
+
+    size_t length = 64 << 20;
+    uint8_t* data = calloc(length, 1);
+    uint8_t* encoded = malloc(length + length / 256);
+    size_t encodedLength = 0;
+    STKHTTPChunkedDecoder decoder;
+
+    for (size_t i = 0; i < length; i += 4096)
+    {
+        encodedLength += sprintf((char*)encoded + encodedLength, "1000\r\n");
+        memcpy(encoded + encodedLength, data + i, 4096);
+        encodedLength += 4096;
+        encodedLength += sprintf((char*)encoded + encodedLength, "\r\n");
+    }
+
+    STKHTTPChunkedDecoderInit(&decoder);
+
+    start = STKTestSeconds();
+
+    for (size_t position = 0; position < encodedLength; position += 64 * 1024)
+    {
+        uint32_t size = encodedLength - position < 64 * 1024 ? (uint32_t)(encodedLength - position) : 64 * 1024;
+
+        sink += STKHTTPChunkedDecoderProcess(&decoder, encoded + position, size);
+    }
+
+    printf("Chunked decoding: %.0f MB/s\n", encodedLength / 1048576.0 / (STKTestSeconds() - start));
+
+    free(data);
+    free(encoded);
+}
+
+int main(int argc, char** argv)
+{
+    if (STKTestIsBenchmark(argc, argv))
+    {
+        Benchmark();
+
+        return 0;
+    }
+
+    STK_RUN_TEST(TestHeaders);
+    STK_RUN_TEST(TestHeaderTooLarge);
+    STK_RUN_TEST(TestAppend);
+    STK_RUN_TEST(TestChunkedBodies);
+    STK_RUN_TEST(TestInvalidChunks);
+
+    return 0;
+}
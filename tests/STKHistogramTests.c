@@ -0,0 +1,214 @@
+//
+//  STKHistogramTests.c
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#include "STKHistogram.h"
+#include "STKTest.h"
+#include <pthread.h>
+#include <sched.h>
+
+#define THREAD_COUNT (4)
+#define VALUES_PER_THREAD (200000)
+
+static uint64_t BucketTotal(const STKHistogram* histogram)
+{
+    uint64_t retval = 0;
+
+    for (uint32_t i = 0; i < STK_HISTOGRAM_BUCKET_COUNT; i++)
+    {
+        retval += histogram->buckets[i];
+    }
+
+    return retval;
+}
+
+static void TestBuckets(void)
+{
+    static const struct { uint64_t value; uint32_t bucket; } cases[] =
+    {
+        { 0, 0 }, { 1, 1 }, { 2, 2 }, { 3, 2 }, { 4, 3 }, { 7, 3 }, { 8, 4 }, { 1000, 10 }, { 1023, 10 }, { 1024, 11 },
+        { (uint64_t)1 << 40, 41 }, { ((uint64_t)1 << 62) - 1, 62 }, { (uint64_t)1 << 62, 63 }, { UINT64_MAX, 63 }
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        STKHistogram histogram = { 0 };
+
+        STKHistogramRecord(&histogram, cases[i].value);
+
+        STK_CHECK(histogram.buckets[cases[i].bucket] == 1 && BucketTotal(&histogram) == 1, "%llu in bucket %u", (unsigned long long)cases[i].value, cases[i].bucket);
+        STK_CHECK(histogram.count == 1 && histogram.total == cases[i].value && histogram.maximum == cases[i].value, "fields for %llu", (unsigned long long)cases[i].value);
+    }
+}
+
+static void TestPercentile(void)
+{
+    STKHistogram histogram = { 0 };
+
+    STK_CHECK(STKHistogramPercentile(&histogram, 50) == 0, "empty");
+
+    for (uint64_t value = 1; value <= 100; value++)
+    {
+        STKHistogramRecord(&histogram, value);
+    }
+
+    // Percentiles are the upper bound of their bucket: 1, 2-3, 4-7, 8-15, 16-31, 32-63 and 64-127 (bounded by the maximum)
+
+    STK_CHECK(STKHistogramPercentile(&histogram, 0) == 1, "p0 %llu", (unsigned long long)STKHistogramPercentile(&histogram, 0));
+    STK_CHECK(STKHistogramPercentile(&histogram, 1) == 1, "p1");
+    STK_CHECK(STKHistogramPercentile(&histogram, 3) == 3, "p3");
+    STK_CHECK(STKHistogramPercentile(&histogram, 31) == 31, "p31");
+    STK_CHECK(STKHistogramPercentile(&histogram, 50) == 63, "p50 %llu", (unsigned long long)STKHistogramPercentile(&histogram, 50));
+    STK_CHECK(STKHistogramPercentile(&histogram, 64) == 100, "p64");
+    STK_CHECK(STKHistogramPercentile(&histogram, 99) == 100, "p99");
+    STK_CHECK(STKHistogramPercentile(&histogram, 100) == 100, "p100");
+    STK_CHECK(STKHistogramPercentile(&histogram, -5) == 1 && STKHistogramPercentile(&histogram, 500) == 100, "clamped");
+
+    STK_CHECK(histogram.total == 5050 && histogram.count == 100, "total %llu", (unsigned long long)histogram.total);
+
+    // Zeros have a bucket of their own
+
+    STKHistogramReset(&histogram);
+    STK_CHECK(histogram.count == 0 && histogram.maximum == 0 && BucketTotal(&histogram) == 0, "reset");
+
+    STKHistogramRecord(&histogram, 0);
+    STKHistogramRecord(&histogram, 0);
+    STKHistogramRecord(&histogram, 5000);
+
+    STK_CHECK(STKHistogramPercentile(&histogram, 50) == 0, "zeros");
+    STK_CHECK(STKHistogramPercentile(&histogram, 90) == 5000, "bounded by the maximum");
+
+    // The last bucket holds every larger value so only the maximum bounds it
+
+    STKHistogramRecord(&histogram, UINT64_MAX);
+
+    STK_CHECK(STKHistogramPercentile(&histogram, 100) == UINT64_MAX, "p100 of the largest value %llu", (unsigned long long)STKHistogramPercentile(&histogram, 100));
+}
+
+typedef struct
+{
+    STKHistogram* histogram;
+    uint32_t index;
+}
+RecorderContext;
+
+static void* Recorder(void* argument)
+{
+    RecorderContext* context = argument;
+    uint32_t random = context->index + 1;
+
+    // Values grow so threads race to raise the maximum
+
+    for (uint64_t i = 0; i < VALUES_PER_THREAD; i++)
+    {
+        STKHistogramRecord(context->histogram, i * THREAD_COUNT + context->index);
+
+        if (STKTestRandom(&random) % 1024 == 0)
+        {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+static void TestConcurrentRecording(void)
+{
+    static STKHistogram histogram;
+    pthread_t threads[THREAD_COUNT];
+    RecorderContext contexts[THREAD_COUNT];
+    uint64_t lastMaximum = 0;
+    uint64_t lastCount = 0;
+
+    for (uint32_t i = 0; i < THREAD_COUNT; i++)
+    {
+        contexts[i] = (RecorderContext){ &histogram, i };
+
+        pthread_create(&threads[i], NULL, Recorder, &contexts[i]);
+    }
+
+    // Copies taken while recording only ever move forward
+
+    for (int i = 0; i < 1000; i++)
+    {
+        STKHistogram copy;
+
+        STKHistogramCopy(&histogram, &copy);
+
+        STK_CHECK(copy.maximum >= lastMaximum && copy.count >= lastCount, "went backwards");
+
+        lastMaximum = copy.maximum;
+        lastCount = copy.count;
+
+        sched_yield();
+    }
+
+    for (uint32_t i = 0; i < THREAD_COUNT; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    uint64_t valueCount = (uint64_t)THREAD_COUNT * VALUES_PER_THREAD;
+    STKHistogram copy;
+
+    STKHistogramCopy(&histogram, &copy);
+
+    STK_CHECK(copy.count == valueCount && BucketTotal(&copy) == valueCount, "count %llu", (unsigned long long)copy.count);
+    STK_CHECK(copy.maximum == valueCount - 1, "maximum %llu", (unsigned long long)copy.maximum);
+    STK_CHECK(copy.total == valueCount * (valueCount - 1) / 2, "total %llu", (unsigned long long)copy.total);
+}
+
+static volatile uint64_t benchmarkSink;
+
+static void Benchmark(void)
+{
+    static STKHistogram histogram;
+    unsigned long long best = ~0ULL;
+    uint32_t random = 1;
+    uint64_t values[1024];
+
+    for (int i = 0; i < 1024; i++)
+    {
+        values[i] = STKTestRandom(&random) % 20000000;
+    }
+
+    for (int round = 0; round < 20; round++)
+    {
+        unsigned long long start = STKTestCycles();
+
+        for (int i = 0; i < 100; i++)
+        {
+            for (int j = 0; j < 1024; j++)
+            {
+                STKHistogramRecord(&histogram, values[j]);
+            }
+        }
+
+        unsigned long long cycles = STKTestCycles() - start;
+
+        best = cycles < best ? cycles : best;
+    }
+
+    benchmarkSink = STKHistogramPercentile(&histogram, 99);
+
+    printf("%-40s %7.2f cycles per value\n", "record (single writer)", (double)best / (100.0 * 1024));
+}
+
+int main(int argc, char** argv)
+{
+    if (STKTestIsBenchmark(argc, argv))
+    {
+        Benchmark();
+
+        return 0;
+    }
+
+    STK_RUN_TEST(TestBuckets);
+    STK_RUN_TEST(TestPercentile);
+    STK_RUN_TEST(TestConcurrentRecording);
+
+    return 0;
+}
@@ -0,0 +1,284 @@
+//
+//  STKIcyDemuxerTests.c
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#include "STKIcyDemuxer.h"
+#include "STKTest.h"
+
+#define MAX_BLOCKS (64)
+
+typedef struct
+{
+    uint8_t blocks[MAX_BLOCKS][STK_ICY_METADATA_MAXIMUM_LENGTH];
+    uint32_t lengths[MAX_BLOCKS];
+    int count;
+}
+MetadataBlocks;
+
+static void CollectMetadata(void* context, const uint8_t* metadata, uint32_t length)
+{
+    MetadataBlocks* blocks = context;
+
+    STK_CHECK(blocks->count < MAX_BLOCKS, "too many blocks");
+
+    memcpy(blocks->blocks[blocks->count], metadata, length);
+    blocks->lengths[blocks->count++] = length;
+}
+
+static void IgnoreMetadata(void* context, const uint8_t* metadata, uint32_t length)
+{
+    (void)metadata;
+
+    *(uint32_t*)context += length;
+}
+
+/// Checks the fields of metadata printed as key=value| pairs
+static void CheckFields(const char* metadata, uint32_t length, const char* expected)
+{
+    char fields[1024] = "";
+    uint32_t offset = 0;
+    STKIcyMetadataField field;
+
+    while (STKIcyMetadataNextField((const uint8_t*)metadata, length, &offset, &field))
+    {
+        strncat(fields, (const char*)field.key, field.keyLength);
+        strcat(fields, "=");
+        strncat(fields, (const char*)field.value, field.valueLength);
+        strcat(fields, "|");
+    }
+
+    STK_CHECK(strcmp(fields, expected) == 0, "%s read as %s", metadata, fields);
+}
+
+static void TestFields(void)
+{
+    static const char padded[] = "StreamTitle='a';\0\0\0\0junk=1";
+
+    CheckFields("StreamTitle='Artist - Title';StreamUrl='';", 42, "StreamTitle=Artist - Title|StreamUrl=|");
+    CheckFields("StreamTitle='Foo; Bar';StreamUrl='http://x/?a=1';", 48, "StreamTitle=Foo; Bar|StreamUrl=http://x/?a=1|");
+    CheckFields("StreamTitle='It's';", 19, "StreamTitle=It's|");
+    CheckFields("garbage;a=b;", 12, "a=b|");
+    CheckFields("StreamTitle='x'", 15, "StreamTitle=x|");
+    CheckFields("", 0, "");
+
+    // Fields stop at the zero padding
+
+    CheckFields(padded, sizeof(padded) - 1, "StreamTitle=a|");
+}
+
+/// Builds random streams with random metadata, feeds them to the demuxer in random sized reads
+/// (often a few bytes so the length byte and blocks are split) and checks the audio and blocks that come out
+static void TestRandomStreams(void)
+{
+    uint32_t random = 1;
+    static MetadataBlocks expected;
+    static MetadataBlocks actual;
+
+    for (int round = 0; round < 3000; round++)
+    {
+        uint32_t metaint = 1 + STKTestRandom(&random) % 64;
+        uint32_t blockCount = 1 + STKTestRandom(&random) % 20;
+        size_t capacity = blockCount * (metaint + 1 + STK_ICY_METADATA_MAXIMUM_LENGTH) + 64;
+        uint8_t* wire = malloc(capacity);
+        uint8_t* audio = malloc(capacity);
+        uint8_t* output = malloc(capacity);
+        uint8_t* buffer = malloc(capacity);
+        size_t wireLength = 0;
+        size_t audioLength = 0;
+        size_t outputLength = 0;
+        STKIcyDemuxer demuxer;
+
+        expected.count = 0;
+        actual.count = 0;
+
+        for (uint32_t block = 0; block < blockCount; block++)
+        {
+            for (uint32_t i = 0; i < metaint; i++)
+            {
+                uint8_t value = (uint8_t)STKTestRandom(&random);
+
+                wire[wireLength++] = value;
+                audio[audioLength++] = value;
+            }
+
+            // Most length bytes are 0 (no metadata)
+
+            uint32_t units = STKTestRandom(&random) % 3 == 0 ? 1 + STKTestRandom(&random) % 4 : 0;
+
+            wire[wireLength++] = (uint8_t)units;
+
+            for (uint32_t i = 0; i < units * 16; i++)
+            {
+                wire[wireLength++] = 'a' + STKTestRandom(&random) % 26;
+            }
+
+            if (units > 0)
+            {
+                memcpy(expected.blocks[expected.count], wire + wireLength - units * 16, units * 16);
+                expected.lengths[expected.count++] = units * 16;
+            }
+        }
+
+        // The stream can end part way through the audio
+
+        uint32_t tail = STKTestRandom(&random) % metaint;
+
+        for (uint32_t i = 0; i < tail; i++)
+        {
+            uint8_t value = (uint8_t)STKTestRandom(&random);
+
+            wire[wireLength++] = value;
+            audio[audioLength++] = value;
+        }
+
+        STKIcyDemuxerInit(&demuxer, metaint);
+
+        for (size_t position = 0; position < wireLength;)
+        {
+            uint32_t size = 1 + STKTestRandom(&random) % (STKTestRandom(&random) % 2 ? 7 : 5000);
+
+            size = size > wireLength - position ? (uint32_t)(wireLength - position) : size;
+
+            memcpy(buffer, wire + position, size);
+
+            uint32_t audioRead = STKIcyDemuxerProcess(&demuxer, buffer, size, CollectMetadata, &actual);
+
+            STK_CHECK(audioRead <= size, "%u audio bytes out of %u", audioRead, size);
+
+            memcpy(output + outputLength, buffer, audioRead);
+
+            outputLength += audioRead;
+            position += size;
+        }
+
+        STK_CHECK(outputLength == audioLength, "%zu audio bytes expected %zu (round %d)", outputLength, audioLength, round);
+        STK_CHECK(memcmp(output, audio, audioLength) == 0, "audio differs (round %d)", round);
+        STK_CHECK(actual.count == expected.count, "%d blocks expected %d (round %d)", actual.count, expected.count, round);
+
+        for (int i = 0; i < actual.count; i++)
+        {
+            STK_CHECK(actual.lengths[i] == expected.lengths[i] && memcmp(actual.blocks[i], expected.blocks[i], actual.lengths[i]) == 0, "block %d differs (round %d)", i, round);
+        }
+
+        free(wire);
+        free(audio);
+        free(output);
+        free(buffer);
+    }
+}
+
+static void TestLargestBlock(void)
+{
+    uint8_t wire[4 + 1 + STK_ICY_METADATA_MAXIMUM_LENGTH + 4];
+    static MetadataBlocks blocks;
+    STKIcyDemuxer demuxer;
+
+    memset(wire, 'm', sizeof(wire));
+    memcpy(wire, "abcd", 4);
+    wire[4] = 255;
+    memcpy(wire + sizeof(wire) - 4, "efgh", 4);
+
+    blocks.count = 0;
+
+    STKIcyDemuxerInit(&demuxer, 4);
+
+    uint32_t audioRead = STKIcyDemuxerProcess(&demuxer, wire, sizeof(wire), CollectMetadata, &blocks);
+
+    STK_CHECK(audioRead == 8 && memcmp(wire, "abcdefgh", 8) == 0, "audio around the largest block");
+    STK_CHECK(blocks.count == 1 && blocks.lengths[0] == STK_ICY_METADATA_MAXIMUM_LENGTH, "largest block");
+}
+
+static void TestNoMetadata(void)
+{
+    uint8_t bytes[100];
+    uint32_t metadataLength = 0;
+    STKIcyDemuxer demuxer;
+
+    for (int i = 0; i < 100; i++)
+    {
+        bytes[i] = (uint8_t)i;
+    }
+
+    // A metaint of 0 means the stream has no metadata
+
+    STKIcyDemuxerInit(&demuxer, 0);
+
+    STK_CHECK(STKIcyDemuxerProcess(&demuxer, bytes, sizeof(bytes), IgnoreMetadata, &metadataLength) == sizeof(bytes), "passthrough");
+    STK_CHECK(bytes[99] == 99 && metadataLength == 0, "bytes left alone");
+}
+
+/// A 320kbps station with a metaint of 16000 read 64KB at a time
+static void Benchmark(void)
+{
+    size_t total = 256u << 20;
+    uint32_t metaint = 16000;
+    uint32_t readSize = 64 * 1024;
+    uint8_t* wire = malloc(total);
+    uint8_t* buffer = malloc(readSize);
+    uint32_t remaining = metaint;
+    uint32_t metadataLength = 0;
+    size_t wireLength = 0;
+    size_t audioLength = 0;
+    STKIcyDemuxer demuxer;
+
+    while (wireLength < total - 4096)
+    {
+        if (remaining == 0)
+        {
+            uint32_t units = (wireLength / metaint) % 8 == 0 ? 2 : 0;
+
+            wire[wireLength++] = (uint8_t)units;
+
+            memset(wire + wireLength, 'x', units * 16);
+
+            wireLength += units * 16;
+            remaining = metaint;
+        }
+        else
+        {
+            wire[wireLength] = (uint8_t)wireLength;
+            wireLength++;
+            remaining--;
+        }
+    }
+
+    STKIcyDemuxerInit(&demuxer, metaint);
+
+    double start = STKTestSeconds();
+
+    for (size_t position = 0; position < wireLength; position += readSize)
+    {
+        uint32_t size = wireLength - position < readSize ? (uint32_t)(wireLength - position) : readSize;
+
+        memcpy(buffer, wire + position, size);
+
+        audioLength += STKIcyDemuxerProcess(&demuxer, buffer, size, IgnoreMetadata, &metadataLength);
+    }
+
+    double elapsed = STKTestSeconds() - start;
+
+    printf("ICY demuxing: %.0f MB/s (%zu MB of audio and %u bytes of metadata in 64KB reads)\n", wireLength / 1048576.0 / elapsed, audioLength >> 20, metadataLength);
+
+    free(wire);
+    free(buffer);
+}
+
+int main(int argc, char** argv)
+{
+    if (STKTestIsBenchmark(argc, argv))
+    {
+        Benchmark();
+
+        return 0;
+    }
+
+    STK_RUN_TEST(TestFields);
+    STK_RUN_TEST(TestRandomStreams);
+    STK_RUN_TEST(TestLargestBlock);
+    STK_RUN_TEST(TestNoMetadata);
+
+    return 0;
+}
@@ -0,0 +1,310 @@
+//
+//  STKMappedReadTests.c
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#include "STKTest.h"
+#include <fcntl.h>
+#include <stdbool.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+///
+/// The two ways the player can read a local file, reduced to the system calls so they can be compared on any POSIX
+/// system. MappedReader follows STKMappedFileDataSource (readBytesNoCopy:withSize: on a mapping with a readahead
+/// window and a truncation check per read) and ReadCopy follows STKLocalFileDataSource (read into a buffer).
+///
+
+#define READ_SIZE (64 * 1024)
+#define READAHEAD_SIZE (2 * 1024 * 1024)
+#define BENCHMARK_FILE_SIZE (32 * 1024 * 1024)
+
+typedef struct
+{
+    int fd;
+    const uint8_t* bytes;
+    int64_t length;
+    int64_t position;
+    int64_t readaheadPosition;
+}
+MappedReader;
+
+static bool MappedReaderOpen(MappedReader* reader, const char* path)
+{
+    struct stat info;
+
+    memset(reader, 0, sizeof(*reader));
+
+    reader->fd = open(path, O_RDONLY);
+
+    if (reader->fd < 0 || fstat(reader->fd, &info) != 0 || info.st_size == 0)
+    {
+        return false;
+    }
+
+    void* address = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, reader->fd, 0);
+
+    if (address == MAP_FAILED)
+    {
+        return false;
+    }
+
+    posix_madvise(address, (size_t)info.st_size, POSIX_MADV_SEQUENTIAL);
+
+    reader->bytes = address;
+    reader->length = info.st_size;
+
+    return true;
+}
+
+static void MappedReaderClose(MappedReader* reader)
+{
+    if (reader->bytes != NULL)
+    {
+        munmap((void*)reader->bytes, (size_t)reader->length);
+    }
+
+    if (reader->fd >= 0)
+    {
+        close(reader->fd);
+    }
+
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = -1;
+}
+
+/// Points bytes at the next size bytes of the mapping. Returns the number of bytes, 0 at the end or -1 if the file
+/// became shorter than the mapping
+static int MappedReaderRead(MappedReader* reader, const uint8_t** bytes, int size)
+{
+    struct stat info;
+    int64_t remaining = reader->length - reader->position;
+    int read = remaining < size ? (int)remaining : size;
+
+    if (read == 0)
+    {
+        return 0;
+    }
+
+    if (fstat(reader->fd, &info) != 0 || info.st_size < reader->length)
+    {
+        return -1;
+    }
+
+    if (reader->position + read + READAHEAD_SIZE / 2 >= reader->readaheadPosition)
+    {
+        int64_t offset = reader->position > reader->readaheadPosition ? reader->position : reader->readaheadPosition;
+        int64_t start = offset & ~((int64_t)sysconf(_SC_PAGESIZE) - 1);
+        int64_t end = offset + READAHEAD_SIZE < reader->length ? offset + READAHEAD_SIZE : reader->length;
+
+        posix_madvise((void*)(reader->bytes + start), (size_t)(end - start), POSIX_MADV_WILLNEED);
+
+        reader->readaheadPosition = end;
+    }
+
+    *bytes = reader->bytes + reader->position;
+    reader->position += read;
+
+    return read;
+}
+
+/// Reads the file the way a parser would, touching every cache line, and returns the sum of the bytes touched
+static uint64_t ReadMapped(const char* path, int64_t* lengthOut)
+{
+    MappedReader reader;
+    const uint8_t* bytes;
+    uint64_t sum = 0;
+    int read;
+
+    STK_CHECK(MappedReaderOpen(&reader, path), "map %s", path);
+
+    while ((read = MappedReaderRead(&reader, &bytes, READ_SIZE)) > 0)
+    {
+        for (int i = 0; i < read; i += 64)
+        {
+            sum += bytes[i];
+        }
+    }
+
+    *lengthOut = reader.position;
+
+    MappedReaderClose(&reader);
+
+    return sum;
+}
+
+static uint64_t ReadCopy(const char* path, int64_t* lengthOut)
+{
+    static uint8_t buffer[READ_SIZE];
+    int fd = open(path, O_RDONLY);
+    uint64_t sum = 0;
+    ssize_t read;
+
+    STK_CHECK(fd >= 0, "open %s", path);
+
+    *lengthOut = 0;
+
+    while ((read = pread(fd, buffer, READ_SIZE, *lengthOut)) > 0)
+    {
+        for (ssize_t i = 0; i < read; i += 64)
+        {
+            sum += buffer[i];
+        }
+
+        *lengthOut += read;
+    }
+
+    close(fd);
+
+    return sum;
+}
+
+/// Writes a file of length bytes that don't repeat within a page to a new temporary file and returns its path
+static char* WriteFile(int64_t length)
+{
+    char* path = strdup("/tmp/STKMappedReadTests.XXXXXX");
+    int fd = mkstemp(path);
+    uint8_t* chunk = malloc(READ_SIZE);
+
+    STK_CHECK(fd >= 0, "create %s", path);
+
+    for (int64_t offset = 0; offset < length; offset += READ_SIZE)
+    {
+        size_t size = (size_t)(length - offset < READ_SIZE ? length - offset : READ_SIZE);
+
+        for (size_t i = 0; i < size; i++)
+        {
+            chunk[i] = (uint8_t)((offset + i) * 31 + (offset + i) / 4096);
+        }
+
+        STK_CHECK(write(fd, chunk, size) == (ssize_t)size, "write");
+    }
+
+    close(fd);
+    free(chunk);
+
+    return path;
+}
+
+static void TestSameBytes(void)
+{
+    int64_t length = 5 * 1024 * 1024 + 123;
+    char* path = WriteFile(length);
+    MappedReader reader;
+    const uint8_t* bytes;
+    int64_t mappedLength;
+    int64_t copiedLength;
+    int read;
+
+    STK_CHECK(ReadMapped(path, &mappedLength) == ReadCopy(path, &copiedLength), "sums");
+    STK_CHECK(mappedLength == length && copiedLength == length, "lengths %lld and %lld", (long long)mappedLength, (long long)copiedLength);
+
+    // Every byte, not just the ones touched by the sum
+
+    STK_CHECK(MappedReaderOpen(&reader, path), "map");
+
+    while ((read = MappedReaderRead(&reader, &bytes, READ_SIZE)) > 0)
+    {
+        int64_t offset = reader.position - read;
+
+        for (int i = 0; i < read; i++)
+        {
+            STK_CHECK(bytes[i] == (uint8_t)((offset + i) * 31 + (offset + i) / 4096), "byte %lld", (long long)(offset + i));
+        }
+    }
+
+    STK_CHECK(reader.position == length && reader.readaheadPosition == length, "read to the end");
+
+    MappedReaderClose(&reader);
+    unlink(path);
+    free(path);
+}
+
+static void TestTruncation(void)
+{
+    char* path = WriteFile(4 * 1024 * 1024);
+    MappedReader reader;
+    const uint8_t* bytes;
+
+    STK_CHECK(MappedReaderOpen(&reader, path), "map");
+    STK_CHECK(MappedReaderRead(&reader, &bytes, READ_SIZE) == READ_SIZE, "read before truncating");
+
+    // Touching pages past the new end would raise SIGBUS so the read has to fail first
+
+    STK_CHECK(truncate(path, READ_SIZE) == 0, "truncate");
+    STK_CHECK(MappedReaderRead(&reader, &bytes, READ_SIZE) == -1, "read after truncating");
+
+    MappedReaderClose(&reader);
+    unlink(path);
+    free(path);
+}
+
+/// Prints the best time of runs reads of the file each way. Cold runs drop the file's pages first where the system
+/// can be asked to
+static void BenchmarkReads(const char* path, int runs, bool cold)
+{
+    double best[2] = { 1e9, 1e9 };
+
+    for (int run = 0; run < runs; run++)
+    {
+        for (int mapped = 0; mapped < 2; mapped++)
+        {
+            int64_t length;
+
+            if (cold)
+            {
+#ifdef POSIX_FADV_DONTNEED
+                int fd = open(path, O_RDONLY);
+
+                fdatasync(fd);
+                posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+                close(fd);
+#endif
+            }
+
+            double start = STKTestSeconds();
+            uint64_t sum = mapped ? ReadMapped(path, &length) : ReadCopy(path, &length);
+            double seconds = STKTestSeconds() - start;
+
+            STK_CHECK(sum != 0 && length == BENCHMARK_FILE_SIZE, "read %lld bytes", (long long)length);
+
+            best[mapped] = seconds < best[mapped] ? seconds : best[mapped];
+        }
+    }
+
+    printf("%s cache, %dMB in %dKB reads\n", cold ? "cold" : "warm", BENCHMARK_FILE_SIZE / (1024 * 1024), READ_SIZE / 1024);
+    printf("    %-30s %8.2f ms %8.0f MB/s\n", "read and copy", best[0] * 1e3, BENCHMARK_FILE_SIZE / best[0] / 1e6);
+    printf("    %-30s %8.2f ms %8.0f MB/s\n", "mapped", best[1] * 1e3, BENCHMARK_FILE_SIZE / best[1] / 1e6);
+}
+
+static void Benchmark(void)
+{
+    char* path = WriteFile(BENCHMARK_FILE_SIZE);
+
+    BenchmarkReads(path, 10, false);
+
+#ifdef POSIX_FADV_DONTNEED
+    BenchmarkReads(path, 3, true);
+#endif
+
+    unlink(path);
+    free(path);
+}
+
+int main(int argc, char** argv)
+{
+    if (STKTestIsBenchmark(argc, argv))
+    {
+        Benchmark();
+
+        return 0;
+    }
+
+    STK_RUN_TEST(TestSameBytes);
+    STK_RUN_TEST(TestTruncation);
+
+    return 0;
+}
@@ -0,0 +1,302 @@
+//
+//  STKMeterTests.c
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#include "STKMeter.h"
+#include "STKTest.h"
+#include <float.h>
+#include <math.h>
+
+#define MAX_CHANNELS (9)
+#define MAX_FRAMES (1031)
+
+/// Peak and RMS in dBFS of one channel computed in double precision one sample at a time
+static void ReferenceMeter(const float* samples, uint32_t frameCount, uint32_t stride, double scale, float* peakDb, float* averageDb)
+{
+    double peak = 0;
+    double sum = 0;
+
+    for (uint32_t i = 0; i < frameCount; i++)
+    {
+        double value = samples[i * stride] * scale;
+
+        peak = fabs(value) > peak ? fabs(value) : peak;
+        sum += value * value;
+    }
+
+    double peakDecibels = peak > 0 ? 20 * log10(peak) : STK_METER_DB_MIN;
+    double averageDecibels = sum > 0 ? 10 * log10(sum / frameCount) : STK_METER_DB_MIN;
+
+    *peakDb = (float)fmin(fmax(peakDecibels, STK_METER_DB_MIN), 0);
+    *averageDb = (float)fmin(fmax(averageDecibels, STK_METER_DB_MIN), 0);
+}
+
+/// Random samples at a different level per channel so a sample measured on the wrong channel shows up
+static void FillSamples(float* samples, uint32_t count, uint32_t channelCount, uint32_t* random)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        float level = 1.0f / (float)(1 + (i % channelCount) * 3);
+
+        samples[i] = ((float)(STKTestRandom(random) % 65535) / 32767.0f - 1.0f) * level;
+    }
+}
+
+static void CheckAgainstReference(uint32_t channelCount, STKMeterSampleFormat format, bool nonInterleaved, uint32_t frameCount, uint32_t* random)
+{
+    static float samples[MAX_CHANNELS * MAX_FRAMES];
+    static float planes[MAX_CHANNELS][MAX_FRAMES];
+    static int16_t samples16[MAX_CHANNELS * MAX_FRAMES];
+    static int16_t planes16[MAX_CHANNELS][MAX_FRAMES];
+    const void* buffers[MAX_CHANNELS];
+    STKMeter meter;
+
+    FillSamples(samples, channelCount * frameCount, channelCount, random);
+
+    // Measure the int16 samples exactly as the meter sees them
+
+    for (uint32_t i = 0; i < channelCount * frameCount; i++)
+    {
+        samples16[i] = (int16_t)lrintf(samples[i] * 32767.0f);
+
+        if (format == STKMeterSampleFormatInt16)
+        {
+            samples[i] = samples16[i];
+        }
+    }
+
+    for (uint32_t channel = 0; channel < channelCount; channel++)
+    {
+        for (uint32_t i = 0; i < frameCount; i++)
+        {
+            planes[channel][i] = samples[i * channelCount + channel];
+            planes16[channel][i] = samples16[i * channelCount + channel];
+        }
+
+        buffers[channel] = format == STKMeterSampleFormatInt16 ? (const void*)planes16[channel] : (const void*)planes[channel];
+    }
+
+    if (!nonInterleaved)
+    {
+        buffers[0] = format == STKMeterSampleFormatInt16 ? (const void*)samples16 : (const void*)samples;
+    }
+
+    STK_CHECK(STKMeterInit(&meter, channelCount, format, nonInterleaved), "init");
+
+    STKMeterProcess(&meter, buffers, frameCount);
+
+    for (uint32_t channel = 0; channel < channelCount; channel++)
+    {
+        float peakDb;
+        float averageDb;
+
+        ReferenceMeter(samples + channel, frameCount, channelCount, format == STKMeterSampleFormatInt16 ? 1.0 / 32768.0 : 1.0, &peakDb, &averageDb);
+
+        STK_CHECK(fabsf(STKMeterPeakPowerDb(&meter, channel) - peakDb) < 0.01f, "peak %.3f expected %.3f (channel %u of %u, %u frames, format %d, non-interleaved %d)",
+                  STKMeterPeakPowerDb(&meter, channel), peakDb, channel, channelCount, frameCount, format, nonInterleaved);
+        STK_CHECK(fabsf(STKMeterAveragePowerDb(&meter, channel) - averageDb) < 0.01f, "average %.3f expected %.3f (channel %u of %u, %u frames, format %d, non-interleaved %d)",
+                  STKMeterAveragePowerDb(&meter, channel), averageDb, channel, channelCount, frameCount, format, nonInterleaved);
+    }
+
+    STKMeterDestroy(&meter);
+}
+
+static void TestMatchesReference(void)
+{
+    static const uint32_t frameCounts[] = { 1, 3, 4, 7, 64, 333, 1024, MAX_FRAMES };
+    uint32_t random = 7;
+
+    for (uint32_t channelCount = 1; channelCount <= MAX_CHANNELS; channelCount++)
+    {
+        for (size_t i = 0; i < sizeof(frameCounts) / sizeof(frameCounts[0]); i++)
+        {
+            CheckAgainstReference(channelCount, STKMeterSampleFormatInt16, false, frameCounts[i], &random);
+            CheckAgainstReference(channelCount, STKMeterSampleFormatFloat32, false, frameCounts[i], &random);
+            CheckAgainstReference(channelCount, STKMeterSampleFormatInt16, true, frameCounts[i], &random);
+            CheckAgainstReference(channelCount, STKMeterSampleFormatFloat32, true, frameCounts[i], &random);
+        }
+    }
+}
+
+static void TestFullScaleSine(void)
+{
+    float samples[2 * 4410];
+    const void* buffers[] = { samples };
+    STKMeter meter;
+
+    // A full scale sine peaks at 0dBFS and averages -3dBFS, the other channel is silent
+
+    for (int i = 0; i < 4410; i++)
+    {
+        samples[i * 2] = (float)sin(2 * 3.14159265358979323846 * 441 * i / 44100.0);
+        samples[i * 2 + 1] = 0;
+    }
+
+    STK_CHECK(STKMeterInit(&meter, 2, STKMeterSampleFormatFloat32, false), "init");
+
+    STKMeterProcess(&meter, buffers, 4410);
+
+    STK_CHECK(fabsf(STKMeterPeakPowerDb(&meter, 0)) < 0.01f, "peak %.3f", STKMeterPeakPowerDb(&meter, 0));
+    STK_CHECK(fabsf(STKMeterAveragePowerDb(&meter, 0) + 3.01f) < 0.01f, "average %.3f", STKMeterAveragePowerDb(&meter, 0));
+    STK_CHECK(STKMeterPeakPowerDb(&meter, 1) == STK_METER_DB_MIN, "silent peak %.3f", STKMeterPeakPowerDb(&meter, 1));
+    STK_CHECK(STKMeterAveragePowerDb(&meter, 1) == STK_METER_DB_MIN, "silent average %.3f", STKMeterAveragePowerDb(&meter, 1));
+
+    // Samples over full scale are clamped
+
+    samples[0] = 4;
+    STKMeterProcess(&meter, buffers, 4410);
+    STK_CHECK(STKMeterPeakPowerDb(&meter, 0) == 0, "clipped peak %.3f", STKMeterPeakPowerDb(&meter, 0));
+
+    STKMeterDestroy(&meter);
+}
+
+static void TestInvalidChannelAndReset(void)
+{
+    int16_t samples[] = { 32767, -32768, 32767, -32768 };
+    const void* buffers[] = { samples };
+    STKMeter meter;
+
+    STK_CHECK(!STKMeterInit(&meter, 0, STKMeterSampleFormatInt16, false), "init with no channels");
+    STK_CHECK(STKMeterInit(&meter, 2, STKMeterSampleFormatInt16, false), "init");
+
+    STK_CHECK(STKMeterPeakPowerDb(&meter, 0) == STK_METER_DB_MIN, "peak before any block");
+
+    STKMeterProcess(&meter, buffers, 2);
+
+    STK_CHECK(STKMeterPeakPowerDb(&meter, 1) > -0.01f, "peak %.3f", STKMeterPeakPowerDb(&meter, 1));
+    STK_CHECK(STKMeterPeakPowerDb(&meter, 2) == STK_METER_DB_MIN, "peak of a channel the meter doesn't have");
+    STK_CHECK(STKMeterAveragePowerDb(&meter, UINT32_MAX) == STK_METER_DB_MIN, "average of a channel the meter doesn't have");
+
+    // Empty blocks leave the last values alone
+
+    STKMeterProcess(&meter, buffers, 0);
+    STK_CHECK(STKMeterPeakPowerDb(&meter, 1) > -0.01f, "peak after an empty block");
+
+    STKMeterReset(&meter);
+    STK_CHECK(STKMeterPeakPowerDb(&meter, 1) == STK_METER_DB_MIN, "peak after reset");
+    STK_CHECK(STKMeterAveragePowerDb(&meter, 0) == STK_METER_DB_MIN, "average after reset");
+
+    STKMeterDestroy(&meter);
+}
+
+// The per-sample meter the player used before STKMeter (stereo int16 only)
+
+#define STK_DBMIN (-60)
+#define STK_DBOFFSET (-74.0)
+#define STK_LOWPASSFILTERTIMESLICE (0.0005)
+
+#define CALCULATE_METER(channel) \
+    float currentFilteredValueOfSampleAmplitude##channel = STK_LOWPASSFILTERTIMESLICE * absoluteValueOfSampleAmplitude##channel + (1.0 - STK_LOWPASSFILTERTIMESLICE) * previousFilteredValueOfSampleAmplitude##channel; \
+    previousFilteredValueOfSampleAmplitude##channel = currentFilteredValueOfSampleAmplitude##channel; \
+    float sampleDB##channel = 20.0 * log10(currentFilteredValueOfSampleAmplitude##channel) + STK_DBOFFSET; \
+    if ((sampleDB##channel == sampleDB##channel) && (sampleDB##channel != -DBL_MAX)) \
+    { \
+        if (sampleDB##channel > peakValue##channel) \
+        { \
+            peakValue##channel = sampleDB##channel; \
+        } \
+        if (sampleDB##channel > -DBL_MAX) \
+        { \
+            count##channel++; \
+            totalValue##channel += sampleDB##channel; \
+        } \
+        decibels##channel = peakValue##channel; \
+    }
+
+static volatile float benchmarkSink;
+
+static void OldMeter(const int16_t* samples, uint32_t frameCount)
+{
+    uint32_t countLeft = 0, countRight = 0;
+    float decibelsLeft = STK_DBMIN, peakValueLeft = STK_DBMIN, previousFilteredValueOfSampleAmplitudeLeft = 0;
+    float decibelsRight = STK_DBMIN, peakValueRight = STK_DBMIN, previousFilteredValueOfSampleAmplitudeRight = 0;
+    double totalValueLeft = 0, totalValueRight = 0;
+
+    for (uint32_t i = 0; i < frameCount * 2; i += 2)
+    {
+        float absoluteValueOfSampleAmplitudeLeft = abs(samples[i]);
+        float absoluteValueOfSampleAmplitudeRight = abs(samples[i + 1]);
+
+        CALCULATE_METER(Left);
+        CALCULATE_METER(Right);
+    }
+
+    benchmarkSink = decibelsLeft + decibelsRight + (float)(totalValueLeft / countLeft) + (float)(totalValueRight / countRight);
+}
+
+static void Benchmark(void)
+{
+    enum { frameCount = 1024, iterations = 20000 };
+    static int16_t samples16[frameCount * 2];
+    static float samples[frameCount * 6];
+    const void* buffers16[] = { samples16 };
+    const void* buffers[] = { samples };
+    STKMeter stereo;
+    STKMeter surround;
+
+    for (int i = 0; i < frameCount * 2; i++)
+    {
+        samples16[i] = (int16_t)(sin(i * 0.01) * 16384);
+    }
+
+    for (int i = 0; i < frameCount * 6; i++)
+    {
+        samples[i] = (float)sin(i * 0.01) * 0.5f;
+    }
+
+    STK_CHECK(STKMeterInit(&stereo, 2, STKMeterSampleFormatInt16, false), "init");
+    STK_CHECK(STKMeterInit(&surround, 6, STKMeterSampleFormatFloat32, false), "init");
+
+    double start = STKTestSeconds();
+
+    for (int i = 0; i < iterations; i++)
+    {
+        OldMeter(samples16, frameCount);
+    }
+
+    double old = STKTestSeconds() - start;
+
+    start = STKTestSeconds();
+
+    for (int i = 0; i < iterations; i++)
+    {
+        STKMeterProcess(&stereo, buffers16, frameCount);
+    }
+
+    double stereoElapsed = STKTestSeconds() - start;
+
+    start = STKTestSeconds();
+
+    for (int i = 0; i < iterations; i++)
+    {
+        STKMeterProcess(&surround, buffers, frameCount);
+    }
+
+    double surroundElapsed = STKTestSeconds() - start;
+
+    printf("CALCULATE_METER int16 stereo: %.2f ns/frame\n", old / frameCount / iterations * 1e9);
+    printf("STKMeter int16 stereo:        %.2f ns/frame (%.0fx faster)\n", stereoElapsed / frameCount / iterations * 1e9, old / stereoElapsed);
+    printf("STKMeter float32 6 channels:  %.2f ns/frame\n", surroundElapsed / frameCount / iterations * 1e9);
+
+    STKMeterDestroy(&stereo);
+    STKMeterDestroy(&surround);
+}
+
+int main(int argc, char** argv)
+{
+    if (STKTestIsBenchmark(argc, argv))
+    {
+        Benchmark();
+
+        return 0;
+    }
+
+    STK_RUN_TEST(TestMatchesReference);
+    STK_RUN_TEST(TestFullScaleSine);
+    STK_RUN_TEST(TestInvalidChannelAndReset);
+
+    return 0;
+}
@@ -0,0 +1,254 @@
+//
+//  STKPacketQueueTests.c
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#include "STKPacketQueue.h"
+#include "STKTest.h"
+#include <pthread.h>
+#include <sched.h>
+
+#define STRESS_RECORD_COUNT (200000)
+
+static STKPacketQueue queue;
+
+/// Pushes a record whose payloads are filled with bytes derived from index. Returns false if it didn't fit
+static bool PushRecord(uint32_t index, uint32_t descriptionsSize, uint32_t dataSize)
+{
+    void* descriptions;
+    void* data;
+
+    if (!STKPacketQueueBeginPush(&queue, descriptionsSize, dataSize, &descriptions, &data))
+    {
+        return false;
+    }
+
+    memset(descriptions, (uint8_t)index, descriptionsSize);
+    memset(data, (uint8_t)(index + 1), dataSize);
+
+    STKPacketQueueEndPush(&queue, index, descriptionsSize / 16, dataSize, (void*)(uintptr_t)dataSize);
+
+    return true;
+}
+
+/// Checks the payloads of a record pushed by PushRecord
+static void CheckRecord(const STKPacketQueueRecord* record, uint32_t index)
+{
+    STK_CHECK(record->type == index, "record %u read as %u", index, record->type);
+    STK_CHECK((uintptr_t)record->context == record->dataSize && record->frames == record->dataSize, "record %u sizes", index);
+    STK_CHECK(record->count * 16 == record->descriptionsSize, "record %u count", index);
+
+    for (uint32_t i = 0; i < record->descriptionsSize; i++)
+    {
+        STK_CHECK(((const uint8_t*)record->descriptions)[i] == (uint8_t)index, "record %u descriptions", index);
+    }
+
+    for (uint32_t i = 0; i < record->dataSize; i++)
+    {
+        STK_CHECK(((const uint8_t*)record->data)[i] == (uint8_t)(index + 1), "record %u data", index);
+    }
+}
+
+static void TestFillAndDrain(void)
+{
+    STKPacketQueueRecord record;
+    uint32_t count = 0;
+
+    STK_CHECK(STKPacketQueueInit(&queue, 4096 + 3), "init");
+    STK_CHECK(queue.capacity % 8 == 0 && queue.capacity >= 4096, "capacity %u", queue.capacity);
+    STK_CHECK(STKPacketQueueIsEmpty(&queue) && !STKPacketQueuePeek(&queue, &record), "empty");
+
+    while (PushRecord(count, 32, 300))
+    {
+        count++;
+    }
+
+    STK_CHECK(count > 5, "%u records fit", count);
+    STK_CHECK(STKPacketQueueUsedBytes(&queue) + STKPacketQueueFreeBytes(&queue) == queue.capacity, "used and free bytes");
+    STK_CHECK(STKPacketQueueFrameCount(&queue) == count * 300ull, "frames %llu", (unsigned long long)STKPacketQueueFrameCount(&queue));
+
+    // Records without payloads are smaller so one may still fit
+
+    while (STKPacketQueuePush(&queue, count, 0, 0, NULL))
+    {
+        count++;
+    }
+
+    for (uint32_t i = 0; STKPacketQueuePeek(&queue, &record); i++)
+    {
+        STK_CHECK(record.type == i, "record %u read as %u", i, record.type);
+
+        STKPacketQueuePop(&queue);
+    }
+
+    STK_CHECK(STKPacketQueueIsEmpty(&queue) && STKPacketQueueUsedBytes(&queue) == 0, "drained");
+    STK_CHECK(STKPacketQueueFrameCount(&queue) == 0, "no frames left");
+
+    STKPacketQueueDestroy(&queue);
+}
+
+static void TestWrapAround(void)
+{
+    STKPacketQueueRecord record;
+    uint32_t random = 4;
+    uint32_t pushed = 0;
+    uint32_t popped = 0;
+
+    STK_CHECK(STKPacketQueueInit(&queue, 8192), "init");
+
+    // Records of random sizes keep landing near the end of the buffer so some start again at the beginning
+
+    for (int round = 0; round < 100000; round++)
+    {
+        if (STKTestRandom(&random) % 2)
+        {
+            uint32_t descriptionsSize = (STKTestRandom(&random) % 5) * 16;
+            uint32_t dataSize = STKTestRandom(&random) % 2000;
+
+            if (PushRecord(pushed, descriptionsSize, dataSize))
+            {
+                pushed++;
+            }
+        }
+        else if (STKPacketQueuePeek(&queue, &record))
+        {
+            CheckRecord(&record, popped++);
+
+            STKPacketQueuePop(&queue);
+        }
+    }
+
+    STK_CHECK(pushed > 10000 && pushed - popped < 100, "%u pushed and %u popped", pushed, popped);
+
+    // Records larger than the queue never fit
+
+    void* descriptions;
+    void* data;
+
+    STK_CHECK(!STKPacketQueueBeginPush(&queue, 0, queue.capacity, &descriptions, &data), "oversized record");
+
+    STKPacketQueueDestroy(&queue);
+}
+
+/// Reserving again without publishing replaces the reservation, which a producer waiting for room relies on
+static void TestReserveAgain(void)
+{
+    STKPacketQueueRecord record;
+    void* descriptions;
+    void* data;
+
+    STK_CHECK(STKPacketQueueInit(&queue, 4096), "init");
+
+    STK_CHECK(STKPacketQueueBeginPush(&queue, 0, 100, &descriptions, &data), "first reservation");
+    STK_CHECK(STKPacketQueueIsEmpty(&queue), "reservations aren't visible");
+    STK_CHECK(PushRecord(7, 16, 200), "second reservation");
+    STK_CHECK(STKPacketQueuePeek(&queue, &record), "published");
+
+    CheckRecord(&record, 7);
+
+    STKPacketQueueDestroy(&queue);
+}
+
+static void* Producer(void* argument)
+{
+    uint32_t random = 5;
+
+    (void)argument;
+
+    for (uint32_t i = 0; i < STRESS_RECORD_COUNT;)
+    {
+        uint32_t descriptionsSize = (STKTestRandom(&random) % 5) * 16;
+        uint32_t dataSize = STKTestRandom(&random) % 3000;
+
+        while (!PushRecord(i, descriptionsSize, dataSize))
+        {
+            sched_yield();
+        }
+
+        i++;
+    }
+
+    return NULL;
+}
+
+static void TestProducerAndConsumerThreads(void)
+{
+    pthread_t producer;
+    STKPacketQueueRecord record;
+
+    STK_CHECK(STKPacketQueueInit(&queue, 64 * 1024 + 3), "init");
+
+    pthread_create(&producer, NULL, Producer, NULL);
+
+    for (uint32_t i = 0; i < STRESS_RECORD_COUNT;)
+    {
+        if (!STKPacketQueuePeek(&queue, &record))
+        {
+            sched_yield();
+
+            continue;
+        }
+
+        CheckRecord(&record, i++);
+
+        STKPacketQueuePop(&queue);
+    }
+
+    pthread_join(producer, NULL);
+
+    STK_CHECK(STKPacketQueueIsEmpty(&queue) && STKPacketQueueFrameCount(&queue) == 0, "drained");
+
+    STKPacketQueueDestroy(&queue);
+}
+
+/// Pushes and pops 400 byte records (about a 128kbps MP3 frame) through a 512KB queue
+static void Benchmark(void)
+{
+    int iterations = 20000000;
+    STKPacketQueueRecord record;
+    void* descriptions;
+    void* data;
+
+    STKPacketQueueInit(&queue, 512 * 1024);
+
+    double start = STKTestSeconds();
+
+    for (int i = 0; i < iterations; i++)
+    {
+        if (STKPacketQueueBeginPush(&queue, 16, 400, &descriptions, &data))
+        {
+            STKPacketQueueEndPush(&queue, 0, 1, 1152, NULL);
+        }
+
+        if (i % 2 == 1)
+        {
+            STKPacketQueuePeek(&queue, &record);
+            STKPacketQueuePop(&queue);
+            STKPacketQueuePeek(&queue, &record);
+            STKPacketQueuePop(&queue);
+        }
+    }
+
+    printf("Packet queue: %.1f ns per push and pop\n", (STKTestSeconds() - start) * 1e9 / iterations);
+
+    STKPacketQueueDestroy(&queue);
+}
+
+int main(int argc, char** argv)
+{
+    if (STKTestIsBenchmark(argc, argv))
+    {
+        Benchmark();
+
+        return 0;
+    }
+
+    STK_RUN_TEST(TestFillAndDrain);
+    STK_RUN_TEST(TestWrapAround);
+    STK_RUN_TEST(TestReserveAgain);
+    STK_RUN_TEST(TestProducerAndConsumerThreads);
+
+    return 0;
+}
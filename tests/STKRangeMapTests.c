@@ -0,0 +1,162 @@
+//
+//  STKRangeMapTests.c
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#include "STKRangeMap.h"
+#include "STKTest.h"
+
+#define BYTE_COUNT (2000)
+
+/// Checks the map against a byte per offset model of which offsets are present
+static void CheckAgainstModel(const STKRangeMap* map, const uint8_t* present)
+{
+    uint64_t total = 0;
+
+    for (int i = 0; i < BYTE_COUNT; i++)
+    {
+        total += present[i];
+    }
+
+    STK_CHECK(STKRangeMapTotal(map) == total, "total %llu expected %llu", (unsigned long long)STKRangeMapTotal(map), (unsigned long long)total);
+
+    // Ranges stay sorted with a gap between neighbours
+
+    for (uint32_t i = 1; i < map->count; i++)
+    {
+        STK_CHECK(map->ranges[i * 2] > map->ranges[(i - 1) * 2 + 1], "range %u overlaps or touches the one before", i);
+    }
+
+    for (int offset = 0; offset < BYTE_COUNT; offset++)
+    {
+        uint64_t length = 0;
+        uint64_t next = UINT64_MAX;
+
+        for (int i = offset; i < BYTE_COUNT && present[i]; i++)
+        {
+            length++;
+        }
+
+        for (int i = offset + 1; i < BYTE_COUNT; i++)
+        {
+            if (present[i] && !present[i - 1])
+            {
+                next = i;
+
+                break;
+            }
+        }
+
+        STK_CHECK(STKRangeMapContiguousLength(map, offset) == length, "contiguous length at %d", offset);
+        STK_CHECK(STKRangeMapNextStart(map, offset) == next, "next start after %d", offset);
+    }
+}
+
+static void TestRandomAdds(void)
+{
+    uint32_t random = 7;
+
+    for (int round = 0; round < 200; round++)
+    {
+        uint8_t present[BYTE_COUNT] = { 0 };
+        STKRangeMap map;
+
+        STKRangeMapInit(&map);
+
+        for (int i = 0; i < 60; i++)
+        {
+            uint64_t start = STKTestRandom(&random) % BYTE_COUNT;
+            uint64_t end = start + STKTestRandom(&random) % 80;
+
+            end = end > BYTE_COUNT ? BYTE_COUNT : end;
+
+            STK_CHECK(STKRangeMapAdd(&map, start, end), "add");
+
+            for (uint64_t offset = start; offset < end; offset++)
+            {
+                present[offset] = 1;
+            }
+        }
+
+        CheckAgainstModel(&map, present);
+
+        STKRangeMapDestroy(&map);
+    }
+}
+
+static void TestMerging(void)
+{
+    STKRangeMap map;
+
+    STKRangeMapInit(&map);
+
+    STK_CHECK(STKRangeMapAdd(&map, 10, 20) && STKRangeMapAdd(&map, 30, 40) && STKRangeMapAdd(&map, 50, 60), "add");
+    STK_CHECK(map.count == 3, "count %u", map.count);
+
+    // Empty ranges are ignored and adjacent ranges merge
+
+    STK_CHECK(STKRangeMapAdd(&map, 25, 25) && map.count == 3, "empty range");
+    STK_CHECK(STKRangeMapAdd(&map, 20, 30) && map.count == 2, "adjacent ranges");
+    STK_CHECK(STKRangeMapContiguousLength(&map, 10) == 30, "merged length");
+
+    // A range covering several merges them all
+
+    STK_CHECK(STKRangeMapAdd(&map, 5, 55) && map.count == 1, "covering range");
+    STK_CHECK(map.ranges[0] == 5 && map.ranges[1] == 60 && STKRangeMapTotal(&map) == 55, "merged range");
+
+    STKRangeMapClear(&map);
+    STK_CHECK(map.count == 0 && STKRangeMapTotal(&map) == 0 && STKRangeMapNextStart(&map, 0) == UINT64_MAX, "clear");
+
+    STKRangeMapDestroy(&map);
+}
+
+static void TestSerialization(void)
+{
+    uint8_t buffer[1024];
+    STKRangeMap map;
+    STKRangeMap copy;
+
+    STKRangeMapInit(&map);
+    STKRangeMapInit(&copy);
+
+    for (uint64_t i = 0; i < 20; i++)
+    {
+        STK_CHECK(STKRangeMapAdd(&map, i * 100, i * 100 + 50), "add");
+    }
+
+    size_t size = STKRangeMapSerializedSize(&map);
+
+    STK_CHECK(size <= sizeof(buffer), "serialized size %zu", size);
+
+    STKRangeMapSerialize(&map, buffer);
+
+    STK_CHECK(STKRangeMapDeserialize(&copy, buffer, size), "deserialize");
+    STK_CHECK(copy.count == map.count && STKRangeMapTotal(&copy) == STKRangeMapTotal(&map), "copy");
+    STK_CHECK(memcmp(copy.ranges, map.ranges, map.count * 2 * sizeof(uint64_t)) == 0, "copied ranges");
+
+    // Truncated or corrupt data leaves the map empty
+
+    STK_CHECK(!STKRangeMapDeserialize(&copy, buffer, size - 1) && copy.count == 0, "truncated");
+    STK_CHECK(!STKRangeMapDeserialize(&copy, buffer, 3) && copy.count == 0, "short header");
+
+    buffer[0] ^= 0xff;
+
+    STK_CHECK(!STKRangeMapDeserialize(&copy, buffer, size) && copy.count == 0, "bad magic");
+
+    STKRangeMapDestroy(&map);
+    STKRangeMapDestroy(&copy);
+}
+
+int main(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    STK_RUN_TEST(TestRandomAdds);
+    STK_RUN_TEST(TestMerging);
+    STK_RUN_TEST(TestSerialization);
+
+    return 0;
+}
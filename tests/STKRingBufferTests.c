@@ -0,0 +1,481 @@
+//
+//  STKRingBufferTests.c
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#include "STKRingBuffer.h"
+#include "STKTest.h"
+#include <pthread.h>
+#include <sched.h>
+
+/// Frames hold a counter and its complement so a frame that is half overwritten is caught
+typedef struct
+{
+    uint32_t value;
+    uint32_t check;
+}
+Frame;
+
+static void WriteFrames(STKRingBuffer* ring, uint32_t* next, uint32_t count)
+{
+    while (count > 0)
+    {
+        void* region;
+        uint32_t available = STKRingBufferBeginWrite(ring, &region);
+
+        STK_CHECK(available > 0, "no room to write %u frames", count);
+
+        uint32_t n = available < count ? available : count;
+        Frame* frames = region;
+
+        for (uint32_t i = 0; i < n; i++)
+        {
+            frames[i].value = *next;
+            frames[i].check = ~*next;
+            (*next)++;
+        }
+
+        STKRingBufferEndWrite(ring, n);
+
+        count -= n;
+    }
+}
+
+static void TestWrapAround(void)
+{
+    STKRingBuffer ring;
+    uint32_t next = 0;
+    uint32_t expected = 0;
+    Frame frames[7];
+    void* destinations[] = { frames };
+
+    STK_CHECK(STKRingBufferInit(&ring, 10, sizeof(Frame), 1), "init");
+
+    for (int round = 0; round < 100; round++)
+    {
+        WriteFrames(&ring, &next, 7);
+
+        STK_CHECK(STKRingBufferUsedFrameCount(&ring) == 7, "used %u", STKRingBufferUsedFrameCount(&ring));
+        STK_CHECK(STKRingBufferFreeFrameCount(&ring) == 3, "free %u", STKRingBufferFreeFrameCount(&ring));
+        STK_CHECK(STKRingBufferRead(&ring, destinations, 7) == 7, "read");
+
+        for (int i = 0; i < 7; i++)
+        {
+            STK_CHECK(frames[i].value == expected && frames[i].check == ~expected, "frame %u", expected);
+            expected++;
+        }
+    }
+
+    // Regions never run past the end of the storage
+
+    void* region;
+
+    WriteFrames(&ring, &next, 5);
+
+    uint32_t contiguous = STKRingBufferBeginWrite(&ring, &region);
+    uint32_t offset = (uint32_t)(((uint8_t*)region - ring.buffer) / sizeof(Frame));
+
+    STK_CHECK(offset + contiguous <= ring.frameCount, "region %u + %u", offset, contiguous);
+
+    STKRingBufferDestroy(&ring);
+}
+
+static void TestPlanes(void)
+{
+    STKRingBuffer ring;
+    int16_t left[32];
+    int16_t right[32];
+    void* destinations[] = { left, right };
+
+    STK_CHECK(STKRingBufferInit(&ring, 24, sizeof(int16_t), 2), "init");
+
+    for (int16_t base = 0; base < 1000; base += 20)
+    {
+        int16_t written = 0;
+
+        while (written < 20)
+        {
+            void* region;
+            uint32_t available = STKRingBufferBeginWrite(&ring, &region);
+            uint32_t n = available < (uint32_t)(20 - written) ? available : (uint32_t)(20 - written);
+            int16_t* plane0 = region;
+            int16_t* plane1 = (int16_t*)((uint8_t*)region + STKRingBufferPlaneStride(&ring));
+
+            for (uint32_t i = 0; i < n; i++)
+            {
+                plane0[i] = base + written + (int16_t)i;
+                plane1[i] = -(base + written + (int16_t)i);
+            }
+
+            STKRingBufferEndWrite(&ring, n);
+
+            written += (int16_t)n;
+        }
+
+        STK_CHECK(STKRingBufferRead(&ring, destinations, 32) == 20, "read");
+
+        for (int16_t i = 0; i < 20; i++)
+        {
+            STK_CHECK(left[i] == base + i && right[i] == -(base + i), "plane sample %d", base + i);
+        }
+    }
+
+    STKRingBufferDestroy(&ring);
+}
+
+static void TestPeek(void)
+{
+    STKRingBuffer ring;
+    uint32_t next = 0;
+    Frame frames[8];
+    void* destinations[] = { frames };
+
+    STK_CHECK(STKRingBufferInit(&ring, 16, sizeof(Frame), 1), "init");
+
+    WriteFrames(&ring, &next, 12);
+    STK_CHECK(STKRingBufferRead(&ring, NULL, 10) == 10, "discard");
+    WriteFrames(&ring, &next, 10);
+
+    // Peeking across the wrap doesn't release anything
+
+    STK_CHECK(STKRingBufferPeek(&ring, 3, destinations, 8) == 8, "peek");
+
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        STK_CHECK(frames[i].value == 13 + i, "peeked %u", frames[i].value);
+    }
+
+    STK_CHECK(STKRingBufferUsedFrameCount(&ring) == 12, "used after peek");
+    STK_CHECK(STKRingBufferPeek(&ring, 12, destinations, 8) == 0, "peek past the end");
+
+    STKRingBufferDestroy(&ring);
+}
+
+static void TestFlush(void)
+{
+    STKRingBuffer ring;
+    uint32_t next = 0;
+    Frame frames[16];
+    void* destinations[] = { frames };
+
+    STK_CHECK(STKRingBufferInit(&ring, 16, sizeof(Frame), 1), "init");
+
+    WriteFrames(&ring, &next, 16);
+    STKRingBufferFlush(&ring);
+
+    // The consumer sees nothing but the space isn't handed back until it has skipped the flushed frames
+
+    STK_CHECK(STKRingBufferUsedFrameCount(&ring) == 0, "used after flush");
+    STK_CHECK(STKRingBufferFreeFrameCount(&ring) == 0, "free before the consumer reads");
+
+    STK_CHECK(STKRingBufferRead(&ring, destinations, 16) == 0, "read after flush");
+    STK_CHECK(STKRingBufferFreeFrameCount(&ring) == 16, "free after the consumer reads");
+
+    WriteFrames(&ring, &next, 4);
+    STK_CHECK(STKRingBufferRead(&ring, destinations, 16) == 4 && frames[0].value == 16, "frames after flush");
+
+    // Reset frees the space straight away
+
+    WriteFrames(&ring, &next, 10);
+    STKRingBufferReset(&ring);
+    STK_CHECK(STKRingBufferFreeFrameCount(&ring) == 16, "free after reset");
+    STK_CHECK(STKRingBufferUsedFrameCount(&ring) == 0, "used after reset");
+
+    STKRingBufferDestroy(&ring);
+}
+
+static void TestFlushFullBufferWithoutReading(void)
+{
+    STKRingBuffer ring;
+    uint32_t next = 0;
+    void* region;
+
+    STK_CHECK(STKRingBufferInit(&ring, 16, sizeof(Frame), 1), "init");
+
+    // A consumer that only reads when frames are used never reads a flushed full buffer so it has to sync instead
+
+    STK_CHECK(!STKRingBufferSyncConsumer(&ring), "sync with nothing flushed");
+
+    WriteFrames(&ring, &next, 16);
+    STKRingBufferFlush(&ring);
+
+    STK_CHECK(STKRingBufferUsedFrameCount(&ring) == 0, "used after flush");
+    STK_CHECK(STKRingBufferBeginWrite(&ring, &region) == 0, "space before the consumer synced");
+
+    STK_CHECK(STKRingBufferSyncConsumer(&ring), "sync after flush");
+    STK_CHECK(!STKRingBufferSyncConsumer(&ring), "sync twice");
+    STK_CHECK(STKRingBufferBeginWrite(&ring, &region) == 16, "space after the consumer synced");
+
+    // Frames written after the flush are left for the consumer
+
+    WriteFrames(&ring, &next, 6);
+    STK_CHECK(!STKRingBufferSyncConsumer(&ring), "sync with frames after the flush");
+    STK_CHECK(STKRingBufferUsedFrameCount(&ring) == 6, "used after sync");
+
+    STKRingBufferDestroy(&ring);
+}
+
+typedef struct
+{
+    STKRingBuffer* ring;
+    uint32_t frameCount;
+    volatile int written;
+}
+BlockedProducerContext;
+
+static void* BlockedProducer(void* argument)
+{
+    BlockedProducerContext* context = argument;
+    uint32_t next = 0;
+
+    // Waits for space as the decode thread does
+
+    while (next < context->frameCount)
+    {
+        if (STKRingBufferFreeFrameCount(context->ring) == 0)
+        {
+            sched_yield();
+
+            continue;
+        }
+
+        WriteFrames(context->ring, &next, 1);
+    }
+
+    __atomic_store_n(&context->written, 1, __ATOMIC_RELEASE);
+
+    return NULL;
+}
+
+static void TestFlushFullBufferWithBlockedProducer(void)
+{
+    STKRingBuffer ring;
+    pthread_t producer;
+
+    STK_CHECK(STKRingBufferInit(&ring, 64, sizeof(Frame), 1), "init");
+
+    BlockedProducerContext context = { .ring = &ring, .frameCount = 64 + 32 };
+    uint32_t next = 0;
+
+    WriteFrames(&ring, &next, 64);
+    pthread_create(&producer, NULL, BlockedProducer, &context);
+
+    // Seeking flushes the full buffer the producer is waiting on
+
+    STKRingBufferFlush(&ring);
+
+    double start = STKTestSeconds();
+
+    // Renders as RenderFrames does, only reading when frames are used
+
+    while (!__atomic_load_n(&context.written, __ATOMIC_ACQUIRE) && STKTestSeconds() - start < 5)
+    {
+        STKRingBufferSyncConsumer(&ring);
+
+        if (STKRingBufferUsedFrameCount(&ring) == 0)
+        {
+            sched_yield();
+
+            continue;
+        }
+
+        Frame frames[8];
+        void* destinations[] = { frames };
+
+        STKRingBufferRead(&ring, destinations, 8);
+    }
+
+    STK_CHECK(__atomic_load_n(&context.written, __ATOMIC_ACQUIRE), "the producer stayed blocked on a flushed full buffer");
+
+    pthread_join(producer, NULL);
+    STKRingBufferDestroy(&ring);
+}
+
+static void TestFlushWhileReading(void)
+{
+    STKRingBuffer ring;
+    uint32_t next = 0;
+
+    STK_CHECK(STKRingBufferInit(&ring, 16, sizeof(Frame), 1), "init");
+
+    WriteFrames(&ring, &next, 16);
+
+    // A flush from another thread lands while the consumer is still copying out of its region
+
+    const void* readRegion;
+    uint32_t reading = STKRingBufferBeginRead(&ring, &readRegion);
+
+    STK_CHECK(reading == 16, "reading %u", reading);
+
+    STKRingBufferFlush(&ring);
+
+    void* writeRegion;
+
+    STK_CHECK(STKRingBufferBeginWrite(&ring, &writeRegion) == 0, "the producer was handed frames still being read");
+
+    STKRingBufferEndRead(&ring, reading);
+
+    STK_CHECK(STKRingBufferBeginWrite(&ring, &writeRegion) == 16, "space after the read finished");
+
+    STKRingBufferDestroy(&ring);
+}
+
+typedef struct
+{
+    STKRingBuffer* ring;
+    uint32_t frameCount;
+    volatile int done;
+}
+StressContext;
+
+static void* Producer(void* argument)
+{
+    StressContext* context = argument;
+    uint32_t next = 0;
+
+    while (next < context->frameCount)
+    {
+        void* region;
+        uint32_t available = STKRingBufferBeginWrite(context->ring, &region);
+
+        if (available == 0)
+        {
+            sched_yield();
+
+            continue;
+        }
+
+        uint32_t n = available < context->frameCount - next ? available : context->frameCount - next;
+        Frame* frames = region;
+
+        for (uint32_t i = 0; i < n; i++)
+        {
+            frames[i].value = next + i;
+            frames[i].check = ~(next + i);
+        }
+
+        STKRingBufferEndWrite(context->ring, n);
+
+        next += n;
+    }
+
+    __atomic_store_n(&context->done, 1, __ATOMIC_RELEASE);
+
+    return NULL;
+}
+
+static void* Flusher(void* argument)
+{
+    StressContext* context = argument;
+    struct timespec pause = { 0, 50 * 1000 };
+
+    while (!__atomic_load_n(&context->done, __ATOMIC_ACQUIRE))
+    {
+        STKRingBufferFlush(context->ring);
+        nanosleep(&pause, NULL);
+    }
+
+    return NULL;
+}
+
+/// Runs a producer against the calling thread as the consumer (and optionally a thread flushing) and checks every
+/// frame read is whole and comes after the one before it. Returns the frames read per second
+static double Stress(uint32_t frameCount, int flushing)
+{
+    STKRingBuffer ring;
+    StressContext context = { &ring, frameCount, 0 };
+    pthread_t producer;
+    pthread_t flusher;
+    Frame frames[512];
+    void* destinations[] = { frames };
+    uint32_t random = 1;
+    uint64_t framesRead = 0;
+    int64_t last = -1;
+
+    STK_CHECK(STKRingBufferInit(&ring, 64 * 1024, sizeof(Frame), 1), "init");
+
+    double start = STKTestSeconds();
+
+    pthread_create(&producer, NULL, Producer, &context);
+
+    if (flushing)
+    {
+        pthread_create(&flusher, NULL, Flusher, &context);
+    }
+
+    while (true)
+    {
+        int done = __atomic_load_n(&context.done, __ATOMIC_ACQUIRE);
+        uint32_t n = STKRingBufferRead(&ring, destinations, STKTestRandom(&random) % 512 + 1);
+
+        for (uint32_t i = 0; i < n; i++)
+        {
+            STK_CHECK(frames[i].check == ~frames[i].value, "torn frame %u", frames[i].value);
+            STK_CHECK((int64_t)frames[i].value > last, "frame %u after %lld", frames[i].value, (long long)last);
+            STK_CHECK(flushing || (int64_t)frames[i].value == last + 1, "frame %u after %lld", frames[i].value, (long long)last);
+
+            last = frames[i].value;
+        }
+
+        framesRead += n;
+
+        if (n == 0)
+        {
+            if (done && STKRingBufferUsedFrameCount(&ring) == 0)
+            {
+                break;
+            }
+
+            sched_yield();
+        }
+    }
+
+    double elapsed = STKTestSeconds() - start;
+
+    pthread_join(producer, NULL);
+
+    if (flushing)
+    {
+        pthread_join(flusher, NULL);
+    }
+
+    STK_CHECK(flushing || framesRead == frameCount, "read %llu of %u", (unsigned long long)framesRead, frameCount);
+
+    STKRingBufferDestroy(&ring);
+
+    return framesRead / elapsed;
+}
+
+static void TestStress(void)
+{
+    Stress(5 * 1000 * 1000, 0);
+}
+
+static void TestStressWithFlushes(void)
+{
+    Stress(5 * 1000 * 1000, 1);
+}
+
+int main(int argc, char** argv)
+{
+    if (STKTestIsBenchmark(argc, argv))
+    {
+        printf("SPSC throughput: %.1f Mframes/s\n", Stress(50 * 1000 * 1000, 0) / 1e6);
+
+        return 0;
+    }
+
+    STK_RUN_TEST(TestWrapAround);
+    STK_RUN_TEST(TestPlanes);
+    STK_RUN_TEST(TestPeek);
+    STK_RUN_TEST(TestFlush);
+    STK_RUN_TEST(TestFlushWhileReading);
+    STK_RUN_TEST(TestFlushFullBufferWithoutReading);
+    STK_RUN_TEST(TestFlushFullBufferWithBlockedProducer);
+    STK_RUN_TEST(TestStress);
+    STK_RUN_TEST(TestStressWithFlushes);
+
+    return 0;
+}
@@ -0,0 +1,467 @@
+//
+//  STKSeekTableTests.c
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#include "STKSeekTable.h"
+#include "STKTest.h"
+
+/// MPEG1 Layer III, 128kbps, 44.1kHz, stereo without padding
+#define FRAME_LENGTH (417)
+#define FRAME_COUNT (40)
+#define TAG_SIZE (300)
+
+static void WriteBigEndian(uint8_t* bytes, uint32_t value, uint32_t size)
+{
+    for (uint32_t i = 0; i < size; i++)
+    {
+        bytes[i] = (uint8_t)(value >> ((size - 1 - i) * 8));
+    }
+}
+
+/// Writes an ID3v2 tag of tagSize bytes (0 for none) followed by frameCount frames. Returns the offset of the first frame
+static uint32_t WriteStream(uint8_t* bytes, uint32_t tagSize, uint32_t frameCount)
+{
+    uint32_t position = 0;
+
+    if (tagSize > 0)
+    {
+        uint32_t size = tagSize - 10;
+
+        memset(bytes, 0, tagSize);
+        memcpy(bytes, "ID3", 3);
+
+        bytes[3] = 3;
+        bytes[6] = (size >> 21) & 0x7f;
+        bytes[7] = (size >> 14) & 0x7f;
+        bytes[8] = (size >> 7) & 0x7f;
+        bytes[9] = size & 0x7f;
+
+        // Tag data that looks like a chain of frames so a scan that doesn't skip the tag finds it
+
+        for (uint32_t i = 16; i + 4 <= tagSize; i += 8)
+        {
+            bytes[i] = 0xff;
+            bytes[i + 1] = 0xfb;
+            bytes[i + 2] = 0x10;
+            bytes[i + 3] = 0x00;
+        }
+
+        position = tagSize;
+    }
+
+    for (uint32_t i = 0; i < frameCount; i++)
+    {
+        uint8_t* frame = bytes + position + i * FRAME_LENGTH;
+
+        memset(frame, 0, FRAME_LENGTH);
+
+        frame[0] = 0xff;
+        frame[1] = 0xfb;
+        frame[2] = 0x90;
+        frame[3] = 0x00;
+    }
+
+    return position;
+}
+
+/// Writes a Xing header with a frame count, byte count and a table of contents where percent i is at byte i * 2 / 256
+static void WriteXingHeader(uint8_t* frame, uint32_t frameCount, uint32_t byteCount)
+{
+    memcpy(frame + 36, "Xing", 4);
+    WriteBigEndian(frame + 40, byteCount > 0 ? 7 : 5, 4);
+    WriteBigEndian(frame + 44, frameCount, 4);
+
+    uint8_t* toc = frame + (byteCount > 0 ? 52 : 48);
+
+    if (byteCount > 0)
+    {
+        WriteBigEndian(frame + 48, byteCount, 4);
+    }
+
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        toc[i] = (uint8_t)(i * 2);
+    }
+}
+
+/// Feeds bytes to the scanner in reads of readSize bytes
+static void ScanInReads(STKSeekTable* table, const uint8_t* bytes, uint32_t length, uint32_t readSize)
+{
+    for (uint32_t offset = 0; offset < length && !table->headerScanned; offset += readSize)
+    {
+        uint32_t size = offset + readSize > length ? length - offset : readSize;
+
+        STKSeekTableScanHeader(table, bytes + offset, size, offset);
+    }
+}
+
+static void TestHeaderSplitAcrossReads(void)
+{
+    static uint8_t bytes[TAG_SIZE + FRAME_LENGTH * FRAME_COUNT];
+    uint32_t frameOffset = WriteStream(bytes, TAG_SIZE, FRAME_COUNT);
+
+    WriteXingHeader(bytes + frameOffset, 1000, 400000);
+
+    // Every read size from byte at a time to more than the scan buffer holds
+
+    for (uint32_t readSize = 1; readSize <= 3000; readSize += readSize < 20 ? 1 : 37)
+    {
+        STKSeekTable table;
+
+        STKSeekTableInit(&table, 16);
+        ScanInReads(&table, bytes, sizeof(bytes), readSize);
+
+        STK_CHECK(table.headerScanned && table.headerFound, "read size %u", readSize);
+        STK_CHECK(table.headerFrameOffset == frameOffset, "read size %u: frame at %llu", readSize, (unsigned long long)table.headerFrameOffset);
+        STK_CHECK(table.headerFrameLength == FRAME_LENGTH, "read size %u: frame length %u", readSize, table.headerFrameLength);
+        STK_CHECK(STKSeekTableHeaderFrameCount(&table) == 1000, "read size %u: frame count", readSize);
+        STK_CHECK(table.headerByteCount == 400000 && table.hasXingToc, "read size %u: byte count and toc", readSize);
+        STK_CHECK(table.scanBuffer == NULL, "read size %u: scan buffer kept", readSize);
+
+        double duration = STKSeekTableHeaderDuration(&table);
+
+        STK_CHECK(duration > 26.12 && duration < 26.13, "read size %u: duration %f", readSize, duration);
+
+        STKSeekTableDestroy(&table);
+    }
+}
+
+static void TestId3Skip(void)
+{
+    static uint8_t bytes[4096 + FRAME_LENGTH * FRAME_COUNT];
+    STKSeekTable table;
+
+    // The tag holds what looks like frames so the header is only found if the tag is skipped
+
+    uint32_t frameOffset = WriteStream(bytes, 4096, FRAME_COUNT);
+
+    WriteXingHeader(bytes + frameOffset, 500, 200000);
+
+    STKSeekTableInit(&table, 16);
+    ScanInReads(&table, bytes, sizeof(bytes), 1000);
+
+    STK_CHECK(table.headerFound && table.headerFrameOffset == 4096, "frame at %llu", (unsigned long long)table.headerFrameOffset);
+    STK_CHECK(STKSeekTableHeaderFrameCount(&table) == 500, "frame count");
+
+    STKSeekTableSetCursorAtStart(&table, frameOffset);
+
+    STK_CHECK(table.cursorPacket == 0 && table.cursorOffset == FRAME_LENGTH, "cursor after the header frame");
+
+    STKSeekTableDestroy(&table);
+
+    // A footer adds 10 bytes to the tag
+
+    bytes[5] = 0x10;
+    memmove(bytes + 4096 + 10, bytes + 4096, sizeof(bytes) - 4096 - 10);
+
+    STKSeekTableInit(&table, 16);
+    ScanInReads(&table, bytes, sizeof(bytes), 1000);
+
+    STK_CHECK(table.headerFound && table.headerFrameOffset == 4096 + 10, "frame after footer at %llu", (unsigned long long)table.headerFrameOffset);
+
+    // The cursor only skips the header frame if it's the first frame of the audio data
+
+    STKSeekTableSetCursorAtStart(&table, 0);
+
+    STK_CHECK(table.cursorPacket == 0 && table.cursorOffset == 0, "cursor with audio data elsewhere");
+
+    STKSeekTableDestroy(&table);
+}
+
+static void TestXingEstimate(void)
+{
+    static uint8_t bytes[TAG_SIZE + FRAME_LENGTH * FRAME_COUNT];
+    STKSeekTable table;
+    uint64_t offset;
+
+    uint32_t frameOffset = WriteStream(bytes, TAG_SIZE, FRAME_COUNT);
+
+    WriteXingHeader(bytes + frameOffset, 1000, 400000);
+
+    STKSeekTableInit(&table, 16);
+
+    STK_CHECK(!STKSeekTableEstimateOffset(&table, 0.5, 0, &offset), "estimate before the header was scanned");
+
+    ScanInReads(&table, bytes, sizeof(bytes), sizeof(bytes));
+
+    STK_CHECK(STKSeekTableEstimateOffset(&table, 0, 0, &offset) && offset == frameOffset, "start %llu", (unsigned long long)offset);
+    STK_CHECK(STKSeekTableEstimateOffset(&table, 0.5, 0, &offset) && offset == frameOffset + (uint64_t)(100.0 / 256 * 400000), "middle %llu", (unsigned long long)offset);
+
+    // Between entries the offset is interpolated and past the last entry it runs to the end of the table (256)
+
+    STK_CHECK(STKSeekTableEstimateOffset(&table, 0.255, 0, &offset) && offset == frameOffset + (uint64_t)(51.0 / 256 * 400000), "between entries %llu", (unsigned long long)offset);
+    STK_CHECK(STKSeekTableEstimateOffset(&table, 0.995, 0, &offset) && offset == frameOffset + (uint64_t)(227.0 / 256 * 400000), "last entry %llu", (unsigned long long)offset);
+    STK_CHECK(STKSeekTableEstimateOffset(&table, 2, 0, &offset) && offset == frameOffset + 400000, "clamped %llu", (unsigned long long)offset);
+
+    STKSeekTableDestroy(&table);
+
+    // Without a byte count the stream length is used
+
+    WriteStream(bytes, TAG_SIZE, FRAME_COUNT);
+    WriteXingHeader(bytes + frameOffset, 1000, 0);
+
+    STKSeekTableInit(&table, 16);
+    ScanInReads(&table, bytes, sizeof(bytes), sizeof(bytes));
+
+    STK_CHECK(table.headerFound && table.hasXingToc && table.headerByteCount == 0, "header without byte count");
+    STK_CHECK(!STKSeekTableEstimateOffset(&table, 0.5, 0, &offset), "estimate without any length");
+    STK_CHECK(STKSeekTableEstimateOffset(&table, 0.5, frameOffset + 256000, &offset) && offset == frameOffset + 100000, "stream length %llu", (unsigned long long)offset);
+
+    STKSeekTableDestroy(&table);
+}
+
+static void TestVbriEstimate(void)
+{
+    static uint8_t bytes[FRAME_LENGTH * FRAME_COUNT];
+    STKSeekTable table;
+    uint64_t offset;
+
+    WriteStream(bytes, 0, FRAME_COUNT);
+
+    // 10 entries of 2 bytes, each 100 frames and 1000 * 4 bytes long apart from the last which is twice that
+
+    uint8_t* vbri = bytes + 36;
+
+    memcpy(vbri, "VBRI", 4);
+    WriteBigEndian(vbri + 10, 44000, 4);
+    WriteBigEndian(vbri + 14, 1000, 4);
+    WriteBigEndian(vbri + 18, 10, 2);
+    WriteBigEndian(vbri + 20, 4, 2);
+    WriteBigEndian(vbri + 22, 2, 2);
+    WriteBigEndian(vbri + 24, 100, 2);
+
+    for (uint32_t i = 0; i < 10; i++)
+    {
+        WriteBigEndian(vbri + 26 + i * 2, i == 9 ? 2000 : 1000, 2);
+    }
+
+    STKSeekTableInit(&table, 16);
+    ScanInReads(&table, bytes, sizeof(bytes), 100);
+
+    STK_CHECK(table.headerFound && !table.hasXingToc && table.vbriTocCount == 11, "toc count %u", table.vbriTocCount);
+    STK_CHECK(STKSeekTableHeaderFrameCount(&table) == 1000 && table.headerByteCount == 44000, "frame and byte count");
+
+    STK_CHECK(STKSeekTableEstimateOffset(&table, 0, 0, &offset) && offset == 0, "start %llu", (unsigned long long)offset);
+    STK_CHECK(STKSeekTableEstimateOffset(&table, 0.25, 0, &offset) && offset == 10000, "quarter %llu", (unsigned long long)offset);
+    STK_CHECK(STKSeekTableEstimateOffset(&table, 0.95, 0, &offset) && offset == 40000, "last segment %llu", (unsigned long long)offset);
+    STK_CHECK(STKSeekTableEstimateOffset(&table, 1, 0, &offset) && offset == 44000, "end %llu", (unsigned long long)offset);
+
+    STKSeekTableDestroy(&table);
+}
+
+static void TestNoHeader(void)
+{
+    static uint8_t bytes[FRAME_LENGTH * FRAME_COUNT];
+    STKSeekTable table;
+    uint64_t offset;
+    uint32_t random = 1;
+
+    // Frames without a Xing/VBRI header
+
+    WriteStream(bytes, 0, FRAME_COUNT);
+
+    STKSeekTableInit(&table, 16);
+    ScanInReads(&table, bytes, sizeof(bytes), 512);
+
+    STK_CHECK(table.headerScanned && !table.headerFound, "plain frames");
+    STK_CHECK(STKSeekTableHeaderFrameCount(&table) == 0 && STKSeekTableHeaderDuration(&table) == 0, "frame count");
+    STK_CHECK(!STKSeekTableEstimateOffset(&table, 0.5, sizeof(bytes), &offset), "estimate");
+
+    STKSeekTableDestroy(&table);
+
+    // Bytes that aren't MPEG at all stop the scan once the scan buffer is full
+
+    for (uint32_t i = 0; i < sizeof(bytes); i++)
+    {
+        bytes[i] = (uint8_t)STKTestRandom(&random) & 0x7f;
+    }
+
+    STKSeekTableInit(&table, 16);
+    ScanInReads(&table, bytes, sizeof(bytes), 512);
+
+    STK_CHECK(table.headerScanned && !table.headerFound && table.scanBuffer == NULL, "noise");
+
+    STKSeekTableDestroy(&table);
+
+    // A read that doesn't follow the last one (a seek) ends the scan
+
+    WriteStream(bytes, TAG_SIZE, FRAME_COUNT);
+    WriteXingHeader(bytes + TAG_SIZE, 1000, 400000);
+
+    STKSeekTableInit(&table, 16);
+    STKSeekTableScanHeader(&table, bytes, 200, 0);
+    STKSeekTableScanHeader(&table, bytes + 1000, 200, 1000);
+
+    STK_CHECK(table.headerScanned && !table.headerFound, "scan after a seek");
+
+    STKSeekTableDestroy(&table);
+}
+
+static void TestCursorGaps(void)
+{
+    STKSeekTable table;
+    uint64_t expected[1000];
+    uint64_t offset = 0;
+    uint64_t packet;
+    uint64_t byteOffset;
+
+    STKSeekTableInit(&table, 16);
+    STKSeekTableSetCursorAtStart(&table, 0);
+
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        uint32_t size = 400 + i % 7;
+
+        expected[i] = offset;
+        STKSeekTableAddPacket(&table, size);
+        offset += size;
+    }
+
+    STK_CHECK(table.count == 63, "count %u", table.count);
+
+    for (uint64_t i = 0; i < 1000; i++)
+    {
+        STK_CHECK(STKSeekTableLookup(&table, i, &packet, &byteOffset), "lookup %llu", (unsigned long long)i);
+        STK_CHECK(packet == i / 16 * 16 && byteOffset == expected[packet], "packet %llu at %llu", (unsigned long long)packet, (unsigned long long)byteOffset);
+    }
+
+    STK_CHECK(!STKSeekTableLookup(&table, 1008, &packet, &byteOffset), "lookup past the recorded range");
+
+    // Nothing is recorded while the position is unknown (after an estimated seek)
+
+    STKSeekTableSetCursor(&table, -1, 0);
+    STKSeekTableAddPacket(&table, 400);
+
+    STK_CHECK(table.count == 63, "recorded with an unknown position");
+
+    // Nor from a known position that leaves a gap after the recorded range
+
+    STKSeekTableSetCursor(&table, 2000, 800000);
+
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        STKSeekTableAddPacket(&table, 400);
+    }
+
+    STK_CHECK(table.count == 63 && !STKSeekTableLookup(&table, 2000, &packet, &byteOffset), "recorded after a gap");
+
+    // A position inside the recorded range extends it once parsing gets past the end
+
+    STKSeekTableSetCursor(&table, 992, expected[992]);
+
+    for (uint32_t i = 992; i < 1000; i++)
+    {
+        STKSeekTableAddPacket(&table, 400 + i % 7);
+    }
+
+    STKSeekTableAddPacket(&table, 400);
+
+    STK_CHECK(table.count == 63, "count before the next interval %u", table.count);
+
+    for (uint32_t i = 1001; i <= 1008; i++)
+    {
+        STKSeekTableAddPacket(&table, 400);
+    }
+
+    STK_CHECK(table.count == 64, "count after extending %u", table.count);
+    STK_CHECK(STKSeekTableLookup(&table, 1010, &packet, &byteOffset) && packet == 1008 && byteOffset == offset + 400 * 8, "extended lookup at %llu", (unsigned long long)byteOffset);
+
+    STKSeekTableDestroy(&table);
+}
+
+static void TestSerialization(void)
+{
+    STKSeekTable table;
+    STKSeekTable copy;
+    uint8_t buffer[1024];
+
+    STKSeekTableInit(&table, 16);
+    STKSeekTableSetCursor(&table, 0, 0);
+
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        STKSeekTableAddPacket(&table, 417);
+    }
+
+    size_t size = STKSeekTableSerializedSize(&table);
+
+    STK_CHECK(size <= sizeof(buffer), "serialized size %zu", size);
+
+    STKSeekTableSerialize(&table, buffer);
+
+    STKSeekTableInit(&copy, 16);
+
+    STK_CHECK(STKSeekTableDeserialize(&copy, buffer, size), "deserialize");
+    STK_CHECK(copy.count == table.count && memcmp(copy.offsets, table.offsets, table.count * sizeof(uint32_t)) == 0, "copied offsets");
+
+    // A table that already records as much is left alone
+
+    copy.offsets[0] = 1;
+
+    STK_CHECK(STKSeekTableDeserialize(&copy, buffer, size) && copy.offsets[0] == 1, "replaced a table as long");
+
+    STKSeekTableDestroy(&copy);
+
+    // Bad input is rejected and leaves the table empty
+
+    STKSeekTableInit(&copy, 16);
+
+    STK_CHECK(!STKSeekTableDeserialize(&copy, buffer, 8), "short header");
+    STK_CHECK(!STKSeekTableDeserialize(&copy, buffer, size - 1), "truncated");
+    STK_CHECK(!STKSeekTableDeserialize(&copy, buffer, size + 4), "trailing bytes");
+
+    STKSeekTableDestroy(&copy);
+    STKSeekTableInit(&copy, 8);
+
+    STK_CHECK(!STKSeekTableDeserialize(&copy, buffer, size), "different packet interval");
+
+    STKSeekTableDestroy(&copy);
+    STKSeekTableInit(&copy, 16);
+
+    uint32_t word;
+
+    // Offsets that go backwards
+
+    memcpy(&word, buffer + 16 + 10 * sizeof(uint32_t), sizeof(word));
+    word = 0;
+    memcpy(buffer + 16 + 10 * sizeof(uint32_t), &word, sizeof(word));
+
+    STK_CHECK(!STKSeekTableDeserialize(&copy, buffer, size), "decreasing offsets");
+
+    // A count that doesn't match the length
+
+    STKSeekTableSerialize(&table, buffer);
+    memcpy(&word, buffer + 8, sizeof(word));
+    word += 1;
+    memcpy(buffer + 8, &word, sizeof(word));
+
+    STK_CHECK(!STKSeekTableDeserialize(&copy, buffer, size), "count past the end");
+
+    STKSeekTableSerialize(&table, buffer);
+    buffer[0] ^= 0xff;
+
+    STK_CHECK(!STKSeekTableDeserialize(&copy, buffer, size), "bad magic");
+    STK_CHECK(copy.count == 0 && copy.offsets == NULL, "table changed by bad input");
+
+    STKSeekTableDestroy(&copy);
+    STKSeekTableDestroy(&table);
+}
+
+int main(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    STK_RUN_TEST(TestHeaderSplitAcrossReads);
+    STK_RUN_TEST(TestId3Skip);
+    STK_RUN_TEST(TestXingEstimate);
+    STK_RUN_TEST(TestVbriEstimate);
+    STK_RUN_TEST(TestNoHeader);
+    STK_RUN_TEST(TestCursorGaps);
+    STK_RUN_TEST(TestSerialization);
+
+    return 0;
+}
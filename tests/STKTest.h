@@ -0,0 +1,82 @@
+//
+//  STKTest.h
+//  StreamingKit
+//
+//  Copyright (c) 2026 Thong Nguyen. All rights reserved.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+///
+/// Minimal test harness for the portable C cores. Each test program runs its tests when started without arguments
+/// and its benchmarks when started with "bench". A failed check prints where it failed and exits with a failure.
+///
+
+#define STK_CHECK(condition, ...) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            fprintf(stderr, "%s:%d: check failed: %s: ", __FILE__, __LINE__, #condition); \
+            fprintf(stderr, __VA_ARGS__); \
+            fprintf(stderr, "\n"); \
+            exit(1); \
+        } \
+    } \
+    while (0)
+
+#define STK_RUN_TEST(test) \
+    do \
+    { \
+        test(); \
+        printf("passed %s\n", #test); \
+    } \
+    while (0)
+
+static inline int STKTestIsBenchmark(int argc, char** argv)
+{
+    return argc > 1 && strcmp(argv[1], "bench") == 0;
+}
+
+/// Monotonic time in seconds
+static inline double STKTestSeconds(void)
+{
+    struct timespec time;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+/// Deterministic xorshift random numbers so failures can be reproduced
+static inline uint32_t STKTestRandom(uint32_t* state)
+{
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    return *state = x;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+
+/// Processor cycles (time stamp counter) where there is one, otherwise nanoseconds
+static inline unsigned long long STKTestCycles(void)
+{
+    return __rdtsc();
+}
+#else
+static inline unsigned long long STKTestCycles(void)
+{
+    return (unsigned long long)(STKTestSeconds() * 1e9);
+}
+#endif